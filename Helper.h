@@ -10,6 +10,9 @@
 ///////////////////////////////////////////////////////////////////////////////
 
 #include "Rtypes.h"
+#include "THaApparatus.h"
+#include "THaGlobals.h"
+#include "TList.h"
 #include <vector>
 #include <algorithm>
 
@@ -81,6 +84,39 @@ void ResetVector(std::vector<std::vector<T> > &vec, T val = 0,
   }
 }
 
+//___________________________________________________________________________
+// Binding of collaborating apparatuses/detectors. These do a list search
+// and a dynamic_cast, so modules should call them once (in Init or Begin)
+// and keep the typed pointers, rather than searching gHaApps every event.
+//
+// Apparatus "name" in gHaApps as a T*, or nullptr if there is no such
+// apparatus or it is not a T:
+template<class T>
+T* FindApparatus( const char* name ) {
+  if( !gHaApps || !name ) return nullptr;
+  return dynamic_cast<T*>( gHaApps->FindObject(name) );
+}
+
+//___________________________________________________________________________
+// First apparatus of type T in gHaApps, regardless of name:
+template<class T>
+T* FindApparatus() {
+  if( !gHaApps ) return nullptr;
+  TIter next(gHaApps);
+  while( TObject* obj = next() ) {
+    if( T* app = dynamic_cast<T*>(obj) ) return app;
+  }
+  return nullptr;
+}
+
+//___________________________________________________________________________
+// Detector "name" of apparatus "app" as a T*, or nullptr:
+template<class T>
+T* FindDetector( THaApparatus* app, const char* name ) {
+  if( !app || !name ) return nullptr;
+  return dynamic_cast<T*>( app->GetDetector(name) );
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 
 #endif
@@ -40,6 +40,7 @@
 #include <map>
 #include <set>
 #include <iostream>
+#include <algorithm>
 
 using namespace std;
 
@@ -50,6 +51,7 @@ namespace Decoder {
 
   MPDModule::MPDModule(Int_t crate, Int_t slot) : VmeModule(crate, slot) {
     fDebugFile=nullptr;
+    fFrameBuffer=nullptr;
     Init(); //Should this be called here? not clear...
     
   }
@@ -87,7 +89,17 @@ namespace Decoder {
     fChan_TimeStamp_high = 642;
     fChan_MPD_EventCount = 643;
     fChan_MPD_Debug = 644;
+
+    fFrameViewOnly = 0;
+
+    //fiber number is 6 bits, APV ID is 5 bits, and effective channel = fiber << 4 | apv_id:
+    fFrameStripOffsets.resize( 1024 );
+    fFrameTimeStampLow.resize( 64 );
+    fFrameTimeStampHigh.resize( 64 );
+    fFrameEventCount.resize( 64 );
+    fFrameFiberFound.assign( 64, false );
     
+    ClearFrameView();
   }
 
   void MPDModule::Init( const char *configstr ) { //parse (optional) configuration parameters:
@@ -97,7 +109,8 @@ namespace Decoder {
 				 {"chan_timestamp_low", fChan_TimeStamp_low},
 				 {"chan_timestamp_high", fChan_TimeStamp_high},
 				 {"chan_event_count", fChan_MPD_EventCount},
-				 {"chan_MPD_debug", fChan_MPD_Debug} };
+				 {"chan_MPD_debug", fChan_MPD_Debug},
+				 {"frameview_only", fFrameViewOnly} };
     ParseConfigStr(configstr, req);
 
     assert( fChan_CM_flags < THaCrateMap::MAXCHAN );
@@ -123,6 +136,10 @@ namespace Decoder {
 
     UInt_t iword=0;
 
+    //Reset the frame view; strip record offsets are stored relative to datawords:
+    ClearFrameView();
+    fFrameBuffer = datawords;
+    
     //Get the slot number for this call to LoadSlot:
     UInt_t this_slot = sldat->getSlot();
     //UInt_t this_crate = sldat->getCrate();
@@ -278,49 +295,44 @@ namespace Decoder {
 	  //this should take care of the issue of missing the last "hit":
 	  if( mpd_word_count%3 == 0 && mpd_strip_count > 0 ){ //extract information from the three "hit words" and "load" the data into the "slot":
 
-	    // load up the ADC samples:
-	    for( int iw=0; iw<3; iw++ ){
-	      
-	      // In words: take the bitwise OR of the first 12 bits of hitwords[iw] with 0xFFFFF000 or 0x0
-	      // depending on the value of bit 12 (13th bit) of hitwords[iw].
-	      // This is essentially implementing the two's complement representation of a 13-bit signed integer 
-	      ADCsamples[2*iw] = ( hitwords[iw] & 0xFFF ) | ( ( hitwords[iw] & 0x1000 ) ? 0xFFFFF000 : 0x0 );
-	      ADCsamples[2*iw+1] = ( (hitwords[iw]>>13) & 0xFFF ) | ( ( (hitwords[iw]>>13) & 0x1000 ) ? 0xFFFFF000 : 0x0 );
-	    }
-
 	    //APV_ID is in bits 26-30 of hitword[2]:
 	    // 0x 0111 1100 .... = 0x7C000000
 	    apv_id = (hitwords[2] & 0x7C000000)>>26;
 
-	    //APV channel num (bits 4:0) is in bits 26:30 of hitword[0];
-	    //APV channel num (bits 6:5) is in bits 26:30 of hitword[1] (but we actually only want bits 26 and 27 AFAIK:
-	    UInt_t apv_chan40 = (hitwords[0] & 0x7C000000) >> 26;
-	    UInt_t apv_chan65 = (hitwords[1] & 0x0C000000) >> 26;
-	    apv_chan = (apv_chan65 << 5) | apv_chan40;
-	    
 	    effChan = (fiber << 4) | apv_id;  
 
 	    UInt_t cm_flags = 4*CM_OR + 2*ENABLE_CM + BUILD_ALL_SAMPLES;
 
 	    cm_flags_vs_chan[effChan] = cm_flags;
+
+	    //record the position of the three words of this strip in the frame view (the last of the three words is at iword-1):
+	    std::vector<UInt_t> &stripoffsets = fFrameStripOffsets[effChan];
+	    if( stripoffsets.empty() ) fFrameChanList.push_back( effChan );
+	    stripoffsets.push_back( iword-3 );
+
+	    if( fFrameViewOnly == 0 ){ //otherwise the consumer decodes the samples directly from the event buffer
+	      // load up the ADC samples and the APV channel number. The samples are 13-bit signed integers in two's complement
+	      // representation, sign-extended to 32 bits:
+	      DecodeStripWords( hitwords, ADCsamples, apv_chan );
 	    
-	    for( int is=0; is<6; is++ ){
-
-	      // if( ADCsamples[is] > 0xFFF && !ENABLE_CM ) {
-	      // 	std::cout << "negative ADC sample encountered when CM not enabled, raw data word = " << ADCsamples[is] << ", signed int representation = " << Int_t(ADCsamples[is]) << std::endl; 
-	      // 	std::cout << "This is not expected" << std::endl;
-	      // }
-	      // This loads each of the six ADC samples as a new "hit" into sldat, with "effChan" as the unique "channel" number,
-	      // the ADC samples as the "data", and the APV channel number as the "rawData"
-	      // std::cout << "decoded one strip hit: (crate, slot, fiber, apv_id, apv_chan, effChan, isample, ADCsamples[isample]) = ("
-	      // 		<< sldat->getCrate() << ", " << slot << ", " << fiber << ", " << apv_id << ", " << apv_chan << ", " << effChan << ", "
-	      // 		<< is <<  ", " << int(ADCsamples[is]) << ")" << std::endl;
-
-	      //Since we need only two bits to encode the ENABLE_CM and BUILD_ALL_SAMPLES flags, we can
+	      for( int is=0; is<6; is++ ){
+
+	        // if( ADCsamples[is] > 0xFFF && !ENABLE_CM ) {
+	        // 	std::cout << "negative ADC sample encountered when CM not enabled, raw data word = " << ADCsamples[is] << ", signed int representation = " << Int_t(ADCsamples[is]) << std::endl; 
+	        // 	std::cout << "This is not expected" << std::endl;
+	        // }
+	        // This loads each of the six ADC samples as a new "hit" into sldat, with "effChan" as the unique "channel" number,
+	        // the ADC samples as the "data", and the APV channel number as the "rawData"
+	        // std::cout << "decoded one strip hit: (crate, slot, fiber, apv_id, apv_chan, effChan, isample, ADCsamples[isample]) = ("
+	        // 		<< sldat->getCrate() << ", " << slot << ", " << fiber << ", " << apv_id << ", " << apv_chan << ", " << effChan << ", "
+	        // 		<< is <<  ", " << int(ADCsamples[is]) << ")" << std::endl;
+
+	        //Since we need only two bits to encode the ENABLE_CM and BUILD_ALL_SAMPLES flags, we can
 	      
 	      
-	      status = sldat->loadData( "adc", effChan, ADCsamples[is], apv_chan );
-	      if( status != SD_OK ) return -1;
+	        status = sldat->loadData( "adc", effChan, ADCsamples[is], apv_chan );
+	        if( status != SD_OK ) return -1;
+	      }
 	    }
 	  }
 	  
@@ -338,6 +350,11 @@ namespace Decoder {
 	    TimeStampL_vs_fiber[fiber] = TIMESTAMP_LO;
 	    TimeStampH_vs_fiber[fiber] = TIMESTAMP_HI;
 	    EventCount_vs_fiber[fiber] = EVENT_COUNT;
+
+	    fFrameTimeStampLow[fiber] = TIMESTAMP_LO;
+	    fFrameTimeStampHigh[fiber] = TIMESTAMP_HI;
+	    fFrameEventCount[fiber] = EVENT_COUNT;
+	    fFrameFiberFound[fiber] = true;
 	    
 	    eventinfo_wordcount = 0;
 	  }
@@ -828,6 +845,24 @@ namespace Decoder {
     
   }
   
+  void MPDModule::ClearFrameView() {
+    //Only clear the channels that were actually filled, keeping the capacity of the offset arrays:
+    for( auto ichan = fFrameChanList.begin(); ichan != fFrameChanList.end(); ++ichan ){
+      fFrameStripOffsets[*ichan].clear();
+    }
+    fFrameChanList.clear();
+    std::fill( fFrameFiberFound.begin(), fFrameFiberFound.end(), false );
+  }
+
+  Bool_t MPDModule::GetFrameTimeStamp( UInt_t fiber, UInt_t &TimeStampLow, UInt_t &TimeStampHigh, UInt_t &EventCount ) const {
+    if( fiber >= fFrameFiberFound.size() || !fFrameFiberFound[fiber] ) return false;
+
+    TimeStampLow = fFrameTimeStampLow[fiber];
+    TimeStampHigh = fFrameTimeStampHigh[fiber];
+    EventCount = fFrameEventCount[fiber];
+    return true;
+  }
+  
   Int_t MPDModule::Decode(const UInt_t *pdat) {
     //Doesn't do anything. I suppose that's fine for now?
     
@@ -29,6 +29,7 @@
 #define MAXHIT    2048
 
 #include "VmeModule.h"
+#include <vector>
 
 namespace Decoder {
 
@@ -77,6 +78,35 @@ namespace Decoder {
     virtual UInt_t LoadSlot( THaSlotData *sldat, const UInt_t *evbuffer, UInt_t pos, UInt_t len);
 //#endif
 
+    // "Frame view" of the APV data: while LoadSlot walks the raw data, it records the position in the event buffer of the
+    // three-word record of every strip, grouped by "effective channel" (fiber << 4 | apv_id), as well as the time stamp and
+    // event count words of every MPD (fiber). Consumers (SBSGEMModule) can then decode the six samples of each strip
+    // directly from the event buffer instead of reading them back one at a time from THaSlotData.
+    // The view is reset at each call to LoadSlot and is only valid for the event currently being decoded:
+    UInt_t GetFrameNstrips( UInt_t effChan ) const {
+      return effChan < fFrameStripOffsets.size() ? fFrameStripOffsets[effChan].size() : 0;
+    }
+    const UInt_t *GetFrameStripWords( UInt_t effChan, UInt_t istrip ) const {
+      return fFrameBuffer + fFrameStripOffsets[effChan][istrip];
+    }
+    Bool_t GetFrameTimeStamp( UInt_t fiber, UInt_t &TimeStampLow, UInt_t &TimeStampHigh, UInt_t &EventCount ) const;
+    //If true, the strip samples are ONLY available through the frame view (crate map option "frameview_only"):
+    Bool_t IsFrameViewOnly() const { return fFrameViewOnly != 0; }
+
+    // Unpack the six signed 13-bit ADC samples (two's complement, sign-extended to 32 bits) and the APV channel number from
+    // the three words of one strip "hit":
+    static void DecodeStripWords( const UInt_t *hitwords, UInt_t *ADCsamples, UInt_t &apv_chan ){
+      for( int iw=0; iw<3; iw++ ){
+	ADCsamples[2*iw] = ( hitwords[iw] & 0xFFF ) | ( ( hitwords[iw] & 0x1000 ) ? 0xFFFFF000 : 0x0 );
+	ADCsamples[2*iw+1] = ( (hitwords[iw]>>13) & 0xFFF ) | ( ( (hitwords[iw]>>13) & 0x1000 ) ? 0xFFFFF000 : 0x0 );
+      }
+      //APV channel num (bits 4:0) is in bits 26:30 of hitword[0];
+      //APV channel num (bits 6:5) is in bits 26:27 of hitword[1]:
+      apv_chan = ( ( (hitwords[1] & 0x0C000000) >> 26 ) << 5 ) | ( (hitwords[0] & 0x7C000000) >> 26 );
+    }
+
+    static const UInt_t fgNsamplesPerStrip = 6; //number of ADC samples packed in one strip "hit"
+
     //void CommonModeSubtraction();
     
   private:
@@ -125,6 +155,20 @@ namespace Decoder {
     
     // TODO: add trigger time stuff and MPD debug header, etc: 
     //UInt_t fChan_Trigger_Time; //default "reference channel" for 
+
+    //If nonzero, the strip samples are ONLY available through the frame view, and are NOT loaded into THaSlotData:
+    UInt_t fFrameViewOnly; //default = 0
+
+    //Frame view storage (see GetFrameNstrips etc.):
+    const UInt_t *fFrameBuffer; //! start of the data for the current call to LoadSlot
+    std::vector<std::vector<UInt_t> > fFrameStripOffsets; //! indexed by effective channel: offsets of the strip records w.r.t. fFrameBuffer
+    std::vector<UInt_t> fFrameChanList; //! effective channels with data in the current event (so that we only clear those)
+    std::vector<UInt_t> fFrameTimeStampLow; //! indexed by fiber
+    std::vector<UInt_t> fFrameTimeStampHigh; //! indexed by fiber
+    std::vector<UInt_t> fFrameEventCount; //! indexed by fiber
+    std::vector<Bool_t> fFrameFiberFound; //! indexed by fiber
+
+    void ClearFrameView();
     
     /* std::vector<Int_t> fFrameHeader;  // Frame Header */
     /* std::vector<Int_t> fFrameTrailer;  // Frame Trailer */
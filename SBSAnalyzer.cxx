@@ -1,27 +1,163 @@
 #include "SBSAnalyzer.h"
+#include "SBSGEMTrackerBase.h"
+#include "THaEvData.h"
+#include "THaRunBase.h"
+#include "THaCutList.h"
+#include "THaGlobals.h"
+#include "THaApparatus.h"
+#include "THaHelicityDet.h"
+#include "TDatime.h"
+#include "TSystem.h"
+#include "TList.h"
+#include <iostream>
+#include <fstream>
+#include <cstdlib>
 
-
-// Pointer to single instance of this object
-SBSAnalyzer* SBSAnalyzer::fgAnalyzer = nullptr;
+using namespace std;
 
 //_____________________________________________________________________________
-SBSAnalyzer::SBSAnalyzer() : THaAnalyzer()
+SBSAnalyzer::SBSAnalyzer() : THaAnalyzer(), fWorker(0), fNworkers(1), fBatchSize(100),
+			     fNevOtherWorkers(0), fStatefulDetectorsFound(false)
 {
+  // Take the default event partition from the environment, if set
+  // (see sbsreplayjobs.sh)
+
+  const char* nworkers = gSystem->Getenv("SBS_REPLAY_NWORKERS");
+  if( nworkers ) {
+    const char* iworker = gSystem->Getenv("SBS_REPLAY_WORKER");
+    const char* batchsize = gSystem->Getenv("SBS_REPLAY_BATCHSIZE");
+    SetEventPartition( iworker ? atoi(iworker) : 0, atoi(nworkers),
+		       batchsize ? atoi(batchsize) : 100 );
+  }
 }
 
 //_____________________________________________________________________________
 SBSAnalyzer::~SBSAnalyzer()
 {
-  // Destructor.
+  // Destructor. Everything is owned and cleaned up by THaAnalyzer.
+}
+
+//_____________________________________________________________________________
+void SBSAnalyzer::SetEventPartition( UInt_t iworker, UInt_t nworkers, UInt_t batchsize )
+{
+  // Set up this job to analyze only its share of the physics events
+  // (see class description).
+
+  if( nworkers == 0 ) nworkers = 1;
+  if( batchsize == 0 ) batchsize = 1;
+
+  if( iworker >= nworkers ) {
+    Error( "SetEventPartition", "Invalid worker index %u for %u workers, "
+	   "analyzing all events", iworker, nworkers );
+    iworker = 0;
+    nworkers = 1;
+  }
+
+  fWorker = iworker;
+  fNworkers = nworkers;
+  fBatchSize = batchsize;
+}
+
+//_____________________________________________________________________________
+TString SBSAnalyzer::JobFileName( const TString& fname ) const
+{
+  // Append "_job<i>" to the base name of the file "fname", unless already there
+
+  if( fNworkers <= 1 || fname.IsNull() )
+    return fname;
+
+  TString suffix = Form("_job%u", fWorker);
+  TString base = fname, ext;
+  Ssiz_t dot = fname.Last('.');
+  if( dot != kNPOS && dot > fname.Last('/') ) {
+    base = fname(0,dot);
+    ext = fname(dot,fname.Length()-dot);
+  }
+  if( base.EndsWith(suffix) )
+    return fname;
+
+  return base + suffix + ext;
+}
+
+//_____________________________________________________________________________
+Int_t SBSAnalyzer::Init( THaRunBase* run )
+{
+  // With more than one job, each one writes its own output and summary files
+
+  fOutFileName = JobFileName( fOutFileName );
+  fSummaryFileName = JobFileName( fSummaryFileName );
+  fStatefulDetectorsFound = false;
+
+  return THaAnalyzer::Init( run );
+}
+
+//_____________________________________________________________________________
+void SBSAnalyzer::FindStatefulDetectors()
+{
+  // Find the detectors whose decoding depends on the preceding physics
+  // events: helicity detectors and GEM trackers
+
+  fHelicityDets.clear();
+  fGEMTrackers.clear();
+
+  TIter aiter(gHaApps);
+  THaApparatus* app = 0;
+  while( (app=(THaApparatus*)aiter()) ){
+    TIter diter(app->GetDetectors());
+    TObject* det = 0;
+    while( (det=diter()) ){
+      THaHelicityDet* hel = dynamic_cast<THaHelicityDet*>(det);
+      if( hel ) fHelicityDets.push_back(hel);
+      SBSGEMTrackerBase* gem = dynamic_cast<SBSGEMTrackerBase*>(det);
+      if( gem ) fGEMTrackers.push_back(gem);
+    }
+  }
+  fStatefulDetectorsFound = true;
+}
+
+//_____________________________________________________________________________
+void SBSAnalyzer::UpdateRunningState()
+{
+  // For a physics event analyzed by another job, update only the state
+  // that the following events of this job depend on
+
+  if( !fStatefulDetectorsFound )
+    FindStatefulDetectors();
+
+  for( auto* hel : fHelicityDets ) {
+    hel->Clear();
+    hel->Decode(*fEvData);
+  }
+  for( auto* gem : fGEMTrackers )
+    gem->UpdateRunningState(*fEvData);
+}
+
+//_____________________________________________________________________________
+Int_t SBSAnalyzer::PhysicsAnalysis( Int_t code )
+{
+  // Skip the physics events that belong to the other jobs before any
+  // reconstruction is done for them, keeping only the event-to-event state
+  // up to date.
+
+  if( code == kOK && !IsWorkerEvent( fEvData->GetEvNum() ) ) {
+    fNevOtherWorkers++;
+    UpdateRunningState();
+    return kSkip;
+  }
+
+  return THaAnalyzer::PhysicsAnalysis( code );
+}
+
+//_____________________________________________________________________________
+Int_t SBSAnalyzer::EndAnalysis()
+{
+  if( fNworkers > 1 && fVerbose > 0 ) {
+    cout << "SBSAnalyzer: job " << fWorker << " of " << fNworkers
+	 << " (batch size " << fBatchSize << "), left "
+	 << fNevOtherWorkers << " physics events to the other jobs" << endl;
+  }
 
-  SBSAnalyzer::Close();
-  DeleteContainer(fPostProcess);
-  DeleteContainer(fEvtHandlers);
-  DeleteContainer(fInterStage);
-  delete fExtra; fExtra = nullptr;
-  delete fBench;
-  if( fgAnalyzer == this )
-    fgAnalyzer = nullptr;
+  return THaAnalyzer::EndAnalysis();
 }
 
 //_____________________________________________________________________________
@@ -55,4 +191,4 @@ void SBSAnalyzer::PrintCutSummary() const
 
 //_____________________________________________________________________________
 
-ClassImp(THaAnalyzer)
+ClassImp(SBSAnalyzer)
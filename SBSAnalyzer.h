@@ -1,20 +1,90 @@
 #ifndef SBSAnalyzer_h_
 #define SBSAnalyzer_h_
 
+//////////////////////////////////////////////////////////////////////////
+//
+// SBSAnalyzer
+//
+// THaAnalyzer with support for event-parallel replay. The Podd analysis
+// chain (global variable and cut lists, output tree, apparatus/detector
+// registry) is not thread-safe, so the parallelism is across processes:
+// N replay jobs read the same CODA file(s), and each one fully analyzes
+// only its own share of the physics events, in interleaved batches of
+// fixed size:
+//
+//   job i analyzes physics event evnum if (evnum/batchsize) % N == i
+//
+// All other event types (scalers, EPICS/slow control, prestart etc.) are
+// processed by every job, so that scaler and event type handlers see the
+// complete sequence. For the physics events of the other jobs, only the
+// state carried from event to event is updated: helicity detectors are
+// decoded, and the GEM modules update their time stamp reference and
+// rolling common-mode averages (SBSGEMModule::UpdateRunningState). The
+// results for the analyzed events are therefore the same as in a serial
+// replay.
+//
+// The partition is set with SetEventPartition, or, if that is not called,
+// from the environment variables SBS_REPLAY_WORKER, SBS_REPLAY_NWORKERS
+// and SBS_REPLAY_BATCHSIZE, which is how the launcher script
+// sbsreplayjobs.sh starts the jobs without changes to the replay script.
+// With more than one job, "_job<i>" is appended to the output and summary
+// file names. The job outputs are merged in event order by sbsmergejobs.
+//
+//////////////////////////////////////////////////////////////////////////
+
 #include "THaAnalyzer.h"
+#include <vector>
+
+class THaHelicityDet;
+class SBSGEMTrackerBase;
 
 class SBSAnalyzer : public THaAnalyzer {
  public:
   SBSAnalyzer();
   virtual ~SBSAnalyzer();
-  
+
+  using THaAnalyzer::Init;
+  virtual Int_t Init( THaRunBase* run );
+
+  // Analyze only the physics events belonging to job "iworker" out of "nworkers".
+  // nworkers <= 1 (the default) means all events are analyzed:
+  void  SetEventPartition( UInt_t iworker, UInt_t nworkers, UInt_t batchsize=100 );
+
+  UInt_t GetWorker() const { return fWorker; }
+  UInt_t GetNworkers() const { return fNworkers; }
+  UInt_t GetBatchSize() const { return fBatchSize; }
+
+  // Does physics event "evnum" belong to this job?
+  Bool_t IsWorkerEvent( UInt_t evnum ) const {
+    return fNworkers <= 1 || (evnum/fBatchSize) % fNworkers == fWorker;
+  }
+
  protected:
   //functions we want to override
+  virtual Int_t  PhysicsAnalysis( Int_t code );
+  virtual Int_t  EndAnalysis();
   virtual void   PrintCutSummary() const;
-  
+
+  // Update the event-to-event state for a physics event of another job
+  void           UpdateRunningState();
+  void           FindStatefulDetectors();
+  TString        JobFileName( const TString& fname ) const;
+
+  UInt_t fWorker;    // index of this job (0...fNworkers-1)
+  UInt_t fNworkers;  // total number of jobs sharing the input
+  UInt_t fBatchSize; // number of consecutive events per batch
+
+  ULong64_t fNevOtherWorkers; // physics events left to the other jobs
+
+  Bool_t fStatefulDetectorsFound;                 //!
+  std::vector<THaHelicityDet*>    fHelicityDets;  //! helicity detectors of all apparatuses
+  std::vector<SBSGEMTrackerBase*> fGEMTrackers;   //! GEM trackers of all apparatuses
+
  private:
-  THaAnalyzer( const SBSAnalyzer& );
-  THaAnalyzer& operator=( const SBSAnalyzer& );
+  SBSAnalyzer( const SBSAnalyzer& );
+  SBSAnalyzer& operator=( const SBSAnalyzer& );
 
   ClassDef(SBSAnalyzer, 0)
-}
+};
+
+#endif
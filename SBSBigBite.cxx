@@ -15,6 +15,7 @@
 #include "SBSGRINCH.h"
 #include "SBSGEMSpectrometerTracker.h"
 #include "SBSRasteredBeam.h"
+#include "Helper.h"
 #include "THaTrackingDetector.h"
 #include "TH2D.h"
 
@@ -96,6 +97,8 @@ THaSpectrometer( name, description )
 
   fUseBeamPosInOptics = false;
 
+  fRasteredBeam = nullptr;
+
   fIsMC = false;
 
   //Default to block size/sqrt(12) for shower and preshower:
@@ -413,6 +416,11 @@ Int_t SBSBigBite::ReadDatabase( const TDatime& date )
       if(f_om[i]==0 && f_ol[i]==0 && f_ok[i]==0 && f_oj[i]==1 && f_oi[i]==0)
 	fYtar_00010 = fb_ytar[i];
     }
+
+    if( !fTargetOptics.Init( f_om, f_ol, f_ok, f_oj, f_oi,
+			     { &fb_xptar, &fb_yptar, &fb_ytar, &fb_pinv } ) ) return kInitError;
+  } else {
+    fTargetOptics.Clear();
   }
 
   if( fETOF_order >= 0 ){
@@ -455,7 +463,11 @@ Int_t SBSBigBite::ReadDatabase( const TDatime& date )
       f_oj_ETOF[term] = int(TOF_param[6*term+4]);
       f_oi_ETOF[term] = int(TOF_param[6*term+5]);
     }
-    
+
+    if( !fETOFOptics.Init( f_om_ETOF, f_ol_ETOF, f_ok_ETOF, f_oj_ETOF, f_oi_ETOF,
+			   { &fb_ETOF } ) ) return kInitError;
+  } else {
+    fETOFOptics.Clear();
   }
   
   if( fForwardOpticsOrder >= 0 ){
@@ -508,8 +520,16 @@ Int_t SBSBigBite::ReadDatabase( const TDatime& date )
       f_foj[i] = int(foptics_param[9*i+7]);
       f_foi[i] = int(foptics_param[9*i+8]);
     }
+
+    if( !fForwardOptics.Init( f_fom, f_fol, f_fok, f_foj, f_foi,
+			      { &fb_xfp, &fb_yfp, &fb_xpfp, &fb_ypfp } ) ) return kInitError;
+  } else {
+    fForwardOptics.Clear();
   }
     
+  //Like the other expansions, the downbending optics must not carry over from a previous run without them:
+  fTargetOpticsDownbend.Clear();
+
   fDownBendingMode = downbend != 0 ? true : false;
   if( fDownBendingMode ){
     if( fOpticsOrderDownbend >= 0 ){
@@ -576,6 +596,9 @@ Int_t SBSBigBite::ReadDatabase( const TDatime& date )
 	  fYtar_00010 = fb_ytar_downbend[i];
                 
       }
+
+      if( !fTargetOpticsDownbend.Init( f_om_downbend, f_ol_downbend, f_ok_downbend, f_oj_downbend, f_oi_downbend,
+				       { &fb_xptar_downbend, &fb_yptar_downbend, &fb_ytar_downbend, &fb_pinv_downbend } ) ) return kInitError;
             
     } else {
       std::cerr << "Warning: downbending mode specified but no downbending optics parameters provided; fix database" << std::endl;
@@ -1154,10 +1177,16 @@ Int_t SBSBigBite::FindVertices( TClonesArray& tracks )
   for( Int_t t = 0; t < n_trk; t++ ) {
     auto* theTrack = static_cast<THaTrack*>( tracks.At(t) );
     CalcOpticsCoords(theTrack);
+  }
+
+  //The target optics of all tracks are evaluated together:
+  if(fOpticsOrder>=0) CalcTargetOptics( tracks );
 
+  for( Int_t t = 0; t < n_trk; t++ ) {
+    auto* theTrack = static_cast<THaTrack*>( tracks.At(t) );
 
     if(fOpticsOrder>=0){
-      CalcTargetCoords(theTrack);
+      CalcTargetCoords(theTrack, t);
       if(fForwardOpticsOrder>=0){ //also calculate forward from target as consistency check:
 	CalcFpCoords( theTrack );
       }
@@ -1274,7 +1303,72 @@ void SBSBigBite::CalcOpticsCoords( THaTrack* track )
     
 }
 
-void SBSBigBite::CalcTargetCoords( THaTrack* track )
+void SBSBigBite::CalcTargetOptics( const TClonesArray& tracks )
+{
+  // Evaluate the target optics expansion for all the tracks of the event with one SBSOpticsExpansion::EvalBatch call
+  // per xtar iteration. Fills fTargetOpticsVars (x_fp, y_fp, xp_fp, yp_fp and the final xtar of each track) and
+  // fTargetOpticsFit (xptar, yptar, ytar and p*thetabend of each track) for CalcTargetCoords:
+  Int_t n_trk = tracks.GetLast()+1;
+
+  const int nvars = SBSOpticsExpansion::kNvars;
+
+  fTargetOpticsVars.resize( nvars*n_trk );
+  fTargetOpticsFit.resize( 4*n_trk );
+
+  const double th_bb = GetThetaGeo();//retrieve the actual angle
+
+  //Beam position from BPMs and Rasters (we want the Lrb variables; see Begin()):
+  double ybeam=0.0;
+  if( fRasteredBeam ) ybeam = fRasteredBeam->GetBeamPosition().Y();
+
+  for( Int_t t = 0; t < n_trk; t++ ) {
+    auto* track = static_cast<THaTrack*>( tracks.At(t) );
+    double *vars = &fTargetOpticsVars[nvars*t];
+
+    if( track->HasRot() ){
+      //    std::cout << "using rotated track coordinates for optics: " << endl;
+      vars[0] = track->GetRX();
+      vars[1] = track->GetRY();
+      vars[2] = track->GetRTheta();
+      vars[3] = track->GetRPhi();
+    } else {
+      //std::cout << "using non-rotated track coordinates for optics: " << endl;
+      vars[0] = track->GetX();
+      vars[1] = track->GetY();
+      vars[2] = track->GetTheta();
+      vars[3] = track->GetPhi();
+    }
+
+    //The fUseBeamPosInOptics flag protects against unintentionally using uncalibrated beam position in optics calculations;
+    // or mixing beam position corrections with optics calibrated without them in an inconsistent way
+    vars[4] = fUseBeamPosInOptics ? -ybeam : 0.0;
+  }
+
+  // rewrite to actually use the exponents loaded from the database, in case
+  // they are provided in a non-standard order. All four expansions share the same
+  // monomials, so they are evaluated together from per-track power tables:
+  SBSOpticsExpansion &optics = fDownBendingMode ? fTargetOpticsDownbend : fTargetOptics;
+
+  //Three iterations needed to converge xtar reconstruction
+  for(int iter = 0; iter < 2; iter++){
+    optics.EvalBatch( n_trk, fTargetOpticsVars.data(), fTargetOpticsFit.data() );
+
+    for( Int_t t = 0; t < n_trk; t++ ) {
+      const double *fit = &fTargetOpticsFit[4*t];
+      double xptar_fit = fit[0];
+      double yptar_fit = fit[1];
+      double ytar_fit = fit[2];
+
+      double vz_fit = -ytar_fit / (sin(th_bb) + cos(th_bb)*yptar_fit);
+
+      double xtar = -cos(GetThetaGeo()) * vz_fit * xptar_fit;
+      if( fUseBeamPosInOptics ) xtar += -ybeam;
+      fTargetOpticsVars[nvars*t+4] = xtar;
+    }
+  }
+}
+
+void SBSBigBite::CalcTargetCoords( THaTrack* track, Int_t itrack )
 {
   //std::cout << "SBSBigBite::CalcTargetCoords()...";
 
@@ -1299,42 +1393,20 @@ void SBSBigBite::CalcTargetCoords( THaTrack* track )
   spec_zaxis_fp.Rotate(-fOpticsAngle, spec_yaxis_fp);
   spec_xaxis_fp = spec_yaxis_fp.Cross(spec_zaxis_fp).Unit();
     
-  Double_t x_fp, y_fp, xp_fp, yp_fp;
-  //if( fCoordType == kTransport ) {
-    
-  if( track->HasRot() ){
-    //    std::cout << "using rotated track coordinates for optics: " << endl;
-    x_fp = track->GetRX();
-    y_fp = track->GetRY();
-    xp_fp = track->GetRTheta();
-    yp_fp = track->GetRPhi();
-  } else {
-    //std::cout << "using non-rotated track coordinates for optics: " << endl;
-    x_fp = track->GetX();
-    y_fp = track->GetY();
-    xp_fp = track->GetTheta();
-    yp_fp = track->GetPhi();
-  }
-  //}
+  //Focal plane coordinates and xtar used by (and the results of) the target optics, from CalcTargetOptics:
+  const double *optvars = &fTargetOpticsVars[SBSOpticsExpansion::kNvars*itrack];
+  const double *fit = &fTargetOpticsFit[4*itrack];
+
+  Double_t x_fp = optvars[0], y_fp = optvars[1], xp_fp = optvars[2], yp_fp = optvars[3];
   //cout << x_fp << " " << y_fp << " " << xp_fp << " " << yp_fp << endl;
     
   //Beam position from BPMs and Rasters
   double ybeam=0.0,xbeam=0.0;
 
-  //retrieve beam position from BPMs and Rasters
-  TIter aiter(gHaApps);
-  THaApparatus* app = 0;
-  
-  while( (app=(THaApparatus*)aiter()) ){
-    if(app->InheritsFrom("SBSRasteredBeam")){
-      //We want the Lrb variables
-      if(app->GetName() != std::string("Lrb")) continue;
-      
-      SBSRasteredBeam* RasterBeam = reinterpret_cast<SBSRasteredBeam*>(app);
-      ybeam = RasterBeam->GetBeamPosition().Y(); 
-      xbeam = RasterBeam->GetBeamPosition().X();
-    }
-    //cout << app->GetName() << endl;
+  //retrieve beam position from BPMs and Rasters (we want the Lrb variables; see Begin()):
+  if( fRasteredBeam ){
+    ybeam = fRasteredBeam->GetBeamPosition().Y(); 
+    xbeam = fRasteredBeam->GetBeamPosition().X();
   }
 
 
@@ -1344,63 +1416,14 @@ void SBSBigBite::CalcTargetCoords( THaTrack* track )
   double pthetabend_fit;
   double vz_fit;
 
-  //The fUseBeamPosInOptics flag protects against unintentionally using uncalibrated beam position in optics calculations;
-  // or mixing beam position corrections with optics calibrated without them in an inconsistent way
-  
-  xtar = fUseBeamPosInOptics ? -ybeam : 0.0;
-  //  if( fUseBeamPosInOptics ) xtar = -ybeam;
- 
-  //Three iterations needed to converge xtar reconstruction
-  for(int iter = 0; iter < 2; iter++){
-    int ipar = 0;
-    xptar_fit = 0.0;
-    yptar_fit = 0.0;
-    ytar_fit = 0.0;
-    pthetabend_fit = 0.0;
-    // rewrite to actually use the exponents loaded from the database, in case
-    // they are provided in a non-standard order:
-    int nterms = fOpticsNterms;
-    if( fDownBendingMode ) nterms = fOpticsNtermsDownbend;
-    for(int iterm=0; iterm<nterms; iterm++ ){
-      int i = f_oi[iterm],
-	j = f_oj[iterm],
-	k = f_ok[iterm],
-	l = f_ol[iterm],
-	m = f_om[iterm];
-      
-      if( fDownBendingMode ){
-	i = f_oi_downbend[iterm];
-	j = f_oj_downbend[iterm];
-	k = f_ok_downbend[iterm];
-	l = f_ol_downbend[iterm];
-	m = f_om_downbend[iterm];
-      }
-      
-      double term = pow(x_fp, m) *
-	pow(y_fp, l) *
-	pow(xp_fp, k) *
-	pow(yp_fp, j) *
-	pow(xtar, i);
-      //	      double term = pow(x_fp,m)*pow(y_fp,l)*pow(xp_fp,k)*pow(yp_fp,j)*pow(xtar,i);
-      
-      if( !fDownBendingMode ){
-	xptar_fit += fb_xptar[iterm]*term;
-	yptar_fit += fb_yptar[iterm]*term;
-	ytar_fit += fb_ytar[iterm]*term;
-	pthetabend_fit += fb_pinv[iterm]*term;
-      } else {
-	xptar_fit += fb_xptar_downbend[iterm]*term;
-	yptar_fit += fb_yptar_downbend[iterm]*term;
-	ytar_fit += fb_ytar_downbend[iterm]*term;
-	pthetabend_fit += fb_pinv_downbend[iterm]*term;
-      }
-    } // End loop over matrix
+  xtar = optvars[4];
+
+  xptar_fit = fit[0];
+  yptar_fit = fit[1];
+  ytar_fit = fit[2];
+  pthetabend_fit = fit[3];
   
-    vz_fit = -ytar_fit / (sin(th_bb) + cos(th_bb)*yptar_fit);
-    
-    xtar = -cos(GetThetaGeo()) * vz_fit * xptar_fit;    
-    if( fUseBeamPosInOptics ) xtar += -ybeam;
-  }
+  vz_fit = -ytar_fit / (sin(th_bb) + cos(th_bb)*yptar_fit);
 
   //Let's simplify the bend angle reconstruction to avoid double-counting, even though
   //this calculation is almost certainly correct:
@@ -1457,12 +1480,12 @@ void SBSBigBite::CalcTargetCoords( THaTrack* track )
 
   //Let's also calculate electron TOF (AFTER reconstructing xtar, etc):
   double ETOF = fETOF_avg;
-  
-  for( int ipar=0; ipar<fb_ETOF.size(); ipar++ ){
-    double term = pow(x_fp,f_om_ETOF[ipar])*pow(y_fp,f_ol_ETOF[ipar])*pow(xp_fp,f_ok_ETOF[ipar])*pow(yp_fp,f_oj_ETOF[ipar])*pow(xtar,f_oi_ETOF[ipar]);
-    
-    ETOF += fb_ETOF[ipar] * term;
 
+  if( !fETOFOptics.IsEmpty() ){
+    double vars[SBSOpticsExpansion::kNvars] = { x_fp, y_fp, xp_fp, yp_fp, xtar };
+    double dETOF;
+    fETOFOptics.Eval( vars, &dETOF );
+    ETOF += dETOF;
   }
 
   double pathlength = 0.299792458*ETOF; //ETOF is already calculated in ns, so 0.3 m/ns (or 1 foot/ns)
@@ -1481,6 +1504,17 @@ void SBSBigBite::CalcTargetCoords( THaTrack* track )
   //std::cout << "Done." << std::endl;
 }
 
+//_____________________________________________________________________________
+Int_t SBSBigBite::Begin( THaRunBase *run ){
+  THaSpectrometer::Begin(run);
+
+  //All apparatuses are initialized at this point; look up the rastered beam
+  //used for the beam position in CalcTargetCoords once per run rather than per track:
+  fRasteredBeam = FindApparatus<SBSRasteredBeam>( "Lrb" );
+
+  return 0;
+}
+
 //_____________________________________________________________________________
 void SBSBigBite::CalcFpCoords( THaTrack *track ){
 
@@ -1491,22 +1525,17 @@ void SBSBigBite::CalcFpCoords( THaTrack *track ){
     double yptar = track->GetTPhi();
     double p = track->GetP();
         
-    double xfp_fit = 0.0;
-    double yfp_fit = 0.0;
-    double xpfp_fit = 0.0;
-    double ypfp_fit = 0.0;
-
     //xtar = 0.0;
-    
-    for( int ipar=0; ipar<fForwardOpticsNterms; ipar++ ){
-      //forward optics expansion is (xfp, yfp, xpfp, ypfp) = sum_ijklm C_(xyxpyp)^ijklm * xptar^i yptar^j ytar^k (1/p)^l (xtar)^m:
-    
-      double term = pow( xptar, f_fom[ipar] )*pow( yptar, f_fol[ipar] )*pow( ytar, f_fok[ipar] ) * pow( 1.0/p, f_foj[ipar] ) * pow( xtar, f_foi[ipar] );
-      xfp_fit += fb_xfp[ipar] * term;
-      yfp_fit += fb_yfp[ipar] * term;
-      xpfp_fit += fb_xpfp[ipar] * term;
-      ypfp_fit += fb_ypfp[ipar] * term;
-    }
+
+    //forward optics expansion is (xfp, yfp, xpfp, ypfp) = sum_ijklm C_(xyxpyp)^ijklm * xptar^i yptar^j ytar^k (1/p)^l (xtar)^m:
+    double vars[SBSOpticsExpansion::kNvars] = { xptar, yptar, ytar, 1.0/p, xtar };
+    double fit[4];
+    fForwardOptics.Eval( vars, fit );
+
+    double xfp_fit = fit[0];
+    double yfp_fit = fit[1];
+    double xpfp_fit = fit[2];
+    double ypfp_fit = fit[3];
         
     // std::cout << "(xptar, yptar, xtar, ytar, p (GeV) ) = (" << xptar << ", " << yptar << ", " << xtar << ", " << ytar << ", " << p << ")" << std::endl;
         
@@ -2,10 +2,12 @@
 #define SBSBigBite_h
 
 #include "THaSpectrometer.h"
+#include "SBSOpticsExpansion.h"
 
 class TList;
 class THaTrack;
 class TH2D;
+class SBSRasteredBeam;
 
 class SBSBigBite : public THaSpectrometer {
 public:
@@ -33,7 +35,7 @@ public:
   Bool_t GetUseBeamPosInOptics() const { return fUseBeamPosInOptics; }
   void SetUseBeamPosInOptics( bool val=true ){ fUseBeamPosInOptics = val; }
     
-  //virtual Int_t   Begin( THaRunBase* r=0 );
+  virtual Int_t   Begin( THaRunBase* r=0 );
   //virtual Int_t   End( THaRunBase* r=0 );
 
   Double_t GetETOF_avg() const { return fETOF_avg; }
@@ -45,7 +47,8 @@ protected:
   virtual void  DefinePidParticles();
 
   void CalcOpticsCoords( THaTrack* the_track );//calculate optics coords from "focal plane" coords
-  void CalcTargetCoords( THaTrack* the_track );//calculate target coords from optics coords
+  void CalcTargetOptics( const TClonesArray& tracks );//evaluate the target optics expansion for all tracks at once
+  void CalcTargetCoords( THaTrack* the_track, Int_t itrack );//calculate target coords from the results of CalcTargetOptics
   void CalcFpCoords( THaTrack* the_track ); //
   void CalcTrackTiming( THaTrack* the_track );
   void CalcTrackPID( THaTrack* the_track );
@@ -119,6 +122,8 @@ protected:
   bool fIsMC;
 
   bool fUseBeamPosInOptics; //default false;
+
+  SBSRasteredBeam *fRasteredBeam; //! "Lrb" beam apparatus, bound in Begin() (nullptr if not defined)
   
   int fOpticsOrder;
   int fOpticsNterms;
@@ -133,6 +138,18 @@ protected:
   std::vector<int> f_ol;
   std::vector<int> f_om;
 
+  //Power-table evaluators built from the coefficients/exponents above in ReadDatabase
+  //(outputs: xptar, yptar, ytar, pinv for target optics; ETOF; xfp, yfp, xpfp, ypfp for forward optics):
+  SBSOpticsExpansion fTargetOptics; //!
+  SBSOpticsExpansion fTargetOpticsDownbend; //!
+  SBSOpticsExpansion fETOFOptics; //!
+  SBSOpticsExpansion fForwardOptics; //!
+
+  //Inputs (x_fp, y_fp, xp_fp, yp_fp, xtar) and outputs of the target optics of all tracks of the event, kept
+  //consecutive by track for SBSOpticsExpansion::EvalBatch in CalcTargetOptics:
+  std::vector<Double_t> fTargetOpticsVars; //!
+  std::vector<Double_t> fTargetOpticsFit; //!
+
   //Build out the same infrastructure for single-arm electron TOF (basically path length): 
 
   Double_t fETOF_avg;
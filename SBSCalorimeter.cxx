@@ -202,11 +202,33 @@ Int_t SBSCalorimeter::ReadDatabase( const TDatime& date )
     }
   }
 
+  InitNeighborTable();
+
   // All is well that ends well
   fIsInit = true;
   return kOK;
 }
 
+//_____________________________________________________________________________
+void SBSCalorimeter::InitNeighborTable()
+{
+  // Precompute, for each block, the list of blocks close enough to be added
+  // to a cluster containing it (same distance criterion as in FindClusters)
+  fNeighbors.assign( fNelem, std::vector<Int_t>() );
+  fBlockSetIndex.assign( fNelem, -1 );
+
+  for( Int_t i=0; i<fNelem; i++ ) {
+    Double_t xblk = fElements[i]->GetX();
+    Double_t yblk = fElements[i]->GetY();
+    for( Int_t j=0; j<fNelem; j++ ) {
+      if( j == i ) continue;
+      Double_t Rad2 = pow( xblk-fElements[j]->GetX(), 2 ) + pow( yblk-fElements[j]->GetY(), 2 );
+      if( Rad2 < pow(fRmax_dis,2) )
+	fNeighbors[i].push_back( j );
+    }
+  }
+}
+
 //_____________________________________________________________________________
 Int_t SBSCalorimeter::DefineVariables( EMode mode )
 {
@@ -363,7 +385,8 @@ Int_t SBSCalorimeter::MakeGoodBlocks()
 {
   // Fill the fElements which have Good hit in Block "Cluster"
   SBSElement *blk = 0;
-  for(Int_t k = 0; k < fNelem; k++) {  
+  // Only elements that received hits in Decode() can have data (list is in element order):
+  for( auto k : fDirtyElements ) {  
     blk = fElements[k];
     Bool_t ADC_HasData=kFALSE;
     Int_t ADC_GoodHitIndex=-1;
@@ -454,18 +477,29 @@ Int_t SBSCalorimeter::FindClusters()
 
   std::map<int,int> clusterids_by_blockid; //key = block id; mapped value = cluster ID.
   
-  //Test new experimental clustering algorithm here; island algorithm: AJRP
-  while( NSize != 0 ){
-    std::sort(fBlockSet.begin(), fBlockSet.end(), [](const SBSBlockSet& c1, const SBSBlockSet& c2) { return c1.e > c2.e;});
+  //Island algorithm: AJRP
+  //fBlockSet is sorted by decreasing energy. Blocks already in a cluster are flagged
+  //by fBlockSetIndex = -1 instead of being erased, and the blocks within
+  //fRmax_dis of a cluster block come from the precomputed neighbor table,
+  //so that each cluster costs only O(blocks in cluster * neighbors per block)
+  std::sort(fBlockSet.begin(), fBlockSet.end(), [](const SBSBlockSet& c1, const SBSBlockSet& c2) { return c1.e > c2.e;});
+
+  for( Int_t j=0; j<NSize; j++ ) {
+    fBlockSetIndex[fBlockSet[j].id-fChanMapStart] = j;
+  }
 
-    fBlockSetIterator it = fBlockSet.begin(); //This starts out as the highest-energy remaining block 
+  Int_t iseed = 0; //position in fBlockSet of the next cluster seed candidate
+  
+  while( NSize != 0 ){
+    //The seed is the highest-energy block not yet in a cluster:
+    while( fBlockSetIndex[fBlockSet[iseed].id-fChanMapStart] < 0 ) iseed++;
     
-    if ( (*it).e > fEmin_clusSeed ){ //don't bother if the highest-energy remaining block is too low in energy
+    if ( fBlockSet[iseed].e > fEmin_clusSeed ){ //don't bother if the highest-energy remaining block is too low in energy
 
-      SBSElement *blk= fElements[(*it).id-fChanMapStart] ; //here blk is the pointer to the highest energy block remaining in fBlockSet, the cluster seed
-      SBSCalorimeterCluster* cluster = new SBSCalorimeterCluster(fBlockSet.size(),blk); //seed a new cluster with blk but don't add it to the cluster array yet"
+      SBSElement *blk= fElements[fBlockSet[iseed].id-fChanMapStart] ; //here blk is the pointer to the highest energy block remaining in fBlockSet, the cluster seed
+      SBSCalorimeterCluster* cluster = new SBSCalorimeterCluster(NSize,blk); //seed a new cluster with blk but don't add it to the cluster array yet"
 
-      fBlockSet.erase(it); //"erase" the cluster seed from fBlockSet. 
+      fBlockSetIndex[fBlockSet[iseed].id-fChanMapStart] = -1; //remove the cluster seed from the unused blocks
       NSize--; //decrement the total number of remaining unused blocks in fBlockSet
       
       Int_t iblk=0;
@@ -476,51 +510,31 @@ Int_t SBSCalorimeter::FindClusters()
       // cluster size or we run out of cluster blocks to test:
       while( iblk<cluster->GetMult() && cluster->GetMult() < cluster->GetNMaxElements() ){
 	SBSElement *blk_i = cluster->GetElement( iblk ); //grab pointer to the ith block in the cluster:
-	//Now loop on all the remaining unused blocks.
-	Double_t xblk = blk_i->GetX();
-	Double_t yblk = blk_i->GetY();
-	Double_t tblk = blk_i->GetAtime();
-	Double_t eblk = blk_i->GetE();
-
-	//now loop on all the unused blocks and check if they are within Rmax of the current block. It is safer, albeit slightly less efficient, to loop on fBlockSet once and then erase any blocks that were added to the cluster in a second loop. For the erasing, it is simpler to refer to the block id than to the index in fBlockSet.
-	std::set<int> blockidstoerase;
-	
-	for( int j=0; j<fBlockSet.size(); j++ ){
-	  SBSElement *blk_j = fElements[fBlockSet[j].id-fChanMapStart];
-	  Double_t xblk_j = blk_j->GetX();
-	  Double_t yblk_j = blk_j->GetY();
-	  Double_t eblk_j = blk_j->GetE();
-	  Double_t tblk_j = blk_j->GetAtime();
-
-	  Double_t Rad2 = pow( xblk-xblk_j, 2 ) + pow( yblk-yblk_j, 2 );
-	  //Even if we later update cluster::AddElement to set cluster time to energy-weighted mean time, this will still compare the current block to the seed: 
-	  Double_t tdiff = tblk_j - cluster->GetElement( 0 )->GetAtime();
-
-	  if( Rad2 < pow(fRmax_dis,2) && fabs( tdiff ) < fTmax &&
-	      cluster->GetMult() < cluster->GetNMaxElements() ){
-	    cluster->AddElement( blk_j );
-	    blockidstoerase.insert( fBlockSet[j].id ); //list of blocks to remove from the set
+	//Even if we later update cluster::AddElement to set cluster time to energy-weighted mean time, this will still compare the current block to the seed: 
+	Double_t tseed = cluster->GetElement( 0 )->GetAtime();
+
+	//now loop on the unused neighbors of the current block and keep the ones in time with the seed:
+	fClusterCandidates.clear();
+	const std::vector<Int_t> &neighbors = fNeighbors[blk_i->GetID()-fChanMapStart];
+	for( size_t k=0; k<neighbors.size(); k++ ){
+	  Int_t j = fBlockSetIndex[neighbors[k]];
+	  if( j >= 0 && fabs( fElements[neighbors[k]]->GetAtime() - tseed ) < fTmax ){
+	    fClusterCandidates.push_back( j );
 	  }
 	}
 
-	//now loop on fBlockSet again using an iterator and erase any elements that were added to the cluster.
-	auto it2 = fBlockSet.begin();
-	while( it2 != fBlockSet.end() ){
-	  if( blockidstoerase.find( (*it2).id ) != blockidstoerase.end() ){ //this block was added to the cluster; erase from fBlockSet
-	    //auto itnext = fBlockSet.erase( it2 ); //return value is an iterator to the next element
-	    //it2 = itnext; //Perhaps it is safe to assign the result of fBlockSet.erase( it2 ) to it2 itself, making this division on two lines unnecessary?
-	    it2 = fBlockSet.erase( it2 );
-	    NSize--;
-	  } else {
-	    ++it2;
-	  }
+	//add them to the cluster in order of decreasing energy, i.e., in the order of fBlockSet:
+	std::sort( fClusterCandidates.begin(), fClusterCandidates.end() );
+	for( size_t k=0; k<fClusterCandidates.size(); k++ ){
+	  if( cluster->GetMult() >= cluster->GetNMaxElements() ) break;
+	  Int_t ielem = fBlockSet[fClusterCandidates[k]].id-fChanMapStart;
+	  cluster->AddElement( fElements[ielem] );
+	  fBlockSetIndex[ielem] = -1;
+	  NSize--;
 	}
-
-	//We don't really need to sort fBlockSet again until we start
-	//the next cluster.
 	
 	iblk++; 
-      } //end loop over blocks in current cluster. On each iteration of this loop, all blocks in fblockset that are added to the cluster are erased from fBlockSet, ensuring that any given block can only be added to a cluster exactly once and can only be used in exactly one cluster!
+      } //end loop over blocks in current cluster. Blocks added to the cluster are flagged as used, ensuring that any given block can only be added to a cluster exactly once and can only be used in exactly one cluster!
 
       //NOW we add the cluster to the array, IF the total energy is above
       // threshold:
@@ -542,6 +556,17 @@ Int_t SBSCalorimeter::FindClusters()
     
   } //End loop on while( NSize != 0 ). Each iteration of this loop finds one cluster, as long as there are more clusters to find.
 
+  //Leave only the unused blocks in fBlockSet (still ordered by energy), and reset the work space for the next event:
+  Int_t nunused = 0;
+  for( size_t j=0; j<fBlockSet.size(); j++ ){
+    Int_t ielem = fBlockSet[j].id-fChanMapStart;
+    if( fBlockSetIndex[ielem] >= 0 ){
+      fBlockSetIndex[ielem] = -1;
+      fBlockSet[nunused++] = fBlockSet[j];
+    }
+  }
+  fBlockSet.resize( nunused );
+
   //NOW clustering is finished; we need to loop on fGoodBlocks and assign the cluster IDs;
   for( int iblk=0; iblk<fGoodBlocks.id.size(); iblk++ ){
     auto foundblock = clusterids_by_blockid.find( fGoodBlocks.id[iblk] );
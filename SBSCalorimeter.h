@@ -157,6 +157,7 @@ protected:
   virtual Int_t  ReadDatabase( const TDatime& date );
   virtual Int_t  DefineVariables( EMode mode = kDefine );
   void ClearCaloOutput(SBSCalorimeterOutput &var);
+  void InitNeighborTable();
 
   Int_t  fNclus;        ///< Size of clusters in the output tree
 
@@ -179,6 +180,12 @@ protected:
 
   // Clusters for this event
   std::vector<SBSCalorimeterCluster*> fClusters; // Cluster
+
+  // Island clustering: for each element, the list of elements within fRmax_dis (built in ReadDatabase),
+  // and per-event work space of FindClusters
+  std::vector<std::vector<Int_t> > fNeighbors; //< [element index] element indices of the neighbors
+  std::vector<Int_t> fBlockSetIndex;  //< [element index] position in fBlockSet if not yet in a cluster, else -1
+  std::vector<Int_t> fClusterCandidates; //< positions in fBlockSet of blocks to add to the current cluster
   
   Double_t    fTmax;            //< Maximum time difference for cluster block
   Double_t    fEmin;         //< Minimum energy for a cluster block
@@ -1,26 +1,168 @@
 #include "SBSData.h"
 #include "TMath.h"
 #include <iostream>
+#include <algorithm>
 #define SBS_ADC_MODE_SINGLE 0 //< Simple ADC with only integral
 #define SBS_ADC_MODE_MULTI  1 //< FADC 250 mode 7
 
 namespace SBSData {
 
+  /////////////////////////////////////////////////////////////////////////////
+  // Hit store functions
+  void HitStore::Init(UInt_t nelem)
+  {
+    fBegin.assign(nelem,0);
+    fNhits.assign(nelem,0);
+    fCapacity.assign(nelem,0);
+    fUsed.clear();
+    fUsed.reserve(nelem);
+    fNrows = 0;
+  }
+
+  void HitStore::Clear()
+  {
+    for( auto k : fUsed ) {
+      fBegin[k] = fNhits[k] = fCapacity[k] = 0;
+    }
+    fUsed.clear();
+    fNrows = 0;
+  }
+
+  void HitStore::Reserve(UInt_t ielem, UInt_t n)
+  {
+    if( n == 0 ) return;
+    if( fCapacity[ielem] == 0 )
+      fUsed.push_back(ielem);
+    fCapacity[ielem] += n;
+  }
+
+  void HitStore::Layout()
+  {
+    // Counting sort: the ranges follow each other in element order
+    std::sort( fUsed.begin(), fUsed.end() );
+    UInt_t row = 0;
+    for( auto k : fUsed ) {
+      fBegin[k] = row;
+      row += fCapacity[k];
+    }
+    fNrows = row;
+    Resize(fNrows);
+  }
+
+  UInt_t HitStore::NewHit(UInt_t ielem)
+  {
+    if( fNhits[ielem] == fCapacity[ielem] )
+      Grow( ielem, fCapacity[ielem] > 0 ? 2*fCapacity[ielem] : 4 );
+    return fBegin[ielem] + fNhits[ielem]++;
+  }
+
+  void HitStore::Grow(UInt_t ielem, UInt_t capacity)
+  {
+    // Only the last range can grow in place; any other one is moved to the end
+    // of the columns (its old rows stay unused until the next Clear())
+    UInt_t begin = fBegin[ielem];
+    if( fCapacity[ielem] == 0 ) {
+      fUsed.push_back(ielem);
+      begin = fNrows;
+    } else if( begin+fCapacity[ielem] != fNrows ) {
+      begin = fNrows;
+    }
+    Resize(begin+capacity);
+    if( begin != fBegin[ielem] ) {
+      for( UInt_t i = 0; i < fNhits[ielem]; i++ ) {
+	CopyRow(fBegin[ielem]+i, begin+i);
+      }
+    }
+    fBegin[ielem] = begin;
+    fCapacity[ielem] = capacity;
+    fNrows = begin+capacity;
+  }
+
+  void ADCHitStore::Resize(UInt_t nrows)
+  {
+    if( integral_raw.size() >= nrows ) return;
+    // Grow geometrically, the columns are never shrunk
+    nrows = std::max<size_t>( nrows, 2*integral_raw.size() );
+    integral_raw.resize(nrows);
+    integral_val.resize(nrows);
+    time_raw.resize(nrows);
+    time_val.resize(nrows);
+    amp_raw.resize(nrows);
+    amp_val.resize(nrows);
+  }
+
+  void ADCHitStore::CopyRow(UInt_t from, UInt_t to)
+  {
+    integral_raw[to] = integral_raw[from];
+    integral_val[to] = integral_val[from];
+    time_raw[to] = time_raw[from];
+    time_val[to] = time_val[from];
+    amp_raw[to] = amp_raw[from];
+    amp_val[to] = amp_val[from];
+  }
+
+  void TDCHitStore::Resize(UInt_t nrows)
+  {
+    if( le_raw.size() >= nrows ) return;
+    nrows = std::max<size_t>( nrows, 2*le_raw.size() );
+    le_raw.resize(nrows);
+    le_val.resize(nrows);
+    te_raw.resize(nrows);
+    te_val.resize(nrows);
+    ToT_raw.resize(nrows);
+    ToT_val.resize(nrows);
+    elemID.resize(nrows);
+    TrigTime.resize(nrows);
+  }
+
+  void TDCHitStore::CopyRow(UInt_t from, UInt_t to)
+  {
+    le_raw[to] = le_raw[from];
+    le_val[to] = le_val[from];
+    te_raw[to] = te_raw[from];
+    te_val[to] = te_val[from];
+    ToT_raw[to] = ToT_raw[from];
+    ToT_val[to] = ToT_val[from];
+    elemID[to] = elemID[from];
+    TrigTime[to] = TrigTime[from];
+  }
+
+  void TDCHitStore::ZeroRow(UInt_t row)
+  {
+    le_raw[row] = le_val[row] = 0;
+    te_raw[row] = te_val[row] = 0;
+    ToT_raw[row] = ToT_val[row] = 0;
+    elemID[row] = 0;
+    TrigTime[row] = 0;
+  }
+
   /////////////////////////////////////////////////////////////////////////////
   // ADC data functions
   ADC::ADC(Double_t ped, Double_t gain, Double_t tcal) :
-    fHasData(false), fMode(SBS_ADC_MODE_SINGLE)
+    fHasData(false), fMode(SBS_ADC_MODE_SINGLE), fHits(nullptr), fHitElem(0),
+    fOwnHits(new ADCHitStore)
   {
+    fOwnHits->Init(1);
+    fHits = fOwnHits.get();
     SetPed(ped);
     SetGain(gain);
     SetTimeCal(tcal);
   }
 
+  void ADC::Attach(ADCHitStore *store, UInt_t ielem)
+  {
+    fHits = store;
+    fHitElem = ielem;
+    fOwnHits.reset();
+  }
+
   void ADC::Process(Double_t val)
   {
-    SingleData zero = { 0.0, 0.0 };
-    SingleData integral = { val, (val-fADC.ped)*fADC.cal };
-    fADC.hits.push_back({integral,zero,zero});
+    UInt_t r = fHits->NewHit(fHitElem);
+    fHits->integral_raw[r] = val;
+    fHits->integral_val[r] = (val-fADC.ped)*fADC.cal;
+    fHits->time_raw[r] = fHits->time_val[r] = 0.0;
+    fHits->amp_raw[r] = fHits->amp_val[r] = 0.0;
     fHasData = true;
     fMode = SBS_ADC_MODE_SINGLE; //< Mode gets set to simple if this function is called
   }
@@ -35,10 +177,13 @@ namespace SBSData {
     Double_t IntVal=  (IntRaw-PedVal*(GetNSA()+GetNSB()+1)*pC_Conv)*GetGain();
     Double_t AmpRaw=  amp*GetChanTomV();
     Double_t AmpVal=  (AmpRaw-PedVal)*GetAmpCal();
-    SingleData t_integral = { IntRaw, IntVal   };
-    SingleData t_time     = { time, TimeVal };
-    SingleData t_amp     = { AmpRaw, AmpVal };
-    fADC.hits.push_back({t_integral,t_time,t_amp } );
+    UInt_t r = fHits->NewHit(fHitElem);
+    fHits->integral_raw[r] = IntRaw;
+    fHits->integral_val[r] = IntVal;
+    fHits->time_raw[r] = time;
+    fHits->time_val[r] = TimeVal;
+    fHits->amp_raw[r] = AmpRaw;
+    fHits->amp_val[r] = AmpVal;
     SetPed(PedVal);
     fHasData = true;
     fMode = SBS_ADC_MODE_MULTI; //< Mode gets set to multi if this function is called
@@ -47,14 +192,18 @@ namespace SBSData {
   void ADC::Clear()
   {
     fADC.good_hit = 0;
-    fADC.hits.clear();
+    if( fOwnHits )
+      fOwnHits->Clear();
     fHasData = false;
   }
 
   /////////////////////////////////////////////////////////////////////////////
   // TDC data functions
-  TDC::TDC(Double_t offset, Double_t cal, Double_t GoodTimeCut) : fHasData(false)
+  TDC::TDC(Double_t offset, Double_t cal, Double_t GoodTimeCut) : fHasData(false),
+    fHits(nullptr), fHitElem(0), fOwnHits(new TDCHitStore)
   {
+    fOwnHits->Init(1);
+    fHits = fOwnHits.get();
     fEdgeIdx[0] = fEdgeIdx[1]=0;
     SetOffset(offset);
     SetCal(cal);
@@ -62,49 +211,54 @@ namespace SBSData {
     fTrigPhaseCorr = 0.0; 
   }
 
+  void TDC::Attach(TDCHitStore *store, UInt_t ielem)
+  {
+    fHits = store;
+    fHitElem = ielem;
+    fOwnHits.reset();
+  }
+
   void TDC::ProcessSimple(Int_t elemID, Double_t val, Int_t nhit,UInt_t TrigTime)
   {
-    fTDC.hits.push_back(TDCHit());
-    Int_t size = fTDC.hits.size();
-    TDCHit *hit = &fTDC.hits[size-1];
-    hit->elemID = elemID;
-    hit->TrigTime = TrigTime;
-    hit->le.raw = val;
-    hit->le.val = (val-fTDC.offset)*fTDC.cal;
-    hit->te.raw = 0;
-    hit->te.val = 0;
-    hit->ToT.raw=0;
-    hit->ToT.val=0;
+    UInt_t r = fHits->NewHit(fHitElem);
+    fHits->elemID[r] = elemID;
+    fHits->TrigTime[r] = TrigTime;
+    fHits->le_raw[r] = val;
+    fHits->le_val[r] = (val-fTDC.offset)*fTDC.cal;
+    fHits->te_raw[r] = 0;
+    fHits->te_val[r] = 0;
+    fHits->ToT_raw[r] = 0;
+    fHits->ToT_val[r] = 0;
     fHasData = true;
   }
 
   void TDC::Process(Int_t elemID, Double_t val, Double_t fedge)
   {
     Int_t edge = int(fedge);
-    // std::cout << " tdc process " << val << " " << edge  << " ftdc hits size = " <<fTDC.hits.size() << " hits in edge "  << fEdgeIdx[edge]<< std::endl;
+    // std::cout << " tdc process " << val << " " << edge  << " ftdc hits size = " << GetNHits() << " hits in edge "  << fEdgeIdx[edge]<< std::endl;
     if(edge < 0 || edge>1) {
       std::cerr << "Edge specified is not valid!" << std::endl;
       edge = 0;
     }
     size_t idx = fEdgeIdx[edge]++;
-    if(idx >= fTDC.hits.size()) {
+    if(idx >= size_t(GetNHits())) {
       // Must grow the hits array to accomodate the new hit
-      // if ( edge ==1)   std::cout << " First edge is TE , this is not right: " << "  idx = " << idx  << " ftdc hits size = " <<fTDC.hits.size() << " hits with LE ="  << fEdgeIdx[0] << " hits with TE ="  << fEdgeIdx[1] << std::endl;
-      fTDC.hits.push_back(TDCHit());
+      // if ( edge ==1)   std::cout << " First edge is TE , this is not right: " << "  idx = " << idx  << " ftdc hits size = " << GetNHits() << " hits with LE ="  << fEdgeIdx[0] << " hits with TE ="  << fEdgeIdx[1] << std::endl;
+      fHits->ZeroRow( fHits->NewHit(fHitElem) );
     }
-    TDCHit *hit = &fTDC.hits[idx];
-    hit->elemID = elemID;
-    hit->TrigTime = 0;
+    UInt_t r = Row(idx);
+    fHits->elemID[r] = elemID;
+    fHits->TrigTime[r] = 0;
     if( edge == 0 ) { // Leading edge
-      hit->le.raw = val;
-      hit->le.val = (val-fTDC.offset)*fTDC.cal;
+      fHits->le_raw[r] = val;
+      fHits->le_val[r] = (val-fTDC.offset)*fTDC.cal;
     } else {
-      hit->te.raw = val;
-      hit->te.val = (val-fTDC.offset)*fTDC.cal;
+      fHits->te_raw[r] = val;
+      fHits->te_val[r] = (val-fTDC.offset)*fTDC.cal;
     }
     if(fEdgeIdx[0] == fEdgeIdx[1]) { // Both leading and trailing edges now found
-      hit->ToT.raw = hit->te.raw - hit->le.raw;
-      hit->ToT.val = hit->te.val - hit->le.val;
+      fHits->ToT_raw[r] = fHits->te_raw[r] - fHits->le_raw[r];
+      fHits->ToT_val[r] = fHits->te_val[r] - fHits->le_val[r];
     }
     if(fEdgeIdx[1] > fEdgeIdx[0]) fEdgeIdx[0] = fEdgeIdx[1]; // if TE found first force LE count to increase
     fHasData = true;
@@ -113,7 +267,8 @@ namespace SBSData {
   void TDC::Clear()
   {
     fEdgeIdx[0] = fEdgeIdx[1] = 0;
-    fTDC.hits.clear();
+    if( fOwnHits )
+      fOwnHits->Clear();
     fHasData = false;
     fTDC.good_hit = 0;
   }
@@ -132,106 +287,146 @@ namespace SBSData {
 
   void Waveform::Process(std::vector<Double_t> &vals)
   {
-    //printf("vals size %d, samples raw size %d\n", vals.size(), fSamples.samples_raw.size());
-    if( vals.size() != fSamples.samples_raw.size()) {
-      // Resize our data vector
-      fSamples.samples_raw.resize(vals.size());
-      fSamples.samples.resize(vals.size());
+    Process(vals.data(), vals.size());
+  }
+
+  void Waveform::Process(const Double_t *vals, size_t n)
+  {
+    //printf("vals size %d, samples raw size %d\n", n, fSamples.samples_raw.size());
+    if( n != fSamples.samples_raw.size()) {
+      // Resize our data vector (only happens when the readout window changes)
+      fSamples.samples_raw.resize(n);
+      fSamples.samples.resize(n);
       Clear();
     }
-    //
-    for(size_t i = 0; i < vals.size(); i++ ) {
-      fSamples.samples_raw[i] = vals[i]*fSamples.ChanTomV;
+    fSamples.hits.clear();
+    fSamples.tot.clear();
+    fHasData = (n > 0);
+    if( n == 0 ) return;
+
+    // All the per-sample loops below run over plain contiguous buffers with
+    // no branches, so that the compiler can vectorize them.
+    Double_t *raw = fSamples.samples_raw.data();
+    Double_t *cal = fSamples.samples.data();
+    const Double_t ChanTomV = fSamples.ChanTomV;
+    for(size_t i = 0; i < n; i++ ) {
+      raw[i] = vals[i]*ChanTomV;
     }
     // Determining pedestal in first and last four samples. Will choose the
     // minimum of the two.
     Double_t pedsum_fsamps=0, pedsum_lsamps=0;
-    Int_t NPedsum=GetNPedBin(), totTimeSamps=vals.size();
-    
-    NPedsum= TMath::Min(NPedsum,int(vals.size()));
+    Int_t NPedsum=GetNPedBin(), totTimeSamps=n;
+
+    NPedsum= TMath::Min(NPedsum,totTimeSamps);
     // std::cout << " Npedsum = " << NPedsum << " " << GetNPedBin() << std::endl;
-    
+
     for(Int_t i = 0; i < NPedsum ; i++ ) {
       // Computing pedestal using first N samples
-      pedsum_fsamps += fSamples.samples_raw[i];
+      pedsum_fsamps += raw[i];
       // Computing pedestal using last N samples
-      pedsum_lsamps += fSamples.samples_raw[(totTimeSamps-1)-i];
+      pedsum_lsamps += raw[(totTimeSamps-1)-i];
     }
-   
-    SetPed( TMath::Min(pedsum_fsamps,pedsum_lsamps)/NPedsum );
-    for(size_t i = 0; i < vals.size(); i++ ) {
-      fSamples.samples[i] = (fSamples.samples_raw[i]-fSamples.ped)*fSamples.cal;
+
+    if( NPedsum > 0 )
+      SetPed( TMath::Min(pedsum_fsamps,pedsum_lsamps)/NPedsum );
+    const Double_t ped = fSamples.ped, gain = fSamples.cal;
+    for(size_t i = 0; i < n; i++ ) {
+      cal[i] = (raw[i]-ped)*gain;
     }
-    
-    // Try and fixd sample threshold crossing above the pedestal
-    Double_t ThresVal=GetThres(); // mV
-    UInt_t ThresCrossBin=TMath::Max(NPedsum-1,0);
-    //    std::cout << " ped = " << fSamples.ped << " thres = " << ThresVal << std::endl ;
-    while ( ThresCrossBin < vals.size() && fSamples.samples_raw[ThresCrossBin] < fSamples.ped+ThresVal ) {
-      ThresCrossBin++;
+
+    // Find every threshold crossing above the pedestal in the window. After
+    // each pulse the search is re-armed only once the signal has dropped
+    // back below threshold and the NSA integration window has ended, as in
+    // the FADC250 firmware (mode 7).
+    const Double_t ThresLevel = ped+GetThres(); // mV
+    UInt_t ThresCrossBin = TMath::Max(NPedsum-1,0);
+    PulseADCData pulse;
+    SingleData tot;
+    while( ThresCrossBin < n ) {
+      while ( ThresCrossBin < n && raw[ThresCrossBin] < ThresLevel ) {
+	ThresCrossBin++;
+      }
+      if( ThresCrossBin >= n )
+	break;
+      ThresCrossBin = AnalyzePulse(raw, n, ThresCrossBin, pulse, tot);
+      fSamples.hits.push_back(pulse);
+      fSamples.tot.push_back(tot);
     }
-    //
-    // if threshold crossing found
+
+    // The single-pulse quantities are those of the first pulse. If no
+    // threshold crossing was found integrate over the fixed window.
+    if( !fSamples.hits.empty() ) {
+      fSamples.pulse = fSamples.hits[0];
+    } else {
+      AnalyzePulse(raw, n, n, fSamples.pulse, tot);
+    }
+  }
+
+  UInt_t Waveform::AnalyzePulse(const Double_t *raw, UInt_t n, UInt_t ThresCrossBin,
+				PulseADCData &pulse, SingleData &tot) const
+  {
+    const Double_t ped = fSamples.ped;
     UInt_t NSB = GetNSB();
     UInt_t NSA = GetNSA();
     UInt_t FixedThresCrossBin=GetFixThresBin();
     Double_t FineTime = 0;
     Double_t max  = 0;
     Double_t sum = 0;
-    Double_t sped = 0;
-    
+
     Bool_t PeakFound= kFALSE;
     UInt_t PeakBin= 0;
     UInt_t IntMinBin= 0;
-    UInt_t IntMaxBin= vals.size();
-    if (ThresCrossBin < vals.size()) {
-      IntMinBin= TMath::Max(ThresCrossBin-NSB,IntMinBin);
-      IntMaxBin= TMath::Min(ThresCrossBin+NSA-1,IntMaxBin);
-    } else {
-      IntMinBin = TMath::Max(FixedThresCrossBin-NSB,IntMinBin);
-      IntMaxBin = TMath::Min(FixedThresCrossBin+NSA-1,IntMaxBin);
-    }
+    UInt_t IntMaxBin= n;
+    UInt_t CrossBin = ThresCrossBin < n ? ThresCrossBin : FixedThresCrossBin;
+    // (guard against unsigned wrap-around for pulses at the start of the window)
+    if (CrossBin > NSB) IntMinBin = CrossBin-NSB;
+    if (CrossBin+NSA >= 1) IntMaxBin= TMath::Min(CrossBin+NSA-1,IntMaxBin);
+    if (IntMinBin > IntMaxBin) IntMinBin = IntMaxBin;
     // convert to pC, assume tcal is in ns, and 50ohm resistance
     Double_t pC_Conv = fSamples.tcal/50.;
-    
-    for(size_t i =IntMinBin ; i <IntMaxBin ; i++ ) {
-      sped+=fSamples.ped*pC_Conv;
-      sum+=fSamples.samples_raw[i]*pC_Conv;
-      if ( i >= ThresCrossBin && !PeakFound) {
-	if (fSamples.samples_raw[i] > max) {
-	  max = fSamples.samples_raw[i];
-	} else {
-	  PeakFound= kTRUE;
-	  PeakBin = i-1;
-	}
+
+    Double_t sped = 0;
+    for(UInt_t i =IntMinBin ; i <IntMaxBin ; i++ ) {
+      sped+=ped*pC_Conv;
+      sum+=raw[i]*pC_Conv;
+    }
+    for(UInt_t i = TMath::Max(IntMinBin,ThresCrossBin); i < IntMaxBin && !PeakFound; i++ ) {
+      if (raw[i] > max) {
+	max = raw[i];
+      } else {
+	PeakFound= kTRUE;
+	PeakBin = i-1;
       }
     }
     //
     //    std::cout << " Int = " << IntMinBin << " " << IntMaxBin<< " ThresCrossBin =   " << ThresCrossBin << " peak-found " << PeakFound << std::endl ;
     //
-    Double_t VMid = (max+fSamples.ped)/2.;
+    Double_t VMid = (max+ped)/2.;
     if (PeakFound) {
-      for(size_t i =IntMinBin ; i <PeakBin+1 ; i++ ) {
-	if (VMid >= fSamples.samples_raw[i]  && VMid < fSamples.samples_raw[i+1]) {
-	  FineTime = i+(VMid-fSamples.samples_raw[i])/(fSamples.samples_raw[i+1]-fSamples.samples_raw[i]);
+      for(UInt_t i =IntMinBin ; i <PeakBin+1 ; i++ ) {
+	if (VMid >= raw[i]  && VMid < raw[i+1]) {
+	  FineTime = i+(VMid-raw[i])/(raw[i+1]-raw[i]);
 	}
       }
     }
-    
-    /*
-      if (ThresCrossBin==vals.size()) {
-      std::cout << " Threshold = " << fThresVal << " ped = " << fSamples.ped << " element = " << ThresCrossBin << " " << " Vmid = " << VMid << "  sum = " << sum << " max = " << max << " time = " << FineTime << " tcal = " << fSamples.tcal <<  std::endl;
-      }
-    */
-    fSamples.pulse.integral.raw = sum;
-    fSamples.pulse.integral.val = (sum-sped)*fSamples.cal;
-    fSamples.pulse.time.raw = FineTime;
-    fSamples.pulse.time.val = (FineTime)*fSamples.tcal + fSamples.timeoffset;
-    fSamples.pulse.amplitude.raw = max;
-    fSamples.pulse.amplitude.val = (max-fSamples.ped)*fSamples.acal;
-    if (max==0) fSamples.pulse.amplitude.val=max;
-    //
-    fHasData = (vals.size() > 0);
+
+    pulse.integral.raw = sum;
+    pulse.integral.val = (sum-sped)*fSamples.cal;
+    pulse.time.raw = FineTime;
+    pulse.time.val = (FineTime)*fSamples.tcal + fSamples.timeoffset;
+    pulse.amplitude.raw = max;
+    pulse.amplitude.val = (max-ped)*fSamples.acal;
+    if (max==0) pulse.amplitude.val=max;
+
+    // Time-over-threshold: number of consecutive samples at or above
+    // threshold starting from the crossing
+    UInt_t EndBin = ThresCrossBin;
+    const Double_t ThresLevel = ped+GetThres();
+    while( EndBin < n && raw[EndBin] >= ThresLevel ) EndBin++;
+    tot.raw = EndBin-ThresCrossBin;
+    tot.val = tot.raw*fSamples.tcal;
+
+    return TMath::Max(EndBin,IntMaxBin);
   }
 
   void Waveform::Clear()
@@ -239,6 +434,8 @@ namespace SBSData {
     for(size_t i = 0; i < fSamples.samples.size(); i++) {
       fSamples.samples_raw[i] = fSamples.samples[i] = 0;
     }
+    fSamples.hits.clear();
+    fSamples.tot.clear();
     fHasData = false;
   }
 
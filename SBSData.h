@@ -2,6 +2,7 @@
 #define SBSDATA_H
 
 #include <vector>
+#include <memory>
 #include <Rtypes.h> // Include standard ROOT types
 
 namespace SBSData {
@@ -35,7 +36,6 @@ namespace SBSData {
     Int_t NPedBin; //< Programmed # of samples used in pedestal average in FADC
     Double_t GoodTimeCut;    //< Time Cut to select good hit in multihit ADC.
     Double_t ChanTomV;    //< milliVolts/channel for FADC
-    std::vector<PulseADCData> hits; //< Pulse data
     Int_t good_hit; //< Index of good hit
   };
 
@@ -59,7 +59,9 @@ namespace SBSData {
     Int_t good_hit; //< Index of good hit
     std::vector<Double_t> samples_raw; //< Raw samples
     std::vector<Double_t> samples;     //< Calibrated samples
-    PulseADCData         pulse;       //< Pulse information
+    PulseADCData         pulse;       //< Pulse information (first pulse in window)
+    std::vector<PulseADCData> hits;   //< All pulses found in the window
+    std::vector<SingleData>   tot;    //< Time-over-threshold of each pulse in hits
   };
 
   ///////////////////////////////////////////////////////////////////////////////
@@ -79,17 +81,142 @@ namespace SBSData {
     Double_t offset; //< Time offset
     Double_t cal;    //< Conversion factor
     Double_t GoodTimeCut;    //< Time Cut to select good hit in multihit TDC.
-    std::vector<TDCHit> hits;
     Int_t good_hit; //< Index of good hit
   };
 
+  ///////////////////////////////////////////////////////////////////////////////
+  // Read-only view of a contiguous range of one hit column (see HitStore)
+  template<typename T> class Span {
+    public:
+      Span() : fData(nullptr), fSize(0) {}
+      Span(const T *data, size_t n) : fData(data), fSize(n) {}
+
+      const T* begin() const { return fData; }
+      const T* end()   const { return fData+fSize; }
+      const T* data()  const { return fData; }
+      size_t size()    const { return fSize; }
+      bool empty()     const { return fSize == 0; }
+      const T& operator[](size_t i) const { return fData[i]; }
+
+    private:
+      const T *fData;
+      size_t fSize;
+  };
+
+  ///////////////////////////////////////////////////////////////////////////////
+  // Detector-wide hit storage, one column per hit quantity. The hits of element
+  // ielem are the rows [Begin(ielem),Begin(ielem)+GetNHits(ielem)) of every column.
+  //
+  // The owner lays out the ranges once per event with a counting pass before any
+  // hit is stored: Reserve() the maximum number of hits of each element, then
+  // Layout() places the ranges back to back in element order. The hits of all
+  // elements then are contiguous and no column is resized during decoding.
+  // Without (or beyond) a reservation NewHit() still works: the range of the
+  // element is grown at the end of the columns, moving its rows if needed.
+  class HitStore {
+    public:
+      HitStore() : fNrows(0) {}
+      virtual ~HitStore() = default;
+
+      // Set the number of elements; drops all hits
+      void Init(UInt_t nelem);
+      // Drop the hits of the event (keeps the memory of the columns)
+      void Clear();
+      // Counting pass: element ielem will get at most n more hits
+      void Reserve(UInt_t ielem, UInt_t n);
+      // Place the reserved ranges in element order
+      void Layout();
+      // Append a hit to the range of element ielem, returns its row
+      UInt_t NewHit(UInt_t ielem);
+
+      UInt_t GetNelem()              const { return fBegin.size(); }
+      UInt_t GetNrows()              const { return fNrows; }
+      UInt_t Begin(UInt_t ielem)     const { return fBegin[ielem]; }
+      UInt_t GetNHits(UInt_t ielem)  const { return fNhits[ielem]; }
+
+      // Hits of element ielem in column col
+      template<typename T> Span<T> Range(const std::vector<T> &col, UInt_t ielem) const
+      { return Span<T>(col.data()+fBegin[ielem], fNhits[ielem]); }
+
+    protected:
+      // Make all columns at least nrows long
+      virtual void Resize(UInt_t nrows) = 0;
+      // Copy row "from" to row "to" in all columns
+      virtual void CopyRow(UInt_t from, UInt_t to) = 0;
+
+      void Grow(UInt_t ielem, UInt_t capacity);
+
+      std::vector<UInt_t> fBegin;    //< First row of each element
+      std::vector<UInt_t> fNhits;    //< Number of hits of each element
+      std::vector<UInt_t> fCapacity; //< Number of rows reserved for each element
+      std::vector<UInt_t> fUsed;     //< Elements with a range in this event
+      UInt_t fNrows;                 //< Number of rows in use (including unused capacity)
+  };
+
+  ///////////////////////////////////////////////////////////////////////////////
+  // Pulse ADC hits
+  class ADCHitStore : public HitStore {
+    public:
+      PulseADCData GetHit(UInt_t row) const {
+        return { { integral_raw[row], integral_val[row] },
+	         { time_raw[row], time_val[row] },
+	         { amp_raw[row], amp_val[row] } };
+      }
+
+      // all public columns
+      std::vector<Double_t> integral_raw;
+      std::vector<Double_t> integral_val;
+      std::vector<Double_t> time_raw;
+      std::vector<Double_t> time_val;
+      std::vector<Double_t> amp_raw;
+      std::vector<Double_t> amp_val;
+
+    protected:
+      virtual void Resize(UInt_t nrows);
+      virtual void CopyRow(UInt_t from, UInt_t to);
+  };
+
+  ///////////////////////////////////////////////////////////////////////////////
+  // TDC hits
+  class TDCHitStore : public HitStore {
+    public:
+      TDCHit GetHit(UInt_t row) const {
+        return { { le_raw[row], le_val[row] },
+	         { te_raw[row], te_val[row] },
+	         { ToT_raw[row], ToT_val[row] },
+	         elemID[row], TrigTime[row] };
+      }
+      // Set all quantities of a row to zero
+      void ZeroRow(UInt_t row);
+
+      // all public columns
+      std::vector<Double_t> le_raw;
+      std::vector<Double_t> le_val;
+      std::vector<Double_t> te_raw;
+      std::vector<Double_t> te_val;
+      std::vector<Double_t> ToT_raw;
+      std::vector<Double_t> ToT_val;
+      std::vector<Int_t>    elemID;
+      std::vector<UInt_t>   TrigTime;
+
+    protected:
+      virtual void Resize(UInt_t nrows);
+      virtual void CopyRow(UInt_t from, UInt_t to);
+  };
+
   ///////////////////////////////////////////////////////////////////////////////
   // ADC single valued
+  //
+  // The hits are kept in an ADCHitStore. A detector attaches all its channels
+  // to one store (see Attach()); until then the ADC uses a private store.
   class ADC {
     public:
     ADC(Double_t ped = 0.0, Double_t gain = 1.0, Double_t tcal = 4.0);
       virtual ~ADC() {};
 
+      // Keep the hits of this channel as element ielem of a detector-wide store
+      void Attach(ADCHitStore *store, UInt_t ielem);
+
       // Getters
       Double_t GetPed()                  const { return fADC.ped;            }
       Double_t GetGain()                 const { return fADC.cal;            }
@@ -103,19 +230,26 @@ namespace SBSData {
       Int_t GetNPedBin()                      const { return fADC.NPedBin; }
       Double_t GetChanTomV() const { return fADC.ChanTomV; }
       Double_t GetGoodHitIndex()            const { return fADC.good_hit; }
-      PulseADCData GetHit(UInt_t i)     const { return fADC.hits[i];        }
-      PulseADCData GetGoodHit()         const { return fADC.hits[fADC.good_hit]; }
-      SingleData GetIntegral(UInt_t i)  const { return GetHit(i).integral;  }
-      SingleData GetTime(UInt_t i)      const { return GetHit(i).time;      }
-      SingleData GetAmplitude(UInt_t i) const { return GetHit(i).amplitude; }
-      ADCData GetADC()                  const { return fADC;                }
-      Int_t GetNHits()                        { return fADC.hits.size();    }
+      // Single hits are assembled from the columns of the hit store
+      PulseADCData GetHit(UInt_t i)      const { return fHits->GetHit(Row(i)); }
+      PulseADCData GetGoodHit()          const { return GetHit(fADC.good_hit); }
+      SingleData GetIntegral(UInt_t i)   const { UInt_t r = Row(i); return { fHits->integral_raw[r], fHits->integral_val[r] }; }
+      SingleData GetTime(UInt_t i)       const { UInt_t r = Row(i); return { fHits->time_raw[r], fHits->time_val[r] }; }
+      SingleData GetAmplitude(UInt_t i)  const { UInt_t r = Row(i); return { fHits->amp_raw[r], fHits->amp_val[r] }; }
+      const ADCData& GetADC()                  const { return fADC;                }
+      Int_t GetNHits()                   const { return fHits->GetNHits(fHitElem); }
 
       // Some additional helper functions for easy access to the ADC integral
-      Double_t GetDataRaw(UInt_t i)      const { return GetHit(i).integral.raw; }
-      Double_t GetTimeData(UInt_t i)         const { return GetHit(i).time.val; }
-      Double_t GetData(UInt_t i)         const { return GetHit(i).integral.val; }
-     std::vector<PulseADCData> GetAllHits()  const { return  fADC.hits; }
+      Double_t GetDataRaw(UInt_t i)      const { return fHits->integral_raw[Row(i)]; }
+      Double_t GetTimeData(UInt_t i)         const { return fHits->time_val[Row(i)]; }
+      Double_t GetData(UInt_t i)         const { return fHits->integral_val[Row(i)]; }
+
+      // All hits of this channel, one quantity at a time (valid until the next
+      // Process() or until the store is cleared)
+      Span<Double_t> GetAllIntegralsRaw() const { return fHits->Range(fHits->integral_raw, fHitElem); }
+      Span<Double_t> GetAllIntegrals()    const { return fHits->Range(fHits->integral_val, fHitElem); }
+      Span<Double_t> GetAllTimes()        const { return fHits->Range(fHits->time_val, fHitElem); }
+      Span<Double_t> GetAllAmplitudes()   const { return fHits->Range(fHits->amp_val, fHitElem); }
 
       // Setters
       void SetPed(Double_t var)  { fADC.ped = var; }
@@ -137,39 +271,57 @@ namespace SBSData {
       // Do we have ADC data for this event?
       Bool_t HasData() { return fHasData; }
 
-      // Clear event
+      // Clear event (the hits of an attached store are dropped by its owner)
       virtual void Clear();
 
     protected:
+      UInt_t Row(UInt_t i) const { return fHits->Begin(fHitElem)+i; }
+
       ADCData fADC; ///< ADC single-value data
       Bool_t fHasData;
       Int_t  fMode; //< ADC mode where 0 == simple, 1 == multi function
+      ADCHitStore *fHits; //! Hit columns (detector-wide store or fOwnHits)
+      UInt_t fHitElem;    //! Index of this channel in fHits
+      std::unique_ptr<ADCHitStore> fOwnHits; //! Private store when not attached
   };
 
   ///////////////////////////////////////////////////////////////////////////////
   // TDC single valued
+  //
+  // The hits are kept in a TDCHitStore (see ADC above)
   class TDC {
     public:
       TDC(Double_t offset = 0.0, Double_t cal = 1.0, Double_t GoodTimeCut = 1.0);
       virtual ~TDC() {};
 
+      // Keep the hits of this channel as element ielem of a detector-wide store
+      void Attach(TDCHitStore *store, UInt_t ielem);
+
       // Getters
       Double_t GetOffset()           const { return fTDC.offset;     }
       Double_t GetCal()              const { return fTDC.cal;        }
       Double_t GetGoodTimeCut()              const { return fTDC.GoodTimeCut;}
       Double_t GetGoodHitIndex()            const { return fTDC.good_hit; }
-      TDCHit GetHit(UInt_t i)       const { return fTDC.hits[i];    }
-      SingleData GetLead(UInt_t i)  const { return GetHit(i).le;    }
-      SingleData GetTrail(UInt_t i) const { return GetHit(i).te;    }
-      TDCHit GetGoodHit()           const { return fTDC.hits[fTDC.good_hit]; }
-      Int_t GetNHits()                    { return fTDC.hits.size();    }
-      UInt_t GetTrigTime(UInt_t i)  const { return GetHit(i).TrigTime;   }
-      std::vector<TDCHit> GetAllHits() const { return  fTDC.hits; }
+      // Single hits are assembled from the columns of the hit store
+      TDCHit GetHit(UInt_t i)        const { return fHits->GetHit(Row(i)); }
+      SingleData GetLead(UInt_t i)   const { UInt_t r = Row(i); return { fHits->le_raw[r], fHits->le_val[r] }; }
+      SingleData GetTrail(UInt_t i)  const { UInt_t r = Row(i); return { fHits->te_raw[r], fHits->te_val[r] }; }
+      TDCHit GetGoodHit()            const { return GetHit(fTDC.good_hit); }
+      Int_t GetNHits()               const { return fHits->GetNHits(fHitElem); }
+      UInt_t GetTrigTime(UInt_t i)   const { return fHits->TrigTime[Row(i)]; }
 
       // Helper functions to get leading edge info
-      Double_t GetData(UInt_t i)     const { return GetLead(i).val;  }
-      Double_t GetDataRaw(UInt_t i)  const { return GetLead(i).raw;  }
-      Double_t GetToT(UInt_t i)      const { return GetHit(i).ToT.val; }
+      Double_t GetData(UInt_t i)     const { return fHits->le_val[Row(i)];  }
+      Double_t GetDataRaw(UInt_t i)  const { return fHits->le_raw[Row(i)];  }
+      Double_t GetToT(UInt_t i)      const { return fHits->ToT_val[Row(i)]; }
+
+      // All hits of this channel, one quantity at a time (see ADC above)
+      Span<Double_t> GetAllLeadsRaw() const { return fHits->Range(fHits->le_raw, fHitElem); }
+      Span<Double_t> GetAllLeads()    const { return fHits->Range(fHits->le_val, fHitElem); }
+      Span<Double_t> GetAllTrails()   const { return fHits->Range(fHits->te_val, fHitElem); }
+      Span<Double_t> GetAllToT()      const { return fHits->Range(fHits->ToT_val, fHitElem); }
+      Span<Int_t> GetAllElemIDs()     const { return fHits->Range(fHits->elemID, fHitElem); }
+      Span<UInt_t> GetAllTrigTimes()  const { return fHits->Range(fHits->TrigTime, fHitElem); }
 
       // Setters
       void SetOffset(Double_t var)  { fTDC.offset = var; }
@@ -185,14 +337,19 @@ namespace SBSData {
       // Do we have TDC data for this event?
       Bool_t HasData() { return fHasData; }
 
-      // Clear event
+      // Clear event (the hits of an attached store are dropped by its owner)
       virtual void Clear();
 
     protected:
-      TDCData fTDC; ///< TDC hit container
+      UInt_t Row(UInt_t i) const { return fHits->Begin(fHitElem)+i; }
+
+      TDCData fTDC; ///< TDC calibration data
       Bool_t fHasData;
       size_t fEdgeIdx[2]; //< Current index of the next hit data
     Double_t fTrigPhaseCorr; //default to zero in the constructor
+      TDCHitStore *fHits; //! Hit columns (detector-wide store or fOwnHits)
+      UInt_t fHitElem;    //! Index of this channel in fHits
+      std::unique_ptr<TDCHitStore> fOwnHits; //! Private store when not attached
   };
 
   ///////////////////////////////////////////////////////////////////////////////
@@ -219,14 +376,20 @@ namespace SBSData {
       Int_t GetGoodHitIndex()   const { return fSamples.good_hit; }
       std::vector<Double_t>& GetDataRaw() { return fSamples.samples_raw; }
       std::vector<Double_t>& GetData() { return fSamples.samples; }
-      PulseADCData GetPulse()   const { return fSamples.pulse; }
-      SingleData GetIntegral()  const { return fSamples.pulse.integral; }
-      SingleData GetTime()      const { return fSamples.pulse.time; }
-      SingleData GetAmplitude() const { return fSamples.pulse.amplitude; }
+      const PulseADCData& GetPulse()   const { return fSamples.pulse; }
+      const SingleData& GetIntegral()  const { return fSamples.pulse.integral; }
+      const SingleData& GetTime()      const { return fSamples.pulse.time; }
+      const SingleData& GetAmplitude() const { return fSamples.pulse.amplitude; }
       Double_t GetTimeData()    const { return fSamples.pulse.time.val; }
+      // All pulses found in the window (same layout as the mode 7 ADC hits)
+      UInt_t GetNHits()                 const { return fSamples.hits.size(); }
+      const PulseADCData& GetHit(UInt_t i) const { return fSamples.hits[i]; }
+      const SingleData& GetToT(UInt_t i)   const { return fSamples.tot[i]; }
+      const std::vector<PulseADCData>& GetAllHits() const { return fSamples.hits; }
 
       // Setters
       void SetValTime(Double_t var)  { fSamples.pulse.time.val = var; }
+      void SetValTime(UInt_t i, Double_t var)  { fSamples.hits[i].time.val = var; }
       void SetPed(Double_t var)  { fSamples.ped = var; }
       void SetGain(Double_t var) { fSamples.cal = var; }
       void SetChanTomV(Double_t var) { fSamples.ChanTomV = var; }
@@ -239,6 +402,8 @@ namespace SBSData {
       void SetWaveformParam(Double_t var,Int_t i1,Int_t i2,Int_t i3, Int_t i4) { fSamples.thres = var;fSamples.FixThresBin=i1;fSamples.NSB=i2;fSamples.NSA=i3;fSamples.NPedBin=i4;}
       // Process data sets raw value, ped-subtracted and calibrated data
       virtual void Process(std::vector<Double_t> &var);
+      // Same, for n samples in a contiguous buffer (no copy of the caller's data)
+      virtual void Process(const Double_t *vals, size_t n);
 
       // Do we have samples data for this event?
       Bool_t HasData() const { return fHasData; }
@@ -246,6 +411,12 @@ namespace SBSData {
       // Clear event
       virtual void Clear();
     protected:
+      // Integrate/time the pulse whose threshold crossing is at bin ThresCrossBin
+      // (or the fixed window if ThresCrossBin >= n). Returns the first bin at
+      // which the search for the next pulse may start.
+      UInt_t AnalyzePulse(const Double_t *raw, UInt_t n, UInt_t ThresCrossBin,
+			  PulseADCData &pulse, SingleData &tot) const;
+
       WaveformData fSamples; ///< Samples single-value data
       Bool_t fHasData;
   };
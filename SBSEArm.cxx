@@ -12,6 +12,7 @@
 #include "SBSGEMPolarimeterTracker.h"
 #include "THaTrack.h"
 #include "SBSRasteredBeam.h"
+#include "Helper.h"
 #include "THaTrackingDetector.h"
 #include "TClass.h"
 
@@ -40,6 +41,9 @@ THaSpectrometer( name, description )
   fForwardOpticsOrder = -1; //default to -1.
   fOpticsNterms = -1;
   fForwardOpticsNterms = -1;
+
+  fRasteredBeamName = "";
+  fRasteredBeam = nullptr;
   
   SetPID( false );
 
@@ -273,6 +277,7 @@ Int_t SBSEArm::ReadDatabase( const TDatime& date )
     { "forwardoptics_parameters", &foptics_param, kDoubleV, 0, 1, 1 },
     { "analyzerthick", &fAnalyzerThick, kDouble, 0, 1, 1 },
     { "nbinsz_fcp", &fNbinsZBackTrackerConstraint, kInt, 0, 1, 1 },
+    { "rasteredbeam_name", &fRasteredBeamName, kString, 0, 1, 1 },
     {0}
   };
 
@@ -391,6 +396,11 @@ Int_t SBSEArm::ReadDatabase( const TDatime& date )
       f_oj[i] = int(optics_param[9*i+7]);
       f_oi[i] = int(optics_param[9*i+8]);
     }
+
+    if( !fTargetOptics.Init( f_om, f_ol, f_ok, f_oj, f_oi,
+			     { &fb_xptar, &fb_yptar, &fb_ytar, &fb_pinv } ) ) return kInitError;
+  } else {
+    fTargetOptics.Clear();
   }
 
   //This code for forward optics modeling is yet-another copy-paste job from SBSBigBite!
@@ -446,6 +456,11 @@ Int_t SBSEArm::ReadDatabase( const TDatime& date )
       f_foj[i] = int(foptics_param[9*i+7]);
       f_foi[i] = int(foptics_param[9*i+8]);
     }
+
+    if( !fForwardOptics.Init( f_fom, f_fol, f_fok, f_foj, f_foi,
+			      { &fb_xfp, &fb_yfp, &fb_xpfp, &fb_ypfp } ) ) return kInitError;
+  } else {
+    fForwardOptics.Clear();
   }
   
   fIsInit = true;
@@ -687,23 +702,15 @@ void SBSEArm::CalcTargetCoords( THaTrack* track )
   double pthetabend_fit;
   double vz_fit;
 
-  xptar_fit = 0.0;
-  yptar_fit = 0.0;
-  ytar_fit = 0.0;
-  pthetabend_fit = 0.0;
-  
-  for( int ipar = 0; ipar<fOpticsNterms; ipar++ ){
-    double term = pow(x_fp, f_om[ipar])*pow(y_fp, f_ol[ipar])*pow(xp_fp, f_ok[ipar])*pow(yp_fp,f_oj[ipar])*pow(xtar,f_oi[ipar]);
-    //double term = pow(x_fp,m)*pow(y_fp,l)*pow(xp_fp,k)*pow(yp_fp,j)*pow(xtar,i);
-    xptar_fit += fb_xptar[ipar]*term;
-    yptar_fit += fb_yptar[ipar]*term;
-    ytar_fit += fb_ytar[ipar]*term;
-    pthetabend_fit += fb_pinv[ipar]*term;
-    //pinv_fit += b_pinv(ipar)*term;
-    // cout << ipar << " " << term << " " 
-    //      << b_xptar(ipar) << " " << b_yptar(ipar) << " " 
-    //      << b_ytar(ipar) << " " << b_pinv(ipar) << endl;
-  }
+  //All four expansions share the same monomials; evaluate them together:
+  double vars[SBSOpticsExpansion::kNvars] = { x_fp, y_fp, xp_fp, yp_fp, xtar };
+  double fit[4];
+  fTargetOptics.Eval( vars, fit );
+
+  xptar_fit = fit[0];
+  yptar_fit = fit[1];
+  ytar_fit = fit[2];
+  pthetabend_fit = fit[3];
 
   TVector3 phat_tgt_fit(xptar_fit, yptar_fit, 1.0 );
   phat_tgt_fit = phat_tgt_fit.Unit();
@@ -764,22 +771,16 @@ void SBSEArm::CalcTargetCoords( THaTrack* track )
 
   xtar = -cos(th_sbs) * vz_fit * xptar_fit;
   
-  //retrieve beam position, if available, to calculate xtar.
-  TIter aiter(gHaApps);
-  THaApparatus* app = 0;
-  while( (app=(THaApparatus*)aiter()) ){
-    if(app->InheritsFrom("SBSRasteredBeam")){
-      SBSRasteredBeam* RasterBeam = reinterpret_cast<SBSRasteredBeam*>(app);
-      //double xbeam = RasterBeam->GetPosition().X();
-      ybeam = RasterBeam->GetPosition().Y()/1000.0; //if this is given in mm, we need to convert to meters (also for BB)
-      xbeam = RasterBeam->GetPosition().X()/1000.0;
-      //xtar = - ybeam - cos(GetThetaGeo()) * vz_fit * xptar_fit;
-      // For now let's exclude the vertical beam position from the calculation
-      // if the "use beam position" flag is turned on, then the user
-      // has presumably calibrated the BPM and/or raster reconstruction:
-      if( fUseBeamPosInOptics ) xtar += -ybeam;
-    }
-    //cout << var->GetName() << endl;
+  //retrieve beam position, if available, to calculate xtar (beam apparatus is bound in Begin()):
+  if( fRasteredBeam ){
+    //double xbeam = fRasteredBeam->GetPosition().X();
+    ybeam = fRasteredBeam->GetPosition().Y()/1000.0; //if this is given in mm, we need to convert to meters (also for BB)
+    xbeam = fRasteredBeam->GetPosition().X()/1000.0;
+    //xtar = - ybeam - cos(GetThetaGeo()) * vz_fit * xptar_fit;
+    // For now let's exclude the vertical beam position from the calculation
+    // if the "use beam position" flag is turned on, then the user
+    // has presumably calibrated the BPM and/or raster reconstruction:
+    if( fUseBeamPosInOptics ) xtar += -ybeam;
   }
   //  f_xtg_exp.push_back(xtar);
   
@@ -804,24 +805,17 @@ void SBSEArm::CalcFpCoords( THaTrack *track ){
     double yptar = track->GetTPhi();
     double p = track->GetP();
         
-    double xfp_fit = 0.0;
-    double yfp_fit = 0.0;
-    double xpfp_fit = 0.0;
-    double ypfp_fit = 0.0;
-
     //xtar = 0.0;
-    
-    for( int ipar=0; ipar<fForwardOpticsNterms; ipar++ ){
-      // Standard order of exponents is xptar^m yptar^l ytar^k (1/p)^j xtar^i
-      double term = pow( xptar, f_fom[ipar] ) * pow( yptar, f_fol[ipar] ) *
-	pow( ytar, f_fok[ipar] ) * pow( 1.0/p, f_foj[ipar] ) *
-	pow( xtar, f_foi[ipar] );
-
-      xfp_fit += fb_xfp[ipar]*term;
-      yfp_fit += fb_yfp[ipar]*term;
-      xpfp_fit += fb_xpfp[ipar]*term;
-      ypfp_fit += fb_ypfp[ipar]*term;
-    }
+
+    // Standard order of exponents is xptar^m yptar^l ytar^k (1/p)^j xtar^i
+    double vars[SBSOpticsExpansion::kNvars] = { xptar, yptar, ytar, 1.0/p, xtar };
+    double fit[4];
+    fForwardOptics.Eval( vars, fit );
+
+    double xfp_fit = fit[0];
+    double yfp_fit = fit[1];
+    double xpfp_fit = fit[2];
+    double ypfp_fit = fit[3];
 
     //NEXT: transform to "detector" coordinate system (same definition as in BigBite):
     TVector3 pos_optics( xfp_fit, yfp_fit, 0.0 );
@@ -1610,6 +1604,31 @@ Int_t SBSEArm::CalcPID(){
 //_______________________
 Int_t SBSEArm::Begin( THaRunBase *run ){
   THaSpectrometer::Begin(run);
+
+  //Look up the rastered beam (if any) once per run instead of once per track. Without a configured name, use the
+  //last SBSRasteredBeam defined, which is the one whose position the old per-track search ended up using:
+  fRasteredBeam = nullptr;
+  if( !fRasteredBeamName.empty() ){
+    fRasteredBeam = FindApparatus<SBSRasteredBeam>( fRasteredBeamName.c_str() );
+    if( !fRasteredBeam ){
+      std::cerr << "Warning: SBSEArm " << GetName() << ": rastered beam apparatus \"" << fRasteredBeamName
+		<< "\" not found, beam position not used" << std::endl;
+    }
+  } else {
+    int nbeams = 0;
+    TIter nextapp(gHaApps);
+    while( TObject *obj = nextapp() ){
+      if( auto *beam = dynamic_cast<SBSRasteredBeam*>(obj) ){
+	fRasteredBeam = beam;
+	nbeams++;
+      }
+    }
+    if( nbeams > 1 ){
+      std::cerr << "Warning: SBSEArm " << GetName() << ": " << nbeams << " SBSRasteredBeam apparatuses defined, using the last one, \""
+		<< fRasteredBeam->GetName() << "\"; set rasteredbeam_name in the database to choose" << std::endl;
+    }
+  }
+  
   //Initialize constraint widths for detectors inheriting SBSGEMSpectrometerTracker or SBSGEMPolarimeterTracker:
   TIter next(fTrackingDetectors);
   while( auto *theTrackDetector = static_cast<THaTrackingDetector*>( next() )) {
@@ -2,11 +2,14 @@
 #define SBSEarm_h
 
 #include "THaSpectrometer.h"
+#include "SBSOpticsExpansion.h"
+#include <string>
 
 class TList;
 class THaTrack;
 class TVector3;
 class TLorentzVector;
+class SBSRasteredBeam;
   
 class SBSEArm : public THaSpectrometer {
 
@@ -189,6 +192,9 @@ protected:
   UInt_t fPrecon_flag; //Indicate which momentum reconstruction formalism we are using:
 
   Bool_t fUseBeamPosInOptics;
+
+  std::string fRasteredBeamName; //name of the beam apparatus used for the beam position ("rasteredbeam_name"); empty = last SBSRasteredBeam defined
+  SBSRasteredBeam *fRasteredBeam; //! beam apparatus, bound in Begin() (nullptr if not defined)
   
   int fOpticsOrder;
   int fOpticsNterms;
@@ -203,6 +209,9 @@ protected:
   std::vector<int> f_ol;
   std::vector<int> f_om;
 
+  //Power-table evaluator built from the above in ReadDatabase (outputs xptar, yptar, ytar, pinv):
+  SBSOpticsExpansion fTargetOptics; //!
+
   Bool_t fPolarimeterMode; //Use polarimeter mode
   Bool_t fPolarimeterMode_DBoverride; //flag to override DB value
   
@@ -229,6 +238,9 @@ protected:
   std::vector<int> f_fol;
   std::vector<int> f_fom;
 
+  //Power-table evaluator for the forward optics (outputs xfp, yfp, xpfp, ypfp):
+  SBSOpticsExpansion fForwardOptics; //!
+
   Bool_t fGEPtrackingMode; //Boolean flag to turn on GEP tracking mode. 
   Int_t fGEPtrackingFlag; //Integer flag to control the behavior of the GEP tracking algorithm
   
@@ -1,6 +1,7 @@
 #include <iostream>
 
 #include "SBSGEMModule.h"
+#include "SBSGEMTrackerBase.h"
 #include "TDatime.h"
 #include "THaEvData.h"
 #include "THaApparatus.h"
@@ -11,12 +12,48 @@
 #include "TF1.h"
 #include "TGraphErrors.h"
 #include "TClonesArray.h"
+#include "MPDModule.h"
 #include <algorithm>
 #include <iomanip>
 
 using namespace std;
 //using namespace SBSGEMModule;
 
+//Per-strip sample kernels specialized on the number of APV25 time samples. NSAMP = 0 is the generic version, which
+//takes the sample count at run time; for NSAMP > 0 the trip count is known at compile time and the loops can be fully unrolled.
+//Only 6 (standard) and 3 samples are instantiated (see ReadDatabase):
+template<int NSAMP>
+static inline void AddWeightedSamples( Double_t *sum, const Double_t *samples, Double_t weight, int nsamp ){
+  const int n = NSAMP > 0 ? NSAMP : nsamp;
+  for( int isamp=0; isamp<n; isamp++ ){
+    sum[isamp] += samples[isamp]*weight;
+  }
+}
+
+template<int NSAMP>
+static Double_t CorrCoeffKernel( int nsamples, const Double_t *Usamples, const Double_t *Vsamples ){
+  const int n = NSAMP > 0 ? NSAMP : nsamples;
+  Double_t sumu=0.0, sumv=0.0, sumu2=0.0, sumv2=0.0, sumuv=0.0;
+
+  for( int isamp=0; isamp<n; isamp++ ){
+    sumu += Usamples[isamp];
+    sumv += Vsamples[isamp];
+    sumu2 += Usamples[isamp]*Usamples[isamp];
+    sumv2 += Vsamples[isamp]*Vsamples[isamp];
+    sumuv += Usamples[isamp]*Vsamples[isamp];
+  }
+
+  double nSAMP = double(n);
+  double mu = sumu/nSAMP;
+  double mv = sumv/nSAMP;
+  double varu = sumu2/nSAMP - mu*mu;
+  double varv = sumv2/nSAMP - mv*mv;
+  double sigu = sqrt(varu);
+  double sigv = sqrt(varv);
+
+  return (sumuv - nSAMP*mu*mv)/(nSAMP*sigu*sigv);
+}
+
 //This should not be hard-coded, I think, but read in from the database (or perhaps not, if it never changes? For now we keep it hard-coded)
 // const int APVMAP[128] = {1, 33, 65, 97, 9, 41, 73, 105, 17, 49, 81, 113, 25, 57, 89, 121, 3, 35, 67, 99, 11, 43, 75, 107, 19, 51, 83, 115, 27, 59, 91, 123, 5, 37, 69, 101, 13, 45, 77, 109, 21, 53, 85, 117, 29, 61, 93, 125, 7, 39, 71, 103, 15, 47, 79, 111, 23, 55, 87, 119, 31, 63, 95, 127, 0, 32, 64, 96, 8, 40, 72, 104, 16, 48, 80, 112, 24, 56, 88, 120, 2, 34, 66, 98, 10, 42, 74, 106, 18, 50, 82, 114, 26, 58, 90, 122, 4, 36, 68, 100, 12, 44, 76, 108, 20, 52, 84, 116, 28, 60, 92, 124, 6, 38, 70, 102, 14, 46, 78, 110, 22, 54, 86, 118, 30, 62, 94, 126};
 
@@ -66,6 +103,8 @@ SBSGEMModule::SBSGEMModule( const char *name, const char *description,
   //Set default values for decode map parameters:
   fN_APV25_CHAN = 128;
   fN_MPD_TIME_SAMP = 6;
+  fNsampKernel = 0;
+  fForceGenericKernels = kFALSE;
   fMPDMAP_ROW_SIZE = 9;
 
   //We should probably get rid of this as it's not used, only leads to confusion:
@@ -135,6 +174,14 @@ SBSGEMModule::SBSGEMModule( const char *name, const char *description,
   fPedSubADC_APV.resize( MAXNSAMP_PER_APV );
   fCommonModeSubtractedADC_APV.resize( MAXNSAMP_PER_APV );
 
+  //work arrays for the common-mode calculation (one APV card, one time sample):
+  fCMblockADC.resize( fN_APV25_CHAN );
+  fCMblockRawADC.resize( fN_APV25_CHAN );
+  fCMblockPedRMS.resize( fN_APV25_CHAN );
+  fCMsortBuffer.reserve( fN_APV25_CHAN );
+  fCMbinCounts.reserve( 256 );
+  fCMbinADCsum.reserve( 256 );
+
   fCM_online.resize( fN_MPD_TIME_SAMP );
   
   //default to 
@@ -144,6 +191,8 @@ SBSGEMModule::SBSGEMModule( const char *name, const char *description,
   fRMS_ConversionFactor = sqrt(fN_MPD_TIME_SAMP); //=2.45
 
   fIsMC = false; //need to set default value!
+  fFrameViewConfigOK = -1;
+  fChannelLUT = nullptr;
 
   fAPVmapping = SBSGEM::kUVA_XY; //default to UVA X/Y style APV mapping, but require this in the database::
 
@@ -259,6 +308,8 @@ Int_t SBSGEMModule::ReadDatabase( const TDatime& date ){
   
   Int_t status;
 
+  fFrameViewConfigOK = -1; //the crate map may change from run to run
+
   FILE* file = OpenFile( date );
   if( !file ) return kFileError;
 
@@ -290,6 +341,7 @@ Int_t SBSGEMModule::ReadDatabase( const TDatime& date ){
   int zerosuppress_flag = fZeroSuppress ? 1 : 0;
   int negsignalstudy_flag = fNegSignalStudy ? 1 : 0;
   int onlinezerosuppress_flag = fOnlineZeroSuppression ? 1 : 0;
+  int generickernels_flag = fForceGenericKernels ? 1 : 0;
 
   int eventinfoplots_flag = fMakeEventInfoPlots ? 1 : 0;
 
@@ -354,6 +406,7 @@ Int_t SBSGEMModule::ReadDatabase( const TDatime& date ){
     { "zerosuppress_nsigma", &fZeroSuppressRMS, kDouble, 0, 1, 1}, //(optional, search):
     { "do_neg_signal_study", &negsignalstudy_flag, kUInt, 0, 1, 1}, //(optional, search): toggle doing negative signal analysis
     { "onlinezerosuppress", &onlinezerosuppress_flag, kUInt, 0, 1, 1}, //(optional, search)
+    { "generic_kernels", &generickernels_flag, kUInt, 0, 1, 1}, //(optional, search): always use the generic strip kernels instead of the ones specialized for 6 or 3 time samples (for benchmarking, default = false)
     { "commonmode_meanU", &fCommonModeMeanU, kDoubleV, 0, 1, 0}, //(optional, don't search)
     { "commonmode_meanV", &fCommonModeMeanV, kDoubleV, 0, 1, 0}, //(optional, don't search)
     { "commonmode_rmsU", &fCommonModeRMSU, kDoubleV, 0, 1, 0}, //(optional, don't search)
@@ -439,6 +492,8 @@ Int_t SBSGEMModule::ReadDatabase( const TDatime& date ){
 
   fNegSignalStudy = negsignalstudy_flag != 0;
 
+  fForceGenericKernels = generickernels_flag != 0;
+
   fMakeEventInfoPlots = eventinfoplots_flag != 0;
 
   //fUseStripTimingCuts = usestriptimingcuts != 0;
@@ -474,6 +529,7 @@ Int_t SBSGEMModule::ReadDatabase( const TDatime& date ){
   fDeconv_weights[0] = exp( x - 1.0 )/x; //~1.32
   fDeconv_weights[1] = -2.0*exp(-1.0)/x; //~ -1.72
   fDeconv_weights[2] = exp(-1.0-x)/x; //0.56
+  fDeconvExpX = exp( x );
   
   //std::cout << GetName() << " fThresholdStripSum " << fThresholdStripSum 
   //<< " fThresholdSample " << fThresholdSample << std::endl;
@@ -531,6 +587,7 @@ Int_t SBSGEMModule::ReadDatabase( const TDatime& date ){
     thisdata.invert = fChanMapData[7+mapline*fMPDMAP_ROW_SIZE];
     thisdata.axis   = fChanMapData[8+mapline*fMPDMAP_ROW_SIZE];
     thisdata.index  = mapline;
+    thisdata.lut_offset = -1;
 
     //Populate relevant quantities mapped by strip index:
     for( int ich=0; ich<fN_APV25_CHAN; ich++ ){
@@ -669,15 +726,28 @@ Int_t SBSGEMModule::ReadDatabase( const TDatime& date ){
   
   fStrip.resize( nstripsmax );
   fAxis.resize( nstripsmax );
-  fADCsamples.resize( nstripsmax );
-  fRawADCsamples.resize( nstripsmax );
-  fADCsamples_deconv.resize( nstripsmax );
-  //The lines below are problematic and unnecessary
-  for( unsigned int istrip=0; istrip<nstripsmax; istrip++ ){
-    fADCsamples[istrip].resize( fN_MPD_TIME_SAMP );
-    fRawADCsamples[istrip].resize( fN_MPD_TIME_SAMP );
-    fADCsamples_deconv[istrip].resize( fN_MPD_TIME_SAMP );
-  }
+  //Fixed-stride sample storage: one contiguous buffer of nstripsmax * fN_MPD_TIME_SAMP for each array:
+  fADCsamples.resize( nstripsmax, fN_MPD_TIME_SAMP );
+  fRawADCsamples.resize( nstripsmax, fN_MPD_TIME_SAMP );
+  fADCsamples_deconv.resize( nstripsmax, fN_MPD_TIME_SAMP );
+
+  fStripADCtemp.resize( fN_MPD_TIME_SAMP );
+  fStripRawADCtemp.resize( fN_MPD_TIME_SAMP );
+  fStripDeconvADCtemp.resize( fN_MPD_TIME_SAMP );
+
+  fStripBatch.resize( nstripsmax, fN_MPD_TIME_SAMP );
+
+  //find_clusters_1D work arrays (strip-indexed, with a guard entry at each end):
+  UInt_t nstripsaxis = std::max( fNstripsU, fNstripsV ) + 2;
+  fClustHitIndex.assign( nstripsaxis, -1 );
+  fClustHitIndexNeg.assign( nstripsaxis, -1 );
+  fClustADCstrip.assign( nstripsaxis, 0.0 );
+  fClustADCmaxsamp.assign( nstripsaxis, 0.0 );
+  fClustIsLocalMax.assign( nstripsaxis, 0 );
+  fClustStrips.reserve( nstripsaxis );
+  fClustStripsNeg.reserve( nstripsaxis );
+  fClustMaxima.reserve( nstripsaxis );
+  fClustPeaksToErase.reserve( nstripsaxis );
   
   fADCsums.resize( nstripsmax );
   fADCsumsDeconv.resize( nstripsmax );
@@ -1067,6 +1137,22 @@ Int_t SBSGEMModule::ReadDatabase( const TDatime& date ){
   //   }
   // }
 
+  //Select the strip kernels specialized for this number of time samples:
+  SetForceGenericKernels( fForceGenericKernels );
+  
+  //Sample times and the reference pulse shape for the strip TS chi2 don't change event-by-event, so compute them once here
+  //(the timing cut centers are only known at this point):
+  fSampleTime.resize( fN_MPD_TIME_SAMP );
+  for( int axis=0; axis<2; axis++ ){
+    fStripTSshape[axis].resize( fN_MPD_TIME_SAMP );
+    double t0 = fStripMaxTcut_central[axis] - fStripTau;
+    for( int isamp=0; isamp<fN_MPD_TIME_SAMP; isamp++ ){
+      double tsamp = (isamp + 0.5)*fSamplePeriod;
+      fSampleTime[isamp] = tsamp;
+      fStripTSshape[axis][isamp] = std::max(0.0, (tsamp-t0)/fStripTau * exp( 1.0 - (tsamp-t0)/fStripTau) );
+    }
+  }
+
   fclose(file);
   
   return 0;
@@ -1371,6 +1457,8 @@ void SBSGEMModule::Clear( Option_t* opt){ //we will want to clear out many more
   //later we may need to check whether this is a performance bottleneck:
   fUclusters.clear();
   fVclusters.clear();
+  //The cluster array members from the previous event are discarded along with the clusters:
+  fClusterArena.Reset();
   fN2Dhits = 0;
   fN2Dhits_total = 0;
   //similar here:
@@ -1423,6 +1511,8 @@ Int_t   SBSGEMModule::Decode( const THaEvData& evdata ){
   fNstrips_hitV = 0;
   fNstrips_hitU_neg = 0;
   fNstrips_hitV_neg = 0;
+
+  if( !CheckFrameViewConfig( evdata ) ) return -1;
   
   //UInt_t MAXNSAMP_PER_APV = fN_APV25_CHAN * fN_MPD_TIME_SAMP;
 
@@ -1454,150 +1544,87 @@ Int_t   SBSGEMModule::Decode( const THaEvData& evdata ){
 
   bool firstevcnt = true;
   UInt_t FirstEvCnt = 0;
+
+  //The MPD decoder module for the current crate/slot, if its "frame view" of the raw data is available (it never is for
+  // simulated data). The time stamp and event count words are per-MPD, so we only look them up when the MPD changes
+  // from one APV card to the next (the decode map is normally grouped by MPD):
+  Decoder::MPDModule *mpdmodule = nullptr;
+  UInt_t mpd_crate = kMaxUInt, mpd_slot = kMaxUInt, mpd_fiber = kMaxUInt;
+  bool mpd_timestamp_found = false;
+  UInt_t mpd_Tlow = 0, mpd_Thigh = 0, mpd_EvCnt = 0;
   
   for (std::vector<mpdmap_t>::iterator it = fMPDmap.begin() ; it != fMPDmap.end(); ++it){
     //loop over all decode map entries associated with this module (each decode map entry is one APV card)
     Int_t effChan = it->mpd_id << 4 | it->adc_id; //left-shift mpd id by 4 bits and take the bitwise OR with ADC_id to uniquely identify the APV card.
     //mpd_id is not necessarily equal to slot, but that seems to be the convention in many cases
     // Find channel for this crate/slot
+
+    //Block of the tracker channel lookup table for this APV card, indexed by raw APV channel, if available:
+    const sbsgemchanlut_t *chanlut = ( fChannelLUT != nullptr && it->lut_offset >= 0 ) ? fChannelLUT + it->lut_offset : nullptr;
     
-    // TO-DO: rewrite this "time stamp" part of the code more efficiently, by somehow pulling it outside the loop over APVs, since the time stamp is
-    // really per-MPD, not per-APV. This is unnecessarily repeated analysis for up to 16 times per MPD.
-    // Note that we don't use the information in the analysis in any way so far.
-    // on the other hand, the decode map is organized by APV card, so it is difficult to imagine how we would restructure this part of the code
-    // since otherwise we don't know which crate/slot to look in.
-    // First get time stamp info:
-    UInt_t nhits_timestamp_low = evdata.GetNumHits( it->crate, it->slot, fChan_TimeStamp_low );
-    UInt_t nhits_timestamp_high = evdata.GetNumHits( it->crate, it->slot, fChan_TimeStamp_high );
-    UInt_t nhits_event_count = evdata.GetNumHits( it->crate, it->slot, fChan_MPD_EventCount );
-
-    //std::cout << "nhits_timestamp_low = " << nhits_timestamp_low << std::endl;
-    
-    if( nhits_timestamp_low > 0 && nhits_timestamp_high == nhits_timestamp_low && nhits_event_count == nhits_timestamp_low ){
-      for( unsigned int ihit=0; ihit<nhits_timestamp_low; ihit++ ){
-	unsigned int fiber = evdata.GetRawData( it->crate, it->slot, fChan_TimeStamp_low, ihit );
-	if( fiber == it->mpd_id ){ //this is the channel we want: 
-	  UInt_t Tlow = evdata.GetData( it->crate, it->slot, fChan_TimeStamp_low, ihit );
-	  UInt_t Thigh = evdata.GetData( it->crate, it->slot, fChan_TimeStamp_high, ihit );
-	  UInt_t EvCnt = evdata.GetData( it->crate, it->slot, fChan_MPD_EventCount, ihit );
-
-	  //std::cout << "Tlow, Thigh, EvCnt = " << Tlow << ", " << Thigh << ", " << EvCnt << std::endl;
-
-	  if( firstevcnt ){
-	    FirstEvCnt = EvCnt;
-	    firstevcnt = false;
-	  }
-	  
-	  fEventCount_by_APV[apvcounter] = EvCnt;
-										    
-	  // Fine time stamp is in the first 8 bits of Tlow;
-	  fTfine_by_APV[apvcounter] = Tlow & 0x000000FF;
+    if( it->crate != mpd_crate || it->slot != mpd_slot ){
+      mpd_crate = it->crate;
+      mpd_slot = it->slot;
+      mpd_fiber = kMaxUInt;
+      mpdmodule = GetFrameViewModule( evdata, *it );
+    }
 
-	  if( fMakeEventInfoPlots && fEventInfoPlotsInitialized ){
-	    hMPD_EventCount_Alignment->Fill( EvCnt - FirstEvCnt );
-	    hMPD_EventCount_Alignment_vs_Fiber->Fill( fiber, EvCnt - FirstEvCnt );
+    // First get time stamp info. This is really per-MPD, not per-APV, so only look it up once per MPD:
+    if( it->mpd_id != mpd_fiber ){
+      mpd_fiber = it->mpd_id;
+      mpd_timestamp_found = ReadMPDTimeStamp( evdata, *it, mpdmodule, mpd_Tlow, mpd_Thigh, mpd_EvCnt );
+    }
+    
+    if( mpd_timestamp_found ){
+      unsigned int fiber = it->mpd_id;
+      UInt_t Tlow = mpd_Tlow;
+      UInt_t Thigh = mpd_Thigh;
+      UInt_t EvCnt = mpd_EvCnt;
 
-	    hMPD_FineTimeStamp_vs_Fiber->Fill( fiber, fTfine_by_APV[apvcounter] * 4.0 );
-	  }
-	    
-	  Long64_t Tcoarse = Thigh << 16 | ( Tlow << 8 );
-	  double Tc = double(Tcoarse);
-	  
-	  if( EvCnt == 0 ) fT0_by_APV[apvcounter] = Tc;
+      //std::cout << "Tlow, Thigh, EvCnt = " << Tlow << ", " << Thigh << ", " << EvCnt << std::endl;
 
-	  //T ref is the coarse time stamp of the reference APV (the first one, in this case)
-	  if( apvcounter == 0 ) fTref_coarse = Tc - fT0_by_APV[apvcounter];
+      if( firstevcnt ){
+	FirstEvCnt = EvCnt;
+	firstevcnt = false;
+      }
+      
+      fEventCount_by_APV[apvcounter] = EvCnt;
 
-	  //This SHOULD make fTcoarse_by_APV the Tcoarse RELATIVE to the
-	  // "reference" APV
-	  fTcoarse_by_APV[apvcounter] = Tc - fT0_by_APV[apvcounter] - fTref_coarse;
+      // Fine time stamp is in the first 8 bits of Tlow;
+      fTfine_by_APV[apvcounter] = Tlow & 0x000000FF;
 
-	  //We probably don't want to hard-code 24 ns and 4 ns here for the units of
-	  //Tcoarse and Tfine, but this should be fine for initial checkout of decoding:
-	  fTimeStamp_ns_by_APV[apvcounter] = 24.0 * fTcoarse_by_APV[apvcounter] + 4.0 * (fTfine_by_APV[apvcounter] % 6);
+      if( fMakeEventInfoPlots && fEventInfoPlotsInitialized ){
+	hMPD_EventCount_Alignment->Fill( EvCnt - FirstEvCnt );
+	hMPD_EventCount_Alignment_vs_Fiber->Fill( fiber, EvCnt - FirstEvCnt );
 
-	  // std::cout << "fiber, apvcounter, EvCnt, Tcoarse, Tfine, time stamp ns = " << fiber << ", " <<  apvcounter << ", "
-	  // 	    << fEventCount_by_APV[apvcounter] << ", " 
-	  // 	    << Tcoarse << ", " << fTfine_by_APV[apvcounter] << ", "
-	  // 	    << fTimeStamp_ns_by_APV[apvcounter] << std::endl;
-							   
-	  break;
-	}	
+	hMPD_FineTimeStamp_vs_Fiber->Fill( fiber, fTfine_by_APV[apvcounter] * 4.0 );
       }
-    }
-    
-    // Get common-mode flags, if applicable:
-    // Default to the values from the database (or the default values):
+        
+      double Tc = UpdateT0( apvcounter, Tlow, Thigh, EvCnt );
 
-    Bool_t CM_ENABLED = fCommonModeFlag != 0 && fCommonModeFlag != 1 && !fPedestalMode;
-    Bool_t BUILD_ALL_SAMPLES = !fOnlineZeroSuppression;
-    Bool_t CM_OUT_OF_RANGE = false;
+      //T ref is the coarse time stamp of the reference APV (the first one, in this case)
+      if( apvcounter == 0 ) fTref_coarse = Tc - fT0_by_APV[apvcounter];
 
-    //Initialize default values based on the run "DAQ info":
-    if(fCODA_BUILD_ALL_SAMPLES != -1){
-      BUILD_ALL_SAMPLES = fCODA_BUILD_ALL_SAMPLES;
-      fPedSubFlag = (fCODA_BUILD_ALL_SAMPLES == 0);
-    }
-    if(fCODA_CM_ENABLED != -1) CM_ENABLED = fCODA_CM_ENABLED;
- 
-    
-    UInt_t cm_flags=4*CM_OUT_OF_RANGE + 2*CM_ENABLED + BUILD_ALL_SAMPLES;
-    UInt_t nhits_cm_flag=evdata.GetNumHits( it->crate, it->slot, fChan_CM_flags );
-    
-    //bool cm_flags_found = false;
-      
-    if( nhits_cm_flag > 0 ){
-      
-      // If applicable, find the common-mode/zero-suppression settings loaded from the raw data for this APV:
-      // In principle in the SSP/VTP event format, there should be exactly one "hit" per APV in this "channel":
-      for( unsigned int ihit=0; ihit<nhits_cm_flag; ihit++ ){
-        int chan_temp = evdata.GetRawData( it->crate, it->slot, fChan_CM_flags, ihit );
-	if( chan_temp == effChan ){ //assume that this is only filled once per MPD per event, and exit the loop when we find this MPD:
-	  // std::cout << "Before decoding cm flags, CM_ENABLED, BUILD_ALL_SAMPLES = " << CM_ENABLED << ", "
-	  // 	    << BUILD_ALL_SAMPLES << std::endl;
-	  cm_flags = evdata.GetData( it->crate, it->slot, fChan_CM_flags, ihit );
-	  //cm_flags_found = true;
-	  break;
-	}
-      }
-    } else if( !fIsMC ){
-      std::cout << "Warning in SBSGEMModule::Decode for module " << GetName()
-		<< ": CM flags missing!" << std::endl;
-    }
+      //This SHOULD make fTcoarse_by_APV the Tcoarse RELATIVE to the
+      // "reference" APV
+      fTcoarse_by_APV[apvcounter] = Tc - fT0_by_APV[apvcounter] - fTref_coarse;
 
-    
-    
+      //We probably don't want to hard-code 24 ns and 4 ns here for the units of
+      //Tcoarse and Tfine, but this should be fine for initial checkout of decoding:
+      fTimeStamp_ns_by_APV[apvcounter] = 24.0 * fTcoarse_by_APV[apvcounter] + 4.0 * (fTfine_by_APV[apvcounter] % 6);
 
-    //The proper logic of common-mode calculation/subtraction and zero suppression is as follows:
-    // 1. If CM_ENABLED is true, we never calculate the common-mode ourselves, it has already been subtracted from the data:
-    // 2. If BUILD_ALL_SAMPLES is false, then online zero suppression is enabled. We can, in addition, apply our own higher thresholds if we want:
-    // 3. If CM_ENABLED is true, the pedestal has also been subtracted, so we don't subtract it again.
-    // 4. If CM_ENABLED is false, we need to subtract the pedestals (maybe) AND calculate and subtract the common-mode:
-    // 5. If BUILD_ALL_SAMPLES is false then CM_ENABLED had better be true!
-    // 6. If CM_OUT_OF_RANGE is true then BUILD_ALL_SAMPLES must be true and CM_ENABLED
-    //    must be false!
+      // std::cout << "fiber, apvcounter, EvCnt, Tcoarse, Tfine, time stamp ns = " << fiber << ", " <<  apvcounter << ", "
+      // 	    << fEventCount_by_APV[apvcounter] << ", " 
+      // 	    << Tcoarse << ", " << fTfine_by_APV[apvcounter] << ", "
+      // 	    << fTimeStamp_ns_by_APV[apvcounter] << std::endl;
+    }
     
-    CM_OUT_OF_RANGE = cm_flags/4;
-    CM_ENABLED = cm_flags/2;
-    BUILD_ALL_SAMPLES = cm_flags%2;
+    // Get common-mode flags, if applicable:
+    Bool_t CM_ENABLED, BUILD_ALL_SAMPLES, CM_OUT_OF_RANGE, cm_flags_found;
 
-    // if( cm_flags_found ){
-    //std::cout << "cm flag defaults overridden by raw data, effChan = " << effChan << ", CM_ENABLED = " << CM_ENABLED << ", BUILD_ALL_SAMPLES = " << BUILD_ALL_SAMPLES << std::endl;
-    // }
-    
-    //cout<<BUILD_ALL_SAMPLES<<" "<<CM_ENABLED<<endl;
-    //fOnlineZeroSuppression = !BUILD_ALL_SAMPLES;
-    if( !BUILD_ALL_SAMPLES && !CM_ENABLED ) { //This should never happen: skip this APV card
+    if( !ReadAPVFlags( evdata, *it, CM_ENABLED, BUILD_ALL_SAMPLES, CM_OUT_OF_RANGE, cm_flags_found ) ){ //This should never happen: skip this APV card
       continue;
     }
-    if( CM_OUT_OF_RANGE && !BUILD_ALL_SAMPLES ){ // this should also never happen: skip this APV card:
-      continue;
-    }
-
-    if( CM_OUT_OF_RANGE && CM_ENABLED ){ //force CM_ENABLED to false if CM_OUT_OF_RANGE is true;
-      //This should have already been done online:
-      CM_ENABLED = false; 
-    }
 
   
     
@@ -1677,7 +1704,11 @@ Int_t   SBSGEMModule::Decode( const THaEvData& evdata ){
       }
     }//End check if CM_ENABLED
     
-    Int_t nsamp = evdata.GetNumHits( it->crate, it->slot, effChan );
+    //If available, decode the strip samples directly from the raw data via the MPD frame view, rather than reading them
+    //back from the slot data one sample at a time:
+    bool useframeview = mpdmodule != nullptr && cm_flags_found;
+    
+    Int_t nsamp = useframeview ? mpdmodule->GetFrameNstrips( effChan ) * fN_MPD_TIME_SAMP : evdata.GetNumHits( it->crate, it->slot, effChan );
    
     if( nsamp > 0 ){ //This APV card has data!
       
@@ -1718,323 +1749,10 @@ Int_t   SBSGEMModule::Decode( const THaEvData& evdata ){
       // First loop over the hits: populate strip, raw strip, raw ADC, ped sub ADC and common-mode-subtracted aDC;
       //ALSO, if this is a full readout event, count the number of hits above the minimum:   
       
-      for( int iraw=0; iraw<nsamp; iraw++ ){ //NOTE: iraw = isamp + fN_MPD_TIME_SAMP * istrip
-	int strip = evdata.GetRawData( it->crate, it->slot, effChan, iraw );
-	UInt_t decoded_rawADC = evdata.GetData( it->crate, it->slot, effChan, iraw );
-
-	int isamp = iraw%fN_MPD_TIME_SAMP;
-	  
-	Int_t ADC = Int_t( decoded_rawADC );
-	
-	rawStrip[iraw] = strip;
-	Strip[iraw] = GetStripNumber( strip, it->pos, it->invert );
-
-	rawADC[iraw] = ADC;
-	
-	double ped = (axis == SBSGEM::kUaxis ) ? fPedestalU[Strip[iraw]] : fPedestalV[Strip[iraw]];
-
-	rawADC_nopedsub[iraw] = ADC;
-	
-	if( fPedSubFlag != 0 ){ //ped subtraction online; add pedestal back in to the "nopedsub" value:
-	  rawADC_nopedsub[iraw] = Int_t(ADC +  ped);
-	}
-
-	if( fullreadout ){ //update min and max values for this APV as appropriate:
-	  //double rawADC_nopedsub = double(ADC);
-
-	  if( fNumFullReadoutEvents_by_APV[apvcounter] == 0 || rawADC_nopedsub[iraw] < fRawADCminResult_by_APV[apvcounter] ){ //first full readout event or val < min:
-	    fRawADCminResult_by_APV[apvcounter] = rawADC_nopedsub[iraw];
-	  }
-
-	  if( fNumFullReadoutEvents_by_APV[apvcounter] == 0 || rawADC_nopedsub[iraw] > fRawADCmaxResult_by_APV[apvcounter] ){ //first full readout event or val < min:
-	    fRawADCmaxResult_by_APV[apvcounter] = rawADC_nopedsub[iraw];
-	  }
-
-	  fNumFullReadoutEvents_by_APV[apvcounter]++;
-	}
-	// If pedestal subtraction was done online, don't do it again:
-	// In pedestal mode, the DAQ should NOT have subtracted the pedestals,
-	// but even if it did, it shouldn't affect the pedestal analysis to first order whether we subtract the pedestals or not:
-	if( fPedSubFlag != 0 && !fPedestalMode && !fIsMC ) ped = 0.0;
-	if( CM_ENABLED && !fIsMC ) {
-	  ped = 0.0; //If this is true then the pedestal was DEFINITELY always calculated online:
-	  //rawADC[iraw] += fCM_online[isamp] (not yet sure if we want to add back the online-CM) ;
-	}
-	  
-	pedsubADC[iraw] = double(ADC) - ped;
-	commonModeSubtractedADC[iraw] = double(ADC) - ped; 
-
-	//the calculation of common mode in pedestal mode analysis differs from the
-	// offline or online zero suppression analysis; here we use a simple average of all 128 channels:
-	if( fPedestalMode ){
-	  //do simple common-mode calculation involving the simple average of all 128 (ped-subtracted) ADC
-	  //values   
-	    
-	  if( fSubtractPedBeforeCommonMode ){
-	    commonMode[isamp] += pedsubADC[iraw]/double(fN_APV25_CHAN);
-	  } else {
-	    commonMode[isamp] += rawADC[iraw]/double(fN_APV25_CHAN);
-	  }
-	}
-      }
+      LoadAPVSamples( evdata, *it, useframeview ? mpdmodule : nullptr, nsamp, CM_ENABLED, fullreadout, apvcounter, commonMode );
       
       if( fullreadout ){ //then we need to calculate the common-mode:
-	//declare temporary array to hold common mode values for this APV card and, if necessary, calculate them:
-	
-	//std::cout << "Common-mode calculation: " << std::endl;
-	
-	if( fMakeCommonModePlots || !fPedestalMode ) { // calculate both ways:
-
-	  //vector<double> CM_danning_online_temp(fN_MPD_TIME_SAMP,0);
-	  
-	  for( int isamp=0; isamp<fN_MPD_TIME_SAMP; isamp++ ){
-
-	    int ngood = GetNumGoodHitsAPV( isamp, *it );
-
-	    if( ngood < fCommonModeMinStripsInRange ){
-	      goodCM = false; //we'll require good common-mode on all six time samples to keep this APV's data for tracking analysis
-	    }
-	    
-	    //moved common-mode calculation to its own function:
-	    
-	    // Now: a question is should we modify the behavior/do added checks if
-	    // CM_OUT_OF_RANGE is set? 
-	  
-	    if( fMakeCommonModePlots ){
-	      //double cm_danning = GetCommonMode( isamp, 1, *it );
-	      //experimental: Test histogramming method:
-	      double cm_danning = GetCommonMode( isamp, 1, *it );
-	      double cm_histo= GetCommonMode( isamp, 2, *it );
-	      double cm_histo_online = GetCommonMode( isamp, 5, *it );
-	      //if( !CM_OUT_OF_RANGE ) { // this is a hack so I only get debug printouts for good (full readout) events
-	      //cm_histo = GetCommonMode( isamp, 2, *it );
-	      // }	else {
-	      //cm_histo = cm_danning;
-	      //}
-	      double cm_sorting = GetCommonMode( isamp, 0, *it );
-	      double cm_danning_online = GetCommonMode( isamp, fCommonModeOnlFlag, *it );
-	      //double cm_danning_offline = GetCommonMode( isamp, 4, *it, cm_danning_online ); //Artificially zero suppress this calculation to check the CM correction algorithm
-
-	      fCM_online[isamp] = cm_danning_online;
-	      
-	      //If we are in this if-block, this is a full-readout event
-
-	      //std::cout << "cm danning, sorting = " << cm_danning << ", " << cm_sorting << std::endl;
-	      
-	      if( !fPedestalMode ){
-		switch( fCommonModeFlag ){
-		case 5:
-		  commonMode[isamp] = cm_histo_online;
-		  break;
-		case 2:
-		  commonMode[isamp] = cm_histo;
-		  break;
-		case 1:
-		default:
-		  commonMode[isamp] = cm_danning;
-		  break;
-		case 0:
-		  commonMode[isamp] = cm_sorting;
-		  break;
-		}
-	      }
-
-	      // //Common-mode correction needs to be moved to its own method:
-	      
-	      // //Calculate diagnostic plots for the CM correction algorithm
-	      // double CM_meas = cm_danning_online;
-	      // double CM_expect_mean, CM_expect_rms;
-	      // if( fMeasureCommonMode && fNeventsRollingAverage_by_APV[apvcounter] >= std::min(UInt_t(100),fNeventsCommonModeLookBack*fN_MPD_TIME_SAMP) ){
-	      // 	//If we have a critical mass of events in the rolling CM average for this to be a reliable estimate, use it: 
-	      // 	CM_expect_mean = fCommonModeRollingAverage_by_APV[apvcounter];
-	      // 	CM_expect_rms = fCommonModeRollingRMS_by_APV[apvcounter]; 
-	      // } else { //use database value:
-	      // 	UInt_t postemp = fMPDmap[apvcounter].pos;
-	      // 	UInt_t axistemp = fMPDmap[apvcounter].axis;
-		
-	      // 	CM_expect_mean = (axistemp == SBSGEM::kUaxis) ? fCommonModeMeanU[postemp] : fCommonModeMeanV[postemp];
-	      // 	CM_expect_rms = (axistemp == SBSGEM::kUaxis) ? fCommonModeRMSU[postemp] : fCommonModeRMSV[postemp];		
-	      // }
-	      
-	      // //if( CM_meas < CM_expect_mean - fCorrectCommonMode_Nsigma * CM_expect_rms ){
-	      // if(true){ // Lets try forcing every event to pass this first cut
-	      // 	// The online common mode appears to have a large negative bias relative to the expectation. 
-	      // 	// Try to correct the common-mode. To calculate the correction requires us to loop on all the strips on this APV that passed
-	      // 	// online zero suppression.
-	      // 	// The simplest approach is just to take a simple average of all the strips within +/- some number of standard deviations of the
-	      // 	// *EXPECTED* common-mode mean, but this is a biased approach.
-		
-	      // 	UInt_t NstripsInRange = 0; 
-		
-	      // 	//Loop on all strips on this APV and calculate raw ADC values from 
-	      // 	for(int istrip=0; istrip<nstrips; ++istrip ){
-	      // 	  int iraw = isamp + fN_MPD_TIME_SAMP * istrip;
-		  
-	      // 	  int strip = evdata.GetRawData( it->crate, it->slot, effChan, iraw );
-	      // 	  UInt_t decoded_rawADC = evdata.GetData( it->crate, it->slot, effChan, iraw );
-		  
-	      // 	  Int_t ADCtemp = pedsubADC[iraw];
-
-	      // 	  double rmstemp = (axis == SBSGEM::kUaxis ) ? fPedRMSU[Strip[iraw]] : fPedRMSV[Strip[iraw]];
-
-	      // 	  double strip_sum = 0;
-	      // 	  for(int itsamp=0; itsamp < 6; itsamp++)
-	      // 	    strip_sum += ADCtemp - cm_danning_online;
-	      // 	  if(strip_sum/fN_MPD_TIME_SAMP < 3*rmstemp) continue;
-		  
-	      // 	  rawStrip[iraw] = strip;
-	      // 	  Strip[iraw] = GetStripNumber( strip, it->pos, it->invert );
-		  		  
-	      // 	  rawADC[iraw] = ADCtemp;
-	      // 	  pedsubADC[iraw] = double( rawADC[iraw] ); //this is the one that goes into the common-mode calculation
-	      // 	  if( fabs( pedsubADC[iraw] - CM_expect_mean ) <= fCorrectCommonMode_Nsigma * CM_expect_rms ) NstripsInRange++;
-	      // 	}
-		
-	      // 	if( NstripsInRange >= fCommonModeMinStripsInRange ){
-	      // 	  //Correction to be ADDED to ADC value to get corrected value:
-	      // 	  CommonModeCorrection[isamp] = CM_meas -  GetCommonMode( isamp, 4, *it, cm_danning_online, nstrips ) + 3*8.3*(1 - NstripsInRange*1.0 / 128); //add extra 3 sigma * (1 - occupancy) to correct for extra positive bias from zero suppression
-		  
-	      // 	} else {
-	      // 	  CommonModeCorrection[isamp] = 0.0; //To be added to ADC value! 
-	      // 	}
-	      // }
-	      
-	    
-	      
-	      //commonMode[isamp] = fCommonModeFlag == 0 ? cm_sorting : cm_danning;
-
-	      //commonMode[isamp] = cm_histo;
-	      
-	      double cm_mean;
-	      
-	      UInt_t iAPV = it->pos;
-	      
-	      // std::cout << "Filling common-mode histograms..." << std::endl;
-	      
-	      // std::cout << "iAPV, nAPVsU, nAPVsV, axis = " << iAPV << ", " << fNAPVs_U << ", "
-	      // 		<< fNAPVs_V << ", " << axis << std::endl;
-	      //if(!CM_OUT_OF_RANGE || fPedestalMode){
-	      if( axis == SBSGEM::kUaxis ){
-		cm_mean = fCommonModeMeanU[iAPV];
-
-		fCommonModeDistU->Fill( iAPV, commonMode[isamp] - cm_mean );
-		fCommonModeDistU_Histo->Fill( iAPV, cm_histo - cm_mean );
-		fCommonModeDistU_Sorting->Fill( iAPV, cm_sorting - cm_mean );
-		fCommonModeDistU_Danning->Fill( iAPV, cm_danning - cm_mean );
-		fCommonModeDiffU->Fill( iAPV, commonMode[isamp] - cm_danning_online );
-		// Moving simulated common-mode corrections for full-readout events to a separate dedicated method
-		// if(CommonModeCorrection[isamp] != 0.0) fCommonModeCorrectionU->Fill( iAPV, cm_sorting - (cm_danning_online - CommonModeCorrection[isamp]));
-		// else fCommonModeNotCorrectionU->Fill( iAPV, cm_sorting - (cm_danning_online - CommonModeCorrection[isamp]));
-	      } else {
-		cm_mean = fCommonModeMeanV[iAPV];
-		
-		fCommonModeDistV->Fill( iAPV, commonMode[isamp] - cm_mean );
-		fCommonModeDistV_Histo->Fill( iAPV, cm_histo - cm_mean );
-		fCommonModeDistV_Sorting->Fill( iAPV, cm_sorting - cm_mean );
-		fCommonModeDistV_Danning->Fill( iAPV, cm_danning - cm_mean );
-		fCommonModeDiffV->Fill( iAPV, commonMode[isamp] - cm_danning_online );
-		// Moving simulated common-mode corrections for full-readout events to a separate dedicated method
-		// if(CommonModeCorrection[isamp] != 0.0) fCommonModeCorrectionV->Fill( iAPV, cm_sorting - (cm_danning_online - CommonModeCorrection[isamp]));
-		// else fCommonModeNotCorrectionV->Fill( iAPV, cm_sorting - (cm_danning_online - CommonModeCorrection[isamp]));
-	      }
-	      //}
-	      //std::cout << "Done..." << std::endl;
-	      
-	    } else if( !fPedestalMode ) { //if not doing diagnostic plots, just calculate whichever way the user wanted:
-	      
-	      commonMode[isamp] = GetCommonMode( isamp, fCommonModeFlag, *it );
-
-	      if( fCorrectCommonMode ){
-		//always calculate online CM if doing corrections:
-		fCM_online[isamp] = GetCommonMode( isamp, fCommonModeOnlFlag, *it ); 
-	      }
-
-	    }
-	    //std::cout << "effChan, isamp, Common-mode = " << effChan << ", " << isamp << ", " << commonMode[isamp] << std::endl;
-
-	    //Now handle rolling average common-mode calculation:
-	    
-	    //UpdateRollingCommonModeAverage(apvcounter,commonMode[isamp]);
-
-	    //Only fill these once per APV card per time sample per event:
-	    if( axis == SBSGEM::kUaxis ){
-	      hcommonmode_mean_by_APV_U->Fill( it->pos, commonMode[isamp] );
-	    } else {
-	      hcommonmode_mean_by_APV_V->Fill( it->pos, commonMode[isamp] );
-	    }
-	    
-	    if( goodCM && !CM_OUT_OF_RANGE ){
-	      UpdateRollingAverage( apvcounter, commonMode[isamp],
-				  fCommonModeResultContainer_by_APV,
-				  fCommonModeRollingAverage_by_APV,
-				  fCommonModeRollingRMS_by_APV,
-				  fNeventsRollingAverage_by_APV ); 
-	    }
-	  } //loop over time samples
-	
-	  if( fCorrectCommonMode ){ //For full readout events we are mainly interested in monitoring the "bias" of the ONLINE calculation,
-	    // NOT correcting the offline calculation
-	    for( int isamp=0; isamp<fN_MPD_TIME_SAMP; isamp++ ){
-	      //Are we passing sufficient information for this purpose? Let's see:
-	      UInt_t ngoodhits=0;
-
-	      //std::cout << "Attempting common-mode correction for full-readout event sample " << isamp << "...";
-	      
-	      double Correction = GetCommonModeCorrection( isamp, *it, ngoodhits, fN_APV25_CHAN, true );
-
-	      double bias = fCM_online[isamp] - Correction - commonMode[isamp];
-
-	      if( Correction != 0. && !CM_OUT_OF_RANGE ){
-		UpdateRollingAverage( apvcounter, bias,
-				      fCMbiasResultContainer_by_APV,
-				      fCommonModeOnlineBiasRollingAverage_by_APV,
-				      fCommonModeOnlineBiasRollingRMS_by_APV,
-				      fNeventsOnlineBias_by_APV );
-	      }
-
-	      //Correction += 2.0*bias*(1.0-double(ngoodhits)/double(fN_APV25_CHAN));
-	      
-	      //double Correction = 0.0;
-	      
-	      //std::cout << " done." << std::endl;
-	      //We are subtracting the result of the CM correction from the data. 
-	      
-	      UInt_t iAPV = it->pos;
-
-	      if( fMakeCommonModePlots ){
-		if( Correction != 0. ){
-
-		  double CMbiasDB = ( it->axis == SBSGEM::kUaxis ) ? fCMbiasU[iAPV] : fCMbiasV[iAPV];
-		  double CMbias = CMbiasDB;
-		  
-		  if( fNeventsOnlineBias_by_APV[apvcounter] >= std::min( UInt_t(100), std::max(UInt_t(10), fN_MPD_TIME_SAMP * fNeventsCommonModeLookBack) ) ){
-		    CMbias = fCommonModeOnlineBiasRollingAverage_by_APV[apvcounter]; 
-		  }
-		  
-		  if( it->axis == SBSGEM::kUaxis ){
-		    fCommonModeCorrectionU->Fill( iAPV, -Correction );
-		    fCommonModeResidualBiasU->Fill( iAPV, fCM_online[isamp] -Correction - commonMode[isamp] );
-		    fCommonModeResidualBias_vs_OccupancyU->Fill( double(ngoodhits)/double(fN_APV25_CHAN), fCM_online[isamp] - Correction - commonMode[isamp] );		    
-		    fCommonModeResidualBiasU_corrected->Fill( iAPV, fCM_online[isamp] -Correction - commonMode[isamp] - 2.0*CMbias*(1.0-double(ngoodhits)/double(fN_APV25_CHAN)) );
-		  } else {
-		    fCommonModeCorrectionV->Fill( iAPV, -Correction );
-		    fCommonModeResidualBiasV->Fill( iAPV, fCM_online[isamp] - Correction - commonMode[isamp] );
-		    fCommonModeResidualBias_vs_OccupancyV->Fill( double(ngoodhits)/double(fN_APV25_CHAN), fCM_online[isamp] - Correction - commonMode[isamp] );
-		    fCommonModeResidualBiasV_corrected->Fill( iAPV, fCM_online[isamp] -Correction - commonMode[isamp] - 2.0*CMbias*(1.0-double(ngoodhits)/double(fN_APV25_CHAN)) );
-		  }
-		} else {
-		  if( it->axis == SBSGEM::kUaxis ){
-		    fCommonModeDiffU_Uncorrected->Fill( iAPV, commonMode[isamp] - fCM_online[isamp] );
-		  } else {
-		    fCommonModeDiffV_Uncorrected->Fill( iAPV, commonMode[isamp] - fCM_online[isamp] );
-		  }
-		}
-	      }
-	    }
-	  }
-	  
-	} //check if conditions are satisfied to require offline common-mode calculation
-      
+	goodCM = CalcFullReadoutCommonMode( *it, apvcounter, CM_OUT_OF_RANGE, commonMode, true );
       } //End check !CM_ENABLED && BUILD_ALL_SAMPLES
       
     
@@ -2120,9 +1838,13 @@ Int_t   SBSGEMModule::Decode( const THaEvData& evdata ){
 	// }
       
 	//Temporary vector to hold ped-subtracted ADC samples for this strip:
-	std::vector<double> ADCtemp(fN_MPD_TIME_SAMP);
-	std::vector<int> rawADCtemp(fN_MPD_TIME_SAMP);
-	std::vector<Double_t> DeconvADCtemp(fN_MPD_TIME_SAMP,0.0);
+	//(these refer to preallocated work arrays, which we re-initialize here, to avoid three allocations per strip):
+	std::vector<double> &ADCtemp = fStripADCtemp;
+	std::vector<int> &rawADCtemp = fStripRawADCtemp;
+	std::vector<Double_t> &DeconvADCtemp = fStripDeconvADCtemp;
+	ADCtemp.assign( fN_MPD_TIME_SAMP, 0.0 );
+	rawADCtemp.assign( fN_MPD_TIME_SAMP, 0 );
+	DeconvADCtemp.assign( fN_MPD_TIME_SAMP, 0.0 );
 	
 	//sums over time samples
 	double ADCsum_temp = 0.0;
@@ -2141,13 +1863,20 @@ Int_t   SBSGEMModule::Decode( const THaEvData& evdata ){
 	//Pedestal has already been subtracted by the time we get herre, but let's grab anyway in case it's needed:
 	
 	//"pedtemp" is only used to fill pedestal histograms as of now:
-	double pedtemp = ( axis == SBSGEM::kUaxis ) ? fPedestalU[strip] : fPedestalV[strip];
+	double pedtemp, rmstemp, gaintemp;
+	if( chanlut != nullptr ){
+	  const sbsgemchanlut_t &chan = chanlut[rawStrip[fN_MPD_TIME_SAMP * istrip]];
+	  pedtemp = chan.pedmean;
+	  rmstemp = chan.pedrms;
+	  gaintemp = chan.gain;
+	} else {
+	  pedtemp = ( axis == SBSGEM::kUaxis ) ? fPedestalU[strip] : fPedestalV[strip];
+	  rmstemp = ( axis == SBSGEM::kUaxis ) ? fPedRMSU[strip] : fPedRMSV[strip];
+	  gaintemp = ( axis == SBSGEM::kUaxis ) ? fUgain[strip/fN_APV25_CHAN] : fVgain[strip/fN_APV25_CHAN]; //should probably not hard-code 128 here
+	}
 
 	if( fPedSubFlag != 0 && !fIsMC && !fPedestalMode ) pedtemp = 0.0;
 
-	double rmstemp = ( axis == SBSGEM::kUaxis ) ? fPedRMSU[strip] : fPedRMSV[strip];
-	double gaintemp = ( axis == SBSGEM::kUaxis ) ? fUgain[strip/fN_APV25_CHAN] : fVgain[strip/fN_APV25_CHAN]; //should probably not hard-code 128 here
-
 	// std::cout << "pedestal temp, rms temp, nsigma cut, threshold, zero suppress, pedestal mode = " << pedtemp << ", " << rmstemp << ", " << fZeroSuppressRMS
 	//   	  << ", " << fZeroSuppressRMS * rmstemp << ", " << fZeroSuppress << ", " << fPedestalMode << std::endl;
 	
@@ -2210,17 +1939,18 @@ Int_t   SBSGEMModule::Decode( const THaEvData& evdata ){
 
 	  
 	  //for crude strip timing, just take simple time bins at the center of each sample (we'll worry about trigger time words later):
-	  double Tsamp = fSamplePeriod * ( adc_samp + 0.5 );
+	  double Tsamp = fSampleTime[adc_samp];
 	  
 	  Tsum += Tsamp * ADCvalue;
-	  T2sum += pow(Tsamp,2) * ADCvalue;
+	  T2sum += Tsamp * Tsamp * ADCvalue;
 	  
 	  //assert( ((UInt_t) fNch) < fMPDmap.size()*fN_APV25_CHAN );
 	  //assert( fNstrips_hit < fMPDmap.size()*fN_APV25_CHAN );
 	}
 
-	//after the temporary ADC samples are calculated we can calculate the temporary deconvoluted ADC samples:
-	CalcDeconvolutedSamples( ADCtemp, DeconvADCtemp );
+	//The deconvoluted samples of the strips that pass zero suppression are calculated for all strips of the module at once
+	//in CalcStripFeatures; here we only need them for the diagnostic histograms of full readout events:
+	if( fullreadout ) CalcDeconvolutedSamples( ADCtemp, DeconvADCtemp );
 	//	assert(strip>=0); // Make sure we don't end up with negative strip numbers!
 	// Zero suppression based on third time sample only?
 	//Maybe better to do based on max ADC sample:
@@ -2377,7 +2107,6 @@ Int_t   SBSGEMModule::Decode( const THaEvData& evdata ){
 	  if( !fPedestalMode ){ //only apply gain correction if we aren't in pedestal-mode:
 	    for( Int_t isamp=0; isamp<fN_MPD_TIME_SAMP; isamp++ ){
 	      ADCtemp[isamp] *= gaintemp;
-	      DeconvADCtemp[isamp] *= gaintemp;
 	    }
 	    maxADC *= gaintemp;
 	    ADCsum_temp *= gaintemp;
@@ -2434,66 +2163,22 @@ Int_t   SBSGEMModule::Decode( const THaEvData& evdata ){
 	  // fADCsamples.push_back( ADCtemp ); //pedestal-subtracted
 	  // fRawADCsamples.push_back( rawADCtemp ); //Raw
 	  
-	  double ADCsum_deconv = 0.0;
-	  double maxdeconv=0.0;
-	  int imaxdeconv=0;
-
-	  double Tsum_deconv = 0.0;
-
-	  double maxcombo = 0.0;
-	  //std::vector<double> combostemp(fN_MPD_TIME_SAMP+1,0.0);
-	  double combotemp = 0.0;
-	  int imaxcombo=0;
-
-	  //we don't need to repeat the calculation of deconvoluted samples. That was moved to its own helper method:
-	  
-	    
+	  //The deconvoluted samples and the quantities derived from them are calculated in CalcStripFeatures,
+	  //once all strips of the module are decoded:
 	  for( Int_t isamp=0; isamp<fN_MPD_TIME_SAMP; isamp++ ){
 	    fADCsamples[fNstrips_hit][isamp] = ADCtemp[isamp];
 	    fRawADCsamples[fNstrips_hit][isamp] = rawADCtemp[isamp];
 
-	    fADCsamples_deconv[fNstrips_hit][isamp] = DeconvADCtemp[isamp];
-
-	    ADCsum_deconv += DeconvADCtemp[isamp];
-
-	    if( isamp==0 ){
-	      combotemp = DeconvADCtemp[isamp];
-	      maxcombo = combotemp;
-	      imaxcombo=isamp;
-	    } else {
-	      combotemp = DeconvADCtemp[isamp] + DeconvADCtemp[isamp-1];
-	      if( combotemp > maxcombo ){
-		maxcombo = combotemp;
-		imaxcombo = isamp;
-	      }
-	    }
-	    if( isamp == 5 ){
-	      combotemp = DeconvADCtemp[isamp];
-	      if( combotemp > maxcombo ){
-		maxcombo = combotemp;
-		imaxcombo = fN_MPD_TIME_SAMP;
-	      }
-	    }
-	    
-	    if( isamp == 0 || DeconvADCtemp[isamp] > maxdeconv ){
-	      imaxdeconv = isamp;
-	      maxdeconv = DeconvADCtemp[isamp];
-	    }
-
-	    Tsum_deconv += ( fSamplePeriod * (isamp + 0.5) ) * DeconvADCtemp[isamp];
-	    
 	    //fADCsamples1D.push_back( ADCtemp[isamp] );
 	    //fRawADCsamples1D.push_back( rawADCtemp[isamp] );
 	    fADCsamples1D[isamp + fN_MPD_TIME_SAMP * fNstrips_hit ] = ADCtemp[isamp];
 	    fRawADCsamples1D[isamp + fN_MPD_TIME_SAMP * fNstrips_hit ] = rawADCtemp[isamp];
-	    fADCsamplesDeconv1D[isamp + fN_MPD_TIME_SAMP * fNstrips_hit ] = fADCsamples_deconv[fNstrips_hit][isamp];
 	    
 	    if( fKeepStrip[fNstrips_hit] && hADCfrac_vs_timesample_allstrips != NULL ){
 	      hADCfrac_vs_timesample_allstrips->Fill( isamp, ADCtemp[isamp]/ADCsum_temp );
 	    }
 	  }
 	  
-	  fADCsumsDeconv[fNstrips_hit] = ADCsum_deconv;
 	  //fStripTrackIndex.push_back( -1 ); //This could be modified later based on tracking results
 	  fStripTrackIndex[fNstrips_hit] = -1;
 	  fStripOnTrack[fNstrips_hit] = 0;
@@ -2518,28 +2203,6 @@ Int_t   SBSGEMModule::Decode( const THaEvData& evdata ){
 	  
 	  //	  fADCmax.push_back( maxADC );
 	  fADCmax[fNstrips_hit] = maxADC;
-	  fADCmaxDeconv[fNstrips_hit] = maxdeconv;
-	  fADCmaxDeconvCombo[fNstrips_hit] = maxcombo;
-
-	  fMaxSampDeconv[fNstrips_hit] = imaxdeconv;
-	  fMaxSampDeconvCombo[fNstrips_hit] = imaxcombo;
-
-	  if( fDeconvolutionFlag != 0 ){
-	    //rmstemp is the rms of the average of six time samples. To get individual sample noise, we take:
-	    double sigma_1sample = rmstemp * fRMS_ConversionFactor; 
-
-	    //5 * 8 * sqrt(6) ~= 100 
-	    
-	    if( maxcombo <= fZeroSuppressRMS * sigma_1sample ){
-	      fKeepStrip[fNstrips_hit] = false;
-	    }
-
-	    if( fSuppressFirstLast != 0 && imaxcombo == 0 ){
-	      fKeepStrip[fNstrips_hit] = false;
-	    }
-	  }
-	  
-	  fTmeanDeconv[fNstrips_hit] = Tsum_deconv/ADCsum_deconv - fTrigTimeSlope*fTrigTime;
 
 	  // if( imaxcombo == 0 ){
 	  //   fTmeanDeconv[fNstrips_hit] = 0.5*fSamplePeriod - fTrigTime;
@@ -2561,18 +2224,12 @@ Int_t   SBSGEMModule::Decode( const THaEvData& evdata ){
 	  fTsigma[fNstrips_hit] = Tsigma_temp;
 	  //fTcorr.push_back( fTmean.back() ); //don't apply any corrections for now
 
-	  fStripTSchi2[fNstrips_hit] = StripTSchi2(fNstrips_hit);
-	  fStripTSprob[fNstrips_hit] = TMath::Prob( fStripTSchi2[fNstrips_hit], 6 );
-
-	  if( fUseTSchi2cut && fStripTSchi2[fNstrips_hit] > fStripTSchi2Cut ){
-	    fKeepStrip[fNstrips_hit] = false;
-	  }
+	  //TS chi2, fit time and the cuts based on them are applied in CalcStripFeatures:
 	  
 	  fStripTdiff[fNstrips_hit] = -1000.; //This will become meaningful only at the clustering stage
 	  fStripCorrCoeff[fNstrips_hit] = -1000.; //This will become meaningful only at the clustering stage
 	  fTcorr[fNstrips_hit] = fTmean[fNstrips_hit];
 
-	  fStripTfit[fNstrips_hit] = FitStripTime( fNstrips_hit, rmstemp*2.45 );
 	  //fStripTfit[fNstrips_hit] = fTmean[fNstrips_hit];
 
 	  fStrip_ENABLE_CM[fNstrips_hit] = CM_ENABLED;
@@ -2603,17 +2260,7 @@ Int_t   SBSGEMModule::Decode( const THaEvData& evdata ){
 
 	  //std::cout << "starting pedestal histograms..." << std::endl;
 
-	  if( fKeepStrip[fNstrips_hit] ){
-	    fNstrips_keep++;
-	    fNstrips_keepU += isU;
-	    fNstrips_keepV += isV;
-	    if( fADCmax[fNstrips_hit] >= fThresholdSample && fADCsums[fNstrips_hit] >= fThresholdStripSum ){
-	      fNstrips_keep_lmax++;
-	      fNstrips_keep_lmaxU += isU;
-	      fNstrips_keep_lmaxV += isV;
-	    }
-	    
-	  }
+	  //the counts of kept strips are incremented in CalcStripFeatures, after all strip cuts are applied
 	  
 	  
 	  fNstrips_hit++;
@@ -2737,17 +2384,12 @@ Int_t   SBSGEMModule::Decode( const THaEvData& evdata ){
 	  fTsigma[fNstrips_hit] = Tsigma_temp;
 	  //fTcorr.push_back( fTmean.back() ); //don't apply any corrections for now
 
-	  fStripTSchi2[fNstrips_hit] = StripTSchi2(fNstrips_hit);
-
-	  if( fUseTSchi2cut && fStripTSchi2[fNstrips_hit] > fStripTSchi2Cut ){
-	    fKeepStrip[fNstrips_hit] = false;
-	  }
+	  //TS chi2, fit time and the cuts based on them are applied in CalcStripFeatures:
 	  
 	  fStripTdiff[fNstrips_hit] = -1000.; //This will become meaningful only at the clustering stage
 	  fStripCorrCoeff[fNstrips_hit] = -1000.; //This will become meaningful only at the clustering stage
 	  fTcorr[fNstrips_hit] = fTmean[fNstrips_hit];
 
-	  fStripTfit[fNstrips_hit] = FitStripTime( fNstrips_hit, rmstemp*2.45 );
 	  //fStripTfit[fNstrips_hit] = fTmean[fNstrips_hit];
 
 	  fStrip_ENABLE_CM[fNstrips_hit] = CM_ENABLED;
@@ -2767,82 +2409,641 @@ Int_t   SBSGEMModule::Decode( const THaEvData& evdata ){
 	  fStripIsU[fNstrips_hit] = isU;
 	  fStripIsV[fNstrips_hit] = isV;
 
-	  fStripUonTrack[fNstrips_hit] = 0;
-	  fStripVonTrack[fNstrips_hit] = 0;
-	  
-	  fNstrips_hitU_neg += isU;
-	  fNstrips_hitV_neg += isV;
-	  
-	  //	  if( axis == SBSGEM::kUaxis ) fUstripIndex[strip] = fNstrips_hit;
-	  //      if( axis == SBSGEM::kVaxis ) fVstripIndex[strip] = fNstrips_hit;
+	  fStripUonTrack[fNstrips_hit] = 0;
+	  fStripVonTrack[fNstrips_hit] = 0;
+	  
+	  fNstrips_hitU_neg += isU;
+	  fNstrips_hitV_neg += isV;
+	  
+	  //	  if( axis == SBSGEM::kUaxis ) fUstripIndex[strip] = fNstrips_hit;
+	  //      if( axis == SBSGEM::kVaxis ) fVstripIndex[strip] = fNstrips_hit;
+
+	  //std::cout << "starting pedestal histograms..." << std::endl;
+
+	  //the counts of kept strips are incremented in CalcStripFeatures, after all strip cuts are applied
+	  
+	  
+	  fNstrips_hit++;
+	  fNstrips_hit_neg++;
+
+	  
+	  
+
+	}// end loop over negative zero suppression for full readout events
+
+      } //end loop over strips on this APV card	
+    } //end if( nsamp > 0 )
+  
+    apvcounter++;
+  } //end loop on decode map entries for this module
+
+  fNdecoded_ADCsamples = fNstrips_hit * fN_MPD_TIME_SAMP;
+
+  CalcStripFeatures();
+  
+  //We will want to resize the 
+
+  //resize all the "decoded strip" arrays to the actual number of fired strips:
+  
+  // fStrip.resize( fNstrips_hit );
+  // fAxis.resize( fNstrips_hit );
+  // fADCsamples.resize( fNstrips_hit );
+  // fRawADCsamples.resize( fNstrips_hit );
+  // for( int istrip=0; istrip<fNstrips_hit; istrip++ ){
+  //   fADCsamples[istrip].resize( fN_MPD_TIME_SAMP );
+  //   fRawADCsamples[istrip].resize( fN_MPD_TIME_SAMP );
+  // }
+  // fADCsums.resize( fNstrips_hit );
+  // fStripADCavg.resize( fNstrips_hit );
+  // fStripIsU.resize( fNstrips_hit );
+  // fStripIsV.resize( fNstrips_hit );
+  // fKeepStrip.resize( fNstrips_hit );
+  // fMaxSamp.resize( fNstrips_hit );
+  // fADCmax.resize( fNstrips_hit );
+  // fTmean.resize( fNstrips_hit );
+  // fTsigma.resize( fNstrips_hit );
+  // fTcorr.resize( fNstrips_hit );
+
+  // fADCsamples1D.resize( fNstrips_hit * fN_MPD_TIME_SAMP );
+  // fRawADCsamples1D.resize( fNstrips_hit * fN_MPD_TIME_SAMP );
+  // fStripTrackIndex.resize( fNstrips_hit );
+  
+  // No longer necessary:
+  //fNstrips_hitU = fUstripIndex.size();
+  //fNstrips_hitV = fVstripIndex.size();
+  
+  //std::cout << fName << " decoded, number of strips fired = " << fNstrips_hit << std::endl;
+
+  fIsDecoded = true;
+  
+  return 0;
+}
+
+Bool_t SBSGEMModule::CheckFrameViewConfig( const THaEvData& evdata ){
+  // The MPD frame view always holds Decoder::MPDModule::fgNsamplesPerStrip samples per strip, and is only used to decode
+  // the strips if fN_MPD_TIME_SAMP is equal to that. An MPD module configured with "frameview_only" doesn't load the strip
+  // samples into the slot data either, so with any other number of time samples this module would silently decode zero
+  // strips in every event. Reject that configuration instead (once per run; the result is cached):
+  if( fFrameViewConfigOK >= 0 ) return fFrameViewConfigOK != 0;
+
+  fFrameViewConfigOK = 1;
+
+  if( fIsMC || fN_MPD_TIME_SAMP == Decoder::MPDModule::fgNsamplesPerStrip ) return true;
+
+  for( const auto &apv : fMPDmap ){
+    Decoder::MPDModule *mpdmodule = dynamic_cast<Decoder::MPDModule*>( evdata.GetModule( apv.crate, apv.slot ) );
+    if( mpdmodule != nullptr && mpdmodule->IsFrameViewOnly() ){
+      Error( Here("CheckFrameViewConfig"), "MPD module in crate %u, slot %u is configured with frameview_only, which requires %u time "
+	     "samples per strip, but this module uses %u. No strips can be decoded. Fix the crate map or the database.",
+	     apv.crate, apv.slot, Decoder::MPDModule::fgNsamplesPerStrip, UInt_t(fN_MPD_TIME_SAMP) );
+      fFrameViewConfigOK = 0;
+      break;
+    }
+  }
+
+  return fFrameViewConfigOK != 0;
+}
+
+Int_t SBSGEMModule::UpdateRunningState( const THaEvData& evdata ){
+  // Update only the run-level state that Decode accumulates from event to event, for an event that is
+  // otherwise not analyzed (used by SBSAnalyzer for the physics events that belong to the other jobs of
+  // an event-partitioned replay): the MPD time stamp reference T0, and, for full-readout APV cards, the
+  // raw ADC range and the rolling averages of the common-mode and of the bias of the online common-mode.
+  // This goes through the same helpers as Decode (including the APV card counter), so that the state seen
+  // by the next analyzed event is the same as in a serial replay. No histograms are filled.
+
+  if( fIsMC ) return 0; //simulated data have no time stamps and no full readout events
+
+  if( !CheckFrameViewConfig( evdata ) ) return -1;
+
+  int apvcounter=0;
+
+  Decoder::MPDModule *mpdmodule = nullptr;
+  UInt_t mpd_crate = kMaxUInt, mpd_slot = kMaxUInt, mpd_fiber = kMaxUInt;
+  bool mpd_timestamp_found = false;
+  UInt_t mpd_Tlow = 0, mpd_Thigh = 0, mpd_EvCnt = 0;
+
+  for (std::vector<mpdmap_t>::iterator it = fMPDmap.begin() ; it != fMPDmap.end(); ++it){
+    Int_t effChan = it->mpd_id << 4 | it->adc_id;
+
+    if( it->crate != mpd_crate || it->slot != mpd_slot ){
+      mpd_crate = it->crate;
+      mpd_slot = it->slot;
+      mpd_fiber = kMaxUInt;
+      mpdmodule = GetFrameViewModule( evdata, *it );
+    }
+
+    if( it->mpd_id != mpd_fiber ){
+      mpd_fiber = it->mpd_id;
+      mpd_timestamp_found = ReadMPDTimeStamp( evdata, *it, mpdmodule, mpd_Tlow, mpd_Thigh, mpd_EvCnt );
+    }
+
+    if( mpd_timestamp_found ) UpdateT0( apvcounter, mpd_Tlow, mpd_Thigh, mpd_EvCnt );
+
+    Bool_t CM_ENABLED, BUILD_ALL_SAMPLES, CM_OUT_OF_RANGE, cm_flags_found;
+    if( !ReadAPVFlags( evdata, *it, CM_ENABLED, BUILD_ALL_SAMPLES, CM_OUT_OF_RANGE, cm_flags_found ) ) continue; //as in Decode, without incrementing the counter
+
+    bool useframeview = mpdmodule != nullptr && cm_flags_found;
+
+    Int_t nsamp = useframeview ? mpdmodule->GetFrameNstrips( effChan ) * fN_MPD_TIME_SAMP : evdata.GetNumHits( it->crate, it->slot, effChan );
+    Int_t nstrips = nsamp/fN_MPD_TIME_SAMP;
+
+    //Only full readout events contribute to the running state:
+    if( nsamp > 0 && !CM_ENABLED && BUILD_ALL_SAMPLES && nstrips == fN_APV25_CHAN ){
+      double commonMode[fN_MPD_TIME_SAMP];
+      for( int isamp=0; isamp<fN_MPD_TIME_SAMP; isamp++ ) commonMode[isamp] = 0.0;
+
+      LoadAPVSamples( evdata, *it, useframeview ? mpdmodule : nullptr, nsamp, CM_ENABLED, true, apvcounter, commonMode );
+      CalcFullReadoutCommonMode( *it, apvcounter, CM_OUT_OF_RANGE, commonMode, false );
+    }
+
+    apvcounter++;
+  }
+
+  return 0;
+}
+
+Decoder::MPDModule *SBSGEMModule::GetFrameViewModule( const THaEvData& evdata, const mpdmap_t &apv ) const {
+  //The MPD decoder module of this APV card, if its "frame view" of the raw data can be used (never for simulated data):
+  if( fIsMC || fN_MPD_TIME_SAMP != Decoder::MPDModule::fgNsamplesPerStrip ) return nullptr;
+  return dynamic_cast<Decoder::MPDModule*>( evdata.GetModule( apv.crate, apv.slot ) );
+}
+
+Bool_t SBSGEMModule::ReadMPDTimeStamp( const THaEvData& evdata, const mpdmap_t &apv, Decoder::MPDModule *mpdmodule,
+				       UInt_t &Tlow, UInt_t &Thigh, UInt_t &EvCnt ) const {
+  //Look up the time stamp and event count words of the MPD (fiber) of this APV card. Returns false if there are none:
+  UInt_t nhits_timestamp_low = evdata.GetNumHits( apv.crate, apv.slot, fChan_TimeStamp_low );
+
+  // The time stamps are only loaded into the slot data by MPDModule::LoadSlot, so if there are any, the frame view
+  // belongs to this event:
+  if( mpdmodule != nullptr && nhits_timestamp_low > 0 ){
+    return mpdmodule->GetFrameTimeStamp( apv.mpd_id, Tlow, Thigh, EvCnt );
+  }
+
+  UInt_t nhits_timestamp_high = evdata.GetNumHits( apv.crate, apv.slot, fChan_TimeStamp_high );
+  UInt_t nhits_event_count = evdata.GetNumHits( apv.crate, apv.slot, fChan_MPD_EventCount );
+
+  //std::cout << "nhits_timestamp_low = " << nhits_timestamp_low << std::endl;
+
+  if( nhits_timestamp_low > 0 && nhits_timestamp_high == nhits_timestamp_low && nhits_event_count == nhits_timestamp_low ){
+    for( unsigned int ihit=0; ihit<nhits_timestamp_low; ihit++ ){
+      unsigned int fiber = evdata.GetRawData( apv.crate, apv.slot, fChan_TimeStamp_low, ihit );
+      if( fiber == apv.mpd_id ){ //this is the channel we want:
+	Tlow = evdata.GetData( apv.crate, apv.slot, fChan_TimeStamp_low, ihit );
+	Thigh = evdata.GetData( apv.crate, apv.slot, fChan_TimeStamp_high, ihit );
+	EvCnt = evdata.GetData( apv.crate, apv.slot, fChan_MPD_EventCount, ihit );
+	return true;
+      }
+    }
+  }
+  return false;
+}
+
+Double_t SBSGEMModule::UpdateT0( int apvcounter, UInt_t Tlow, UInt_t Thigh, UInt_t EvCnt ){
+  //Returns the coarse time stamp; the time stamp reference T0 is taken from the first event of the run (MPD event count zero):
+  Long64_t Tcoarse = Thigh << 16 | ( Tlow << 8 );
+  double Tc = double(Tcoarse);
+
+  if( EvCnt == 0 ) fT0_by_APV[apvcounter] = Tc;
+
+  return Tc;
+}
+
+Bool_t SBSGEMModule::ReadAPVFlags( const THaEvData& evdata, const mpdmap_t &apv, Bool_t &CM_ENABLED, Bool_t &BUILD_ALL_SAMPLES,
+				   Bool_t &CM_OUT_OF_RANGE, Bool_t &cm_flags_found ){
+  // Get common-mode flags, if applicable. Returns false if the combination of flags is invalid and the APV card
+  // must be skipped:
+  Int_t effChan = apv.mpd_id << 4 | apv.adc_id;
+
+  // Default to the values from the database (or the default values):
+  CM_ENABLED = fCommonModeFlag != 0 && fCommonModeFlag != 1 && !fPedestalMode;
+  BUILD_ALL_SAMPLES = !fOnlineZeroSuppression;
+  CM_OUT_OF_RANGE = false;
+
+  //Initialize default values based on the run "DAQ info":
+  if(fCODA_BUILD_ALL_SAMPLES != -1){
+    BUILD_ALL_SAMPLES = fCODA_BUILD_ALL_SAMPLES;
+    fPedSubFlag = (fCODA_BUILD_ALL_SAMPLES == 0);
+  }
+  if(fCODA_CM_ENABLED != -1) CM_ENABLED = fCODA_CM_ENABLED;
+
+  UInt_t cm_flags=4*CM_OUT_OF_RANGE + 2*CM_ENABLED + BUILD_ALL_SAMPLES;
+  UInt_t nhits_cm_flag=evdata.GetNumHits( apv.crate, apv.slot, fChan_CM_flags );
+
+  //The cm flags are loaded by MPDModule::LoadSlot for every APV card with data, so if we find them, the frame view
+  // of this APV card (if any) belongs to the current event:
+  cm_flags_found = false;
+
+  if( nhits_cm_flag > 0 ){
+    // If applicable, find the common-mode/zero-suppression settings loaded from the raw data for this APV:
+    // In principle in the SSP/VTP event format, there should be exactly one "hit" per APV in this "channel":
+    for( unsigned int ihit=0; ihit<nhits_cm_flag; ihit++ ){
+      int chan_temp = evdata.GetRawData( apv.crate, apv.slot, fChan_CM_flags, ihit );
+      if( chan_temp == effChan ){ //assume that this is only filled once per MPD per event, and exit the loop when we find this MPD:
+	cm_flags = evdata.GetData( apv.crate, apv.slot, fChan_CM_flags, ihit );
+	cm_flags_found = true;
+	break;
+      }
+    }
+  } else if( !fIsMC ){
+    std::cout << "Warning in SBSGEMModule::Decode for module " << GetName()
+	      << ": CM flags missing!" << std::endl;
+  }
+
+  //The proper logic of common-mode calculation/subtraction and zero suppression is as follows:
+  // 1. If CM_ENABLED is true, we never calculate the common-mode ourselves, it has already been subtracted from the data:
+  // 2. If BUILD_ALL_SAMPLES is false, then online zero suppression is enabled. We can, in addition, apply our own higher thresholds if we want:
+  // 3. If CM_ENABLED is true, the pedestal has also been subtracted, so we don't subtract it again.
+  // 4. If CM_ENABLED is false, we need to subtract the pedestals (maybe) AND calculate and subtract the common-mode:
+  // 5. If BUILD_ALL_SAMPLES is false then CM_ENABLED had better be true!
+  // 6. If CM_OUT_OF_RANGE is true then BUILD_ALL_SAMPLES must be true and CM_ENABLED
+  //    must be false!
+
+  CM_OUT_OF_RANGE = cm_flags/4;
+  CM_ENABLED = cm_flags/2;
+  BUILD_ALL_SAMPLES = cm_flags%2;
+
+  if( !BUILD_ALL_SAMPLES && !CM_ENABLED ) { //This should never happen: skip this APV card
+    return false;
+  }
+  if( CM_OUT_OF_RANGE && !BUILD_ALL_SAMPLES ){ // this should also never happen: skip this APV card:
+    return false;
+  }
+
+  if( CM_OUT_OF_RANGE && CM_ENABLED ){ //force CM_ENABLED to false if CM_OUT_OF_RANGE is true;
+    //This should have already been done online:
+    CM_ENABLED = false;
+  }
+
+  return true;
+}
+
+void SBSGEMModule::LoadAPVSamples( const THaEvData& evdata, const mpdmap_t &apv, Decoder::MPDModule *frameview, Int_t nsamp,
+				   Bool_t CM_ENABLED, Bool_t fullreadout, int apvcounter, Double_t *commonMode ){
+  // Populate the per-APV work arrays (strip, raw strip, raw ADC, ped sub ADC and common-mode-subtracted ADC) from the
+  // raw data of this APV card. If frameview is not null, the strip samples are decoded directly from the raw data via
+  // the MPD frame view, rather than read back from the slot data one sample at a time.
+  // For full readout events, also update the raw ADC range of this APV card, and in pedestal mode, accumulate the
+  // simple common-mode average in commonMode (which must be zeroed by the caller):
+  Int_t effChan = apv.mpd_id << 4 | apv.adc_id;
+
+  SBSGEM::GEMaxis_t axis = apv.axis == 0 ? SBSGEM::kUaxis : SBSGEM::kVaxis;
+
+  //Block of the tracker channel lookup table for this APV card, indexed by raw APV channel, if available:
+  const sbsgemchanlut_t *chanlut = ( fChannelLUT != nullptr && apv.lut_offset >= 0 ) ? fChannelLUT + apv.lut_offset : nullptr;
+
+  vector<UInt_t> &Strip = fStripAPV;
+  vector<UInt_t> &rawStrip = fRawStripAPV;
+  vector<Int_t> &rawADC = fRawADC_APV;
+  vector<Int_t> &rawADC_nopedsub = fRawADC_nopedsub_APV;
+  vector<Double_t> &pedsubADC = fPedSubADC_APV;
+  vector<Double_t> &commonModeSubtractedADC = fCommonModeSubtractedADC_APV;
+
+  UInt_t frameADC[Decoder::MPDModule::fgNsamplesPerStrip];
+  UInt_t framestrip = 0;
+
+  for( int iraw=0; iraw<nsamp; iraw++ ){ //NOTE: iraw = isamp + fN_MPD_TIME_SAMP * istrip
+    int isamp = iraw%fN_MPD_TIME_SAMP;
+
+    int strip;
+    UInt_t decoded_rawADC;
+
+    if( frameview != nullptr ){ //unpack all the samples of this strip when we reach the first one:
+      if( isamp == 0 ){
+	Decoder::MPDModule::DecodeStripWords( frameview->GetFrameStripWords( effChan, iraw/fN_MPD_TIME_SAMP ), frameADC, framestrip );
+      }
+      strip = framestrip;
+      decoded_rawADC = frameADC[isamp];
+    } else {
+      strip = evdata.GetRawData( apv.crate, apv.slot, effChan, iraw );
+      decoded_rawADC = evdata.GetData( apv.crate, apv.slot, effChan, iraw );
+    }
+
+    Int_t ADC = Int_t( decoded_rawADC );
+
+    rawStrip[iraw] = strip;
+    rawADC[iraw] = ADC;
+
+    double ped;
+    if( chanlut != nullptr ){
+      Strip[iraw] = chanlut[strip].strip;
+      ped = chanlut[strip].pedmean;
+    } else {
+      Strip[iraw] = GetStripNumber( strip, apv.pos, apv.invert );
+      ped = (axis == SBSGEM::kUaxis ) ? fPedestalU[Strip[iraw]] : fPedestalV[Strip[iraw]];
+    }
+
+    rawADC_nopedsub[iraw] = ADC;
+
+    if( fPedSubFlag != 0 ){ //ped subtraction online; add pedestal back in to the "nopedsub" value:
+      rawADC_nopedsub[iraw] = Int_t(ADC +  ped);
+    }
+
+    if( fullreadout ){ //update min and max values for this APV as appropriate:
+      //double rawADC_nopedsub = double(ADC);
+
+      if( fNumFullReadoutEvents_by_APV[apvcounter] == 0 || rawADC_nopedsub[iraw] < fRawADCminResult_by_APV[apvcounter] ){ //first full readout event or val < min:
+	fRawADCminResult_by_APV[apvcounter] = rawADC_nopedsub[iraw];
+      }
+
+      if( fNumFullReadoutEvents_by_APV[apvcounter] == 0 || rawADC_nopedsub[iraw] > fRawADCmaxResult_by_APV[apvcounter] ){ //first full readout event or val < min:
+	fRawADCmaxResult_by_APV[apvcounter] = rawADC_nopedsub[iraw];
+      }
+
+      fNumFullReadoutEvents_by_APV[apvcounter]++;
+    }
+    // If pedestal subtraction was done online, don't do it again:
+    // In pedestal mode, the DAQ should NOT have subtracted the pedestals,
+    // but even if it did, it shouldn't affect the pedestal analysis to first order whether we subtract the pedestals or not:
+    if( fPedSubFlag != 0 && !fPedestalMode && !fIsMC ) ped = 0.0;
+    if( CM_ENABLED && !fIsMC ) {
+      ped = 0.0; //If this is true then the pedestal was DEFINITELY always calculated online:
+      //rawADC[iraw] += fCM_online[isamp] (not yet sure if we want to add back the online-CM) ;
+    }
+
+    pedsubADC[iraw] = double(ADC) - ped;
+    commonModeSubtractedADC[iraw] = double(ADC) - ped; 
+
+    //the calculation of common mode in pedestal mode analysis differs from the
+    // offline or online zero suppression analysis; here we use a simple average of all 128 channels:
+    if( fPedestalMode ){
+      //do simple common-mode calculation involving the simple average of all 128 (ped-subtracted) ADC
+      //values   
+
+      if( fSubtractPedBeforeCommonMode ){
+	commonMode[isamp] += pedsubADC[iraw]/double(fN_APV25_CHAN);
+      } else {
+	commonMode[isamp] += rawADC[iraw]/double(fN_APV25_CHAN);
+      }
+    }
+  }
+}
+
+Bool_t SBSGEMModule::CalcFullReadoutCommonMode( const mpdmap_t &apv, int apvcounter, Bool_t CM_OUT_OF_RANGE, Double_t *commonMode,
+						Bool_t fillhistos ){
+  // Calculate the common-mode of a full readout APV card from the work arrays filled by LoadAPVSamples, and update the
+  // rolling averages of the common-mode and of the bias of the online common-mode. Diagnostic histograms are only
+  // filled if fillhistos is true. Returns false if the common-mode was not good in every time sample:
+  SBSGEM::GEMaxis_t axis = apv.axis == 0 ? SBSGEM::kUaxis : SBSGEM::kVaxis;
+
+  bool goodCM = true;
+
+  if( fMakeCommonModePlots || !fPedestalMode ) { // calculate both ways:
+
+    //vector<double> CM_danning_online_temp(fN_MPD_TIME_SAMP,0);
+
+    for( int isamp=0; isamp<fN_MPD_TIME_SAMP; isamp++ ){
+
+      int ngood = GetNumGoodHitsAPV( isamp, apv );
+
+      if( ngood < fCommonModeMinStripsInRange ){
+	goodCM = false; //we'll require good common-mode on all six time samples to keep this APV's data for tracking analysis
+      }
+
+      //moved common-mode calculation to its own function:
+
+      // Now: a question is should we modify the behavior/do added checks if
+      // CM_OUT_OF_RANGE is set? 
+
+      if( fMakeCommonModePlots ){
+	//double cm_danning = GetCommonMode( isamp, 1, apv );
+	//experimental: Test histogramming method:
+	double cm_danning = GetCommonMode( isamp, 1, apv );
+	double cm_histo= GetCommonMode( isamp, 2, apv );
+	double cm_histo_online = GetCommonMode( isamp, 5, apv );
+	//if( !CM_OUT_OF_RANGE ) { // this is a hack so I only get debug printouts for good (full readout) events
+	//cm_histo = GetCommonMode( isamp, 2, apv );
+	// }    else {
+	//cm_histo = cm_danning;
+	//}
+	double cm_sorting = GetCommonMode( isamp, 0, apv );
+	double cm_danning_online = GetCommonMode( isamp, fCommonModeOnlFlag, apv );
+	//double cm_danning_offline = GetCommonMode( isamp, 4, apv, cm_danning_online ); //Artificially zero suppress this calculation to check the CM correction algorithm
+
+	fCM_online[isamp] = cm_danning_online;
+
+	//If we are in this if-block, this is a full-readout event
+
+	//std::cout << "cm danning, sorting = " << cm_danning << ", " << cm_sorting << std::endl;
+
+	if( !fPedestalMode ){
+	  switch( fCommonModeFlag ){
+	  case 5:
+	    commonMode[isamp] = cm_histo_online;
+	    break;
+	  case 2:
+	    commonMode[isamp] = cm_histo;
+	    break;
+	  case 1:
+	  default:
+	    commonMode[isamp] = cm_danning;
+	    break;
+	  case 0:
+	    commonMode[isamp] = cm_sorting;
+	    break;
+	  }
+	}
+
+	// //Common-mode correction needs to be moved to its own method:
+
+	// //Calculate diagnostic plots for the CM correction algorithm
+	// double CM_meas = cm_danning_online;
+	// double CM_expect_mean, CM_expect_rms;
+	// if( fMeasureCommonMode && fNeventsRollingAverage_by_APV[apvcounter] >= std::min(UInt_t(100),fNeventsCommonModeLookBack*fN_MPD_TIME_SAMP) ){
+	//      //If we have a critical mass of events in the rolling CM average for this to be a reliable estimate, use it: 
+	//      CM_expect_mean = fCommonModeRollingAverage_by_APV[apvcounter];
+	//      CM_expect_rms = fCommonModeRollingRMS_by_APV[apvcounter]; 
+	// } else { //use database value:
+	//      UInt_t postemp = fMPDmap[apvcounter].pos;
+	//      UInt_t axistemp = fMPDmap[apvcounter].axis;
+
+	//      CM_expect_mean = (axistemp == SBSGEM::kUaxis) ? fCommonModeMeanU[postemp] : fCommonModeMeanV[postemp];
+	//      CM_expect_rms = (axistemp == SBSGEM::kUaxis) ? fCommonModeRMSU[postemp] : fCommonModeRMSV[postemp];             
+	// }
+
+	// //if( CM_meas < CM_expect_mean - fCorrectCommonMode_Nsigma * CM_expect_rms ){
+	// if(true){ // Lets try forcing every event to pass this first cut
+	//      // The online common mode appears to have a large negative bias relative to the expectation. 
+	//      // Try to correct the common-mode. To calculate the correction requires us to loop on all the strips on this APV that passed
+	//      // online zero suppression.
+	//      // The simplest approach is just to take a simple average of all the strips within +/- some number of standard deviations of the
+	//      // *EXPECTED* common-mode mean, but this is a biased approach.
+
+	//      UInt_t NstripsInRange = 0; 
+
+	//      //Loop on all strips on this APV and calculate raw ADC values from 
+	//      for(int istrip=0; istrip<nstrips; ++istrip ){
+	//        int iraw = isamp + fN_MPD_TIME_SAMP * istrip;
+
+	//        int strip = evdata.GetRawData( apv.crate, apv.slot, effChan, iraw );
+	//        UInt_t decoded_rawADC = evdata.GetData( apv.crate, apv.slot, effChan, iraw );
+
+	//        Int_t ADCtemp = pedsubADC[iraw];
+
+	//        double rmstemp = (axis == SBSGEM::kUaxis ) ? fPedRMSU[Strip[iraw]] : fPedRMSV[Strip[iraw]];
+
+	//        double strip_sum = 0;
+	//        for(int itsamp=0; itsamp < 6; itsamp++)
+	//          strip_sum += ADCtemp - cm_danning_online;
+	//        if(strip_sum/fN_MPD_TIME_SAMP < 3*rmstemp) continue;
+
+	//        rawStrip[iraw] = strip;
+	//        Strip[iraw] = GetStripNumber( strip, apv.pos, apv.invert );
+
+	//        rawADC[iraw] = ADCtemp;
+	//        pedsubADC[iraw] = double( rawADC[iraw] ); //this is the one that goes into the common-mode calculation
+	//        if( fabs( pedsubADC[iraw] - CM_expect_mean ) <= fCorrectCommonMode_Nsigma * CM_expect_rms ) NstripsInRange++;
+	//      }
+
+	//      if( NstripsInRange >= fCommonModeMinStripsInRange ){
+	//        //Correction to be ADDED to ADC value to get corrected value:
+	//        CommonModeCorrection[isamp] = CM_meas -  GetCommonMode( isamp, 4, apv, cm_danning_online, nstrips ) + 3*8.3*(1 - NstripsInRange*1.0 / 128); //add extra 3 sigma * (1 - occupancy) to correct for extra positive bias from zero suppression
+
+	//      } else {
+	//        CommonModeCorrection[isamp] = 0.0; //To be added to ADC value! 
+	//      }
+	// }
+
+
+
+	//commonMode[isamp] = fCommonModeFlag == 0 ? cm_sorting : cm_danning;
+
+	//commonMode[isamp] = cm_histo;
+
+	double cm_mean;
+
+	UInt_t iAPV = apv.pos;
+
+	// std::cout << "Filling common-mode histograms..." << std::endl;
+
+	// std::cout << "iAPV, nAPVsU, nAPVsV, axis = " << iAPV << ", " << fNAPVs_U << ", "
+	//              << fNAPVs_V << ", " << axis << std::endl;
+	//if(!CM_OUT_OF_RANGE || fPedestalMode){
+	if( fillhistos ){
+	  if( axis == SBSGEM::kUaxis ){
+	    cm_mean = fCommonModeMeanU[iAPV];
+
+	    fCommonModeDistU->Fill( iAPV, commonMode[isamp] - cm_mean );
+	    fCommonModeDistU_Histo->Fill( iAPV, cm_histo - cm_mean );
+	    fCommonModeDistU_Sorting->Fill( iAPV, cm_sorting - cm_mean );
+	    fCommonModeDistU_Danning->Fill( iAPV, cm_danning - cm_mean );
+	    fCommonModeDiffU->Fill( iAPV, commonMode[isamp] - cm_danning_online );
+	    // Moving simulated common-mode corrections for full-readout events to a separate dedicated method
+	    // if(CommonModeCorrection[isamp] != 0.0) fCommonModeCorrectionU->Fill( iAPV, cm_sorting - (cm_danning_online - CommonModeCorrection[isamp]));
+	    // else fCommonModeNotCorrectionU->Fill( iAPV, cm_sorting - (cm_danning_online - CommonModeCorrection[isamp]));
+	  } else {
+	    cm_mean = fCommonModeMeanV[iAPV];
+
+	    fCommonModeDistV->Fill( iAPV, commonMode[isamp] - cm_mean );
+	    fCommonModeDistV_Histo->Fill( iAPV, cm_histo - cm_mean );
+	    fCommonModeDistV_Sorting->Fill( iAPV, cm_sorting - cm_mean );
+	    fCommonModeDistV_Danning->Fill( iAPV, cm_danning - cm_mean );
+	    fCommonModeDiffV->Fill( iAPV, commonMode[isamp] - cm_danning_online );
+	    // Moving simulated common-mode corrections for full-readout events to a separate dedicated method
+	    // if(CommonModeCorrection[isamp] != 0.0) fCommonModeCorrectionV->Fill( iAPV, cm_sorting - (cm_danning_online - CommonModeCorrection[isamp]));
+	    // else fCommonModeNotCorrectionV->Fill( iAPV, cm_sorting - (cm_danning_online - CommonModeCorrection[isamp]));
+	  }
+	}
+	//}
+	//std::cout << "Done..." << std::endl;
+
+      } else if( !fPedestalMode ) { //if not doing diagnostic plots, just calculate whichever way the user wanted:
+
+	commonMode[isamp] = GetCommonMode( isamp, fCommonModeFlag, apv );
+
+	if( fCorrectCommonMode ){
+	  //always calculate online CM if doing corrections:
+	  fCM_online[isamp] = GetCommonMode( isamp, fCommonModeOnlFlag, apv ); 
+	}
+
+      }
+      //std::cout << "effChan, isamp, Common-mode = " << effChan << ", " << isamp << ", " << commonMode[isamp] << std::endl;
+
+      //Now handle rolling average common-mode calculation:
+
+      //UpdateRollingCommonModeAverage(apvcounter,commonMode[isamp]);
+
+      //Only fill these once per APV card per time sample per event:
+      if( fillhistos ){
+	if( axis == SBSGEM::kUaxis ){
+	  hcommonmode_mean_by_APV_U->Fill( apv.pos, commonMode[isamp] );
+	} else {
+	  hcommonmode_mean_by_APV_V->Fill( apv.pos, commonMode[isamp] );
+	}
+      }
+
+      if( goodCM && !CM_OUT_OF_RANGE ){
+	UpdateRollingAverage( apvcounter, commonMode[isamp],
+			    fCommonModeResultContainer_by_APV,
+			    fCommonModeRollingAverage_by_APV,
+			    fCommonModeRollingRMS_by_APV,
+			    fNeventsRollingAverage_by_APV ); 
+      }
+    } //loop over time samples
 
-	  //std::cout << "starting pedestal histograms..." << std::endl;
+    if( fCorrectCommonMode ){ //For full readout events we are mainly interested in monitoring the "bias" of the ONLINE calculation,
+      // NOT correcting the offline calculation
+      for( int isamp=0; isamp<fN_MPD_TIME_SAMP; isamp++ ){
+	//Are we passing sufficient information for this purpose? Let's see:
+	UInt_t ngoodhits=0;
 
-	  if( fKeepStrip[fNstrips_hit] ){
-	    fNstrips_keep++;
-	    fNstrips_keepU += isU;
-	    fNstrips_keepV += isV;
-	    if( fADCmax[fNstrips_hit] >= fThresholdSample && fADCsums[fNstrips_hit] >= fThresholdStripSum ){
-	      fNstrips_keep_lmax++;
-	      fNstrips_keep_lmaxU += isU;
-	      fNstrips_keep_lmaxV += isV;
-	    }
-	    
-	  }
-	  
-	  
-	  fNstrips_hit++;
-	  fNstrips_hit_neg++;
+	//std::cout << "Attempting common-mode correction for full-readout event sample " << isamp << "...";
 
-	  
-	  
+	double Correction = GetCommonModeCorrection( isamp, apv, ngoodhits, fN_APV25_CHAN, true );
 
-	}// end loop over negative zero suppression for full readout events
+	double bias = fCM_online[isamp] - Correction - commonMode[isamp];
 
-      } //end loop over strips on this APV card	
-    } //end if( nsamp > 0 )
-  
-    apvcounter++;
-  } //end loop on decode map entries for this module
+	if( Correction != 0. && !CM_OUT_OF_RANGE ){
+	  UpdateRollingAverage( apvcounter, bias,
+				fCMbiasResultContainer_by_APV,
+				fCommonModeOnlineBiasRollingAverage_by_APV,
+				fCommonModeOnlineBiasRollingRMS_by_APV,
+				fNeventsOnlineBias_by_APV );
+	}
 
-  fNdecoded_ADCsamples = fNstrips_hit * fN_MPD_TIME_SAMP;
-  
-  //We will want to resize the 
+	//Correction += 2.0*bias*(1.0-double(ngoodhits)/double(fN_APV25_CHAN));
 
-  //resize all the "decoded strip" arrays to the actual number of fired strips:
-  
-  // fStrip.resize( fNstrips_hit );
-  // fAxis.resize( fNstrips_hit );
-  // fADCsamples.resize( fNstrips_hit );
-  // fRawADCsamples.resize( fNstrips_hit );
-  // for( int istrip=0; istrip<fNstrips_hit; istrip++ ){
-  //   fADCsamples[istrip].resize( fN_MPD_TIME_SAMP );
-  //   fRawADCsamples[istrip].resize( fN_MPD_TIME_SAMP );
-  // }
-  // fADCsums.resize( fNstrips_hit );
-  // fStripADCavg.resize( fNstrips_hit );
-  // fStripIsU.resize( fNstrips_hit );
-  // fStripIsV.resize( fNstrips_hit );
-  // fKeepStrip.resize( fNstrips_hit );
-  // fMaxSamp.resize( fNstrips_hit );
-  // fADCmax.resize( fNstrips_hit );
-  // fTmean.resize( fNstrips_hit );
-  // fTsigma.resize( fNstrips_hit );
-  // fTcorr.resize( fNstrips_hit );
+	//double Correction = 0.0;
 
-  // fADCsamples1D.resize( fNstrips_hit * fN_MPD_TIME_SAMP );
-  // fRawADCsamples1D.resize( fNstrips_hit * fN_MPD_TIME_SAMP );
-  // fStripTrackIndex.resize( fNstrips_hit );
-  
-  // No longer necessary:
-  //fNstrips_hitU = fUstripIndex.size();
-  //fNstrips_hitV = fVstripIndex.size();
-  
-  //std::cout << fName << " decoded, number of strips fired = " << fNstrips_hit << std::endl;
+	//std::cout << " done." << std::endl;
+	//We are subtracting the result of the CM correction from the data. 
 
-  fIsDecoded = true;
-  
-  return 0;
+	UInt_t iAPV = apv.pos;
+
+	if( fMakeCommonModePlots && fillhistos ){
+	  if( Correction != 0. ){
+
+	    double CMbiasDB = ( apv.axis == SBSGEM::kUaxis ) ? fCMbiasU[iAPV] : fCMbiasV[iAPV];
+	    double CMbias = CMbiasDB;
+
+	    if( fNeventsOnlineBias_by_APV[apvcounter] >= std::min( UInt_t(100), std::max(UInt_t(10), fN_MPD_TIME_SAMP * fNeventsCommonModeLookBack) ) ){
+	      CMbias = fCommonModeOnlineBiasRollingAverage_by_APV[apvcounter]; 
+	    }
+
+	    if( apv.axis == SBSGEM::kUaxis ){
+	      fCommonModeCorrectionU->Fill( iAPV, -Correction );
+	      fCommonModeResidualBiasU->Fill( iAPV, fCM_online[isamp] -Correction - commonMode[isamp] );
+	      fCommonModeResidualBias_vs_OccupancyU->Fill( double(ngoodhits)/double(fN_APV25_CHAN), fCM_online[isamp] - Correction - commonMode[isamp] );                   
+	      fCommonModeResidualBiasU_corrected->Fill( iAPV, fCM_online[isamp] -Correction - commonMode[isamp] - 2.0*CMbias*(1.0-double(ngoodhits)/double(fN_APV25_CHAN)) );
+	    } else {
+	      fCommonModeCorrectionV->Fill( iAPV, -Correction );
+	      fCommonModeResidualBiasV->Fill( iAPV, fCM_online[isamp] - Correction - commonMode[isamp] );
+	      fCommonModeResidualBias_vs_OccupancyV->Fill( double(ngoodhits)/double(fN_APV25_CHAN), fCM_online[isamp] - Correction - commonMode[isamp] );
+	      fCommonModeResidualBiasV_corrected->Fill( iAPV, fCM_online[isamp] -Correction - commonMode[isamp] - 2.0*CMbias*(1.0-double(ngoodhits)/double(fN_APV25_CHAN)) );
+	    }
+	  } else {
+	    if( apv.axis == SBSGEM::kUaxis ){
+	      fCommonModeDiffU_Uncorrected->Fill( iAPV, commonMode[isamp] - fCM_online[isamp] );
+	    } else {
+	      fCommonModeDiffV_Uncorrected->Fill( iAPV, commonMode[isamp] - fCM_online[isamp] );
+	    }
+	  }
+	}
+      }
+    }
+  } //check if conditions are satisfied to require offline common-mode calculation
+
+  return goodCM;
 }
 
 void SBSGEMModule::add_constraint( TVector2 constraint_center, TVector2 constraint_width ){
@@ -3204,6 +3405,7 @@ void SBSGEMModule::find_clusters_1D_experimental( SBSGEM::GEMaxis_t axis, Double
       //std::cout << "time sample " << isamp << ", local max in strip " << stripmax << ", nstrips = " << nstrips << std::endl;
       
       sbsgemcluster_t clusttemp;
+      clusttemp.SetArena( &fClusterArena );
       clusttemp.nstrips = nstrips;
       clusttemp.istriplo = striplo;
       clusttemp.istriphi = striphi;
@@ -3316,6 +3518,7 @@ void SBSGEMModule::find_clusters_1D_experimental( SBSGEM::GEMaxis_t axis, Double
     if( Nsamp_allmaxima[stripmax] > 2 ){ // we want this strip to be a local max in at least three time samples (at this stage we aren't requiring them to be consecutive)
       
       sbsgemcluster_t fullcluster;
+      fullcluster.SetArena( &fClusterArena );
 
       fullcluster.ADCsamples.resize( fN_MPD_TIME_SAMP, 0.0 );
       fullcluster.DeconvADCsamples.resize( fN_MPD_TIME_SAMP, 0.0 );
@@ -3490,19 +3693,21 @@ void SBSGEMModule::find_clusters_1D( SBSGEM::GEMaxis_t axis, Double_t constraint
   
   clusters.clear();
   
-  std::set<UShort_t> striplist;  //sorted list of strips for 1D clustering
-  std::map<UShort_t, UInt_t> hitindex; //key = strip ID, mapped value = index in decoded hit array, needed to access the other information efficiently:
-  std::map<UShort_t, Double_t> pedrms_strip;
-  std::map<UShort_t, Double_t> ADC_strip; // These are the (configuration-dependent) quantities we use for clustering. They depend on the values of fClusteringFlag and fSuppressFirstLast and fDeconvolution_flag
-  std::map<UShort_t, Double_t> ADC_maxsamp; //
-  std::map<UShort_t, Double_t> Tmean_strip; //strip mean time with first and/or last samples removed (if applicable)
-  std::map<UShort_t, Double_t> Tmean_strip_deconv; //strip deconvoluted mean time
-  std::map<UShort_t, Double_t> Tfit_strip; //strip "fit" time
-  std::map<UShort_t, Double_t> Tsigma_strip; //strip rms time with first and/or last samples removed (if applicable)
+  //All the per-strip bookkeeping uses the module's preallocated strip-indexed work arrays (see ReadDatabase), so that
+  //clustering doesn't allocate. The arrays have one guard entry before strip 0 and after the last strip, so that
+  //hitindex[strip-1] and hitindex[strip+1] are always valid; a strip that didn't fire has hitindex < 0:
+  std::vector<UShort_t> &striplist = fClustStrips;  //sorted list of strips for 1D clustering
+  Int_t *hitindex = fClustHitIndex.data() + 1; //index in decoded hit array by strip, needed to access the other information efficiently:
+  const Double_t *pedrms_strip = ( axis == SBSGEM::kUaxis ) ? fPedRMSU.data() : fPedRMSV.data();
+  Double_t *ADC_strip = fClustADCstrip.data() + 1; // These are the (configuration-dependent) quantities we use for clustering. They depend on the values of fClusteringFlag and fSuppressFirstLast and fDeconvolution_flag
+  Double_t *ADC_maxsamp = fClustADCmaxsamp.data() + 1; //
   
-  std::set<UShort_t> striplist_neg;  //same as above but for negative strips
-  std::map<UShort_t, UInt_t> hitindex_neg;
-  std::map<UShort_t, Double_t> pedrms_strip_neg;
+  std::vector<UShort_t> &striplist_neg = fClustStripsNeg;  //same as above but for negative strips
+  Int_t *hitindex_neg = fClustHitIndexNeg.data() + 1;
+  const Double_t *pedrms_strip_neg = pedrms_strip;
+
+  striplist.clear();
+  striplist_neg.clear();
 
   UShort_t FirstSampleCorrCoeff=0;
   UShort_t NsampCorrCoeff=fN_MPD_TIME_SAMP;
@@ -3524,24 +3729,16 @@ void SBSGEMModule::find_clusters_1D( SBSGEM::GEMaxis_t axis, Double_t constraint
     //if( fAxis[ihit] == axis && fKeepStrip[ihit] ){
     if( fAxis[ihit] == axis ){ //Try only enforcing fKeepStrip on the cluster maximum:
     
-      bool newstrip = (striplist.insert( fStrip[ihit] ) ).second;
+      bool newstrip = hitindex[fStrip[ihit]] < 0;
 
       if( newstrip ){ //should always be true:
+	striplist.push_back( fStrip[ihit] );
 	hitindex[fStrip[ihit]] = ihit;
-	if( axis == SBSGEM::kUaxis ){
-	  pedrms_strip[fStrip[ihit]] = fPedRMSU[fStrip[ihit]];
-	} else {
-	  pedrms_strip[fStrip[ihit]] = fPedRMSV[fStrip[ihit]];
-	}
 
 	//Default behavior is that clustering is done using sums of ADC values over all time
 	//samples on a strip:
 	ADC_strip[fStrip[ihit]] = fADCsums[ihit];
 	ADC_maxsamp[fStrip[ihit]] = fADCmax[ihit];
-	Tmean_strip[fStrip[ihit]] = fTmean[ihit];
-	Tmean_strip_deconv[fStrip[ihit]] = fTmeanDeconv[ihit];
-	Tfit_strip[fStrip[ihit]] = fStripTfit[ihit];
-	Tsigma_strip[fStrip[ihit]] = fTsigma[ihit];
 
 	//fClusteringFlag =
 	// 1. Use deconvoluted max. combo
@@ -3555,25 +3752,25 @@ void SBSGEMModule::find_clusters_1D( SBSGEM::GEMaxis_t axis, Double_t constraint
     }
     //Also add strips for negative signal clustering if fNegSignalStudy is true
     if( fAxis[ihit] == axis && fStripIsNeg[ihit] && fStrip_BUILD_ALL_SAMPLES[ihit] && !fStrip_ENABLE_CM[ihit] && fNegSignalStudy){
-      bool newstrip = (striplist_neg.insert( fStrip[ihit] ) ).second;
+      bool newstrip = hitindex_neg[fStrip[ihit]] < 0;
       
       if( newstrip ){ //should always be true:
+	striplist_neg.push_back( fStrip[ihit] );
 	hitindex_neg[fStrip[ihit]] = ihit;
-	if( axis == SBSGEM::kUaxis ){
-	  pedrms_strip_neg[fStrip[ihit]] = fPedRMSU[fStrip[ihit]];
-	} else {
-	  pedrms_strip_neg[fStrip[ihit]] = fPedRMSV[fStrip[ihit]];
-	}
       }
     }
   }
 
-  std::set<UShort_t> localmaxima;
-  std::map<UShort_t,bool> islocalmax;
-  //std::map<UShort_t,bool> passed_constraint;
+  //The decoded strips are not necessarily in strip order:
+  std::sort( striplist.begin(), striplist.end() );
+  std::sort( striplist_neg.begin(), striplist_neg.end() );
+
+  std::vector<UShort_t> &localmaxima = fClustMaxima; //local maxima in ascending strip order
+  char *islocalmax = fClustIsLocalMax.data() + 1;
+  localmaxima.clear();
   
   
-  for( std::set<UShort_t>::iterator i=striplist.begin(); i != striplist.end(); ++i ){
+  for( auto i=striplist.begin(); i != striplist.end(); ++i ){
     int strip = *i;
     //int hitidx = hitindex[strip];
     islocalmax[strip] = false;
@@ -3584,11 +3781,11 @@ void SBSGEMModule::find_clusters_1D( SBSGEM::GEMaxis_t axis, Double_t constraint
     double sumright = 0.0;
 
     
-    if( striplist.find( strip - 1 ) != striplist.end() ){
+    if( hitindex[strip-1] >= 0 ){
       //sumleft = fADCsums[hitindex[strip-1]]; //if strip - 1 is found in strip list, hitindex is guaranteed to have been initialized above
       sumleft = ADC_strip[strip-1]; //if strip - 1 is found in strip list, hitindex is guaranteed to have been initialized above
     }
-    if( striplist.find( strip + 1 ) != striplist.end() ){
+    if( hitindex[strip+1] >= 0 ){
       //sumright = fADCsums[hitindex[strip+1]];
       sumright = ADC_strip[strip+1];
     }
@@ -3605,7 +3802,7 @@ void SBSGEMModule::find_clusters_1D( SBSGEM::GEMaxis_t axis, Double_t constraint
 	//	fADCmax[hitindex[strip]] >= fThresholdSample ){ //new local max:
       bool goodtime = true;
 
-      double tstrip = Tmean_strip[strip];
+      double tstrip = fTmean[hitindex[strip]];
       double t0 = fStripMaxTcut_central[axis];
       double tcut = fStripMaxTcut_width[axis];
       double tsigma = fStripMaxTcut_sigma[axis];
@@ -3613,14 +3810,14 @@ void SBSGEMModule::find_clusters_1D( SBSGEM::GEMaxis_t axis, Double_t constraint
       //double t0 = 0.0; //now the mean value has been subtracted off.
       
       if( fUseStripTimingCuts == 2 && fClusteringFlag != 1 ){ //alternate timing cut based on strip "fitted" time
-	tstrip = Tfit_strip[strip];
+	tstrip = fStripTfit[hitindex[strip]];
 	t0 = fStripMaxTcut_central_fit[axis];
 	tcut = fStripMaxTcut_width_fit[axis];
 	tsigma = fStripMaxTcut_sigma_fit[axis]; 
       }
       
       if( fClusteringFlag == 1 ){
-	tstrip = Tmean_strip_deconv[strip];
+	tstrip = fTmeanDeconv[hitindex[strip]];
 	t0 = fStripMaxTcut_central_deconv[axis];
 	tcut = fStripMaxTcut_width_deconv[axis];
 	tsigma = fStripMaxTcut_sigma_deconv[axis]; 
@@ -3638,18 +3835,20 @@ void SBSGEMModule::find_clusters_1D( SBSGEM::GEMaxis_t axis, Double_t constraint
 
       if( goodtime && fKeepStrip[hitindex[strip]] ){
 	islocalmax[strip] = true;
-	localmaxima.insert( strip );
+	localmaxima.push_back( strip );
       }
     }
   } // end loop over list of strips along this axis:
 
   //cout << "before peak erasing, n local maxima = " << localmaxima.size() << endl;
   
-  vector<int> peakstoerase; 
+  //Peaks to erase are only flagged (islocalmax = false) here and removed from localmaxima after the loop:
+  std::vector<UShort_t> &peakstoerase = fClustPeaksToErase;
+  peakstoerase.clear();
 
   //now calculate "prominence" for all peaks and erase "insignificant" peaks:
 
-  for( std::set<UShort_t>::iterator i=localmaxima.begin(); i != localmaxima.end(); ++i ){
+  for( auto i=localmaxima.begin(); i != localmaxima.end(); ++i ){
     int stripmax = *i;
 
     //double ADCmax = fADCsums[hitindex[stripmax]];
@@ -3662,7 +3861,7 @@ void SBSGEMModule::find_clusters_1D( SBSGEM::GEMaxis_t axis, Double_t constraint
     bool higherpeakright=false,higherpeakleft=false;
     int peakright = -1, peakleft = -1;
 
-    while( striplist.find( striphi+1 ) != striplist.end() ){
+    while( hitindex[striphi+1] >= 0 ){
       striphi++;
 
       //Double_t ADCtest = fADCsums[hitindex[striphi]];
@@ -3678,7 +3877,7 @@ void SBSGEMModule::find_clusters_1D( SBSGEM::GEMaxis_t axis, Double_t constraint
       }
     }
 
-    while( striplist.find(striplo-1) != striplist.end() ){
+    while( hitindex[striplo-1] >= 0 ){
       striplo--;
       //Double_t ADCtest = fADCsums[hitindex[striplo]];
       Double_t ADCtest = ADC_strip[striplo];
@@ -3730,9 +3929,11 @@ void SBSGEMModule::find_clusters_1D( SBSGEM::GEMaxis_t axis, Double_t constraint
 
   //Erase "insignificant" peaks (those in contiguous grouping with higher peak with prominence below thresholds):
   for(int ipeak : peakstoerase){
-    localmaxima.erase( ipeak );
     islocalmax[ipeak] = false;
   }
+  localmaxima.erase( std::remove_if( localmaxima.begin(), localmaxima.end(),
+				     [islocalmax]( UShort_t strip ){ return !islocalmax[strip]; } ),
+		     localmaxima.end() );
   
 
   //cout << "After peak erasing, n local maxima = " << localmaxima.size() << endl;
@@ -3760,7 +3961,8 @@ void SBSGEMModule::find_clusters_1D( SBSGEM::GEMaxis_t axis, Double_t constraint
     //	   stripmax - striplo < maxsep ){
     while( found_neighbor_low ){
       
-      found_neighbor_low = striplist.find( striplo - 1 ) != striplist.end() && stripmax - striplo < maxsep;
+      found_neighbor_low = hitindex[striplo - 1] >= 0 && stripmax - striplo < maxsep;
+      if( !found_neighbor_low ) break;
 
       double Tdiff = fTmean[hitindex[striplo-1]] - fTmean[hitindex[stripmax]];
       
@@ -3801,7 +4003,8 @@ void SBSGEMModule::find_clusters_1D( SBSGEM::GEMaxis_t axis, Double_t constraint
     //	   stripmax - striplo < maxsep ){
     while( found_neighbor_high ){
       
-      found_neighbor_high = striplist.find( striphi + 1 ) != striplist.end() && striphi - stripmax < maxsep;
+      found_neighbor_high = hitindex[striphi + 1] >= 0 && striphi - stripmax < maxsep;
+      if( !found_neighbor_high ) break;
 
       double Tdiff = fTmean[hitindex[striphi+1]] - fTmean[hitindex[stripmax]];
 
@@ -3848,9 +4051,6 @@ void SBSGEMModule::find_clusters_1D( SBSGEM::GEMaxis_t axis, Double_t constraint
     double sumADCdeconv = 0.0;
     //double sumADCdeconv_combo = 0.0;
     
-    map<int,double> splitfraction;
-    vector<double> stripADCsum(nstrips);
-
     double maxpos = (stripmax + 0.5 - 0.5*Nstrips) * pitch + offset;
 
     //If peak position falls inside the "track search region" constraint, add a new cluster: 
@@ -3860,6 +4060,7 @@ void SBSGEMModule::find_clusters_1D( SBSGEM::GEMaxis_t axis, Double_t constraint
     
     //create a cluster, but don't add it to the 1D cluster array unless it passes the track search region constraint:
     sbsgemcluster_t clusttemp;
+    clusttemp.SetArena( &fClusterArena );
     clusttemp.nstrips = nstrips;
     clusttemp.istriplo = striplo;
     clusttemp.istriphi = striphi;
@@ -3885,38 +4086,34 @@ void SBSGEMModule::find_clusters_1D( SBSGEM::GEMaxis_t axis, Double_t constraint
       //calculate "split fraction" for each strip in the cluster:
       double sumweight = ADCmax/(1.0 + pow( (stripmax-istrip)*pitch/fSigma_hitshape, 2 ) );
       double maxweight = sumweight;
-      for( int jstrip=istrip-maxsep; jstrip<=istrip+maxsep; jstrip++ ){
-	if( localmaxima.find( jstrip ) != localmaxima.end() && jstrip != stripmax ){
+      for( int jstrip=std::max(istrip-int(maxsep),0); jstrip<=std::min(istrip+int(maxsep),int(Nstrips)-1); jstrip++ ){
+	if( islocalmax[jstrip] && jstrip != stripmax ){
 	  sumweight += ADC_strip[jstrip]/( 1.0 + pow( (jstrip-istrip)*pitch/fSigma_hitshape, 2 ) );
 	}
       }
    
-      splitfraction[istrip] = maxweight/sumweight;
+      double splitfraction = maxweight/sumweight;
 
       double hitpos = (istrip + 0.5 - 0.5*Nstrips) * pitch + offset; //local hit position along direction measured by these strips
-      double ADCstrip = ADC_strip[istrip] * splitfraction[istrip];
-      //double tstrip = fTmean[hitindex[istrip]];
-      double tstrip = Tmean_strip[istrip];
+      double ADCstrip = ADC_strip[istrip] * splitfraction;
+      double tstrip = fTmean[hitindex[istrip]];
 
-      //    double tstrip_deconv = fTmeanDeconv[hitindex[istrip]];
-      double tstrip_deconv = Tmean_strip_deconv[istrip];
-      double ADCstrip_deconv = fADCsumsDeconv[hitindex[istrip]]*splitfraction[istrip];
+      double tstrip_deconv = fTmeanDeconv[hitindex[istrip]];
+      double ADCstrip_deconv = fADCsumsDeconv[hitindex[istrip]]*splitfraction;
       
-      for( int isamp=0; isamp<fN_MPD_TIME_SAMP; isamp++ ){
-	clusttemp.ADCsamples[isamp] += fADCsamples[hitindex[istrip]][isamp]*splitfraction[istrip];
-	clusttemp.DeconvADCsamples[isamp] += fADCsamples_deconv[hitindex[istrip]][isamp]*splitfraction[istrip];
-      }
+      AddStripSamples( clusttemp.ADCsamples.data(), fADCsamples[hitindex[istrip]], splitfraction );
+      AddStripSamples( clusttemp.DeconvADCsamples.data(), fADCsamples_deconv[hitindex[istrip]], splitfraction );
       
       //clusttemp.stripADCsum.push_back( ADCstrip );
-      clusttemp.stripADCsum.push_back( fADCsums[hitindex[istrip]]*splitfraction[istrip] );
+      clusttemp.stripADCsum.push_back( fADCsums[hitindex[istrip]]*splitfraction );
       clusttemp.DeconvADCsum.push_back( ADCstrip_deconv );
       
       clusttemp.hitindex.push_back( hitindex[istrip] ); //do we use this anywhere? Yes, it is good to keep track of this if we want to access raw strip info later on 
 				       //sumADC += ADCstrip;
-      sumADC += fADCsums[hitindex[istrip]]*splitfraction[istrip];
+      sumADC += fADCsums[hitindex[istrip]]*splitfraction;
 				       
       sumADCdeconv += ADCstrip_deconv;
-      //sumADCdeconv_combo += fADCmaxDeconvCombo[hitindex[istrip]]*splitfraction[istrip];
+      //sumADCdeconv_combo += fADCmaxDeconvCombo[hitindex[istrip]]*splitfraction;
       
       if( std::abs( istrip - stripmax ) <= std::max(UShort_t(1),std::min(maxsepcoord,maxsep)) ){ 
 	sumx += hitpos * ADCstrip;
@@ -4058,11 +4255,11 @@ void SBSGEMModule::find_clusters_1D( SBSGEM::GEMaxis_t axis, Double_t constraint
   ////// Below is an exact copy of the parts above but clusters negative strips instead. This works by adding -1 factors
   ////// whenever we need the ADC value. Then at the end when saving the cluster information we flip the ADC back 
   ////// negative again. 
+  for( auto strip : localmaxima ) islocalmax[strip] = false;
   localmaxima.clear();
-  islocalmax.clear();
   
   //Do clustering again but for negative strips
-  for( std::set<UShort_t>::iterator i=striplist_neg.begin(); i != striplist_neg.end(); ++i ){
+  for( auto i=striplist_neg.begin(); i != striplist_neg.end(); ++i ){
     int strip = *i;
     //int hitidx = hitindex_neg[strip];
     islocalmax[strip] = false;
@@ -4072,10 +4269,10 @@ void SBSGEMModule::find_clusters_1D( SBSGEM::GEMaxis_t axis, Double_t constraint
     double sumright = 0.0;
     
     
-    if( striplist_neg.find( strip - 1 ) != striplist_neg.end() ){
+    if( hitindex_neg[strip-1] >= 0 ){
       sumleft = -1*fADCsums[hitindex_neg[strip-1]]; //if strip - 1 is found in strip list, hitindex_neg is guaranteed to have been initialized above
     }
-    if( striplist_neg.find( strip + 1 ) != striplist_neg.end() ){
+    if( hitindex_neg[strip+1] >= 0 ){
       sumright = -1*fADCsums[hitindex_neg[strip+1]];
     }
 
@@ -4087,7 +4284,7 @@ void SBSGEMModule::find_clusters_1D( SBSGEM::GEMaxis_t axis, Double_t constraint
 	sumstrip >= fThresholdStripSum &&
 	-1*fADCmax[hitindex_neg[strip]] >= fThresholdSample ){ //new local max:
       islocalmax[strip] = true;
-      localmaxima.insert( strip );      
+      localmaxima.push_back( strip );
     } 
   } // end loop over list of strips along this axis:
 
@@ -4097,7 +4294,7 @@ void SBSGEMModule::find_clusters_1D( SBSGEM::GEMaxis_t axis, Double_t constraint
 
   //now calculate "prominence" for all peaks and erase "insignificant" peaks:
 
-  for( std::set<UShort_t>::iterator i=localmaxima.begin(); i != localmaxima.end(); ++i ){
+  for( auto i=localmaxima.begin(); i != localmaxima.end(); ++i ){
     int stripmax = *i;
 
     //Added -1 factor
@@ -4110,7 +4307,7 @@ void SBSGEMModule::find_clusters_1D( SBSGEM::GEMaxis_t axis, Double_t constraint
     bool higherpeakright=false,higherpeakleft=false;
     int peakright = -1, peakleft = -1;
 
-    while( striplist_neg.find( striphi+1 ) != striplist_neg.end() ){
+    while( hitindex_neg[striphi+1] >= 0 ){
       striphi++;
 
       Double_t ADCtest = -1*fADCsums[hitindex_neg[striphi]]; //Added -1 factor
@@ -4125,7 +4322,7 @@ void SBSGEMModule::find_clusters_1D( SBSGEM::GEMaxis_t axis, Double_t constraint
       }
     }
 
-    while( striplist_neg.find(striplo-1) != striplist_neg.end() ){
+    while( hitindex_neg[striplo-1] >= 0 ){
       striplo--;
       Double_t ADCtest = -1*fADCsums[hitindex_neg[striplo]]; //Added -q factor
       if( ADCtest < ADCminleft && !higherpeakleft ){ //as long as we haven't yet found a higher peak to the left, this is the lowest point between the current maximum and the next higher peak to the left:
@@ -4165,9 +4362,11 @@ void SBSGEMModule::find_clusters_1D( SBSGEM::GEMaxis_t axis, Double_t constraint
 
   //Erase "insignificant" peaks (those in contiguous grouping with higher peak with prominence below thresholds):
   for(int ipeak : peakstoerase){
-    localmaxima.erase( ipeak );
     islocalmax[ipeak] = false;
   }
+  localmaxima.erase( std::remove_if( localmaxima.begin(), localmaxima.end(),
+				     [islocalmax]( UShort_t strip ){ return !islocalmax[strip]; } ),
+		     localmaxima.end() );
   
 
   //cout << "After peak erasing, n local maxima = " << localmaxima.size() << endl;
@@ -4191,7 +4390,7 @@ void SBSGEMModule::find_clusters_1D( SBSGEM::GEMaxis_t axis, Double_t constraint
     //	   stripmax - striplo < maxsep ){
     while( found_neighbor_low ){
       
-      found_neighbor_low = striplist_neg.find( striplo - 1 ) != striplist_neg.end() && stripmax - striplo < maxsep;
+      found_neighbor_low = hitindex_neg[striplo - 1] >= 0 && stripmax - striplo < maxsep;
 
       if( found_neighbor_low && fUseStripTimingCuts ){
 	//check time difference and correlation coefficient of the candidate strip
@@ -4217,7 +4416,7 @@ void SBSGEMModule::find_clusters_1D( SBSGEM::GEMaxis_t axis, Double_t constraint
     
     while( found_neighbor_high ){
       
-      found_neighbor_high = striplist_neg.find( striphi + 1 ) != striplist_neg.end() && striphi - stripmax < maxsep;
+      found_neighbor_high = hitindex_neg[striphi + 1] >= 0 && striphi - stripmax < maxsep;
 
       if( found_neighbor_high && fUseStripTimingCuts ){
 	//check time difference and correlation coefficient of the candidate strip
@@ -4239,9 +4438,6 @@ void SBSGEMModule::find_clusters_1D( SBSGEM::GEMaxis_t axis, Double_t constraint
     double sumx = 0.0, sumx2 = 0.0, sumADC = 0.0, sumt = 0.0, sumt2 = 0.0;
     double sumwx = 0.0;
 
-    map<int,double> splitfraction;
-    vector<double> stripADCsum(nstrips);
-
     double maxpos = (stripmax + 0.5 - 0.5*Nstrips) * pitch + offset;
 
     //If peak position falls inside the "track search region" constraint, add a new cluster: 
@@ -4249,6 +4445,7 @@ void SBSGEMModule::find_clusters_1D( SBSGEM::GEMaxis_t axis, Double_t constraint
       
       //create a cluster, but don't add it to the 1D cluster array unless it passes the track search region constraint:
       sbsgemcluster_t clusttemp;
+      clusttemp.SetArena( &fClusterArena );
       clusttemp.nstrips = nstrips;
       clusttemp.istriplo = striplo;
       clusttemp.istriphi = striphi;
@@ -4269,22 +4466,20 @@ void SBSGEMModule::find_clusters_1D( SBSGEM::GEMaxis_t axis, Double_t constraint
 	double sumweight = ADCmax/(1.0 + pow( (stripmax-istrip)*pitch/fSigma_hitshape, 2 ) );
 	double maxweight = sumweight;
 	
-	for( int jstrip=istrip-maxsep; jstrip<=istrip+maxsep; jstrip++ ){
-	  if( localmaxima.find( jstrip ) != localmaxima.end() && jstrip != stripmax ){
+	for( int jstrip=std::max(istrip-int(maxsep),0); jstrip<=std::min(istrip+int(maxsep),int(Nstrips)-1); jstrip++ ){
+	  if( islocalmax[jstrip] && jstrip != stripmax ){
 	    sumweight += -1*fADCsums[hitindex_neg[jstrip]]/( 1.0 + pow( (jstrip-istrip)*pitch/fSigma_hitshape, 2 ) ); //Added -1 factor
 	  }
 	}
    
-	splitfraction[istrip] = maxweight/sumweight;
+	double splitfraction = maxweight/sumweight;
 	
 	double hitpos = (istrip + 0.5 - 0.5*Nstrips) * pitch + offset; //local hit position along direction measured by these strips
-	double ADCstrip = fADCsums[hitindex_neg[istrip]] * splitfraction[istrip];
+	double ADCstrip = fADCsums[hitindex_neg[istrip]] * splitfraction;
 	double tstrip = fTmean[hitindex_neg[istrip]];
 	
-	for( int isamp=0; isamp<fN_MPD_TIME_SAMP; isamp++ ){
-	  //Do not add -1 factor. We are now saving the negative cluster information
-	  clusttemp.ADCsamples[isamp] += fADCsamples[hitindex_neg[istrip]][isamp]*splitfraction[istrip]; 
-	}
+	//Do not add -1 factor. We are now saving the negative cluster information
+	AddStripSamples( clusttemp.ADCsamples.data(), fADCsamples[hitindex_neg[istrip]], splitfraction );
 
 	clusttemp.stripADCsum.push_back( ADCstrip );
 
@@ -4349,6 +4544,11 @@ void SBSGEMModule::find_clusters_1D( SBSGEM::GEMaxis_t axis, Double_t constraint
   } //end loop on local maxima
   
   clusters.resize(nclust); //just to make sure no pathological behavior later on
+
+  //Reset the strip-indexed work arrays for the next call (only the entries of the fired strips were touched):
+  for( auto strip : localmaxima ) islocalmax[strip] = false;
+  for( auto strip : striplist ) hitindex[strip] = -1;
+  for( auto strip : striplist_neg ) hitindex_neg[strip] = -1;
  
   fClustering1DIsDone = true;
 }
@@ -4371,9 +4571,6 @@ void SBSGEMModule::fill_2D_hit_arrays(){
   //   std::cout << "Warning in SBSGEMModule::fill_2D_hit_arrays(): 
   // }
 
-  TString appname = (static_cast<THaDetector *>(GetParent()) )->GetApparatus()->GetName();
-  TString detname = GetParent()->GetName();
-  
   // std::cout << "SBSGEMModule::fill_2D_hit_arrays(), module \"" << appname << "." << detname << "." << GetName() << "\", (nclustu,nclustv)=(" << fNclustU << ", " << fNclustV
   // 	    << ")" << std::endl;
   
@@ -4394,11 +4591,107 @@ void SBSGEMModule::fill_2D_hit_arrays(){
   //been called, if that is NOT the case, then this routine will just do nothing:
   bool maxhits_exceeded = false;
 
+  //Pairing windows: when filter_2Dhits applies a "hard" cut on the U/V time difference and/or ADC asymmetry, a candidate
+  //outside the cut window is always rejected, so we don't need to build it at all. The V clusters are sorted by time
+  //(or by ADC sum if only the asymmetry cut is hard) and each U cluster only visits the V clusters inside its window.
+  //The asymmetry cut can only be used this way if no "soft" time difference or correlation coefficient cut is applied,
+  //since candidates failing the asymmetry cut still count as "good" hits in those earlier filtering steps.
+  //The surviving candidates are processed in the original order, so that the accepted hit list doesn't change:
+  Int_t filterflag = fFiltering_flag2D + 1;
+  bool hard_dt = fFiltering_flag2D >= 0 && TESTBIT(filterflag,4);
+  bool soft_dt = fFiltering_flag2D >= 0 && TESTBIT(filterflag,1) && !hard_dt;
+  bool soft_ccor = fFiltering_flag2D >= 0 && TESTBIT(filterflag,0) && !TESTBIT(filterflag,3);
+  bool hard_asym = fFiltering_flag2D >= 0 && TESTBIT(filterflag,5) && !soft_dt && !soft_ccor;
+
+  //Same cut values and variables as in filter_2Dhits:
+  double tcut_pair = fTimeCutUVdiff;
+  double toffset_pair = fHitTimeMean[0]-fHitTimeMean[1];
+  if( fClusteringFlag == 1 ){
+    tcut_pair = fTimeCutUVdiffDeconv;
+    toffset_pair = fHitTimeMeanDeconv[0]-fHitTimeMeanDeconv[1];
+  } else if( fUseStripTimingCuts == 2 ){
+    tcut_pair = fTimeCutUVdiffFit;
+    toffset_pair = fHitTimeMeanFit[0]-fHitTimeMeanFit[1];
+  }
+  double asymcut_pair = fADCasymCut;
+  
+  enum { kPairAll, kPairByTime, kPairByADC } pairmode = kPairAll;
+  if( hard_dt ) {
+    pairmode = kPairByTime;
+  } else if( hard_asym && asymcut_pair < 1.0 ){
+    pairmode = kPairByADC;
+  }
+
+  fPairKeyV.resize( fNclustV );
+  fPairOrderV.clear();
+  for( UInt_t iv=0; iv<fNclustV; iv++ ){
+    if( !fVclusters[iv].keep || fVclusters[iv].ontrack ) continue;
+
+    double key = 0.0;
+    if( pairmode == kPairByTime ){
+      key = GetClusterPairTime( fVclusters[iv] );
+      if( std::isnan(key) ) continue; //always fails the time difference cut
+    } else if( pairmode == kPairByADC ){
+      key = GetClusterPairADC( fVclusters[iv] );
+      if( std::isnan(key) ) continue; //always fails the asymmetry cut
+      if( key <= 0.0 ) pairmode = kPairAll; //the window below assumes positive ADC sums
+    }
+    fPairKeyV[iv] = key;
+    fPairOrderV.push_back( iv );
+  }
+  
+  if( pairmode != kPairAll ){
+    std::sort( fPairOrderV.begin(), fPairOrderV.end(), [this]( UInt_t a, UInt_t b ){ return fPairKeyV[a] < fPairKeyV[b]; } );
+  }
+  
   //std::cout << "Starting 2D hit finding..." << std::endl;
   for( UInt_t iu=0; iu<fNclustU; iu++ ){
-    for( UInt_t iv=0; iv<fNclustV; iv++ ){
-      //Check that this is a "good" cluster and that it was not already used in track formation:
-      if( fUclusters[iu].keep && fVclusters[iv].keep && !fUclusters[iu].ontrack && !fVclusters[iv].ontrack ){ 
+    //Check that this is a "good" cluster and that it was not already used in track formation:
+    if( !fUclusters[iu].keep || fUclusters[iu].ontrack ) continue;
+
+    const std::vector<UInt_t> *vcands = &fPairOrderV;
+    if( pairmode != kPairAll ){
+      //Window of sort key values that can pass the cut(s), slightly widened for rounding. The exact cuts are applied below:
+      double keylo, keyhi;
+      if( pairmode == kPairByTime ){
+	double tu = GetClusterPairTime( fUclusters[iu] );
+	keylo = tu - toffset_pair - tcut_pair;
+	keyhi = tu - toffset_pair + tcut_pair;
+      } else {
+	double adcu = GetClusterPairADC( fUclusters[iu] );
+	keylo = adcu*(1.0-asymcut_pair)/(1.0+asymcut_pair);
+	keyhi = adcu*(1.0+asymcut_pair)/(1.0-asymcut_pair);
+      }
+      double slack = 1.e-9*( 1.0 + std::max( fabs(keylo), fabs(keyhi) ) );
+      keylo -= slack;
+      keyhi += slack;
+
+      auto first = std::lower_bound( fPairOrderV.begin(), fPairOrderV.end(), keylo,
+				     [this]( UInt_t iv, double key ){ return fPairKeyV[iv] < key; } );
+      auto last = std::upper_bound( first, fPairOrderV.end(), keyhi,
+				    [this]( double key, UInt_t iv ){ return key < fPairKeyV[iv]; } );
+      fPairCandV.assign( first, last );
+      std::sort( fPairCandV.begin(), fPairCandV.end() );
+      vcands = &fPairCandV;
+    }
+    
+    for( UInt_t iv : *vcands ){
+      //Exact hard cuts, computed the same way as the corresponding hit quantities below:
+      if( hard_dt ){
+	double dt = GetClusterPairTime( fUclusters[iu] ) - GetClusterPairTime( fVclusters[iv] ) - toffset_pair;
+	if( !(fabs(dt) <= tcut_pair) ) continue;
+      }
+      if( hard_asym ){
+	double asym;
+	if( fClusteringFlag == 1 ){
+	  asym = (fUclusters[iu].clusterADCsumDeconvMaxCombo-fVclusters[iv].clusterADCsumDeconvMaxCombo)/(fUclusters[iu].clusterADCsumDeconvMaxCombo+fVclusters[iv].clusterADCsumDeconvMaxCombo);
+	} else {
+	  asym = ( fUclusters[iu].clusterADCsum - fVclusters[iv].clusterADCsum )/( fUclusters[iu].clusterADCsum + fVclusters[iv].clusterADCsum );
+	}
+	if( !(fabs(asym) <= asymcut_pair) ) continue;
+      }
+      
+      { //build the 2D hit candidate:
 	//Initialize sums for computing cluster and strip correlation coefficients:
 	sbsgemhit_t hittemp; // declare a temporary "hit" object:
 
@@ -4470,7 +4763,7 @@ void SBSGEMModule::fill_2D_hit_arrays(){
 	    hittemp.thitDeconv = 0.5*(fUclusters[iu].t_mean_deconv + fVclusters[iv].t_mean_deconv);
 	  
 	    //Calculate correlation coefficients:
-	    hittemp.corrcoeff_clust = CorrCoeff( nsamp_corr, fUclusters[iu].ADCsamples, fVclusters[iv].ADCsamples, firstsamp_corr );
+	    hittemp.corrcoeff_clust = CorrCoeff( nsamp_corr, fUclusters[iu].ADCsamples.data(), fVclusters[iv].ADCsamples.data(), firstsamp_corr );
 	
 	    //compute index of strip with max ADC sum within cluster strip array:
 	    UInt_t ustripidx = fUclusters[iu].istripmax-fUclusters[iu].istriplo; //
@@ -4482,7 +4775,7 @@ void SBSGEMModule::fill_2D_hit_arrays(){
 	
 	    hittemp.corrcoeff_strip = CorrCoeff( nsamp_corr, fADCsamples[uhitidx], fADCsamples[vhitidx], firstsamp_corr );
 
-	    hittemp.corrcoeff_clust_deconv = CorrCoeff( fN_MPD_TIME_SAMP, fUclusters[iu].DeconvADCsamples, fVclusters[iv].DeconvADCsamples );
+	    hittemp.corrcoeff_clust_deconv = CorrCoeff( fN_MPD_TIME_SAMP, fUclusters[iu].DeconvADCsamples.data(), fVclusters[iv].DeconvADCsamples.data() );
 	    hittemp.corrcoeff_strip_deconv = CorrCoeff( fN_MPD_TIME_SAMP, fADCsamples_deconv[uhitidx], fADCsamples_deconv[vhitidx] );
 	    //these lines redundant with the lines above (3860-3862):
 	    // hittemp.ADCasymDeconv = (fUclusters[iu].clusterADCsumDeconvMaxCombo - fVclusters[iv].clusterADCsumDeconvMaxCombo)/
@@ -4583,7 +4876,7 @@ void SBSGEMModule::fill_2D_hit_arrays(){
 	    }
 	  } //end check that hit passes any constraint (or that constraint application is not applicable)
 	} //end check that 2D point is inside active area
-      } //end check that both U and V clusters passed filtering criteria:
+      }
     } //end loop over "V" clusters
   } //end loop over "U" clusters
 
@@ -4603,6 +4896,18 @@ void SBSGEMModule::fill_2D_hit_arrays(){
   
 }
 
+Double_t SBSGEMModule::GetClusterPairTime( const sbsgemcluster_t &clust ) const {
+  //Cluster time used for the U/V time difference cut in filter_2Dhits:
+  if( fClusteringFlag == 1 ) return clust.t_mean_deconv;
+  if( fUseStripTimingCuts == 2 ) return clust.t_mean_fit;
+  return clust.t_mean;
+}
+
+Double_t SBSGEMModule::GetClusterPairADC( const sbsgemcluster_t &clust ) const {
+  //Cluster ADC sum used for the U/V ADC asymmetry cut in filter_2Dhits:
+  return fClusteringFlag == 1 ? clust.clusterADCsumDeconvMaxCombo : clust.clusterADCsum;
+}
+
 void    SBSGEMModule::Print( Option_t* opt) const{
   return;
 }
@@ -5368,30 +5673,25 @@ Int_t   SBSGEMModule::End( THaRunBase* r){ //Calculates efficiencies and writes
 
 //utility method to calculate correlation coefficient of U and V samples: 
 Double_t SBSGEMModule::CorrCoeff( int nsamples, const std::vector<double> &Usamples, const std::vector<double> &Vsamples, int firstsample ){
-  Double_t sumu=0.0, sumv=0.0, sumu2=0.0, sumv2=0.0, sumuv=0.0;
-
   if ( (int)Usamples.size() < firstsample+nsamples || (int)Vsamples.size() < firstsample+nsamples ){
     return -10.0; //nonsense value, correlation coefficient by definition is -1 < c < 1
   }
-  
-  for( int isamp=firstsample; isamp<firstsample+nsamples; isamp++ ){
-    sumu += Usamples[isamp];
-    sumv += Vsamples[isamp];
-    sumu2 += pow(Usamples[isamp],2);
-    sumv2 += pow(Vsamples[isamp],2);
-    sumuv += Usamples[isamp]*Vsamples[isamp];
-  }
 
-  double nSAMP = double(nsamples);
-  double mu = sumu/nSAMP;
-  double mv = sumv/nSAMP;
-  double varu = sumu2/nSAMP - pow(mu,2);
-  double varv = sumv2/nSAMP - pow(mv,2);
-  double sigu = sqrt(varu);
-  double sigv = sqrt(varv);
+  return CorrCoeff( nsamples, Usamples.data(), Vsamples.data(), firstsample );
+}
 
-  return (sumuv - nSAMP*mu*mv)/(nSAMP*sigu*sigv);
-  
+Double_t SBSGEMModule::CorrCoeff( int nsamples, const Double_t *Usamples, const Double_t *Vsamples, int firstsample ){
+  //nsamples is not always the full number of time samples (see NsampCorrCoeff), so dispatch on the argument:
+  if( fForceGenericKernels ) return CorrCoeffKernel<0>( nsamples, Usamples+firstsample, Vsamples+firstsample );
+  
+  switch( nsamples ){
+  case 6:
+    return CorrCoeffKernel<6>( nsamples, Usamples+firstsample, Vsamples+firstsample );
+  case 3:
+    return CorrCoeffKernel<3>( nsamples, Usamples+firstsample, Vsamples+firstsample );
+  default:
+    return CorrCoeffKernel<0>( nsamples, Usamples+firstsample, Vsamples+firstsample );
+  }
 }
 
 TVector2 SBSGEMModule::UVtoXY( TVector2 UV ){
@@ -5416,6 +5716,32 @@ TVector2 SBSGEMModule::XYtoUV( TVector2 XY ){
   return TVector2(Utemp,Vtemp);
 }
 
+void SBSGEMModule::FillChannelLUT( std::vector<sbsgemchanlut_t> &lut, Int_t imodule ){
+  for( auto &apv : fMPDmap ){
+    apv.lut_offset = lut.size();
+
+    bool isU = apv.axis == SBSGEM::kUaxis;
+    UInt_t iAPV = apv.pos;
+    
+    double cm_mean = isU ? fCommonModeMeanU[iAPV] : fCommonModeMeanV[iAPV];
+    double cm_rms = isU ? fCommonModeRMSU[iAPV] : fCommonModeRMSV[iAPV];
+    
+    for( int ich=0; ich<fN_APV25_CHAN; ich++ ){
+      sbsgemchanlut_t chan;
+      chan.strip = GetStripNumber( ich, apv.pos, apv.invert );
+      chan.module = imodule;
+      chan.pos = apv.pos;
+      chan.axis = apv.axis;
+      chan.pedmean = isU ? fPedestalU[chan.strip] : fPedestalV[chan.strip];
+      chan.pedrms = isU ? fPedRMSU[chan.strip] : fPedRMSV[chan.strip];
+      chan.gain = isU ? fUgain[chan.strip/fN_APV25_CHAN] : fVgain[chan.strip/fN_APV25_CHAN];
+      chan.cmmin = cm_mean - fCommonModeRange_nsigma * cm_rms;
+      chan.cmmax = cm_mean + fCommonModeRange_nsigma * cm_rms;
+      lut.push_back( chan );
+    }
+  }
+}
+
 Int_t SBSGEMModule::GetStripNumber( UInt_t rawstrip, UInt_t pos, UInt_t invert ){
   Int_t RstripNb = APVMAP[fAPVmapping][rawstrip];
   RstripNb = RstripNb + (127-2*RstripNb)*invert;
@@ -5613,25 +5939,20 @@ double SBSGEMModule::GetCommonMode( UInt_t isamp, Int_t flag, const mpdmap_t &ap
   double rawADCmax = ( apvinfo.axis == SBSGEM::kUaxis ) ? fRawADCmaxU[apvinfo.pos] : fRawADCmaxV[apvinfo.pos];
   
   if( flag == 0 ){ //"enhanced" sorting method (experimental):
-    vector<double> goodADCs(nhits);
-    vector<double> allADCs(nhits);
-    
-    int ngood = 0;
+    LoadCommonModeBlock( isamp, apvinfo, nhits );
+
+    //Sort the strips above the negative saturation threshold if there are enough of them, otherwise sort all strips.
+    //The sort buffer is preallocated, so this does no allocation:
+    std::vector<double> &sortedADCs = fCMsortBuffer;
+    sortedADCs.clear();
     
     for( int ihit=0; ihit<nhits; ihit++ ){
-      int iraw = isamp + fN_MPD_TIME_SAMP * ihit;
-
-      allADCs[ihit] = fPedSubADC_APV[ iraw ];
-      
-      if( fRawADC_nopedsub_APV[ iraw ] > rawADCmin ){    
-	goodADCs[ngood] = fPedSubADC_APV[ iraw ];
-	ngood++;
-      }
+      if( fCMblockRawADC[ihit] > rawADCmin ) sortedADCs.push_back( fCMblockADC[ihit] );
     }
 
-    goodADCs.resize( ngood );
-
-    std::vector<double> &sortedADCs = (ngood >= fCommonModeMinStripsInRange) ? goodADCs : allADCs;
+    if( sortedADCs.size() < fCommonModeMinStripsInRange ){
+      sortedADCs.assign( fCMblockADC.begin(), fCMblockADC.begin() + nhits );
+    }
 
     //if( nhits < fCommonModeNstripRejectLow + fCommonModeNstripRejectHigh + fCommonModeMinStripsInRange ){
     if( sortedADCs.size() < fCommonModeMinStripsInRange ){
@@ -5642,15 +5963,13 @@ double SBSGEMModule::GetCommonMode( UInt_t isamp, Int_t flag, const mpdmap_t &ap
     
     std::sort( sortedADCs.begin(), sortedADCs.end() );
 
-    int nstrip = sortedADCs.size();
-    
     //   commonMode[isamp] = 0.0;
     double cm_temp = 0.0;
-    //   int stripcount=0;
-
-    //    for( int k=fCommonModeNstripRejectLow; k<nhits-fCommonModeNstripRejectHigh; k++ ){
 
-    int firststrip = 0;
+    //Find the narrowest window of fCommonModeMinStripsInRange consecutive sorted values. Only the window
+    //boundaries are needed for the scan; the average is calculated once for the winning window, summing
+    //in the same order as before, so that the result doesn't change:
+    int firststrip = -1;
     double mindiff = sortedADCs.back() - sortedADCs.front(); 
     
     for( int j=0; j<=sortedADCs.size()-fCommonModeMinStripsInRange; j++ ){
@@ -5659,30 +5978,24 @@ double SBSGEMModule::GetCommonMode( UInt_t isamp, Int_t flag, const mpdmap_t &ap
       if( diff < mindiff ){
 	firststrip = j;
 	mindiff = diff;
+      }
+    }
 
-	//Calculate sum:
-	double sum = 0.0;
-	for( int k=j; k<j+fCommonModeMinStripsInRange; k++ ){
-	  sum += sortedADCs[k];
-	}
-
-	cm_temp = sum/double(fCommonModeMinStripsInRange);
+    if( firststrip >= 0 ){
+      double sum = 0.0;
+      for( int k=firststrip; k<firststrip+fCommonModeMinStripsInRange; k++ ){
+	sum += sortedADCs[k];
       }
+      cm_temp = sum/double(fCommonModeMinStripsInRange);
     }
 
-    ngood = 0;
+    int ngood = 0;
     double sumADC = 0.0;
     //Let's see if we can improve things by averaging all strips within +/-3*sigma_ped of cm_temp
     for( int j=0; j<nhits; j++ ){
-      int iraw = isamp + fN_MPD_TIME_SAMP * j;
+      double ADC = fCMblockADC[j];
 
-      int strip = fStripAPV[iraw];
-
-      double pedRMS = ( apvinfo.axis == SBSGEM::kUaxis ) ? fPedRMSU[strip] : fPedRMSV[strip];
-
-      double ADC = fPedSubADC_APV[ iraw ];
-
-      if( fabs( ADC - cm_temp ) <= 3.0*pedRMS*fRMS_ConversionFactor ){
+      if( fabs( ADC - cm_temp ) <= 3.0*fCMblockPedRMS[j]*fRMS_ConversionFactor ){
 	sumADC += ADC;
 	ngood++;
       }
@@ -5770,8 +6083,13 @@ double SBSGEMModule::GetCommonMode( UInt_t isamp, Int_t flag, const mpdmap_t &ap
     //    bool anygoodbin = false;
     //while ( !anygoodbin ){
     
-    std::vector<int> bincounts(nbins,0);
-    std::vector<double> binADCsum(nbins,0.0);
+    //bin contents are kept in preallocated work arrays (assign only reallocates if nbins exceeds the capacity):
+    LoadCommonModeBlock( isamp, apvinfo, nhits );
+    
+    std::vector<int> &bincounts = fCMbinCounts;
+    std::vector<double> &binADCsum = fCMbinADCsum;
+    bincounts.assign( nbins, 0 );
+    binADCsum.assign( nbins, 0.0 );
     //The sums of squares aren't actually used for the time being:
     //std::vector<double> binADCsum2(nbins+1,0.0);
     
@@ -5780,11 +6098,11 @@ double SBSGEMModule::GetCommonMode( UInt_t isamp, Int_t flag, const mpdmap_t &ap
     //Now loop on all the strips and fill the histogram: 
     //for( int ihit=0; ihit<fN_APV25_CHAN; ihit++ ){
     for( int ihit=0; ihit<nhits; ihit++ ){
-      double ADC = fPedSubADC_APV[ isamp + fN_MPD_TIME_SAMP * ihit ];
+      double ADC = fCMblockADC[ihit];
 
       //compare raw ADC without pedestal subtraction to rawADCmin to
       // avoid negative saturation:
-      double rawADCnopedsub = fRawADC_nopedsub_APV[ isamp + fN_MPD_TIME_SAMP * ihit ];
+      double rawADCnopedsub = fCMblockRawADC[ihit];
 
       int nearestbin = std::max(0,std::min(nbins-1,int(round( (ADC - scan_min - 0.5*binwidth)/stepsize))));
 
@@ -5870,10 +6188,9 @@ double SBSGEMModule::GetCommonMode( UInt_t isamp, Int_t flag, const mpdmap_t &ap
       int ngood = 0;
       double sum = 0.0;
       for( int ihit=0; ihit<nhits; ihit++ ){
-	int iraw = isamp + fN_MPD_TIME_SAMP * ihit;
-	double ADC = fPedSubADC_APV[ isamp + fN_MPD_TIME_SAMP * ihit ];
-	double pedrmstemp = ( apvinfo.axis == SBSGEM::kUaxis ) ? fPedRMSU[fStripAPV[iraw]] : fPedRMSV[fStripAPV[iraw]];
-	double rawADCnopedsub = fRawADC_nopedsub_APV[iraw];
+	double ADC = fCMblockADC[ihit];
+	double pedrmstemp = fCMblockPedRMS[ihit];
+	double rawADCnopedsub = fCMblockRawADC[ihit];
 	// now loop on all the hits again and calculate the average of all ADCs falling within
 	// +/- nsigma * individual sample noise width of binavg:
 	if( fabs( ADC - binavg ) <= 3.0*pedrmstemp*fRMS_ConversionFactor && rawADCnopedsub > rawADCmin ){
@@ -6011,8 +6328,10 @@ double SBSGEMModule::GetCommonMode( UInt_t isamp, Int_t flag, const mpdmap_t &ap
 
     //We want the upper edge of the last bin to be at scan_max.
     //So the LOWER edge of the last bin is at scan_max - binwidth;
-    std::vector<int> bincounts(nbins,0);
-    std::vector<double> binADCsum(nbins,0.0);
+    std::vector<int> &bincounts = fCMbinCounts;
+    std::vector<double> &binADCsum = fCMbinADCsum;
+    bincounts.assign( nbins, 0 );
+    binADCsum.assign( nbins, 0.0 );
 
     double scan_min = scan_max - binwidth - (nbins-1)*stepsize;
 
@@ -6024,7 +6343,19 @@ double SBSGEMModule::GetCommonMode( UInt_t isamp, Int_t flag, const mpdmap_t &ap
    
     for( int ihit=0; ihit<nhits; ihit++ ){
       double ADC = fPedSubADC_APV[ isamp + fN_MPD_TIME_SAMP * ihit ];
-      for( int bin=0; bin<nbins; bin++ ){
+
+      //Only the bins within +/- binwidth/2 of the ADC value can contain it; visit those (plus one bin of margin on
+      // each side to be safe against rounding) in increasing order, exactly as the full scan would:
+      int binlo = 0, binhi = nbins-1;
+      if( stepsize > 0. ){
+	double binpos = (ADC - scan_min - 0.5*binwidth)/stepsize;
+	double halfrange = 0.5*binwidth/stepsize;
+	if( binpos + halfrange < -1.0 || binpos - halfrange > double(nbins) ) continue; //outside the scan range
+	binlo = std::max( 0, int( floor( binpos - halfrange ) ) - 1 );
+	binhi = std::min( nbins-1, int( ceil( binpos + halfrange ) ) + 1 );
+      }
+      
+      for( int bin=binlo; bin<=binhi; bin++ ){
 	double bincenter = scan_min + bin*stepsize + 0.5*binwidth;
 
 	//bin 0 center = (max - binwidth - 63*stepsize) + 0.5;
@@ -6071,6 +6402,8 @@ double SBSGEMModule::GetCommonMode( UInt_t isamp, Int_t flag, const mpdmap_t &ap
     double cm_max = cm_mean + fCommonModeDanningMethod_NsigmaCut*DBrms;
 
     double cm_temp = 0.0;
+
+    LoadCommonModeBlock( isamp, apvinfo, nhits );
     
     for( int iter=0; iter<fCommonModeNumIterations; iter++ ){
       int nstripsinrange=0;
@@ -6078,15 +6411,13 @@ double SBSGEMModule::GetCommonMode( UInt_t isamp, Int_t flag, const mpdmap_t &ap
       //double sum2ADCinrange=0.0;
       //for( int ihit=0; ihit<fN_APV25_CHAN; ihit++ ){
       for( int ihit=0; ihit<nhits; ihit++ ){
-	int iraw=isamp + fN_MPD_TIME_SAMP * ihit;
-	
-	double ADCtemp = fPedSubADC_APV[iraw];
+	double ADCtemp = fCMblockADC[ihit];
 
-	double rawADCnopedsub = fRawADC_nopedsub_APV[iraw];
+	double rawADCnopedsub = fCMblockRawADC[ihit];
 	//	double rawADCmin = ( apvinfo.axis == SBSGEM::kUaxis ) ? fRawADCminU[iraw] : fRawADCminV[iraw];
 	
 	//on iterations after the first iteration, reject strips with signals above nsigma * pedrms:
-	double rmstemp = ( apvinfo.axis == SBSGEM::kUaxis ) ? fPedRMSU[fStripAPV[iraw]] : fPedRMSV[fStripAPV[iraw]];
+	double rmstemp = fCMblockPedRMS[ihit];
 
 	// if(flag == 4){  //This is used for diagnostic plots where we "pretend" the data is zero suppressed //moving this to another method
 	//   double strip_sum = 0;
@@ -6140,6 +6471,25 @@ double SBSGEMModule::GetCommonMode( UInt_t isamp, Int_t flag, const mpdmap_t &ap
   }
 }
 
+//Gather one time sample of the current APV card from the (strip-major) APV arrays into the contiguous
+//common-mode work arrays, together with the pedestal RMS of each strip:
+void SBSGEMModule::LoadCommonModeBlock( UInt_t isamp, const mpdmap_t &apvinfo, UInt_t nhits ){
+  if( fCMblockADC.size() < nhits ){ //should never happen since nhits <= fN_APV25_CHAN
+    fCMblockADC.resize( nhits );
+    fCMblockRawADC.resize( nhits );
+    fCMblockPedRMS.resize( nhits );
+  }
+
+  const std::vector<Double_t> &pedRMS = ( apvinfo.axis == SBSGEM::kUaxis ) ? fPedRMSU : fPedRMSV;
+  
+  for( UInt_t ihit=0; ihit<nhits; ihit++ ){
+    UInt_t iraw = isamp + fN_MPD_TIME_SAMP * ihit;
+    fCMblockADC[ihit] = fPedSubADC_APV[iraw];
+    fCMblockRawADC[ihit] = fRawADC_nopedsub_APV[iraw];
+    fCMblockPedRMS[ihit] = pedRMS[fStripAPV[iraw]];
+  }
+}
+
 void SBSGEMModule::fill_ADCfrac_vs_time_sample_goodstrip( Int_t hitindex, bool ismax ){
   if( hitindex < 0 || hitindex >= fNstrips_hit ) return;
   if( hADCfrac_vs_timesample_goodstrips == NULL ) return;
@@ -6157,7 +6507,8 @@ void SBSGEMModule::fill_ADCfrac_vs_time_sample_goodstrip( Int_t hitindex, bool i
 double SBSGEMModule::StripTSchi2( int hitindex ){
   if( hitindex < 0 || hitindex > fNstrips_hit ) return -1.;
   double chi2 = 0.0;
-  double t0 = fStripMaxTcut_central[fAxis[hitindex]] - fStripTau;
+  //reference pulse shape with its peak at fStripMaxTcut_central, precomputed in ReadDatabase:
+  const Double_t *shape = fStripTSshape[fAxis[hitindex]].data();
 
   double sigma = (fAxis[hitindex] == SBSGEM::kUaxis) ? fPedRMSU[fStrip[hitindex]] : fPedRMSV[fStrip[hitindex]] * fRMS_ConversionFactor; 
 
@@ -6165,9 +6516,9 @@ double SBSGEMModule::StripTSchi2( int hitindex ){
   // for individual ADC samples
   
   for( int isamp=0; isamp<fN_MPD_TIME_SAMP; isamp++ ){
-    double tsamp = (isamp + 0.5)*fSamplePeriod;
     //chi2 += pow( (fADCsamples[hitindex][isamp] / fADCsums[hitindex] - fGoodStrip_TSfrac_mean[isamp])/fGoodStrip_TSfrac_sigma[isamp], 2 );
-    chi2 += pow( (fADCsamples[hitindex][isamp] - fADCmax[hitindex] * std::max(0.0, (tsamp-t0)/fStripTau * exp( 1.0 - (tsamp-t0)/fStripTau) ) )/sigma, 2 ); 
+    double diff = (fADCsamples[hitindex][isamp] - fADCmax[hitindex] * shape[isamp])/sigma;
+    chi2 += diff*diff;
   }
   return chi2;
 }
@@ -6176,64 +6527,49 @@ double SBSGEMModule::StripTSchi2( int hitindex ){
 double SBSGEMModule::FitStripTime( int striphitindex, double RMS ){
   if( striphitindex < 0 || striphitindex > fNstrips_hit ) return -1000.0;
 
-  std::vector<Double_t> &ADC = fADCsamples[striphitindex];
+  const Double_t *ADC = fADCsamples[striphitindex];
 
   return CalcFitTime( ADC, RMS );
   
 }
 
 //common code for calculating strip and cluster fit times:
-double SBSGEMModule::CalcFitTime( const std::vector<Double_t> &ADC, double RMS ){
+double SBSGEMModule::CalcFitTime( const Double_t *ADC, double RMS ){
 
-  double ndeconv[fN_MPD_TIME_SAMP-1];
-  double dndeconv[fN_MPD_TIME_SAMP-1];
-  double weight[fN_MPD_TIME_SAMP-1];
-  double Tdeconv[fN_MPD_TIME_SAMP-1]; //estimate of signal start time based on ndeconv.
-  double dTdeconv[fN_MPD_TIME_SAMP-1];
-  
-  //Grab pedestal RMS to estimate weights in strip mean time calculation:
+  //For each pair of consecutive samples, the ratio gives an estimate of the signal start time, which is
+  //combined with the others weighted by its uncertainty. Same calculation as the batched version in CalcStripFeatures.
+  //exp(fSamplePeriod/fStripTau) is precomputed in ReadDatabase.
   
-  //Double_t pedrms = ( fAxis[striphitindex] == SBSGEM::kUaxis ) ? fPedRMSU[fStrip[striphitindex]] : fPedRMSV[fStrip[striphitindex]];
-
-  Double_t xdeconv = fSamplePeriod/fStripTau;
-  Double_t exdeconv = exp(xdeconv);
+  Double_t exdeconv = fDeconvExpX;
 
   // n = 1.0/(r * exdeconv - 1.0);
   // dn = -1.0 / (r * exdeconv - 1)^2 * exdeconv * dr = -exdeconv * n^2 * dr
   // dr = r * sqrt( (dADCi/ADCi,2) + pow(dADC_{i+1}/ADC_{i+1},2))
 
   //dADC = sigma 
-  double sigma = RMS;
+  double sigma2 = RMS*RMS;
 
-  double Tsum = 0.0, Tsum2=0.0;
+  double Tsum = 0.0;
   double sumw2 = 0.0;
   
   for( int isamp=0; isamp<fN_MPD_TIME_SAMP-1; isamp++ ){
-    ndeconv[isamp] = ADC[isamp]/(ADC[isamp+1]*exdeconv - ADC[isamp]); //estimated number of samples before current sample that the signal started
+    double A0 = ADC[isamp], A1 = ADC[isamp+1];
+    double ndeconv = A0/(A1*exdeconv - A0); //estimated number of samples before current sample that the signal started
 
-    double r = ADC[isamp+1]/ADC[isamp];
-    double dr2 = r*r * sigma * sigma * ( pow( ADC[isamp], -2 ) + pow( ADC[isamp+1], -2 ) );
-    dndeconv[isamp] = exdeconv * pow(ndeconv[isamp],2) * sqrt(dr2);
+    double r = A1/A0;
+    double dr2 = r*r * sigma2 * ( 1.0/(A0*A0) + 1.0/(A1*A1) );
+    double dndeconv = exdeconv * ndeconv * ndeconv * sqrt(dr2);
 
-    Tdeconv[isamp] = ( isamp + 0.5 - ndeconv[isamp] ) * fSamplePeriod;
-    dTdeconv[isamp] = dndeconv[isamp] * fSamplePeriod;
+    double Tdeconv = ( isamp + 0.5 - ndeconv ) * fSamplePeriod; //estimate of signal start time based on ndeconv.
+    double dTdeconv = dndeconv * fSamplePeriod;
 
-    double weight = pow(dTdeconv[isamp],-2);
-    
-    //weight = 1.0;
+    double weight = 1.0/(dTdeconv*dTdeconv);
     
-    //if( ndeconv[isamp] >= 0.0 ){
-    // if( true ){
-    Tsum += Tdeconv[isamp] * weight;
-    Tsum2 += pow(Tdeconv[isamp],2) * weight;
+    Tsum += Tdeconv * weight;
     sumw2 += weight;
-      //}
   }
 
-  //if( true ){
-  //if( true ){
   return Tsum / sumw2 - fTrigTimeSlope * fTrigTime;
-  //} 
 }
 
 void SBSGEMModule::InitAPVMAP(){
@@ -6642,87 +6978,235 @@ void SBSGEMModule::CalcDeconvolutedSamples( const std::vector<Double_t> &ADC, st
   //"Baseline" assumption is that the two samples prior to the window are both zero:
   double ADCpre[2] = {0.0,0.0};
 
-  //This loop is necessary in the generic case to get the max ADC value and time sample
-  int isampmax=0;
-  double ADCmax = 0.0;
-  double ADCsum = 0.0;
-  for( int isamp=0; isamp<fN_MPD_TIME_SAMP; isamp++ ){
-    if( isamp == 0 || ADC[isamp] > ADCmax ){
-      isampmax = isamp;
-      ADCmax = ADC[isamp];
-    }
-    ADCsum += ADC[isamp];
-  }
-
-  double xdeconv = fSamplePeriod/fStripTau;
-  double exdeconv = exp(xdeconv);
+  double exdeconv = fDeconvExpX; //exp(fSamplePeriod/fStripTau), precomputed in ReadDatabase
 
   // calculate the expected number of samples since the start of the signal
   //The calculation is based on the assumed time dependence of the signal:
   // ADC_n(t) = nx e^{-nx}, where x = dt/tau
   // ADC_{n-2} = (n-2)x*e^{-(n-2)x}
   // ADC_{n-2}/ADCn = (n-2)/n * e^{-(n-2)x + nx} = (n-2)/n * e^{2x}
-  // based on the 0/1 ratio and based on the 1/2 ratio:
-  
-  double ndeconv[fN_MPD_TIME_SAMP-1]; //for samples 0-4, estimate of the start time of the signal (in samples) based on the ratio of samples n, n+1
-  double ADCminus1[fN_MPD_TIME_SAMP-1]; //estimates of sample -1 based on ratios of later samples
-  double ADCminus2[fN_MPD_TIME_SAMP-1]; //estimates of sample -2 based on ratios of later samples
+  // Only the estimate from the 0/1 ratio is needed, to extrapolate the two samples before the window:
+  double ndeconv0 = ADC[0]/(ADC[1]*exdeconv - ADC[0]);
+
+  //first calculate deconvoluted samples 2-5: these are independent of any estimation of samples -1, -2
+  for( int isamp=2; isamp<fN_MPD_TIME_SAMP; isamp++ ){
+    double Adeconv = ADC[isamp] * fDeconv_weights[0] + ADC[isamp-1]*fDeconv_weights[1] + ADC[isamp-2]*fDeconv_weights[2];
 
-  double avgADCminus1=0.0, avgADCminus2=0.0;
+    DeconvADC[isamp] = Adeconv;
+  }
+
+  if( ndeconv0 >= 1. && ADC[0] > ADC[1] ){ //This calculation essentially zeroes out deconvoluted ADC samples 0 and 1:
+    ADCpre[1] = std::max( 0.0, (ndeconv0-1.)/ndeconv0 * exdeconv * ADC[0] );
+    ADCpre[0] = std::max( 0.0, (ndeconv0-2.)/(ndeconv0-1.) * exdeconv * ADCpre[1] );
+  }
 
-  //double nsamp = double(fN_MPD_TIME_SAMP-1);
+  DeconvADC[0] = ADC[0] * fDeconv_weights[0] + ADCpre[1] * fDeconv_weights[1] + ADCpre[0] * fDeconv_weights[2];
+  DeconvADC[1] = ADC[1] * fDeconv_weights[0] + ADC[0] * fDeconv_weights[1] + ADCpre[1] * fDeconv_weights[2];
 
-  double nsamp_minus1 = 0.0;
-  double nsamp_minus2 = 0.0;
+  return;
   
-  for( int isamp=0; isamp<fN_MPD_TIME_SAMP-1; isamp++ ){
-    ndeconv[isamp] = ADC[isamp]/(ADC[isamp+1]*exdeconv - ADC[isamp]);
+}
 
-    // if( ADCsum >= 400. ){
-    //   std::cout << "(isamp, ADCi, ADCi+1, ndeconv)=(" << isamp << ", "
-    // 		<< ADC[isamp] << ", " << ADC[isamp+1] << ", " << ndeconv[isamp] << ")" << std::endl;
-    // }
-    //if( ndeconv[isamp] > 0. ){
-    ADCminus1[isamp] = std::max( 0.0, (ndeconv[isamp] - (isamp+1.))/ndeconv[isamp] * pow(exdeconv,isamp+1) * ADC[isamp] );
-    ADCminus2[isamp] = std::max( 0.0, (ndeconv[isamp] - (isamp+2.))/ndeconv[isamp] * pow(exdeconv,isamp+2) * ADC[isamp] );
+void SBSGEMModule::SetForceGenericKernels( Bool_t force ){
+  fForceGenericKernels = force;
+  fNsampKernel = ( !force && ( fN_MPD_TIME_SAMP == 6 || fN_MPD_TIME_SAMP == 3 ) ) ? fN_MPD_TIME_SAMP : 0;
+}
 
-    //if( ADCminus1[isamp] > 0. ){
-    avgADCminus1 += ADCminus1[isamp];
-    nsamp_minus1 += 1.;
-	//}
-    //  if( ADCminus2[isamp] > 0. ){
-    avgADCminus2 += ADCminus2[isamp];
-    nsamp_minus2 += 1.;
-    //  }
-    //}
+void SBSGEMModule::AddStripSamples( Double_t *sum, const Double_t *samples, Double_t weight ){
+  switch( fNsampKernel ){
+  case 6:
+    AddWeightedSamples<6>( sum, samples, weight, 6 );
+    break;
+  case 3:
+    AddWeightedSamples<3>( sum, samples, weight, 3 );
+    break;
+  default:
+    AddWeightedSamples<0>( sum, samples, weight, fN_MPD_TIME_SAMP );
+    break;
   }
+}
 
-  //first calculate deconvoluted samples 2-5: these are independent of any estimation of samples -1, -2
-  for( int isamp=2; isamp<fN_MPD_TIME_SAMP; isamp++ ){
-    double Adeconv = ADC[isamp] * fDeconv_weights[0] + ADC[isamp-1]*fDeconv_weights[1] + ADC[isamp-2]*fDeconv_weights[2];
+void SBSGEMModule::CalcStripFeatures(){
+  //The sample count is fixed for the run, so the kernel is selected once in ReadDatabase (fNsampKernel).
+  //With a compile-time sample count, the inner sample loops below are fully unrolled:
+  switch( fNsampKernel ){
+  case 6:
+    CalcStripFeaturesN<6>();
+    break;
+  case 3:
+    CalcStripFeaturesN<3>();
+    break;
+  default:
+    CalcStripFeaturesN<0>();
+    break;
+  }
+}
 
-    DeconvADC[isamp] = Adeconv;
+template<int NSAMP>
+void SBSGEMModule::CalcStripFeaturesN(){
+  //Batched version of CalcDeconvolutedSamples, the deconvoluted sample loop formerly in Decode, StripTSchi2 and FitStripTime,
+  //run once per event over all decoded strips of the module. The strip samples are first copied to a sample-major buffer
+  //so that every inner loop runs over strips with unit stride and no branches, which the compiler can vectorize.
+  //Since the deconvolution is linear in the samples, deconvoluting the gain-corrected samples is equivalent to applying
+  //the gain to the deconvoluted samples, as was done before.
+  
+  const Int_t nstrips = fNstrips_hit;
+  const Int_t nsamp = NSAMP > 0 ? NSAMP : fN_MPD_TIME_SAMP;
+  if( nstrips <= 0 || nsamp < 2 ) return;
+
+  sbsgemstripbatch_t &B = fStripBatch;
+  if( B.sum.size() < UInt_t(nstrips) ) B.resize( nstrips, nsamp );
+
+  Double_t *A = B.ADC.data();
+  Double_t *D = B.Deconv.data();
+  
+  //Gather: sample-major copy of the samples, axis and pedestal RMS of each strip:
+  for( Int_t istrip=0; istrip<nstrips; istrip++ ){
+    const Double_t *samples = fADCsamples[istrip];
+    for( Int_t isamp=0; isamp<nsamp; isamp++ ){
+      A[isamp*nstrips + istrip] = samples[isamp];
+    }
+    B.axis[istrip] = fAxis[istrip];
+    B.rms[istrip] = ( fAxis[istrip] == SBSGEM::kUaxis ) ? fPedRMSU[fStrip[istrip]] : fPedRMSV[fStrip[istrip]];
+  }
+
+  const Double_t w0 = fDeconv_weights[0], w1 = fDeconv_weights[1], w2 = fDeconv_weights[2];
+  const Double_t ex = fDeconvExpX;
+  
+  //Deconvoluted samples 2...nsamp-1 don't depend on the baseline estimate:
+  for( Int_t isamp=2; isamp<nsamp; isamp++ ){
+    const Double_t *a0 = A + isamp*nstrips, *a1 = a0 - nstrips, *a2 = a1 - nstrips;
+    Double_t *d = D + isamp*nstrips;
+    for( Int_t i=0; i<nstrips; i++ ){
+      d[i] = w0*a0[i] + w1*a1[i] + w2*a2[i];
+    }
+  }
+  //Samples 0 and 1 use the extrapolation of the two samples before the window from the 0/1 ratio:
+  for( Int_t i=0; i<nstrips; i++ ){
+    Double_t A0 = A[i], A1 = A[nstrips+i];
+    Double_t n0 = A0/(A1*ex - A0);
+    bool extrap = n0 >= 1. && A0 > A1;
+    Double_t pre1 = extrap ? std::max( 0.0, (n0-1.)/n0 * ex * A0 ) : 0.0;
+    Double_t pre0 = extrap ? std::max( 0.0, (n0-2.)/(n0-1.) * ex * pre1 ) : 0.0;
+    D[i] = A0*w0 + pre1*w1 + pre0*w2;
+    D[nstrips+i] = A1*w0 + A0*w1 + pre1*w2;
   }
 
-  if( ndeconv[0] >= 1. && ADC[0] > ADC[1] ){ //This calculation essentially zeroes out deconvoluted ADC samples 0 and 1:
-    ADCpre[1] = std::max( 0.0, (ndeconv[0]-1.)/ndeconv[0] * exdeconv * ADC[0] );
-    ADCpre[0] = std::max( 0.0, (ndeconv[0]-2.)/(ndeconv[0]-1.) * exdeconv * ADCpre[1] );
+  //Sums, max. sample and max. two-sample combination of the deconvoluted samples. The combo index is the
+  //last sample of the pair; sample 0 alone counts as combo 0 and (as before) sample 5 alone as combo nsamp:
+  for( Int_t i=0; i<nstrips; i++ ){
+    B.sum[i] = 0.0; B.tsum[i] = 0.0;
+    B.max[i] = D[i]; B.imax[i] = 0;
+    B.combo[i] = D[i]; B.icombo[i] = 0;
+    B.tfitsum[i] = 0.0; B.wsum[i] = 0.0; B.chi2[i] = 0.0;
+  }
+  for( Int_t isamp=0; isamp<nsamp; isamp++ ){
+    const Double_t *d = D + isamp*nstrips;
+    const Double_t tsamp = fSampleTime[isamp];
+    for( Int_t i=0; i<nstrips; i++ ){
+      B.sum[i] += d[i];
+      B.tsum[i] += tsamp * d[i];
+    }
+    if( isamp > 0 ){
+      const Double_t *dprev = d - nstrips;
+      for( Int_t i=0; i<nstrips; i++ ){
+	bool newmax = d[i] > B.max[i];
+	B.max[i] = newmax ? d[i] : B.max[i];
+	B.imax[i] = newmax ? isamp : B.imax[i];
+	Double_t combo = d[i] + dprev[i];
+	bool newcombo = combo > B.combo[i];
+	B.combo[i] = newcombo ? combo : B.combo[i];
+	B.icombo[i] = newcombo ? isamp : B.icombo[i];
+      }
+    }
+    if( isamp == 5 ){
+      for( Int_t i=0; i<nstrips; i++ ){
+	bool newcombo = d[i] > B.combo[i];
+	B.combo[i] = newcombo ? d[i] : B.combo[i];
+	B.icombo[i] = newcombo ? nsamp : B.icombo[i];
+      }
+    }
   }
 
-  DeconvADC[0] = ADC[0] * fDeconv_weights[0] + ADCpre[1] * fDeconv_weights[1] + ADCpre[0] * fDeconv_weights[2];
-  DeconvADC[1] = ADC[1] * fDeconv_weights[0] + ADC[0] * fDeconv_weights[1] + ADCpre[1] * fDeconv_weights[2];
+  //Fit time (see CalcFitTime), with sigma = pedestal RMS * 2.45 as before:
+  for( Int_t isamp=0; isamp<nsamp-1; isamp++ ){
+    const Double_t *a0 = A + isamp*nstrips, *a1 = a0 + nstrips;
+    for( Int_t i=0; i<nstrips; i++ ){
+      Double_t sigma = B.rms[i]*2.45;
+      Double_t ndeconv = a0[i]/(a1[i]*ex - a0[i]);
+      Double_t r = a1[i]/a0[i];
+      Double_t dr2 = r*r * sigma*sigma * ( 1.0/(a0[i]*a0[i]) + 1.0/(a1[i]*a1[i]) );
+      Double_t dT = ex * ndeconv * ndeconv * sqrt(dr2) * fSamplePeriod;
+      Double_t weight = 1.0/(dT*dT);
+      B.tfitsum[i] += ( isamp + 0.5 - ndeconv ) * fSamplePeriod * weight;
+      B.wsum[i] += weight;
+    }
+  }
 
-  // if( ADCmax > 150. ){
+  //TS chi2 wrt the reference pulse shape scaled to the max. sample (see StripTSchi2):
+  const Double_t *shapeU = fStripTSshape[SBSGEM::kUaxis].data();
+  const Double_t *shapeV = fStripTSshape[SBSGEM::kVaxis].data();
+  for( Int_t isamp=0; isamp<nsamp; isamp++ ){
+    const Double_t *a = A + isamp*nstrips;
+    for( Int_t i=0; i<nstrips; i++ ){
+      bool isU = B.axis[i] == SBSGEM::kUaxis;
+      //NOTE: as in StripTSchi2, the sample sigma for V strips includes the RMS conversion factor (sqrt(6)):
+      Double_t sigma = isU ? B.rms[i] : B.rms[i]*fRMS_ConversionFactor;
+      Double_t diff = ( a[i] - fADCmax[i] * (isU ? shapeU[isamp] : shapeV[isamp]) )/sigma;
+      B.chi2[i] += diff*diff;
+    }
+  }
 
-  //   std::cout << "ntest, estimated (ADC_{-2}, ADC_{-1}) = " << ntest << ", (" << ADCpre[0] << ", " << ADCpre[1] << ")" << std::endl;
+  //Scatter the results back to the strip arrays and apply the strip cuts that depend on them:
+  Double_t tcorr = fTrigTimeSlope*fTrigTime;
+  for( Int_t istrip=0; istrip<nstrips; istrip++ ){
+    Double_t *deconv = fADCsamples_deconv[istrip];
+    for( Int_t isamp=0; isamp<nsamp; isamp++ ){
+      deconv[isamp] = D[isamp*nstrips + istrip];
+      fADCsamplesDeconv1D[isamp + nsamp * istrip] = deconv[isamp];
+    }
     
-  //   for( int isamp=0; isamp<fN_MPD_TIME_SAMP; isamp++ ){
-  //     std::cout << "(isamp, ADC, DeconvADC)=(" << isamp << ", " << ADC[isamp] << ", " << DeconvADC[isamp]
-  // 		<< ")" << std::endl;
-  //   }
-  // }
-  return;
-  
+    fADCsumsDeconv[istrip] = B.sum[istrip];
+    fADCmaxDeconv[istrip] = B.max[istrip];
+    fADCmaxDeconvCombo[istrip] = B.combo[istrip];
+    fMaxSampDeconv[istrip] = B.imax[istrip];
+    fMaxSampDeconvCombo[istrip] = B.icombo[istrip];
+    fTmeanDeconv[istrip] = B.tsum[istrip]/B.sum[istrip] - tcorr;
+    
+    fStripTfit[istrip] = B.tfitsum[istrip]/B.wsum[istrip] - tcorr;
+    fStripTSchi2[istrip] = B.chi2[istrip];
+    fStripTSprob[istrip] = TMath::Prob( B.chi2[istrip], 6 );
+
+    if( fDeconvolutionFlag != 0 && fStripIsNeg[istrip] == 0 ){
+      //rmstemp is the rms of the average of six time samples. To get individual sample noise, we take:
+      double sigma_1sample = B.rms[istrip] * fRMS_ConversionFactor; 
+      
+      //5 * 8 * sqrt(6) ~= 100 
+      if( B.combo[istrip] <= fZeroSuppressRMS * sigma_1sample ){
+	fKeepStrip[istrip] = false;
+      }
+
+      if( fSuppressFirstLast != 0 && B.icombo[istrip] == 0 ){
+	fKeepStrip[istrip] = false;
+      }
+    }
+    
+    if( fUseTSchi2cut && fStripTSchi2[istrip] > fStripTSchi2Cut ){
+      fKeepStrip[istrip] = false;
+    }
+
+    if( fKeepStrip[istrip] ){
+      UInt_t isU = fStripIsU[istrip], isV = fStripIsV[istrip];
+      fNstrips_keep++;
+      fNstrips_keepU += isU;
+      fNstrips_keepV += isV;
+      if( fADCmax[istrip] >= fThresholdSample && fADCsums[istrip] >= fThresholdStripSum ){
+	fNstrips_keep_lmax++;
+	fNstrips_keep_lmaxU += isU;
+	fNstrips_keep_lmaxV += isV;
+      }
+    }
+  }
 }
 
 void SBSGEMModule::SetTriggerTime( Double_t ttrig ){
@@ -6737,7 +7221,7 @@ void SBSGEMModule::FitClusterTime( sbsgemcluster_t &clust ){
     return;
   }
   
-  std::vector<Double_t> &ADC = clust.ADCsamples;
+  const Double_t *ADC = clust.ADCsamples.data();
 
   //RMS of the cluster-summed samples is ~20.0 * sqrt(nstrip);
   
@@ -7,6 +7,7 @@
 #include <map>
 #include <array>
 #include <deque>
+#include <algorithm>
 
 //using namespace std;
 
@@ -17,6 +18,7 @@ class TH1D;
 class TH2D;
 class TF1;
 class TClonesArray;
+namespace Decoder { class MPDModule; }
 
 namespace SBSGEM {
   enum GEMaxis_t { kUaxis=0, kVaxis };
@@ -34,6 +36,117 @@ struct mpdmap_t {
   UInt_t invert;
   UInt_t axis; //needed to add axis to the decode map
   UInt_t index;
+  Int_t lut_offset; //index of channel 0 of this APV card in the tracker channel lookup table (-1 if the table is not built)
+};
+
+struct sbsgemchanlut_t; //defined in SBSGEMTrackerBase.h
+
+
+//Per-module, per-event "bump" allocator for the variable-length per-cluster buffers. Memory is handed out from
+//large blocks that are kept from one event to the next; Reset() (called from SBSGEMModule::Clear()) just rewinds
+//to the start of the first block, so that in steady state clustering makes no heap allocations.
+//Everything allocated from the arena is invalidated by Reset():
+struct sbsgemarena_t {
+  std::vector<std::vector<Double_t> > blocks; //memory blocks (in units of Double_t, which gives sufficient alignment for all our types)
+  UInt_t iblock; //block currently being filled
+  size_t pos;    //fill position in current block
+  size_t blocksize; //default size of new blocks
+  ULong64_t nheapallocs; //number of blocks allocated so far (this should stop growing after the first few events)
+
+  sbsgemarena_t( size_t bsize=16384 ) : iblock(0), pos(0), blocksize(bsize), nheapallocs(0) {}
+
+  void Reset() { iblock = 0; pos = 0; }
+
+  template<typename T> T *Alloc( size_t n ){
+    size_t nwords = (n*sizeof(T) + sizeof(Double_t) - 1)/sizeof(Double_t);
+    if( iblock >= blocks.size() || pos + nwords > blocks[iblock].size() ){
+      //move on to the next block that is big enough, allocating a new one if necessary:
+      if( iblock < blocks.size() ) iblock++;
+      pos = 0;
+      while( iblock < blocks.size() && blocks[iblock].size() < nwords ) iblock++;
+      if( iblock == blocks.size() ){
+	blocks.push_back( std::vector<Double_t>( std::max( blocksize, nwords ) ) );
+	nheapallocs++;
+      }
+    }
+    T *ptr = reinterpret_cast<T*>( blocks[iblock].data() + pos );
+    pos += nwords;
+    return ptr;
+  }
+};
+
+//Minimal vector-like array whose storage lives in an sbsgemarena_t. Copies are shallow (they refer to the same
+//storage), which is all that is needed for the cluster arrays. Growing beyond the current capacity takes a fresh
+//piece of the arena; the old piece is only recycled at the next Reset() of the arena.
+template<typename T>
+struct sbsgemarenavec_t {
+  T *fData; //! storage in arena
+  UInt_t fSize;
+  UInt_t fCapacity;
+  sbsgemarena_t *fArena; //! arena that owns the storage
+
+  sbsgemarenavec_t() : fData(nullptr), fSize(0), fCapacity(0), fArena(nullptr) {}
+
+  void SetArena( sbsgemarena_t *arena ){ fArena = arena; fData = nullptr; fSize = 0; fCapacity = 0; }
+
+  UInt_t size() const { return fSize; }
+  bool empty() const { return fSize == 0; }
+  T *data() { return fData; }
+  const T *data() const { return fData; }
+  T &operator[]( UInt_t i ) { return fData[i]; }
+  const T &operator[]( UInt_t i ) const { return fData[i]; }
+  T &back() { return fData[fSize-1]; }
+
+  void clear() { fSize = 0; }
+  void reserve( UInt_t n ){
+    if( n <= fCapacity ) return;
+    T *newdata = fArena->Alloc<T>( n );
+    for( UInt_t i=0; i<fSize; i++ ) newdata[i] = fData[i];
+    fData = newdata;
+    fCapacity = n;
+  }
+  void resize( UInt_t n, const T &val=T() ){
+    reserve( n );
+    for( UInt_t i=fSize; i<n; i++ ) fData[i] = val;
+    fSize = n;
+  }
+  void push_back( const T &val ){
+    if( fSize == fCapacity ) reserve( std::max( 2*fCapacity, UInt_t(8) ) );
+    fData[fSize++] = val;
+  }
+};
+
+//Fixed-stride 2D array (one row per decoded strip, one column per time sample) in a single contiguous
+//buffer, allocated once when the module is initialized. Rows are accessed as array[irow][isamp]:
+template<typename T>
+struct sbsgemstriparray_t {
+  std::vector<T> fData;
+  UInt_t fStride;
+
+  sbsgemstriparray_t() : fStride(0) {}
+
+  void resize( UInt_t nrows, UInt_t stride ){ fStride = stride; fData.assign( size_t(nrows)*stride, T() ); }
+  UInt_t size() const { return fStride > 0 ? fData.size()/fStride : 0; }
+  UInt_t stride() const { return fStride; }
+  T *operator[]( UInt_t irow ) { return fData.data() + size_t(irow)*fStride; }
+  const T *operator[]( UInt_t irow ) const { return fData.data() + size_t(irow)*fStride; }
+};
+
+//Sample-major work buffers for the batched strip feature calculation (see SBSGEMModule::CalcStripFeatures).
+//Sample arrays are indexed as isamp * nstrips + istrip, so that all the inner loops run over strips with unit stride;
+//the per-strip arrays hold running sums and maxima:
+struct sbsgemstripbatch_t {
+  std::vector<Double_t> ADC, Deconv;
+  std::vector<Double_t> sum, tsum, max, combo, rms, tfitsum, wsum, chi2;
+  std::vector<Int_t> imax, icombo, axis;
+
+  void resize( UInt_t nstrips, UInt_t nsamples ){
+    ADC.resize( size_t(nstrips)*nsamples );
+    Deconv.resize( size_t(nstrips)*nsamples );
+    sum.resize( nstrips ); tsum.resize( nstrips ); max.resize( nstrips ); combo.resize( nstrips );
+    rms.resize( nstrips ); tfitsum.resize( nstrips ); wsum.resize( nstrips ); chi2.resize( nstrips );
+    imax.resize( nstrips ); icombo.resize( nstrips ); axis.resize( nstrips );
+  }
 };
 
 //Clustering results can be held in a simple C struct, as a cluster is just a collection of basic data types (not even arrays):
@@ -100,23 +213,23 @@ struct sbsgemcluster_t {  //1D clusters;
   UInt_t isampmax; //time sample in which the cluster-summed ADC samples peaks:
   UInt_t isampmaxDeconv; //time sample in which the deconvoluted cluster-summed ADC samples peaks.
   UInt_t icombomaxDeconv; //2nd time sample of max two-sample combo for cluster-summed deconvoluted ADC samples
-  std::vector<Double_t> ADCsamples; //cluster-summed ADC samples (accounting for split fraction)
+  sbsgemarenavec_t<Double_t> ADCsamples; //cluster-summed ADC samples (accounting for split fraction)
   //New variables:
-  std::vector<Double_t> DeconvADCsamples; //cluster-summed deconvoluted ADC ssamples (accounting for split fraction)
+  sbsgemarenavec_t<Double_t> DeconvADCsamples; //cluster-summed deconvoluted ADC ssamples (accounting for split fraction)
   Double_t hitpos_mean;  //ADC-weighted mean coordinate along the direction measured by the strip
   Double_t hitpos_sigma; //ADC-weighted RMS coordinate deviation from the mean along the direction measured by the strip
   Double_t clusterADCsum; //Sum of ADCs over all samples on all strips, accounting for split fraction and first/last sample suppression
   Double_t clusterADCsumDeconv; //sum of all deconvoluted ADC samples over all strips in the cluster
   Double_t clusterADCsumDeconvMaxCombo; //sum over all strips in the cluster of max two-sample combo 
-  std::vector<Double_t> stripADCsum; //Sum of individual strip ADCs over all samples on all strips; accounting for split fraction
-  std::vector<Double_t> DeconvADCsum; //Sum of individual deconvoluted ADC samples over all samples on all strips; accounting for split fraction
+  sbsgemarenavec_t<Double_t> stripADCsum; //Sum of individual strip ADCs over all samples on all strips; accounting for split fraction
+  sbsgemarenavec_t<Double_t> DeconvADCsum; //Sum of individual deconvoluted ADC samples over all samples on all strips; accounting for split fraction
   Double_t t_mean; //reconstructed hit time
   Double_t t_sigma; //unclear what we might use this for
   Double_t t_mean_deconv; //cluster-summed mean deconvoluted hit time.
   Double_t t_mean_fit; //cluster-summed "fit" time.
   //Do we want to store the individual strip ADC Samples with the 1D clustering results? I don't think so; as these can be accessed via the decoded strip info.
   
-  std::vector<UInt_t> hitindex; //position in decoded hit array of each strip in the cluster:
+  sbsgemarenavec_t<UInt_t> hitindex; //position in decoded hit array of each strip in the cluster:
   UInt_t rawstrip; //Raw APV strip number before decoding 
   UInt_t rawMPD; //Raw MPD number before decoding 
   UInt_t rawAPV; //Raw APV number before decoding 
@@ -124,6 +237,15 @@ struct sbsgemcluster_t {  //1D clusters;
   bool isnegontrack; //Cluster is from negative strips
   bool keep;
   bool ontrack;
+
+  //All the array members of a new cluster must be attached to the module's cluster arena before use:
+  void SetArena( sbsgemarena_t *arena ){
+    ADCsamples.SetArena( arena );
+    DeconvADCsamples.SetArena( arena );
+    stripADCsum.SetArena( arena );
+    DeconvADCsum.SetArena( arena );
+    hitindex.SetArena( arena );
+  }
 };
 
 
@@ -154,6 +276,8 @@ class SBSGEMModule : public THaSubDetector {
 
   virtual void    Clear( Option_t* opt="" ); //should be called once per event
   virtual Int_t   Decode( const THaEvData& );
+  //Update only the run-level state (time stamp T0, rolling common-mode averages) from an event that is not analyzed:
+  Int_t           UpdateRunningState( const THaEvData& );
   virtual void    Print( Option_t* opt="" ) const;
 
   virtual Int_t   ReadDatabase(const TDatime& );
@@ -180,6 +304,9 @@ class SBSGEMModule : public THaSubDetector {
 
   // fill the 2D hit arrays from the 1D cluster arrays:
   void fill_2D_hit_arrays(); 
+  //Cluster time and ADC sum entering the U/V time difference and ADC asymmetry cuts of filter_2Dhits (depend on fClusteringFlag):
+  Double_t GetClusterPairTime( const sbsgemcluster_t &clust ) const;
+  Double_t GetClusterPairADC( const sbsgemcluster_t &clust ) const;
 
   //Filter 1D hits by criteria possibly to include ADC threshold, cluster size
   void filter_1Dhits(SBSGEM::GEMaxis_t axis);
@@ -187,8 +314,14 @@ class SBSGEMModule : public THaSubDetector {
   //Filter 2D hits by criteria possibly to include ADC X/Y asymmetry, cluster size, time correlation, (lack of) overlap, possibly others:
   void filter_2Dhits(); 
   
+  //Use the generic strip kernels (run-time sample count) even for 6 or 3 time samples, to compare them with the specialized
+  //ones. Also called from ReadDatabase with the database setting:
+  void SetForceGenericKernels( Bool_t force );
+
   //Utility function to calculate correlation coefficient between U and V time samples:
   Double_t CorrCoeff( int nsamples, const std::vector<double> &Usamples, const std::vector<double> &Vsamples, int firstsample=0 );
+  //Same, for samples stored in contiguous arrays (strip rows of fADCsamples, cluster sample arrays). No size check is possible:
+  Double_t CorrCoeff( int nsamples, const Double_t *Usamples, const Double_t *Vsamples, int firstsample=0 );
   Double_t StripTSchi2( int hitindex );
   
   //Utility functions to compute "module local" X and Y coordinates from U and V (strip coordinates) to "transport" coordinates (x,y) and vice-versa:
@@ -205,6 +338,9 @@ class SBSGEMModule : public THaSubDetector {
   
   double GetCommonMode( UInt_t isamp, Int_t flag, const mpdmap_t &apvinfo, UInt_t nhits=128, bool out_of_range=false ); //default to "sorting" method:
 
+  //Copy one time sample of the current APV card into the contiguous common-mode work arrays:
+  void LoadCommonModeBlock( UInt_t isamp, const mpdmap_t &apvinfo, UInt_t nhits );
+
   //Simulation of common-mode correction algorithm as applied to full readout events:
   double GetCommonModeCorrection( UInt_t isamp, const mpdmap_t &apvinfo, UInt_t &ngood, const UInt_t &nhits=128, bool fullreadout=false, Int_t flag=0 );
   
@@ -213,7 +349,7 @@ class SBSGEMModule : public THaSubDetector {
   double FitStripTime( int striphitindex, double RMS=20.0 ); // "dumb" fit method 
   void FitClusterTime( sbsgemcluster_t &clus ); //calculate "fit time" for cluster-summed ADC samples
 
-  double CalcFitTime( const std::vector<Double_t> &samples, double RMS=20.0 );
+  double CalcFitTime( const Double_t *samples, double RMS=20.0 ); //samples has fN_MPD_TIME_SAMP entries
   
   //Since we have two different kinds of rolling averages to evaluate, we consolidate both codes into one method.
   //Since we can only declare references with initialization, we have to pass the underlying arrays as arguments:
@@ -223,7 +359,30 @@ class SBSGEMModule : public THaSubDetector {
 
   void CalcDeconvolutedSamples( const std::vector<Double_t> &ADCs, std::vector<Double_t> &DeconvADCs );
 
+  //Deconvoluted samples, max. sample and two-sample combo, deconvoluted mean time, fit time and TS chi2 for all strips
+  //decoded in this event, in one pass over sample-major copies of the strip samples. Also applies the strip
+  //selection cuts that depend on these quantities and counts the kept strips:
+  void CalcStripFeatures();
+  //Implementation of CalcStripFeatures for NSAMP time samples (NSAMP=0: generic version using fN_MPD_TIME_SAMP):
+  template<int NSAMP> void CalcStripFeaturesN();
+  //sum[isamp] += weight * samples[isamp] for the fN_MPD_TIME_SAMP samples of a strip (cluster sums):
+  void AddStripSamples( Double_t *sum, const Double_t *samples, Double_t weight );
+
   void SetTriggerTime( Double_t ttrig );
+
+  //Check (once per run) that no MPD module of this module's decode map is configured with "frameview_only" unless
+  //fN_MPD_TIME_SAMP equals the fixed number of samples per strip record of the frame view. Returns false otherwise:
+  Bool_t CheckFrameViewConfig( const THaEvData& );
+
+  //Pieces of the per-APV decoding shared by Decode and UpdateRunningState, so that both update the event-to-event
+  //state (time stamp reference, raw ADC range, rolling common-mode and online bias averages) the same way:
+  Decoder::MPDModule *GetFrameViewModule( const THaEvData&, const mpdmap_t &apv ) const;
+  Bool_t ReadMPDTimeStamp( const THaEvData&, const mpdmap_t &apv, Decoder::MPDModule *mpdmodule, UInt_t &Tlow, UInt_t &Thigh, UInt_t &EvCnt ) const;
+  Double_t UpdateT0( int apvcounter, UInt_t Tlow, UInt_t Thigh, UInt_t EvCnt );
+  Bool_t ReadAPVFlags( const THaEvData&, const mpdmap_t &apv, Bool_t &CM_ENABLED, Bool_t &BUILD_ALL_SAMPLES, Bool_t &CM_OUT_OF_RANGE, Bool_t &cm_flags_found );
+  void LoadAPVSamples( const THaEvData&, const mpdmap_t &apv, Decoder::MPDModule *frameview, Int_t nsamp,
+		       Bool_t CM_ENABLED, Bool_t fullreadout, int apvcounter, Double_t *commonMode );
+  Bool_t CalcFullReadoutCommonMode( const mpdmap_t &apv, int apvcounter, Bool_t CM_OUT_OF_RANGE, Double_t *commonMode, Bool_t fillhistos );
   
   
   TF1 *fStripTimeFunc;
@@ -233,6 +392,9 @@ class SBSGEMModule : public THaSubDetector {
   //UShort_t GetLayer() const { return fLayer; }
 
   //std::vector<sbsgemhit_t> GetHitList() { return fHits; }
+
+  //Number of heap allocations made so far by the cluster arena (should stop growing once the occupancy has been "seen"):
+  ULong64_t GetNclusterArenaAllocs() const { return fClusterArena.nheapallocs; }
   
   //If we are going to declare all these data members private, we will need to write public getters and setters for at least the information required by the tracker classes:
   //private:
@@ -319,6 +481,10 @@ class SBSGEMModule : public THaSubDetector {
   
   Double_t fStripTau; //time constant for strip timing fit
   Double_t fDeconv_weights[3]; //
+  //Constants for the strip pulse-shape calculations, precomputed in ReadDatabase:
+  Double_t fDeconvExpX; // exp( fSamplePeriod/fStripTau )
+  std::vector<Double_t> fSampleTime; // center time of each sample, (isamp+0.5)*fSamplePeriod
+  std::vector<Double_t> fStripTSshape[2]; // reference pulse shape (by axis) for the strip TS chi2, normalized to the max. sample
   //Make these fixed-size arrays defined per strip axis direction, this will require some painful code changes but will improve efficiency and S/N
   Double_t fStripMaxTcut_central[2], fStripMaxTcut_width[2], fStripMaxTcut_sigma[2]; // Strip timing cuts for local maximum used to seed cluster
   Double_t fStripMaxTcut_central_deconv[2], fStripMaxTcut_width_deconv[2], fStripMaxTcut_sigma_deconv[2]; //Strip timing cuts based on deconvoluted strip time
@@ -384,6 +550,8 @@ class SBSGEMModule : public THaSubDetector {
 
   UChar_t fN_APV25_CHAN;     //number of APV25 channels, default 128
   UChar_t fN_MPD_TIME_SAMP;  //number of MPD time samples, default = 6
+  UChar_t fNsampKernel; //number of time samples the strip kernels are specialized for (6 or 3), 0 = generic; set in ReadDatabase
+  Bool_t fForceGenericKernels; //always use the generic strip kernels (DB key "generic_kernels", for benchmarking), default = false
   UShort_t fMPDMAP_ROW_SIZE; //MPDMAP_ROW_SIZE: default = 9, let's not hardcode
   UShort_t fNumberOfChannelInFrame; //default 128, not clear if this is used: This might not be constant, in fact
 
@@ -401,7 +569,17 @@ class SBSGEMModule : public THaSubDetector {
   std::vector<Int_t> fRawADC_nopedsub_APV;
   std::vector<Double_t> fPedSubADC_APV;
   std::vector<Double_t> fCommonModeSubtractedADC_APV;
-  
+
+  //Preallocated work arrays for the common-mode calculation, so that GetCommonMode doesn't have to allocate
+  //anything per APV per time sample. The "block" arrays hold ONE time sample of ONE APV card in contiguous
+  //(strip-ordered) form; they are filled by LoadCommonModeBlock:
+  std::vector<Double_t> fCMblockADC;   //ped-subtracted ADC
+  std::vector<Double_t> fCMblockRawADC; //raw ADC without pedestal subtraction (to compare to rawADCmin)
+  std::vector<Double_t> fCMblockPedRMS; //pedestal RMS of the strip
+  std::vector<Double_t> fCMsortBuffer; //sorting method
+  std::vector<Int_t>    fCMbinCounts;  //histogramming methods
+  std::vector<Double_t> fCMbinADCsum;  //histogramming methods
+
   //Let's store the online calculated common-mode in its own dedicated array as well:
   std::vector<Double_t> fCM_online; //size equal to fN_MPD_TIME_SAMP
   
@@ -436,9 +614,32 @@ class SBSGEMModule : public THaSubDetector {
   
   std::vector<UInt_t> fStrip;  //Strip index of hit (these could be "U" or "V" generalized X and Y), assumed to run from 0..N-1
   std::vector<SBSGEM::GEMaxis_t>  fAxis;  //We just made our enumerated type that has two possible values, makes the code more readable (maybe)
-  std::vector<std::vector<Double_t> > fADCsamples; //2D array of ADC samples by hit: Outer index runs over hits; inner index runs over ADC samples
-  std::vector<std::vector<Int_t> > fRawADCsamples; //2D array of raw (non-baseline-subtracted) ADC values.
-  std::vector<std::vector<Double_t> > fADCsamples_deconv; //"Deconvoluted" ADC samples
+  sbsgemstriparray_t<Double_t> fADCsamples; //2D array of ADC samples by hit: row index runs over hits; column index runs over ADC samples
+  sbsgemstriparray_t<Int_t> fRawADCsamples; //2D array of raw (non-baseline-subtracted) ADC values.
+  sbsgemstriparray_t<Double_t> fADCsamples_deconv; //"Deconvoluted" ADC samples
+
+  //Work arrays for the samples of the strip currently being decoded (size fN_MPD_TIME_SAMP):
+  std::vector<Double_t> fStripADCtemp;
+  std::vector<Int_t> fStripRawADCtemp;
+  std::vector<Double_t> fStripDeconvADCtemp;
+
+  sbsgemstripbatch_t fStripBatch; //work buffers for CalcStripFeatures
+
+  //Strip-indexed work arrays for find_clusters_1D, allocated for the larger of the two strip axes plus one guard entry
+  //at each end (entry 0 is strip -1). Only the entries of the fired strips are touched, and they are reset after each call:
+  std::vector<Int_t> fClustHitIndex;     //index in the decoded strip arrays by strip; -1 if the strip didn't fire
+  std::vector<Int_t> fClustHitIndexNeg;  //same, for the negative strips
+  std::vector<Double_t> fClustADCstrip;   //strip ADC quantity used for clustering (depends on fClusteringFlag)
+  std::vector<Double_t> fClustADCmaxsamp; //strip max. sample used for clustering
+  std::vector<char> fClustIsLocalMax;    //strip is a (surviving) local maximum
+  std::vector<UShort_t> fClustStrips, fClustStripsNeg; //fired strips in ascending order
+  std::vector<UShort_t> fClustMaxima, fClustPeaksToErase; //local maxima in ascending order
+
+  //Work arrays for the U/V cluster pairing in fill_2D_hit_arrays: sort key by V cluster, V clusters sorted by key,
+  //and the V clusters inside the window of the current U cluster:
+  std::vector<Double_t> fPairKeyV;
+  std::vector<UInt_t> fPairOrderV;
+  std::vector<UInt_t> fPairCandV;
   
   std::vector<Double_t> fADCsums;
   std::vector<Double_t> fADCsumsDeconv; //deconvoluted strip ADC sums
@@ -499,6 +700,7 @@ class SBSGEMModule : public THaSubDetector {
   UInt_t fNclustV_total; // Number of U clusters found in entire active area, without enforcing search region constraint
   std::vector<sbsgemcluster_t> fUclusters; //1D clusters along "U" direction
   std::vector<sbsgemcluster_t> fVclusters; //1D clusters along "V" direction
+  sbsgemarena_t fClusterArena; //storage for the array members of fUclusters and fVclusters; reset every event
 
   UInt_t fMAX2DHITS; // Max. 2d hits per module, to limit memory usage:
   UInt_t fN2Dhits; // number of 2D hits found in region of interest:
@@ -646,6 +848,13 @@ class SBSGEMModule : public THaSubDetector {
        
   Bool_t fIsMC;//we kinda want this guy no matter what don't we...
 
+  Int_t fFrameViewConfigOK; //result of CheckFrameViewConfig: -1 = not checked yet (reset in ReadDatabase), 0 = unsupported, 1 = OK
+
+  //Append the lookup table entries of this module's APV cards to the tracker-wide table and set the lut_offset of each
+  //decode map entry. Called from SBSGEMTrackerBase::CompleteInitialization, after ReadDatabase:
+  void FillChannelLUT( std::vector<sbsgemchanlut_t> &lut, Int_t imodule );
+  const sbsgemchanlut_t *fChannelLUT; //tracker-wide channel lookup table (owned by the tracker); nullptr = use the per-module maps
+
 
   //Efficiency histograms:
   TH1D *fhdidhitx;
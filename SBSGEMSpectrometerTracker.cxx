@@ -154,6 +154,14 @@ Int_t SBSGEMSpectrometerTracker::ReadDatabase( const TDatime& date ){
     { "maxhitcombos_inner", &fMaxHitCombinations_InnerLayers, kInt, 0, 1},
     { "maxhitcombos_total", &fMaxHitCombinations_Total, kDouble, 0, 1},
     { "tryfasttrack", &fasttrack_flag, kInt, 0, 1 },
+    { "trackfinder", &fTrackFinderMethod, kInt, 0, 1, 1 }, //(optional, search): 0 = combinatorial search (default), 1 = cellular automaton
+    { "nthreads", &fNthreads, kInt, 0, 1, 1 }, //(optional, search): number of threads for module decoding and hit reconstruction within one event (default 1 = serial). The worker threads come from a pool shared by all GEM trackers, but each tracker only uses nthreads of them
+    { "ca_maxslopex", &fCA_MaxSlopeX, kDouble, 0, 1, 1 },
+    { "ca_maxslopey", &fCA_MaxSlopeY, kDouble, 0, 1, 1 },
+    { "ca_maxkinkx", &fCA_MaxKinkX, kDouble, 0, 1, 1 },
+    { "ca_maxkinky", &fCA_MaxKinkY, kDouble, 0, 1, 1 },
+    { "ca_maxcells", &fCA_MaxCells, kInt, 0, 1, 1 },
+    { "ca_maxcandidates", &fCA_MaxCandidates, kInt, 0, 1, 1 },
     { "gridbinwidthx", &fGridBinWidthX, kDouble, 0, 1},
     { "gridbinwidthy", &fGridBinWidthY, kDouble, 0, 1},
     { "gridedgetolerancex", &fGridEdgeToleranceX, kDouble, 0, 1},
@@ -164,6 +172,7 @@ Int_t SBSGEMSpectrometerTracker::ReadDatabase( const TDatime& date ){
     { "constraintwidth_phi", &fConstraintWidth_phi, kDouble, 0, 1},
     { "useopticsconstraint", &useopticsconstraint, kInt, 0, 1},
     { "sigmahitpos", &fSigma_hitpos, kDouble, 0, 1},
+    { "sigmahitpos_1strip", &fSigma_hitpos_1strip, kDouble, 0, 1, 1}, //(optional, search): resolution of hits with a single-strip cluster, de-weights these hits in the track fit
     { "pedestalmode", &pedestalmode_flag, kInt, 0, 1, 1},
     { "do_neg_signal_study", &negsignalstudy_flag, kUInt, 0, 1, 1}, //(optional, search): toggle doing negative signal analysis
     { "do_efficiencies", &doefficiency_flag, kInt, 0, 1, 1},
@@ -240,6 +249,12 @@ Int_t SBSGEMSpectrometerTracker::ReadDatabase( const TDatime& date ){
   fIsMC = (mc_flag != 0);
   fTryFastTrack = (fasttrack_flag != 0);
 
+  if( fTrackFinderMethod < 0 || fTrackFinderMethod > 1 ){
+    std::cout << "Warning in [" << GetName() << "::ReadDatabase]: unknown track finder method " << fTrackFinderMethod
+	      << ", using combinatorial search" << std::endl;
+    fTrackFinderMethod = 0;
+  }
+
   fUseSlopeConstraint = (useslopeconstraint != 0 );
   
   //std::cout << "pedestal file name = " << fpedfilename << std::endl;
@@ -435,18 +450,14 @@ Int_t SBSGEMSpectrometerTracker::Decode(const THaEvData& evdata ){
 
   //Int_t stripcounter = 0;
   for( auto& module: fModules ) {
-
     module->SetTriggerTime( fTrigTime );
-    
-    module->Decode(evdata);
-
-    //std::cout << "Decoding module " << (*it)->GetName() << ", nstrips fired = " << (*it)->fNstrips_hit << std::endl;
-
-
-    //stripcounter += module->fNstrips_hit;
-    //std::cout << "done..." << std::endl;
   }
 
+  //The modules decode independently of each other (in parallel if fNthreads > 1):
+  ForEachModule( [this,&evdata]( int imodule ){
+    fModules[imodule]->Decode( evdata );
+  } );
+
   //std::cout << "done, fNstrips_hit = " << stripcounter << std::endl;
   
   return 0;
@@ -650,6 +661,8 @@ Int_t SBSGEMSpectrometerTracker::DefineVariables( EMode mode ){
     { "trigtime", "trigger time (ns)", "fTrigTime" },
     { "track.ntrack", "number of tracks found", "fNtracks_found" },
     { "track.nhits", "number of hits on track", "fNhitsOnTrack" },
+    { "track.ncombos", "number of hit combinations tested", "fNcombosTested" },
+    { "track.skipped", "1 = tracking skipped (too many hit combinations), 2 = CA search truncated (too many cells/candidates)", "fTrackingSkipped" },
     { "track.x", "Track X (TRANSPORT)", "fXtrack" }, //might be redundant with spectrometer variables, but probably needed for "non-tracking" version
     { "track.y", "Track Y (TRANSPORT)", "fYtrack" },
     { "track.xp", "Track dx/dz (TRANSPORT)", "fXptrack" },
@@ -7,13 +7,100 @@
 #include "TClonesArray.h"
 //#include "THaTrack.h"
 #include "TSystem.h"
+#include "TROOT.h"
 #include <sstream>
 #include <iomanip>
 #include <cstdlib>
+#include <algorithm>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 #include "Helper.h"
 
 using namespace std;
 
+//Fork-join worker pool for ForEachModule. The threads are started on first use and then sleep between events. The pool is
+//shared by all GEM trackers and has enough threads for the largest nthreads, but each call of Run only lets the first
+//nthreads-1 of them take tasks; the calling thread also works on the tasks, so nthreads threads are busy in total. Tasks
+//are handed out one at a time, which is fine since each task is the decoding or clustering of a whole module:
+class SBSGEMWorkerPool {
+public:
+  SBSGEMWorkerPool() : fStop(false), fTask(nullptr), fNtasks(0), fNextTask(0), fNdone(0), fNworkers(0) {}
+  
+  ~SBSGEMWorkerPool(){
+    {
+      std::lock_guard<std::mutex> lock( fMutex );
+      fStop = true;
+    }
+    fWake.notify_all();
+    for( auto &thr : fThreads ) thr.join();
+  }
+
+  void Reserve( int nthreads ){
+    std::lock_guard<std::mutex> lock( fMutex );
+    while( (int) fThreads.size() < nthreads - 1 ){
+      fThreads.emplace_back( &SBSGEMWorkerPool::WorkerLoop, this, int(fThreads.size()) );
+    }
+  }
+
+  //Run task( itask ) for itask = 0...ntasks-1 on at most nthreads threads (including the calling thread):
+  void Run( int ntasks, const std::function<void(int)> &task, int nthreads ){
+    std::unique_lock<std::mutex> lock( fMutex );
+    fTask = &task;
+    fNtasks = ntasks;
+    fNextTask = 0;
+    fNdone = 0;
+    fNworkers = std::min( nthreads - 1, (int) fThreads.size() );
+    lock.unlock();
+    fWake.notify_all();
+
+    lock.lock();
+    while( fNextTask < fNtasks ){
+      int itask = fNextTask++;
+      lock.unlock();
+      task( itask );
+      lock.lock();
+      fNdone++;
+    }
+    fDone.wait( lock, [this]{ return fNdone == fNtasks; } );
+
+    fTask = nullptr;
+    fNtasks = 0;
+    fNextTask = 0;
+    fNworkers = 0;
+  }
+  
+private:
+  void WorkerLoop( int iworker ){
+    std::unique_lock<std::mutex> lock( fMutex );
+    while( true ){
+      //workers beyond the limit of the current Run keep sleeping:
+      fWake.wait( lock, [this,iworker]{ return fStop || ( iworker < fNworkers && fNextTask < fNtasks ); } );
+      if( fStop ) return;
+
+      int itask = fNextTask++;
+      const std::function<void(int)> *task = fTask;
+      lock.unlock();
+      (*task)( itask );
+      lock.lock();
+      if( ++fNdone == fNtasks ) fDone.notify_all();
+    }
+  }
+  
+  std::vector<std::thread> fThreads;
+  std::mutex fMutex;
+  std::condition_variable fWake, fDone;
+  bool fStop;
+  const std::function<void(int)> *fTask;
+  int fNtasks, fNextTask, fNdone;
+  int fNworkers; //number of pool threads allowed to take tasks in the current Run
+};
+
+static SBSGEMWorkerPool &GetGEMWorkerPool(){
+  static SBSGEMWorkerPool pool;
+  return pool;
+}
+
 SBSGEMTrackerBase::SBSGEMTrackerBase(){ //Set default values of important parameters: 
   Clear();
 
@@ -38,6 +125,16 @@ SBSGEMTrackerBase::SBSGEMTrackerBase(){ //Set default values of important parame
   fMaxHitCombinations_Total = 1.e16;
   fTryFastTrack = true;
 
+  fTrackFinderMethod = 0; //default to the combinatorial search
+  fCA_MaxSlopeX = 0.0; //default to the slope constraint window
+  fCA_MaxSlopeY = 0.0;
+  fCA_MaxKinkX = 0.02;
+  fCA_MaxKinkY = 0.02;
+  fCA_MaxCells = 1000000;
+  fCA_MaxCandidates = 100000;
+
+  fNthreads = 1; //default to serial module loops
+  
   //moved zero suppression/common-mode parameters to module class
   //  fOnlineZeroSuppression = false;
   // fZeroSuppress = true;
@@ -59,6 +156,9 @@ SBSGEMTrackerBase::SBSGEMTrackerBase(){ //Set default values of important parame
   fTrackChi2CutHitQuality.resize(1,100.0);
 
   fSigma_hitpos = 0.0001; //100 um
+  fSigma_hitpos_1strip = 0.0; //default: all hits get equal weight in the track fit
+
+  fFitNhitsLast = 0;
 
   fMultiTrackSearch = false;
 
@@ -166,6 +266,8 @@ void SBSGEMTrackerBase::Clear(){ //Clear out any event-specific stuff
   //Don't clear constraint widths for "theta" and "phi" as
   
   fNtracks_found = 0;
+  fNcombosTested = 0;
+  fTrackingSkipped = 0;
   fNhitsOnTrack.clear();
   fNgoodhitsOnTrack.clear();
   fModListTrack.clear();
@@ -509,6 +611,65 @@ void SBSGEMTrackerBase::CompleteInitialization(){
   binswithfreehits_layer.resize( fNlayers );
 
   freehitlist_goodxy.resize( fNlayers );
+
+  // flat hit arrays used by the track fitting routines: the per-hit arrays are sized event-by-event in InitHitList
+  fFlatHitOffset.resize( fNlayers );
+  fComboHits.resize( fNlayers );
+
+  fFitSums.resize( fNlayers+1 );
+  fFitComboLast.resize( fNlayers );
+  fFitNhitsLast = 0;
+
+  // The module loops of the decoding and hit reconstruction can run on several threads; ROOT needs to know before any
+  // other thread uses it. The worker pool is static and shared by all GEM trackers: it grows to the largest fNthreads
+  // requested by any of them, but each tracker only runs its module loops on fNthreads threads (see ForEachModule):
+  if( fNthreads > 1 ){
+    ROOT::EnableThreadSafety();
+    GetGEMWorkerPool().Reserve( fNthreads );
+  }
+  
+  // Build the channel lookup table for all modules. The modules only get the pointer once the table is complete, since
+  // filling it can reallocate:
+  fChannelLUT.clear();
+  for( int imod=0; imod<fNmodules; imod++ ){
+    fModules[imod]->FillChannelLUT( fChannelLUT, imod );
+  }
+  for( int imod=0; imod<fNmodules; imod++ ){
+    fModules[imod]->fChannelLUT = fChannelLUT.empty() ? nullptr : fChannelLUT.data();
+  }
+  
+  // Precompute the projection of global coordinates into the U/V strip coordinates of each module. The transformation from global
+  // to local coordinates is affine, so the images of the unit vectors give us the coefficients:
+  fModuleProjection.resize( fNmodules );
+  for( int imod=0; imod<fNmodules; imod++ ){
+    SBSGEMModule *mod = fModules[imod];
+    gemmodproj_t &proj = fModuleProjection[imod];
+
+    TVector3 origin = mod->GetOrigin();
+    TVector3 zaxis = mod->GetZax();
+
+    proj.x0 = origin.X();
+    proj.y0 = origin.Y();
+    proj.z0 = origin.Z();
+    proj.nx = zaxis.X();
+    proj.ny = zaxis.Y();
+    proj.nz = zaxis.Z();
+
+    TVector3 ex_local = mod->TrackToDetCoord( origin + TVector3(1,0,0) );
+    TVector3 ey_local = mod->TrackToDetCoord( origin + TVector3(0,1,0) );
+    TVector3 ez_local = mod->TrackToDetCoord( origin + TVector3(0,0,1) );
+
+    TVector2 UVx = mod->XYtoUV( TVector2( ex_local.X(), ex_local.Y() ) );
+    TVector2 UVy = mod->XYtoUV( TVector2( ey_local.X(), ey_local.Y() ) );
+    TVector2 UVz = mod->XYtoUV( TVector2( ez_local.X(), ez_local.Y() ) );
+
+    proj.ux = UVx.X();
+    proj.uy = UVy.X();
+    proj.uz = UVz.X();
+    proj.vx = UVx.Y();
+    proj.vy = UVy.Y();
+    proj.vz = UVz.Y();
+  }
   
   for( int ilayer=0; ilayer<fNlayers; ilayer++ ){
     int ngridbins = fGridNbinsX_layer[ilayer]*fGridNbinsY_layer[ilayer];
@@ -1000,6 +1161,20 @@ Double_t SBSGEMTrackerBase::InitHitList(){
   layerswithfreehits.clear();
 
   Double_t ncombos_all_layers=1;
+
+  int nhits_flat = 0; //running total of the sizes of the per-layer sections of the flat hit arrays
+
+  fFitNhitsLast = 0; //the flat hit arrays are about to change, so the incremental fit sums are no longer valid
+
+  //Clear the hit lists by 1D cluster (the inner arrays keep their capacity from one event to the next):
+  fHitListByUclust.resize( fNmodules );
+  fHitListByVclust.resize( fNmodules );
+  for( int imod=0; imod<fNmodules; imod++ ){
+    fHitListByUclust[imod].resize( fModules[imod]->fNclustU );
+    fHitListByVclust[imod].resize( fModules[imod]->fNclustV );
+    for( auto &hitlist : fHitListByUclust[imod] ) hitlist.clear();
+    for( auto &hitlist : fHitListByVclust[imod] ) hitlist.clear();
+  }
   
   for( int layer=0; layer<fNlayers; layer++ ){
 
@@ -1023,6 +1198,26 @@ Double_t SBSGEMTrackerBase::InitHitList(){
     gridbinhit2D[layer].resize( n2Dhits_tot );
 
     freehitlist_layer[layer].resize( n2Dhits_tot );
+
+    //reserve a section of n2Dhits_tot entries for this layer in the flat hit arrays (these never shrink, so
+    //once the arrays have reached their maximum size there is no reallocation here):
+    fFlatHitOffset[layer] = nhits_flat;
+    nhits_flat += n2Dhits_tot;
+    if( (int) fFlatHitModule.size() < nhits_flat ){
+      fFlatHitModule.resize( nhits_flat );
+      fFlatHitXg.resize( nhits_flat );
+      fFlatHitYg.resize( nhits_flat );
+      fFlatHitZg.resize( nhits_flat );
+      fFlatHitU.resize( nhits_flat );
+      fFlatHitV.resize( nhits_flat );
+      fFlatHitTrel.resize( nhits_flat );
+      fFlatHitTweight.resize( nhits_flat );
+      fFlatHitTcorr.resize( nhits_flat );
+      fFlatHitTcorrSigma.resize( nhits_flat );
+      fFlatHitChi2UV.resize( nhits_flat );
+      fFlatHitHighQuality.resize( nhits_flat );
+      fFlatHitWeight.resize( nhits_flat );
+    }
     
     N2Dhits_layer[layer] = 0;
     Nfreehits_layer[layer] = 0;
@@ -1060,6 +1255,11 @@ Double_t SBSGEMTrackerBase::InitHitList(){
 	  int binxytemp = GetGridBin( module, ihit );
 
 	  gridbinhit2D[layer][ngoodhits] = binxytemp; 
+
+	  FillFlatHit( fFlatHitOffset[layer] + ngoodhits, module, ihit );
+
+	  fHitListByUclust[module][hittemp.iuclust].push_back( ngoodhits );
+	  fHitListByVclust[module][hittemp.ivclust].push_back( ngoodhits );
 	  
 	  if( binxytemp >= 0 && binxytemp < ngridbins ){
 	    //int nhitsbin = Nfreehits_binxy_layer[layer][binxytemp];
@@ -1123,6 +1323,67 @@ Double_t SBSGEMTrackerBase::InitHitList(){
   
 }
 
+//Copy everything the track fitting routines need to know about one hit into the flat hit arrays. The hit time and
+//hit quality variables depend on the clustering and timing cut flags of the module, so this choice is made only once here:
+void SBSGEMTrackerBase::FillFlatHit( int ihitflat, int module, int clustidx ){
+  SBSGEMModule *mod = fModules[module];
+  const sbsgemhit_t &hit = mod->fHits[clustidx];
+
+  fFlatHitModule[ihitflat] = module;
+  fFlatHitXg[ihitflat] = hit.xghit;
+  fFlatHitYg[ihitflat] = hit.yghit;
+  fFlatHitZg[ihitflat] = hit.zghit;
+  fFlatHitU[ihitflat] = hit.uhit;
+  fFlatHitV[ihitflat] = hit.vhit;
+  fFlatHitHighQuality[ihitflat] = hit.highquality ? 1 : 0;
+
+  fFlatHitWeight[ihitflat] = 1.0;
+  if( fSigma_hitpos_1strip > 0.0 &&
+      ( mod->fUclusters[hit.iuclust].nstrips <= 1 || mod->fVclusters[hit.ivclust].nstrips <= 1 ) ){
+    fFlatHitWeight[ihitflat] = pow( fSigma_hitpos/fSigma_hitpos_1strip, 2 );
+  }
+
+  int cflag = mod->fClusteringFlag;
+  int tcuts = mod->fUseStripTimingCuts;
+
+  //Inputs for CalcTrackT0:
+  double tavg0 = 0.5*(mod->fHitTimeMean[0]+mod->fHitTimeMean[1]);
+  double tavg = hit.thit;
+  double tsigma = 0.5*(mod->fHitTimeSigma[0]+mod->fHitTimeSigma[1]);
+
+  //Inputs for CalcTrackChi2HitQuality:
+  double tdiff = hit.tdiff;
+  double dtsigma = mod->fTimeCutUVsigma;
+  double ADCasym = hit.ADCasym;
+
+  if( cflag == 1 ){
+    tavg0 = 0.5*(mod->fHitTimeMeanDeconv[0]+mod->fHitTimeMeanDeconv[1]);
+    tavg = hit.thitDeconv;
+    tsigma = 0.5*(mod->fHitTimeSigmaDeconv[0]+mod->fHitTimeSigmaDeconv[1]);
+
+    tdiff = hit.tdiffDeconv;
+    dtsigma = mod->fTimeCutUVsigmaDeconv;
+    ADCasym = hit.ADCasymDeconv;
+  }
+
+  if( cflag != 1 && tcuts == 2 ){
+    tavg0 = 0.5*(mod->fHitTimeMeanFit[0]+mod->fHitTimeMeanFit[1]);
+    tavg = hit.thitFit;
+    tsigma = 0.5*(mod->fHitTimeSigmaFit[0]+mod->fHitTimeSigmaFit[1]);
+
+    tdiff = hit.tdiffFit;
+    dtsigma = mod->fTimeCutUVsigmaFit;
+  }
+
+  fFlatHitTrel[ihitflat] = tavg - tavg0;
+  fFlatHitTweight[ihitflat] = pow(tsigma,-2);
+
+  //The part of the hit quality chi2 that does not depend on the track t0:
+  fFlatHitChi2UV[ihitflat] = pow( tdiff/dtsigma, 2 ) + pow( ADCasym/mod->fADCasymSigma, 2 );
+  fFlatHitTcorr[ihitflat] = hit.thitcorr; //Use corrected time!
+  fFlatHitTcorrSigma[ihitflat] = mod->fSigmaHitTimeAverageCorrected;
+}
+
 Double_t SBSGEMTrackerBase::InitFreeHitList(){
   //We should clear these things out at the beginning of each iteration just in case:
   layerswithfreehits.clear();
@@ -1223,6 +1484,60 @@ Double_t SBSGEMTrackerBase::InitFreeHitList(){
   return Ncombos;
 }
 
+Double_t SBSGEMTrackerBase::UpdateFreeHitList(){
+  //The free hit lists themselves were updated by PurgeHits; reset what the track search uses as work space, as InitFreeHitList does:
+  freehitcounter.clear();
+  layerswithfreehits_goodxy.clear();
+  for( int ilayer=0; ilayer<fNlayers; ilayer++ ){
+    freehitlist_goodxy[ilayer].clear();
+  }
+
+  Double_t Ncombos=1.0;
+  for( auto ilay = layerswithfreehits.begin(); ilay != layerswithfreehits.end(); ++ilay ){
+    freehitcounter[*ilay] = 0;
+    Ncombos *= Nfreehits_layer[*ilay];
+  }
+
+  return Ncombos;
+}
+
+void SBSGEMTrackerBase::RemoveFreeHit( int layer, int ihit ){
+  //The free hit lists are sorted by hit list index (that is the order in which InitFreeHitList fills them), so we can find the
+  //hit by bisection. Removing it keeps the order, so the lists are exactly what InitFreeHitList would produce:
+  std::vector<int> &freelist = freehitlist_layer[layer];
+  auto last = freelist.begin() + Nfreehits_layer[layer];
+  auto pos = std::lower_bound( freelist.begin(), last, ihit );
+  if( pos == last || *pos != ihit ) return; //already removed
+
+  std::copy( pos+1, last, pos );
+  if( --Nfreehits_layer[layer] == 0 ) layerswithfreehits.erase( layer );
+
+  int binxy = gridbinhit2D[layer][ihit];
+  if( binxy >= 0 && binxy < fGridNbinsX_layer[layer]*fGridNbinsY_layer[layer] ){
+    std::vector<int> &binlist = freehitlist_binxy_layer[layer][binxy];
+    auto binlast = binlist.begin() + Nfreehits_binxy_layer[layer][binxy];
+    auto binpos = std::lower_bound( binlist.begin(), binlast, ihit );
+    if( binpos != binlast && *binpos == ihit ){
+      std::copy( binpos+1, binlast, binpos );
+      if( --Nfreehits_binxy_layer[layer][binxy] == 0 ) binswithfreehits_layer[layer].erase( binxy );
+    }
+  }
+}
+
+void SBSGEMTrackerBase::ForEachModule( const std::function<void(int)> &task ){
+  if( fNthreads <= 1 || fNmodules <= 1 ){
+    for( int imodule=0; imodule<fNmodules; imodule++ ) task( imodule );
+    return;
+  }
+
+  GetGEMWorkerPool().Run( fNmodules, task, fNthreads );
+}
+
+void SBSGEMTrackerBase::UpdateRunningState( const THaEvData &evdata ){
+  //The modules only touch their own state, so this can be distributed like the decoding:
+  ForEachModule( [this,&evdata]( int imodule ){ fModules[imodule]->UpdateRunningState( evdata ); } );
+}
+
 void SBSGEMTrackerBase::hit_reconstruction(){
 
   //  std::cout << "Starting hit reconstruction..." << std::endl;
@@ -1248,7 +1563,9 @@ void SBSGEMTrackerBase::hit_reconstruction(){
   //Loop over all the GEM modules and invoke their cluster-finding methods with search region constraints:
   // To allow for the possibility of using multiple constraint points, we'll need to make some minor modifications in how find_2Dhits
   // operates for GEM modules.
-  for( int imodule=0; imodule<fNmodules; imodule++ ){
+  // The modules are independent of each other up to the layer statistics, so (if fNthreads > 1) they are processed in parallel,
+  // and the statistics are summed afterwards:
+  ForEachModule( [this]( int imodule ){
     SBSGEMModule *mod = fModules[imodule];
 
     //std::cout << "Calling hit reconstruction for module " << mod->GetName() << std::endl;
@@ -1312,6 +1629,10 @@ void SBSGEMTrackerBase::hit_reconstruction(){
     } //end if block on fUseConstraint
     
     mod->find_2Dhits();
+  } );
+
+  for( int imodule=0; imodule<fNmodules; imodule++ ){
+    SBSGEMModule *mod = fModules[imodule];
     
     //now fill the strip, 1D cluster and 2D hit statistics by layer and/or module:
     // "did hit" and "should hit" cannot be computed until after tracking:
@@ -1404,6 +1725,7 @@ void SBSGEMTrackerBase::find_tracks(){
     //std::cout << "[SBSGEMTrackerBase::find_tracks]: nhitsrequired = " << nhitsrequired << endl;
 
     bool foundtrack = false;
+    bool firstiteration = true;
     
     while( nhitsrequired >= fMinHitsOnTrack ){ //as long as the current minimum hit requirement exceeds the minimum hits to define a track, we look for more tracks with
       // nhitsrequired hits:
@@ -1418,12 +1740,16 @@ void SBSGEMTrackerBase::find_tracks(){
 
       //This happens once per track-finding iteration: if any tracks were found on the previous iteration, then their hits (and any others sharing the same 1D U or V clusters)
       //will have been marked as used, reducing the number of "available" hits for finding additional tracks:
-      Double_t Ncombos_free = InitFreeHitList(); 
+      Double_t Ncombos_free = firstiteration ? InitFreeHitList() : UpdateFreeHitList();
+      firstiteration = false;
 
-      if( Ncombos_free > fMaxHitCombinations_Total ){
+      //The total combinations limit only applies to the combinatorial search; the cellular automaton has its own limits on the number of
+      //cells and candidates (fCA_MaxCells, fCA_MaxCandidates):
+      if( fTrackFinderMethod == 0 && Ncombos_free > fMaxHitCombinations_Total ){
       	std::cout << "Warning in [SBSGEMTrackerBase::find_tracks]: total potential hit combinations = "
       		  << Ncombos_free << ", exceeds user maximum of " << fMaxHitCombinations_Total
       		  << ", skipping tracking..." << std::endl;
+	fTrackingSkipped = 1;
       	break;
       }
       
@@ -1468,8 +1794,17 @@ void SBSGEMTrackerBase::find_tracks(){
 	vector<double> uresidbest, vresidbest;
 
 	//How should we implement the possibility of multiple constraint points here? Probably right HERE is the best place to add a loop over constraint points? 
+
+	//With the cellular automaton, the loop over layer combinations below is skipped entirely:
+	unsigned int nlayercombos = fLayerCombinations[nhitsrequired].size();
+	if( fTrackFinderMethod == 1 ){
+	  find_track_candidates_CA( nhitsrequired, mingoodhits, chi2cut_hits_temp, firstgoodcombo, besthitcombo, minchi2,
+				    chi2space_bestcombo, chi2hits_bestcombo, t0track_bestcombo, besttrack, uresidbest, vresidbest );
+	  //Too many cells or candidates only truncates the search (fTrackingSkipped = 2); whatever was found is still used:
+	  nlayercombos = 0;
+	}
 	
-	for( unsigned int icombo=0; icombo<fLayerCombinations[nhitsrequired].size(); icombo++ ){
+	for( unsigned int icombo=0; icombo<nlayercombos; icombo++ ){
 
 	  // std::cout << "layer combo index, list of layers = "
 	  // 	    << icombo << ", ";
@@ -1994,7 +2329,11 @@ void SBSGEMTrackerBase::find_tracks(){
 		    
 			double chi2ndftemp, t0temp = 0.0;
 
-			int nhighQhits = CountHighQualityHits( hitcombo );
+			//the fit routines below use the flat hit arrays:
+
+			int ncombohits = LoadHitCombo( hitcombo );
+
+			int nhighQhits = CountHighQualityHits( fComboHits.data(), ncombohits );
 			//This declaration might shadow another one up above
 			//(actually it DOESN'T: the ones above are for the "best" hit combo, these are temporary dummy variables. Proceed)
 
@@ -2010,20 +2349,20 @@ void SBSGEMTrackerBase::find_tracks(){
 			  
 			  //Fit a track to the current hit combination:
 			  //NOTE: the FitTrack method computes the line of best fit and chi2 and gives us the hit residuals:
-			  FitTrack( hitcombo, xtrtemp, ytrtemp, xptrtemp, yptrtemp, chi2ndftemp, uresidtemp, vresidtemp );
+			  FitTrack( fComboHits.data(), ncombohits, xtrtemp, ytrtemp, xptrtemp, yptrtemp, chi2ndftemp, uresidtemp, vresidtemp );
 			  
 			  double chi2enhanced = chi2ndftemp; 
 			
 			  if( fUseEnhancedChi2 >= 2 ){ //Use sum of hit chi2 and spatial chi2 as criterion for best hit candidate selection
 			    double chi2space = chi2ndftemp * (2.0*hitcombo.size() - 4.0);
-			    double chi2hits = (3.0*hitcombo.size() + 1.0 ) * CalcTrackChi2HitQuality( hitcombo, t0temp );
+			    double chi2hits = (3.0*hitcombo.size() + 1.0 ) * CalcTrackChi2HitQuality( fComboHits.data(), ncombohits, t0temp );
 			    double ndftot = 5.0*hitcombo.size() + 1.0 - 4.0;
 			    chi2enhanced = (chi2space + chi2hits)/ndftot;
 			  }
 
 			  bool validcombo = true;
 			  if( fUseEnhancedChi2 == 1 ){
-			    validcombo = CalcTrackChi2HitQuality( hitcombo, t0temp ) <= chi2cut_hits_temp;
+			    validcombo = CalcTrackChi2HitQuality( fComboHits.data(), ncombohits, t0temp ) <= chi2cut_hits_temp;
 			  }
 			  
 			  validcombo = validcombo && fabs( t0temp ) <= fCutTrackT0;
@@ -2038,7 +2377,7 @@ void SBSGEMTrackerBase::find_tracks(){
 			      minchi2 = chi2enhanced;
 			      
 			      chi2space_bestcombo = chi2ndftemp;
-			      chi2hits_bestcombo = CalcTrackChi2HitQuality( hitcombo, t0track_bestcombo );
+			      chi2hits_bestcombo = CalcTrackChi2HitQuality( fComboHits.data(), ncombohits, t0track_bestcombo );
 			      
 			      besthitcombo = hitcombo;
 
@@ -2057,6 +2396,7 @@ void SBSGEMTrackerBase::find_tracks(){
 			  }
 			  
 			  ncombostested++;
+			  fNcombosTested++;
 			} 
 			//clear hitcombo just so we start fresh each iteration of the loop: this is PROBABLY unnecessary, but safer than not doing so:
 			hitcombo.clear();
@@ -2077,17 +2417,16 @@ void SBSGEMTrackerBase::find_tracks(){
 			for( int khit=0; khit<(int)freehitlist_goodxy[layerk].size(); khit++ ){
 			  int hitk = freehitlist_goodxy[layerk][khit];
 			    
-			  int modk = modindexhit2D[layerk][hitk];
-			  int clustk = clustindexhit2D[layerk][hitk];
-			    
-			  //TVector3 hitposk = GetHitPosGlobal( modk, clustk );
-			    
-			  double uhitk = fModules[modk]->fHits[clustk].uhit;
-			  double vhitk = fModules[modk]->fHits[clustk].vhit;
+			  int kflat = fFlatHitOffset[layerk] + hitk;
 			    
-			  TVector2 UVprojtemp = GetUVTrack( modk, TrackPosTemp, TrackDirTemp );
+			  double uhitk = fFlatHitU[kflat];
+			  double vhitk = fFlatHitV[kflat];
+
+			  //project the straight line through the hits in minlayer and maxlayer (same as TrackPosTemp, TrackDirTemp):
+			  double utrackk, vtrackk;
+			  ProjectTrackUV( fFlatHitModule[kflat], xtrtemp, ytrtemp, xptrtemp, yptrtemp, utrackk, vtrackk );
 		      
-			  double resid2 = ( pow( uhitk - UVprojtemp.X(), 2 ) + pow( vhitk - UVprojtemp.Y(), 2 ) )/pow( fSigma_hitpos, 2 );
+			  double resid2 = ( pow( uhitk - utrackk, 2 ) + pow( vhitk - vtrackk, 2 ) )/pow( fSigma_hitpos, 2 );
 			    
 			  if( besthit < 0 || resid2 < minresid2 ){
 			    minresid2 = resid2;
@@ -2100,7 +2439,11 @@ void SBSGEMTrackerBase::find_tracks(){
 			
 		      double chi2ndftemp, t0temp = 0.0;
 
-		      int nhighQhits = CountHighQualityHits( hitcombo );
+		      //the fit routines below use the flat hit arrays:
+
+		      int ncombohits = LoadHitCombo( hitcombo );
+
+		      int nhighQhits = CountHighQualityHits( fComboHits.data(), ncombohits );
 		      
 		      int minhits = mingoodhits;
 		      if( hitcombo.size() == 3 ){
@@ -2111,21 +2454,21 @@ void SBSGEMTrackerBase::find_tracks(){
 			
 			vector<double> uresidtemp,vresidtemp;
 			
-			FitTrack( hitcombo, xtrtemp, ytrtemp, xptrtemp, yptrtemp, chi2ndftemp, uresidtemp, vresidtemp );
+			FitTrack( fComboHits.data(), ncombohits, xtrtemp, ytrtemp, xptrtemp, yptrtemp, chi2ndftemp, uresidtemp, vresidtemp );
 			
 			double chi2enhanced = chi2ndftemp;
 			
 			
 			if( fUseEnhancedChi2 >= 2 ){
 			  double chi2space = chi2ndftemp * (2.0*hitcombo.size()-4.0);
-			  double chi2hits = (3.0*hitcombo.size() + 1.0 )* CalcTrackChi2HitQuality( hitcombo, t0temp );
+			  double chi2hits = (3.0*hitcombo.size() + 1.0 )* CalcTrackChi2HitQuality( fComboHits.data(), ncombohits, t0temp );
 			  double ndftot = 5.0*hitcombo.size() + 1.0 -4.0;
 			  chi2enhanced = (chi2space + chi2hits)/ndftot;
 			}
 
 			bool validcombo = true;
 			if( fUseEnhancedChi2 == 1 ){
-			  validcombo = CalcTrackChi2HitQuality( hitcombo, t0temp ) <= chi2cut_hits_temp;
+			  validcombo = CalcTrackChi2HitQuality( fComboHits.data(), ncombohits, t0temp ) <= chi2cut_hits_temp;
 			}
 			
 			validcombo = validcombo && fabs( t0temp ) <= fCutTrackT0;
@@ -2137,7 +2480,7 @@ void SBSGEMTrackerBase::find_tracks(){
 			    besthitcombo = hitcombo;
 			    
 			    chi2space_bestcombo = chi2ndftemp;
-			    chi2hits_bestcombo = CalcTrackChi2HitQuality( hitcombo, t0track_bestcombo );
+			    chi2hits_bestcombo = CalcTrackChi2HitQuality( fComboHits.data(), ncombohits, t0track_bestcombo );
 			    
 			    besttrack[0] = xtrtemp;
 			    besttrack[1] = ytrtemp;
@@ -2152,6 +2495,7 @@ void SBSGEMTrackerBase::find_tracks(){
 		      }
 			
 		      ncombostested++;
+		      fNcombosTested++;
 		      
 		      hitcombo.clear();
 		      
@@ -2257,6 +2601,257 @@ void SBSGEMTrackerBase::find_tracks(){
 
 }
 
+void SBSGEMTrackerBase::find_track_candidates_CA( int nhitsrequired, int mingoodhits, double chi2cut_hits, bool &firstgoodcombo,
+						  std::map<int,int> &besthitcombo, double &minchi2, double &chi2space_best, double &chi2hits_best,
+						  double &t0track_best, std::vector<double> &besttrack,
+						  std::vector<double> &uresidbest, std::vector<double> &vresidbest ){
+  // Cellular automaton track candidate search. Instead of looping over all layer combinations and all hit pairs in the outermost layers,
+  // we do the following:
+  // 1. Build "cells" (two-hit segments) from pairs of free hits in layers close together in z, looking only in the grid bins of the
+  //    downstream layer that are compatible with the allowed range of track slopes (and the track search region constraint, if any)
+  // 2. Assign to each cell, in order of increasing z, a "state" equal to the number of cells in the longest chain of compatible cells
+  //    ending with it. Two cells are compatible ("neighbors") if they share a hit and their slopes differ by less than fCA_MaxKinkX(Y)
+  // 3. Starting from each cell that terminates a chain long enough to give nhitsrequired hits, follow the neighbors with the smallest
+  //    kink backward to build a hit combination, which is then fitted and tested exactly like in the combinatorial search.
+  // The number of cells grows roughly linearly with the number of hits for a given grid bin size and slope window, so this remains fast
+  // at high occupancy where the number of hit combinations explodes.
+
+  fCA_layers.clear();
+  for( auto ilay = layerswithfreehits.begin(); ilay != layerswithfreehits.end(); ++ilay ){
+    fCA_layers.push_back( *ilay );
+  }
+
+  //The layer index does not necessarily increase with z, so sort explicitly:
+  std::sort( fCA_layers.begin(), fCA_layers.end(), [this]( int a, int b ){ return fZavgLayer[a] < fZavgLayer[b]; } );
+
+  int nlayers_free = fCA_layers.size();
+  if( nlayers_free < nhitsrequired ) return;
+
+  //a cell may skip layers, but never more than the total number of layers that can be missing from the track:
+  int maxlayergap = nlayers_free - nhitsrequired;
+
+  if( (int) fCA_firstcell.size() < fNlayers ) fCA_firstcell.resize( fNlayers );
+
+  //reset the lists of cells ending on each hit:
+  for( int ilay=0; ilay<nlayers_free; ilay++ ){
+    int layer = fCA_layers[ilay];
+    fCA_firstcell[layer].assign( N2Dhits_layer[layer], -1 );
+  }
+
+  //The slope window sets the number of grid bins searched for each hit, so the cost of building the cells grows with its area. Use the
+  //slope constraint window unless a (wider) window was explicitly requested for the cellular automaton without the slope constraint:
+  double xpmin = fxpfpmin, xpmax = fxpfpmax;
+  double ypmin = fypfpmin, ypmax = fypfpmax;
+  if( !fUseSlopeConstraint ){
+    if( fCA_MaxSlopeX > 0.0 ){
+      xpmin = -fCA_MaxSlopeX;
+      xpmax = fCA_MaxSlopeX;
+    }
+    if( fCA_MaxSlopeY > 0.0 ){
+      ypmin = -fCA_MaxSlopeY;
+      ypmax = fCA_MaxSlopeY;
+    }
+  }
+
+  fCA_cells.clear();
+
+  //Beyond fCA_MaxCells, no more cells are created, but the hit combinations are still built from the cells we have:
+  bool celllimit = false;
+
+  // Steps 1 and 2: cells are created in order of increasing z of their upstream hit, so that all the cells ending on a given hit
+  // already exist (with their final state) when we create the cells starting from it:
+  for( int ilay=0; ilay<nlayers_free-1 && !celllimit; ilay++ ){
+    int layer1 = fCA_layers[ilay];
+
+    for( int jlay=ilay+1; jlay<nlayers_free && jlay<=ilay+1+maxlayergap && !celllimit; jlay++ ){
+      int layer2 = fCA_layers[jlay];
+
+      int offset1 = fFlatHitOffset[layer1]; //hit positions are taken from the flat hit arrays
+      int offset2 = fFlatHitOffset[layer2];
+
+      int nbinsx = fGridNbinsX_layer[layer2];
+      int nbinsy = fGridNbinsY_layer[layer2];
+      double xmin2 = fGridXmin_layer[layer2];
+      double ymin2 = fGridYmin_layer[layer2];
+
+      for( int khit=0; khit<Nfreehits_layer[layer1] && !celllimit; khit++ ){
+	int hit1 = freehitlist_layer[layer1][khit];
+
+	double x1 = fFlatHitXg[offset1+hit1];
+	double y1 = fFlatHitYg[offset1+hit1];
+	double z1 = fFlatHitZg[offset1+hit1];
+
+	//Range of grid bins in layer2 compatible with the slope window. The modules in a layer are not all at the same z, so
+	//add one bin on each side (plus the grid edge tolerance) in addition to the exact slope check below:
+	double dz = fZavgLayer[layer2] - z1;
+
+	int binxlo = std::max( 0, int( floor( (x1 + xpmin*dz - fGridEdgeToleranceX - xmin2)/fGridBinWidthX ) ) - 1 );
+	int binxhi = std::min( nbinsx-1, int( floor( (x1 + xpmax*dz + fGridEdgeToleranceX - xmin2)/fGridBinWidthX ) ) + 1 );
+	int binylo = std::max( 0, int( floor( (y1 + ypmin*dz - fGridEdgeToleranceY - ymin2)/fGridBinWidthY ) ) - 1 );
+	int binyhi = std::min( nbinsy-1, int( floor( (y1 + ypmax*dz + fGridEdgeToleranceY - ymin2)/fGridBinWidthY ) ) + 1 );
+
+	for( int biny=binylo; biny<=binyhi && !celllimit; biny++ ){
+	  for( int binx=binxlo; binx<=binxhi && !celllimit; binx++ ){
+	    int bin = binx + nbinsx*biny;
+
+	    for( int lhit=0; lhit<Nfreehits_binxy_layer[layer2][bin]; lhit++ ){
+	      int hit2 = freehitlist_binxy_layer[layer2][bin][lhit];
+
+	      double dzhits = fFlatHitZg[offset2+hit2] - z1;
+	      if( dzhits <= 0.0 ) continue;
+
+	      double xp = ( fFlatHitXg[offset2+hit2] - x1 )/dzhits;
+	      double yp = ( fFlatHitYg[offset2+hit2] - y1 )/dzhits;
+
+	      if( xp < xpmin || xp > xpmax || yp < ypmin || yp > ypmax ) continue;
+
+	      //coarse check of the straight line through the two hits against the track search region:
+	      if( fUseConstraint && !CheckConstraint( x1 - xp*z1, y1 - yp*z1, xp, yp, true ) ) continue;
+
+	      if( (int) fCA_cells.size() >= fCA_MaxCells ){
+		celllimit = true;
+		fTrackingSkipped = 2;
+		break;
+	      }
+
+	      CAcell_t cell;
+	      cell.layer1 = layer1;
+	      cell.hit1 = hit1;
+	      cell.layer2 = layer2;
+	      cell.hit2 = hit2;
+	      cell.xp = xp;
+	      cell.yp = yp;
+	      cell.state = 1;
+
+	      //Evolve the state of the new cell using its (already final) left neighbors:
+	      for( int icell = fCA_firstcell[layer1][hit1]; icell >= 0; icell = fCA_cells[icell].nextsameend ){
+		if( fabs( fCA_cells[icell].xp - xp ) <= fCA_MaxKinkX &&
+		    fabs( fCA_cells[icell].yp - yp ) <= fCA_MaxKinkY ){
+		  cell.state = std::max( cell.state, fCA_cells[icell].state + 1 );
+		}
+	      }
+
+	      //Add the new cell to the list of cells ending on hit2:
+	      cell.nextsameend = fCA_firstcell[layer2][hit2];
+	      fCA_firstcell[layer2][hit2] = fCA_cells.size();
+
+	      fCA_cells.push_back( cell );
+	    }
+	  }
+	}
+      }
+    }
+  }
+
+  // Step 3: build and test hit combinations from the chains of at least nhitsrequired-1 cells:
+  std::map<int,int> hitcombo;
+  vector<double> uresidtemp, vresidtemp;
+
+  int ncandidates = 0;
+
+  for( int icell=0; icell<(int)fCA_cells.size(); icell++ ){
+    if( fCA_cells[icell].state < nhitsrequired-1 ) continue;
+
+    //Each chain end gives one candidate (with a walk back of at most nhitsrequired-2 cells); a high-occupancy event can still give
+    //a very large number of them. Beyond fCA_MaxCandidates, keep the best combination among those already tested:
+    if( ++ncandidates > fCA_MaxCandidates ){
+      fTrackingSkipped = 2;
+      break;
+    }
+
+    hitcombo.clear();
+    hitcombo[fCA_cells[icell].layer2] = fCA_cells[icell].hit2;
+    hitcombo[fCA_cells[icell].layer1] = fCA_cells[icell].hit1;
+
+    int current = icell;
+    int ncellsneeded = nhitsrequired - 2; //number of additional cells (= hits) needed to complete the combination
+
+    while( ncellsneeded > 0 ){
+      const CAcell_t &cellcurrent = fCA_cells[current];
+      int bestneighbor = -1;
+      double minkink2 = 1.e20;
+
+      for( int jcell = fCA_firstcell[cellcurrent.layer1][cellcurrent.hit1]; jcell >= 0; jcell = fCA_cells[jcell].nextsameend ){
+	double dxp = fCA_cells[jcell].xp - cellcurrent.xp;
+	double dyp = fCA_cells[jcell].yp - cellcurrent.yp;
+	if( fCA_cells[jcell].state >= ncellsneeded && fabs( dxp ) <= fCA_MaxKinkX && fabs( dyp ) <= fCA_MaxKinkY ){
+	  double kink2 = pow( dxp/fCA_MaxKinkX, 2 ) + pow( dyp/fCA_MaxKinkY, 2 );
+	  if( bestneighbor < 0 || kink2 < minkink2 ){
+	    bestneighbor = jcell;
+	    minkink2 = kink2;
+	  }
+	}
+      }
+
+      if( bestneighbor < 0 ) break; //this should not happen given the definition of the cell state
+
+      hitcombo[fCA_cells[bestneighbor].layer1] = fCA_cells[bestneighbor].hit1;
+      current = bestneighbor;
+      ncellsneeded--;
+    }
+
+    if( (int) hitcombo.size() < nhitsrequired ) continue;
+
+    //From here on, the hit combination is tested exactly as in the combinatorial search:
+    int minhits = mingoodhits;
+    if( hitcombo.size() == 3 ){
+      minhits = std::max( 2, std::min( 3, mingoodhits ) );
+    }
+
+    int ncombohits = LoadHitCombo( hitcombo );
+
+    fNcombosTested++;
+
+    if( CountHighQualityHits( fComboHits.data(), ncombohits ) < minhits ) continue;
+
+    double xtrtemp, ytrtemp, xptrtemp, yptrtemp, chi2ndftemp, t0temp = 0.0;
+
+    FitTrack( fComboHits.data(), ncombohits, xtrtemp, ytrtemp, xptrtemp, yptrtemp, chi2ndftemp, uresidtemp, vresidtemp );
+
+    double chi2enhanced = chi2ndftemp;
+
+    if( fUseEnhancedChi2 >= 2 ){
+      double chi2space = chi2ndftemp * (2.0*hitcombo.size() - 4.0);
+      double chi2hits = (3.0*hitcombo.size() + 1.0 ) * CalcTrackChi2HitQuality( fComboHits.data(), ncombohits, t0temp );
+      double ndftot = 5.0*hitcombo.size() + 1.0 - 4.0;
+      chi2enhanced = (chi2space + chi2hits)/ndftot;
+    }
+
+    bool validcombo = true;
+    if( fUseEnhancedChi2 == 1 ){
+      validcombo = CalcTrackChi2HitQuality( fComboHits.data(), ncombohits, t0temp ) <= chi2cut_hits;
+    }
+
+    validcombo = validcombo && fabs( t0temp ) <= fCutTrackT0;
+
+    if( validcombo && fIsSpectrometerTracker && fUseOpticsConstraint ){
+      TVector3 TrackPosTemp( xtrtemp, ytrtemp, 0.0 );
+      TVector3 TrackDirTemp( xptrtemp, yptrtemp, 1.0 );
+      validcombo = PassedOpticsConstraint( TrackPosTemp, TrackDirTemp.Unit() );
+    }
+
+    if( validcombo && (firstgoodcombo || chi2enhanced < minchi2) ){
+      if( !fUseConstraint || CheckConstraint( xtrtemp, ytrtemp, xptrtemp, yptrtemp ) ){
+	firstgoodcombo = false;
+	minchi2 = chi2enhanced;
+
+	chi2space_best = chi2ndftemp;
+	chi2hits_best = CalcTrackChi2HitQuality( fComboHits.data(), ncombohits, t0track_best );
+
+	besthitcombo = hitcombo;
+
+	besttrack[0] = xtrtemp;
+	besttrack[1] = ytrtemp;
+	besttrack[2] = xptrtemp;
+	besttrack[3] = yptrtemp;
+
+	uresidbest = uresidtemp;
+	vresidbest = vresidtemp;
+      }
+    }
+  }
+}
+
 void SBSGEMTrackerBase::fill_good_hit_arrays() { //this gets called at the end of track-finding. 
   // fill information that will be written to the ROOT tree: this should never be called directly, but check whether tracking is already done
   // anyway, and if NOT, do the tracking:
@@ -2469,7 +3064,7 @@ void SBSGEMTrackerBase::fill_good_hit_arrays() { //this gets called at the end o
 	if( ismaxstrip ){ //for the max. strip, calculate corr. coeff with the cluster-summed ADC samples:
 	  ccor_temp = fModules[module]->CorrCoeff( ntimesamples,
 						   fModules[module]->fADCsamples[hitidx_i],
-						   uclustinfo->ADCsamples );
+						   uclustinfo->ADCsamples.data() );
 	} else { //for other strips, calculate corr. coeff. with the max strip:
 	  ccor_temp = fModules[module]->CorrCoeff( ntimesamples,
 						   fModules[module]->fADCsamples[hitidx_i],
@@ -2498,7 +3093,7 @@ void SBSGEMTrackerBase::fill_good_hit_arrays() { //this gets called at the end o
 	if( ismaxstrip ){
 	  ccor_temp = fModules[module]->CorrCoeff( ntimesamples,
 						   fModules[module]->fADCsamples[hitidx_i],
-						   vclustinfo->ADCsamples );
+						   vclustinfo->ADCsamples.data() );
 	} else {
 	  ccor_temp = fModules[module]->CorrCoeff( ntimesamples,
 						   fModules[module]->fADCsamples[hitidx_i],
@@ -2886,133 +3481,139 @@ void SBSGEMTrackerBase::fill_good_hit_arrays() { //this gets called at the end o
 
 
 
+//Copy a hit combination mapped by layer into the fixed-size array fComboHits (positions in the flat hit arrays, in order of increasing layer).
+//Returns the number of hits:
+int SBSGEMTrackerBase::LoadHitCombo( const std::map<int,int> &hitcombo ){
+  int nhits = 0;
+  for( auto ilayer=hitcombo.begin(); ilayer != hitcombo.end(); ++ilayer ){
+    fComboHits[nhits++] = fFlatHitOffset[ilayer->first] + ilayer->second;
+  }
+  return nhits;
+}
+
 //The next function determines the line of best fit through a combination of hits, without calculating residuals or chi2.
-// Note that these equations assume all hits are to be given equal weights. You will need a different function if you want to use different weights for different hits:
+// Hits are weighted by fFlatHitWeight (all equal unless sigmahitpos_1strip is set):
 void SBSGEMTrackerBase::CalcLineOfBestFit( const std::map<int,int> &hitcombo, double &xtrack, double &ytrack, double &xptrack, double &yptrack ){
-  double sumx = 0.0, sumy = 0.0, sumz = 0.0, sumxz = 0.0, sumyz = 0.0, sumz2 = 0.0;
-  
-  int nhits = 0;
+  int nhits = LoadHitCombo( hitcombo );
+  CalcLineOfBestFit( fComboHits.data(), nhits, xtrack, ytrack, xptrack, yptrack );
+}
+
+void SBSGEMTrackerBase::CalcLineOfBestFit( const int *combo, int nhits, double &xtrack, double &ytrack, double &xptrack, double &yptrack ){
+  //Weighted least-squares fit. The sums are kept in fFitSums[ihit] as running sums over hits ihit...nhits-1, so that
+  //we only need to redo the sums for the hits that changed since the last call, which in the odometer search is usually just one:
+  int nsame = 0; //number of hits at the end of the combination that are the same as last time
+
+  if( nhits == fFitNhitsLast ){
+    while( nsame < nhits && combo[nhits-1-nsame] == fFitComboLast[nhits-1-nsame] ) nsame++;
+  } else {
+    trackfitsums_t &sums0 = fFitSums[nhits];
+    sums0.sumw = sums0.sumx = sums0.sumy = sums0.sumz = sums0.sumxz = sums0.sumyz = sums0.sumz2 = 0.0;
+  }
   
-  for( auto ilayer=hitcombo.begin(); ilayer != hitcombo.end(); ++ilayer ){
-    int layer = ilayer->first;   //layer 
-    int hitidx = ilayer->second; //index in the "hit list" array
-    
-    //grab hit coordinates:
-    int module = modindexhit2D[layer][hitidx];
-    int clustidx = clustindexhit2D[layer][hitidx];
-    
-    TVector3 hitpos_global = GetHitPosGlobal( module, clustidx );
-    
+  for( int ihit=nhits-1-nsame; ihit>=0; ihit-- ){
+    int k = combo[ihit]; //position in the flat hit arrays
+
     //we don't use the u and v coordinates until the chi2 calculation, which comes later:
-    //double uhit = fModules[module]->fHits[clustidx].uhit;
-    //double vhit = fModules[module]->fHits[clustidx].vhit; 
-    
-    sumx += hitpos_global.X();
-    sumy += hitpos_global.Y();
-    sumz += hitpos_global.Z();
-    sumxz += hitpos_global.X()*hitpos_global.Z();
-    sumyz += hitpos_global.Y()*hitpos_global.Z();
-    sumz2 += pow(hitpos_global.Z(),2);
+    double w = fFlatHitWeight[k];
+    double xhit = fFlatHitXg[k];
+    double yhit = fFlatHitYg[k];
+    double zhit = fFlatHitZg[k];
+
+    const trackfitsums_t &prev = fFitSums[ihit+1];
+    trackfitsums_t &sums = fFitSums[ihit];
     
-    nhits++;
+    sums.sumw = prev.sumw + w;
+    sums.sumx = prev.sumx + w*xhit;
+    sums.sumy = prev.sumy + w*yhit;
+    sums.sumz = prev.sumz + w*zhit;
+    sums.sumxz = prev.sumxz + w*xhit*zhit;
+    sums.sumyz = prev.sumyz + w*yhit*zhit;
+    sums.sumz2 = prev.sumz2 + w*zhit*zhit;
+
+    fFitComboLast[ihit] = k;
   }
+
+  fFitNhitsLast = nhits;
+
+  const trackfitsums_t &S = fFitSums[0];
   
   //now compute line of best fit:
-  double denom = (sumz2 * nhits - pow(sumz,2) );
+  double denom = (S.sumz2 * S.sumw - pow(S.sumz,2) );
   
-  xptrack = (nhits*sumxz - sumx*sumz)/denom;
-  yptrack = (nhits*sumyz - sumy*sumz)/denom;
-  xtrack = (sumx * sumz2 - sumxz * sumz)/denom;
-  ytrack = (sumy * sumz2 - sumyz * sumz)/denom;
+  xptrack = (S.sumw*S.sumxz - S.sumx*S.sumz)/denom;
+  yptrack = (S.sumw*S.sumyz - S.sumy*S.sumz)/denom;
+  xtrack = (S.sumx * S.sumz2 - S.sumxz * S.sumz)/denom;
+  ytrack = (S.sumy * S.sumz2 - S.sumyz * S.sumz)/denom;
 }
 
 void SBSGEMTrackerBase::FitTrack( const std::map<int,int> &hitcombo, double &xtrack, double &ytrack, double &xptrack, double &yptrack, double &chi2ndf, vector<double> &uresid, vector<double> &vresid ){
+  int nhits = LoadHitCombo( hitcombo );
+  FitTrack( fComboHits.data(), nhits, xtrack, ytrack, xptrack, yptrack, chi2ndf, uresid, vresid );
+}
+
+void SBSGEMTrackerBase::FitTrack( const int *combo, int nhits, double &xtrack, double &ytrack, double &xptrack, double &yptrack, double &chi2ndf, vector<double> &uresid, vector<double> &vresid ){
 
   //calculation of the best-fit line through the points was moved to its own function, since sometimes we want to perform ONLY that step; e.g.,
   //when calculating "exclusive" residuals:
-  CalcLineOfBestFit( hitcombo, xtrack, ytrack, xptrack, yptrack );
+  CalcLineOfBestFit( combo, nhits, xtrack, ytrack, xptrack, yptrack );
 
   double chi2 = 0.0; 
 
   uresid.clear();
   vresid.clear();
-  
-  //I see no particularly good way to avoid looping over the hits again for the chi2 calculation:
-
-  for( auto ilayer=hitcombo.begin(); ilayer != hitcombo.end(); ++ilayer ){
-    int layer = ilayer->first;
-    int hitidx = ilayer->second;
-
-    int module = modindexhit2D[layer][hitidx];
-    int clustidx = clustindexhit2D[layer][hitidx];
 
-    double uhit = fModules[module]->fHits[clustidx].uhit;
-    double vhit = fModules[module]->fHits[clustidx].vhit;
+  //I see no particularly good way to avoid looping over the hits again for the chi2 calculation:
 
-    TVector3 TrackOrigin( xtrack, ytrack, 0.0 );
-    TVector3 TrackDirection( xptrack, yptrack, 1.0 );
-    TrackDirection = TrackDirection.Unit();
+  for( int ihit=0; ihit<nhits; ihit++ ){
+    int k = combo[ihit];
 
-    TVector2 UVtrack = GetUVTrack( module, TrackOrigin, TrackDirection ); 
+    double uhit = fFlatHitU[k];
+    double vhit = fFlatHitV[k];
 
-    double utrack = UVtrack.X();
-    double vtrack = UVtrack.Y();
+    double utrack, vtrack;
+    ProjectTrackUV( fFlatHitModule[k], xtrack, ytrack, xptrack, yptrack, utrack, vtrack );
 
     uresid.push_back( uhit - utrack );
     vresid.push_back( vhit - vtrack );
     
-    chi2 += pow( (uhit-utrack)/fSigma_hitpos, 2 ) + pow( (vhit-vtrack)/fSigma_hitpos, 2 );
+    chi2 += fFlatHitWeight[k] * ( pow( (uhit-utrack)/fSigma_hitpos, 2 ) + pow( (vhit-vtrack)/fSigma_hitpos, 2 ) );
   }
 
-  double ndf = double(2*hitcombo.size() - 4);
+  double ndf = double(2*nhits - 4);
 
   chi2ndf = chi2/ndf;
   
 }
 
 Double_t SBSGEMTrackerBase::CalcTrackT0( const std::map<int,int> &hitcombo ){
+  int nhits = LoadHitCombo( hitcombo );
+  return CalcTrackT0( fComboHits.data(), nhits );
+}
 
+Double_t SBSGEMTrackerBase::CalcTrackT0( const int *combo, int nhits ){
+
+  //The hit times, mean hit times and time resolutions appropriate to each module's clustering and timing cut flags are
+  //chosen once per event in FillFlatHit:
   double sumt = 0.0, sumw = 0.0;
   
-  for( auto ilayer=hitcombo.begin(); ilayer != hitcombo.end(); ++ilayer ){
-    int layer = ilayer->first;
-    int hitidx = ilayer->second;
-    int module = modindexhit2D[layer][hitidx];
-    int clustidx = clustindexhit2D[layer][hitidx];
-    
-    double tavg0 = 0.5*(fModules[module]->fHitTimeMean[0]+fModules[module]->fHitTimeMean[1]);
-    double tavg = fModules[module]->fHits[clustidx].thit;
-    double tsigma = 0.5*(fModules[module]->fHitTimeSigma[0]+fModules[module]->fHitTimeSigma[1]);
-
-    int cflag = fModules[module]->fClusteringFlag;
-    int tcuts = fModules[module]->fUseStripTimingCuts;
-    
-    if( cflag == 1 ){
-      tavg0 = 0.5*(fModules[module]->fHitTimeMeanDeconv[0]+fModules[module]->fHitTimeMeanDeconv[1]);
-      tavg = fModules[module]->fHits[clustidx].thitDeconv;
-      
-      tsigma = 0.5*(fModules[module]->fHitTimeSigmaDeconv[0]+fModules[module]->fHitTimeSigmaDeconv[1]);
-    }
-
-    if( cflag != 1 && tcuts == 2 ){
-      tavg0 = 0.5*(fModules[module]->fHitTimeMeanFit[0]+fModules[module]->fHitTimeMeanFit[1]);
-      tavg = fModules[module]->fHits[clustidx].thitFit;
-      tsigma = 0.5*(fModules[module]->fHitTimeSigmaFit[0]+fModules[module]->fHitTimeSigmaFit[1]);
-    }
-    
-    double weight = pow(tsigma,-2);
-    
-    sumt += (tavg-tavg0) * weight;
-    sumw += weight;
+  for( int ihit=0; ihit<nhits; ihit++ ){
+    int k = combo[ihit];
     
+    sumt += fFlatHitTrel[k] * fFlatHitTweight[k];
+    sumw += fFlatHitTweight[k];
   }
 
   return sumt/sumw;
 }
 
 Double_t SBSGEMTrackerBase::CalcTrackChi2HitQuality( const std::map<int,int> &hitcombo, Double_t &t0track ){
+  int nhits = LoadHitCombo( hitcombo );
+  return CalcTrackChi2HitQuality( fComboHits.data(), nhits, t0track );
+}
+
+Double_t SBSGEMTrackerBase::CalcTrackChi2HitQuality( const int *combo, int nhits, Double_t &t0track ){
 
-  t0track = CalcTrackT0( hitcombo );
+  t0track = CalcTrackT0( combo, nhits );
   
   double chi2 = 0.0;
 
@@ -3025,55 +3626,11 @@ Double_t SBSGEMTrackerBase::CalcTrackChi2HitQuality( const std::map<int,int> &hi
   
   
   // The chi2 calculation for hit quality has two (three) ingredients: hit time U/V difference, ADC correlation, and
-  // difference between hit average time and mean time:
-  for( auto ilayer=hitcombo.begin(); ilayer != hitcombo.end(); ++ilayer ){
-    int layer = ilayer->first;
-    int hitidx = ilayer->second;
-    int module = modindexhit2D[layer][hitidx];
-    int clustidx = clustindexhit2D[layer][hitidx];
+  // difference between hit average time and mean time. The first two don't depend on t0 and are precomputed in FillFlatHit:
+  for( int ihit=0; ihit<nhits; ihit++ ){
+    int k = combo[ihit];
 
-    int uclidx = fModules[module]->fHits[clustidx].iuclust;
-    int vclidx = fModules[module]->fHits[clustidx].ivclust;
-
-    //double tavg0 = 0.5*(fModules[module]->fHitTimeMean[0]+fModules[module]->fHitTimeMean[1]);
-    double tavg0 = 0.0;
-    double tavg = fModules[module]->fHits[clustidx].thitcorr; //Use corrected time!
-    //double tsigma = 0.5*(fModules[module]->fHitTimeSigma[0]+fModules[module]->fHitTimeSigma[1]);
-    double tsigma = fModules[module]->fSigmaHitTimeAverageCorrected;
-    
-    double tdiff = fModules[module]->fHits[clustidx].tdiff;
-    double dtsigma = fModules[module]->fTimeCutUVsigma;
-    
-    double ADCratio = fModules[module]->fVclusters[vclidx].clusterADCsum / fModules[module]->fUclusters[uclidx].clusterADCsum;
-    double ADCratio_sigma = fModules[module]->fADCratioSigma;
-
-    double ADCasym_sigma = fModules[module]->fADCasymSigma;
-    
-    double ADCasym = fModules[module]->fHits[clustidx].ADCasym;
-    
-    int cflag = fModules[module]->fClusteringFlag;
-    int tcuts = fModules[module]->fUseStripTimingCuts;
-
-    if( cflag == 1 ){
-      // tavg0 = 0.5*(fModules[module]->fHitTimeMeanDeconv[0]+fModules[module]->fHitTimeMeanDeconv[1]);
-      // tavg = fModules[module]->fHits[clustidx].thitDeconv;
-      tdiff = fModules[module]->fHits[clustidx].tdiffDeconv;
-      //tsigma = 0.5*(fModules[module]->fHitTimeSigmaDeconv[0]+fModules[module]->fHitTimeSigmaDeconv[1]);
-      dtsigma = fModules[module]->fTimeCutUVsigmaDeconv;
-      ADCratio = fModules[module]->fVclusters[vclidx].clusterADCsumDeconvMaxCombo/fModules[module]->fUclusters[uclidx].clusterADCsumDeconvMaxCombo;
-      ADCasym = fModules[module]->fHits[clustidx].ADCasymDeconv;
-    }
-
-    if( cflag != 1 && tcuts == 2 ){
-      // tavg0 = 0.5*(fModules[module]->fHitTimeMeanFit[0]+fModules[module]->fHitTimeMeanFit[1]);
-      // tavg = fModules[module]->fHits[clustidx].thitFit;
-      //tsigma = 0.5*(fModules[module]->fHitTimeSigmaFit[0]+fModules[module]->fHitTimeSigmaFit[1]);
-      tdiff = fModules[module]->fHits[clustidx].tdiffFit;
-      dtsigma = fModules[module]->fTimeCutUVsigmaFit;
-    }
-
-    chi2 += pow( tdiff/dtsigma, 2 ) + pow( (ADCasym)/ADCasym_sigma, 2 ) + pow( (tavg-tavg0-t0track)/tsigma, 2 );
-    
+    chi2 += fFlatHitChi2UV[k] + pow( (fFlatHitTcorr[k]-t0track)/fFlatHitTcorrSigma[k], 2 );
   }
 
   //The way t0track is calculated centers the "track time" at zero for tracks with "good" timing
@@ -3082,25 +3639,21 @@ Double_t SBSGEMTrackerBase::CalcTrackChi2HitQuality( const std::map<int,int> &hi
 
   
   //each hit contributes three dof:
-  double ndf = 3.0 * hitcombo.size() + 1;
+  double ndf = 3.0 * nhits + 1;
   return chi2/ndf;
   
 }
 
 Int_t SBSGEMTrackerBase::CountHighQualityHits( const std::map<int,int> &hitcombo ){
+  int nhits = LoadHitCombo( hitcombo );
+  return CountHighQualityHits( fComboHits.data(), nhits );
+}
+
+Int_t SBSGEMTrackerBase::CountHighQualityHits( const int *combo, int nhits ){
 
   Int_t nHighQualityHits = 0;
-  //For three-hit tracks, we require ALL three hits to be "high-quality" hits: 
-  //if( besthitcombo.size() == 3 ){
-  for( auto ilayer = hitcombo.begin(); ilayer != hitcombo.end(); ++ilayer ){
-    int layer = ilayer->first;
-    int hitidx = ilayer->second;
-	    
-    int module = modindexhit2D[layer][hitidx];
-    int iclust = clustindexhit2D[layer][hitidx];
-	    
-    if( fModules[module]->fHits[iclust].highquality ) nHighQualityHits++;
-	    
+  for( int ihit=0; ihit<nhits; ihit++ ){
+    nHighQualityHits += fFlatHitHighQuality[combo[ihit]];
   }
 
   return nHighQualityHits;
@@ -3256,8 +3809,8 @@ void SBSGEMTrackerBase::AddNewTrack( const std::map<int,int> &hitcombo, const ve
 }
 
 //The purpose of this routine is to mark all the 2D hits as used that contain any of the same 1D U/V clusters as the 2D hits on this track.
-//This routine accesses both the module hit arrays and the "hit list" arrays used by the track-finding. The loop over the entire 2D hit list in each layer
-//on the track at the end of each track-finding iteration is maybe a bit expensive, but still probably cheap compared to the alternative (and will lead to fewer false tracks)
+//This routine accesses both the module hit arrays and the "hit list" arrays used by the track-finding. It only visits the hits sharing a 1D cluster
+//with the track, and also updates the free hit lists for the next track-finding iteration, so the cost is proportional to the number of hits removed
 // The routine is designed to prevent re-use of the same 1D cluster in multiple tracks:
 void SBSGEMTrackerBase::PurgeHits( int itrack ){
   for( int ihit=0; ihit<fNhitsOnTrack[itrack]; ihit++ ){
@@ -3268,25 +3821,22 @@ void SBSGEMTrackerBase::PurgeHits( int itrack ){
     int uidx = fModules[module]->fHits[cluster].iuclust;
     int vidx = fModules[module]->fHits[cluster].ivclust;
 
-    // Next we need to loop on the 2D hit list of this layer (the one used for track-finding) and mark any unused hits containing the same 1D (U/V) clusters
-    // as the hits on this track as used:
-    for( int jhit = 0; jhit<N2Dhits_layer[layer]; jhit++ ){
-      int modj = modindexhit2D[layer][jhit];
-      int clustj = clustindexhit2D[layer][jhit];
-
-      if( modj == module ){
-	if( fPurgeHitsFlag == 0 ){
-	  if( clustj == cluster ){ //purge only the 2D hit in question
-	    hitused2D[layer][jhit] = true;
-	  }
-	} else { //purge all 2D hits containing either of the 1D clusters used to form this 2D hit candidate
-	  int uj = fModules[modj]->fHits[clustj].iuclust;
-	  int vj = fModules[modj]->fHits[clustj].ivclust;
+    // Mark any unused hits of this layer's 2D hit list (the one used for track-finding) containing the same 1D (U/V) clusters
+    // as the hits on this track as used, and take them out of the free hit lists for the next track-finding iteration.
+    // The hits containing a given 1D cluster are looked up directly in the lists by cluster filled by InitHitList:
+    for( int jhit : fHitListByUclust[module][uidx] ){
+      //With fPurgeHitsFlag == 0, purge only the 2D hit in question; otherwise purge all 2D hits containing either of the 1D clusters
+      //used to form this 2D hit candidate:
+      if( fPurgeHitsFlag != 0 || clustindexhit2D[layer][jhit] == cluster ){
+	hitused2D[layer][jhit] = true;
+	RemoveFreeHit( layer, jhit );
+      }
+    }
 
-	  if( uj == uidx || vj == vidx ){
-	    hitused2D[layer][jhit] = true;
-	  }
-	}
+    if( fPurgeHitsFlag != 0 ){
+      for( int jhit : fHitListByVclust[module][vidx] ){
+	hitused2D[layer][jhit] = true;
+	RemoveFreeHit( layer, jhit );
       }
     }
   }
@@ -3311,6 +3861,26 @@ TVector2 SBSGEMTrackerBase::GetUVTrack( int module, TVector3 track_origin, TVect
   return fModules[module]->XYtoUV( XYtrack );
 }
 
+void SBSGEMTrackerBase::ProjectTrackUV( int module, double xtrack, double ytrack, double xptrack, double yptrack, double &utrack, double &vtrack ) const {
+  const gemmodproj_t &proj = fModuleProjection[module];
+
+  //track position relative to the module origin at z = 0:
+  double dx = xtrack - proj.x0;
+  double dy = ytrack - proj.y0;
+  double dz = -proj.z0;
+
+  //path length parameter (along z) from z = 0 to the intersection with the module plane:
+  double s = -( proj.nx*dx + proj.ny*dy + proj.nz*dz )/( proj.nx*xptrack + proj.ny*yptrack + proj.nz );
+
+  //intersection point relative to the module origin:
+  dx += s*xptrack;
+  dy += s*yptrack;
+  dz += s;
+
+  utrack = proj.ux*dx + proj.uy*dy + proj.uz*dz;
+  vtrack = proj.vx*dx + proj.vy*dy + proj.vz*dz;
+}
+
 int SBSGEMTrackerBase::GetNearestModule( int layer, TVector3 track_origin, TVector3 track_direction, TVector3 &track_intersect ){
 
   int nearestmod = -1;
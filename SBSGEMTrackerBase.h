@@ -5,6 +5,7 @@
 #include <map>
 #include <set>
 #include <fstream>
+#include <functional>
 //#include "SBSGEMModule.h"
 #include "TVector3.h"
 #include "TVector2.h"
@@ -13,7 +14,7 @@
 
 //class THaRunBase;
 //class THaApparatus;
-//class THaEvData;
+class THaEvData;
 class SBSGEMModule;
 class TClonesArray;
 
@@ -23,6 +24,45 @@ class TClonesArray;
 //Instead, this class is only going to contain the common data members and methods needed by SBSGEMSpectrometerTracker and SBSGEMPolarimeterTracker, largely following the stand-alone clustering and track finding codes. The database reading and initialization will be taken care of by the derived classes: 
 //Base class for GEM tracking assembly (of either the "tracking" or "non-tracking" flavor)
 
+//One entry of the channel lookup table built by SBSGEMTrackerBase::CompleteInitialization. The table holds
+//fN_APV25_CHAN consecutive entries per APV card, in decode map order, and each decode map entry stores the offset of its
+//block (mpdmap_t::lut_offset), so (crate, slot, mpd, adc, channel) --> strip, pedestal, gain etc. is a single indexed load.
+//Each entry occupies exactly one cache line:
+struct alignas(64) sbsgemchanlut_t {
+  Double_t pedmean; //pedestal mean
+  Double_t pedrms;  //pedestal RMS
+  Double_t gain;    //gain-match coefficient of the APV card
+  Double_t cmmin;   //common-mode range of the APV card: mean -/+ commonmode_range_nsigma * RMS
+  Double_t cmmax;
+  Int_t strip;      //physical strip number along the axis
+  Int_t module;     //module index in the tracker
+  UShort_t pos;     //APV card position along the axis
+  UChar_t axis;     //SBSGEM::kUaxis or kVaxis
+};
+
+//Linear map from the global coordinates of a point to the U/V strip coordinates of a module, and the plane of the module,
+//used to project straight-line tracks into the strip frame without building TVector3 objects:
+struct gemmodproj_t {
+  double x0, y0, z0; //module origin (global)
+  double nx, ny, nz; //module plane normal (global)
+  double ux, uy, uz; //u = ux*(x-x0) + uy*(y-y0) + uz*(z-z0)
+  double vx, vy, vz; //v = vx*(x-x0) + vy*(y-y0) + vz*(z-z0)
+};
+
+//Running sums of the weighted least-squares normal equations of a straight-line fit:
+struct trackfitsums_t {
+  double sumw, sumx, sumy, sumz, sumxz, sumyz, sumz2;
+};
+
+//A "cell" of the cellular automaton track finder is a straight-line segment connecting two free hits in different layers:
+struct CAcell_t {
+  int layer1, hit1; //upstream hit: tracking layer and index in the (unchanging) layer hit list
+  int layer2, hit2; //downstream hit: tracking layer and index in the (unchanging) layer hit list
+  double xp, yp;    //slopes dx/dz and dy/dz of the segment
+  int state;        //number of cells in the longest chain of compatible cells ending with this one
+  int nextsameend;  //index of the next cell ending on the same hit (-1 if none)
+};
+
 
 class SBSGEMTrackerBase {
 public:
@@ -97,6 +137,8 @@ public:
   
   //Need to add some public "getter" and "setter" methods for the polarimeter-mode analysis:
   int GetNtracks() const { return fNtracks_found; }
+  int GetNcombosTested() const { return fNcombosTested; }
+  bool TrackingSkipped() const { return fTrackingSkipped != 0; }
   void GetTrack(int itrack, double &x, double &y, double &xp, double &yp);
   double GetXTrack( int itrack=0 ) const { return (itrack>=0&&itrack<fNtracks_found) ? fXtrack[itrack] : 1.e20; };
   double GetYTrack( int itrack=0 ) const { return (itrack>=0&&itrack<fNtracks_found) ? fYtrack[itrack] : 1.e20; };
@@ -141,6 +183,9 @@ public:
   //1D and 2D clustering (need to make this public): 
   void hit_reconstruction();
   bool ClusteringIsDone() const { return fclustering_done; }
+
+  //Update the run-level state of all modules from an event that is not analyzed (see SBSGEMModule::UpdateRunningState):
+  void UpdateRunningState( const THaEvData &evdata );
   
 protected:
   SBSGEMTrackerBase(); //only derived classes can construct me.
@@ -162,9 +207,21 @@ protected:
   //track-finding: 
   void find_tracks();
 
+  //Alternative candidate search for find_tracks() using a cellular automaton (fTrackFinderMethod == 1).
+  //Updates the "best" hit combination and track parameters in the same way as the combinatorial search:
+  void find_track_candidates_CA( int nhitsrequired, int mingoodhits, double chi2cut_hits, bool &firstgoodcombo,
+				 std::map<int,int> &besthitcombo, double &minchi2, double &chi2space_best, double &chi2hits_best,
+				 double &t0track_best, std::vector<double> &besttrack,
+				 std::vector<double> &uresidbest, std::vector<double> &vresidbest );
+
   // Fill arrays of "good" hits (hits that end up on fitted tracks)
   void fill_good_hit_arrays();
 
+  //Run task( imodule ) for all modules. With fNthreads > 1, the modules are distributed over a worker pool shared by all
+  //GEM trackers and the call returns when all of them are done. At most fNthreads threads (including the calling thread)
+  //work on the tasks, whatever the size of the pool. The task must only touch the state of its own module:
+  void ForEachModule( const std::function<void(int)> &task );
+
   //Utility methods: initialization:
   void CompleteInitialization(); //do some extra initialization that we want to reuse:
   void LoadPedestals(const char *fname);
@@ -179,6 +236,11 @@ protected:
   
   Double_t InitHitList(); //Initialize (unchanging) "hit list" arrays used by track-finding: this only happens at the beginning of tracking
   Double_t InitFreeHitList(); //Initialize "free hit list" arrays used on each track-finding iteration
+  //After the first track-finding iteration of an event, the free hit lists are kept up to date by PurgeHits (via RemoveFreeHit),
+  //so later iterations only reset the search arrays and recompute the number of free hit combinations:
+  Double_t UpdateFreeHitList();
+  void RemoveFreeHit( int layer, int ihit ); //remove hit ihit of the layer hit list from the free hit lists, if it is still there
+  void FillFlatHit( int ihitflat, int module, int clustidx ); //copy one hit into the flat hit arrays (called by InitHitList)
 
   //Retrieve the global position of a hit by module and hit index:
   TVector3 GetHitPosGlobal( int modidx, int clustidx );
@@ -190,6 +252,9 @@ protected:
 
   //Calculates the position of the track's intersection with a module in "module" coordinates U/V (the ones measured by the strips)
   TVector2 GetUVTrack( int module, TVector3 track_origin, TVector3 track_direction );
+
+  //Same as GetUVTrack, for a track given by its intercept (xtrack, ytrack) at z = 0 and slopes, using precomputed coefficients:
+  void ProjectTrackUV( int module, double xtrack, double ytrack, double xptrack, double yptrack, double &utrack, double &vtrack ) const;
   
   //Utility method to iterate over combinations of hits in layers, used by find_tracks()
   bool GetNextCombo( const std::set<int> &layers, std::map<int,int> &hitcounter, std::map<int,int> &hitcombo, bool &firstcombo );
@@ -207,6 +272,15 @@ protected:
   Double_t CalcTrackT0( const std::map<int,int> &hitcombo );
 
   Int_t CountHighQualityHits( const std::map<int,int> &hitcombo );
+
+  //Versions of the above taking a hit combination as an array of nhits positions in the flat hit arrays (see fFlatHitOffset),
+  //one hit per layer in order of increasing layer. These are used in the inner loops of the track search:
+  int LoadHitCombo( const std::map<int,int> &hitcombo ); //fill fComboHits from hitcombo, return the number of hits
+  void FitTrack( const int *combo, int nhits, double &xtrack, double &ytrack, double &xptrack, double &yptrack, double &chi2ndf, std::vector<double> &uresid, std::vector<double> &vresid );
+  void CalcLineOfBestFit( const int *combo, int nhits, double &xtrack, double &ytrack, double &xptrack, double &yptrack );
+  Double_t CalcTrackChi2HitQuality( const int *combo, int nhits, Double_t &t0track );
+  Double_t CalcTrackT0( const int *combo, int nhits );
+  Int_t CountHighQualityHits( const int *combo, int nhits );
   
   // routine to fit the best track to a set of hits, without the overhead of chi2 calculation, useful for "exclusive residuals" calculation:
   //void FitTrackNoChisquaredCalc( const std::map<int,int> &hitcombo, double &xtrack, double &ytrack, double &xptrack, double &yptrack );
@@ -254,6 +328,14 @@ protected:
   long fMaxHitCombinations_InnerLayers; //default = 10000?
   double fMaxHitCombinations_Total; //default = 100000000
   bool fTryFastTrack; //default = true?
+
+  int fTrackFinderMethod; //0 (default) = combinatorial search over layer combinations and grid bins; 1 = cellular automaton
+  double fCA_MaxSlopeX, fCA_MaxSlopeY; //cellular automaton only: max |dx/dz|, |dy/dz| of a cell when the slope constraint is not used; <= 0 (default) = use the slope constraint window xpfp_min...ypfp_max anyway
+  double fCA_MaxKinkX, fCA_MaxKinkY; //cellular automaton only: max difference in dx/dz, dy/dz between two linked cells
+  int fCA_MaxCells; //cellular automaton only: max number of cells per track-finding iteration; no more cells are created beyond this
+  int fCA_MaxCandidates; //cellular automaton only: max number of candidate hit combinations per track-finding iteration; no more are tested beyond this
+
+  int fNthreads; //number of threads for module-level decoding and hit reconstruction within one event; <= 1 (default) = serial, > 1 = use the shared worker pool (see ForEachModule)
   
   // The use of maps here instead of vectors may be slightly algorithmically inefficient, but it DOES guarantee that the maps are
   //  (a) sorted by increasing layer index, which, generally speaking, for a sensibly constructed database, will also be in ascending order of Z.
@@ -357,6 +439,7 @@ protected:
   //FP track cuts: 
   
   Double_t fSigma_hitpos;   //sigma parameter controlling resolution entering track chi^2 calculation
+  Double_t fSigma_hitpos_1strip; //(optional) resolution of hits with a single-strip U or V cluster; if > 0, these hits are de-weighted in the track fit
   
   //////////////////////////////////////////////////////////////////////////////////////////////////////////////////
   //            DATA members to hold the track information (at least temporarily, will eventually                 //
@@ -376,6 +459,31 @@ protected:
   std::vector<std::vector<int> > clustindexhit2D; //key = layer, mapped value = index of hits within 2D cluster array of module in question
   std::vector<std::vector<bool> > hitused2D; //flag to tell each track-finding iteration whether hit was already used in a previous track
   std::vector<std::vector<int> > gridbinhit2D;
+
+  //Flat "structure of arrays" copy of the hit list, filled once per event by InitHitList and used by the track fitting routines.
+  //Hit hitidx of the layer hit list above is found at position fFlatHitOffset[layer] + hitidx of each array:
+  std::vector<int> fFlatHitOffset; //by layer
+  std::vector<int> fFlatHitModule; //module index
+  std::vector<double> fFlatHitXg, fFlatHitYg, fFlatHitZg; //global hit coordinates
+  std::vector<double> fFlatHitU, fFlatHitV; //hit coordinates along the directions measured by the strips
+  std::vector<double> fFlatHitTrel, fFlatHitTweight; //hit time relative to the mean hit time of the module, and 1/sigma^2 (for CalcTrackT0)
+  std::vector<double> fFlatHitTcorr, fFlatHitTcorrSigma; //corrected hit time and its resolution (for CalcTrackChi2HitQuality)
+  std::vector<double> fFlatHitChi2UV; //t0-independent part of the hit quality chi2: U/V time difference and ADC asymmetry
+  std::vector<char> fFlatHitHighQuality;
+  std::vector<double> fFlatHitWeight; //weight of the hit in the track fit: (fSigma_hitpos/sigma of this hit)^2
+
+  std::vector<gemmodproj_t> fModuleProjection; //by module, filled in CompleteInitialization
+
+  //Channel lookup table shared by all modules during decoding, filled in CompleteInitialization (see sbsgemchanlut_t):
+  std::vector<sbsgemchanlut_t> fChannelLUT;
+
+  //Incremental track fit: during the odometer search, consecutive hit combinations differ only in a few layers, so we keep
+  //the normal-equation sums over hits i...nhits-1 of the last combination fitted and only redo the sums for the hits that changed:
+  std::vector<trackfitsums_t> fFitSums; //size = number of layers + 1
+  std::vector<int> fFitComboLast; //last hit combination passed to CalcLineOfBestFit
+  int fFitNhitsLast; //number of hits of the last combination, 0 = no valid sums
+
+  std::vector<int> fComboHits; //current hit combination as positions in the flat hit arrays; fixed size = number of layers
   
   //////////////////// "Free hit list" arrays used on individual track-finding iterations: /////////////////////////////
   std::vector<int> Nfreehits_layer; //key = layer, mapped value = number of unused hits available:
@@ -393,10 +501,22 @@ protected:
   //Array to hold the "reduced free hit list":
   std::vector<std::vector<int> > freehitlist_goodxy;
   std::set<int> layerswithfreehits_goodxy;
+
+  //Layer hit list indices of the 2D hits containing each 1D cluster, by module and U (V) cluster index. Filled by InitHitList,
+  //used by PurgeHits to find the hits sharing a cluster with a track without scanning the whole layer:
+  std::vector<std::vector<std::vector<int> > > fHitListByUclust;
+  std::vector<std::vector<std::vector<int> > > fHitListByVclust;
+
+  //Working arrays of the cellular automaton track finder:
+  std::vector<int> fCA_layers; //layers with free hits, ordered by z
+  std::vector<std::vector<int> > fCA_firstcell; //by layer and index in the layer hit list: first cell ending on that hit (-1 if none)
+  std::vector<CAcell_t> fCA_cells;
   
   //////////////////// Tracking results: //////////////////////////////
   
   int fNtracks_found;
+  int fNcombosTested; //number of hit combinations tested in the current event (all track-finding iterations)
+  int fTrackingSkipped; //1 if tracking was abandoned (hit combinations exceeded fMaxHitCombinations_Total, combinatorial search); 2 if the search was truncated at fCA_MaxCells/fCA_MaxCandidates (cellular automaton; tracks found are kept)
   std::vector<int> fNhitsOnTrack; //number of hits on track:
   std::vector<std::vector<int> > fModListTrack; //list of modules containing hits on fitted tracks
   std::vector<std::vector<int> > fHitListTrack; //list of hits on fitted tracks: NOTE--the "hit list" of the track refers to the index in the 2D cluster array. To locate the hit and its properties you need the module index and the hit index, i.e., fModules[fModListTrack[ihit]]->fHits[fHitListTrack[ihit]]
@@ -22,6 +22,7 @@
 #include "THaTrack.h"
 #include "TMath.h"
 #include "TList.h"
+#include "Helper.h"
 //_____________________________________________________________________________
 SBSGEPRegionOfInterestModule::SBSGEPRegionOfInterestModule( const char *name, const char *description, Int_t stage ) : InterStageModule(name,description,stage){
   //Constructor; for now, does nothing other than instantiate
@@ -32,6 +33,13 @@ SBSGEPRegionOfInterestModule::SBSGEPRegionOfInterestModule( const char *name, co
   fParmDetName = "gemFT";
   fParmDetNamePol = "gemFPP";
   fParmDetNameCalo = "hcal";
+
+  fEarm = nullptr;
+  fParm = nullptr;
+  fEdet = nullptr;
+  fPdet = nullptr;
+  fPdetPol = nullptr;
+  fPdetCalo = nullptr;
   
   fTestTracks = new TClonesArray("THaTrack",1);
 
@@ -158,64 +166,43 @@ Int_t SBSGEPRegionOfInterestModule::ReadDatabase( const TDatime &date ){
 }
 
 //_____________________________________________________________________________
-Int_t SBSGEPRegionOfInterestModule::Process( const THaEvData &evdata ){
-  //Okay here we go: we've written the code needed to start writing the code.
-
-  THaApparatus *app = 0;
-
-  bool gotEarm = false;
-  bool gotParm = false;
-  bool gotEdet = false;
-  bool gotPdet = false;
-  bool gotPdetPol = false;
-  bool gotPdetCalo = false;
-  
-  TIter aiter(gHaApps);
+Int_t SBSGEPRegionOfInterestModule::Begin( THaRunBase *run ){
+  //At this point all the apparatuses have been initialized, so we look up the
+  //E arm, P arm and their detectors here once instead of searching gHaApps every event:
+  InterStageModule::Begin(run);
+
+  fEarm = FindApparatus<SBSGEPEArm>( fEarmName.c_str() );
+  fParm = FindApparatus<SBSEArm>( fParmName.c_str() );
+
+  fEdet = FindDetector<SBSECal>( fEarm, fEarmDetName.c_str() );
+  fPdet = FindDetector<SBSGEMSpectrometerTracker>( fParm, fParmDetName.c_str() );
+  fPdetPol = FindDetector<SBSGEMPolarimeterTracker>( fParm, fParmDetNamePol.c_str() );
+  fPdetCalo = FindDetector<SBSHCal>( fParm, fParmDetNameCalo.c_str() );
+
+  if( !fParm || !fEarm || !fEdet || !fPdet || !fPdetPol || !fPdetCalo ){
+    std::cout << "Error: missing Earm and/or Parm and/or Edet and/or Pdet and/or PdetPol and/or PdetCalo! (gotEarm, gotParm, gotEdet, gotPdet, gotPdetPol, gotPdetCalo)=(" << (fEarm != nullptr) << ", " << (fParm != nullptr) << ", "
+	      << (fEdet != nullptr) << ", " << (fPdet != nullptr) << ", " << (fPdetPol != nullptr)
+	      << ", " << (fPdetCalo != nullptr) << ")" << std::endl;
+  }
 
-  SBSGEPEArm *Earm = nullptr;
-  SBSEArm *Parm = nullptr;
+  return kOK;
+}
 
-  SBSECal *Edet = nullptr;
-  SBSGEMSpectrometerTracker *Pdet = nullptr;
-  SBSGEMPolarimeterTracker *PdetPol = nullptr;
+//_____________________________________________________________________________
+Int_t SBSGEPRegionOfInterestModule::Process( const THaEvData &evdata ){
+  //Okay here we go: we've written the code needed to start writing the code.
 
-  SBSHCal *PdetCalo = nullptr;
-  
-  while( (app = (THaApparatus*) aiter()) ){
-    std::string appname = app->GetName();
-    if( app->InheritsFrom("SBSGEPEArm") ){
-      if( appname == fEarmName ){
-	Earm = dynamic_cast<SBSGEPEArm*>(app);
-	gotEarm = true;
+  SBSGEPEArm *Earm = fEarm;
+  SBSEArm *Parm = fParm;
 
-	Edet = dynamic_cast<SBSECal*>(Earm->GetDetector(fEarmDetName.c_str()));
+  SBSECal *Edet = fEdet;
+  SBSGEMSpectrometerTracker *Pdet = fPdet;
+  SBSGEMPolarimeterTracker *PdetPol = fPdetPol;
 
-	if( Edet ) gotEdet = true;
-      }
-    }
-    if( app->InheritsFrom("SBSEArm") ){
-      if( appname == fParmName ){
-	Parm = dynamic_cast<SBSEArm*>(app);
-	gotParm = true;
-
-	Pdet = dynamic_cast<SBSGEMSpectrometerTracker*>(Parm->GetDetector(fParmDetName.c_str()));
-	if( Pdet ) gotPdet = true;
-
-	PdetPol = dynamic_cast<SBSGEMPolarimeterTracker*>(Parm->GetDetector(fParmDetNamePol.c_str()));
-
-	if( PdetPol ) gotPdetPol = true;
-	
-	PdetCalo = dynamic_cast<SBSHCal*>(Parm->GetDetector(fParmDetNameCalo.c_str()));
-	if( PdetCalo ) gotPdetCalo = true;
-	
-      }
-    }
-  }
+  SBSHCal *PdetCalo = fPdetCalo;
 
-  if( !gotParm || !gotEarm || !gotEdet || !gotPdet || !gotPdetPol || !gotPdetCalo ){
-    std::cout << "Error: missing Earm and/or Parm and/or Edet and/or Pdet and/or PdetPol and/or PdetCalo! (gotEarm, gotParm, gotEdet, gotPdet, gotPdetPol, gotPdetCalo)=(" << gotEarm << ", " << gotParm << ", "
-	      << gotEdet << ", " << gotPdet << ", " << gotPdetPol
-	      << ", " << gotPdetCalo << ")" << std::endl;
+  //Missing collaborators were already reported in Begin():
+  if( !Parm || !Earm || !Edet || !Pdet || !PdetPol || !PdetCalo ){
     fDataValid = false;
     return 0;
   }
@@ -18,6 +18,12 @@
 
 class TClonesArray;
 class THaTrack;
+class SBSGEPEArm;
+class SBSEArm;
+class SBSECal;
+class SBSHCal;
+class SBSGEMSpectrometerTracker;
+class SBSGEMPolarimeterTracker;
 //class InterStageModule;
 
 using namespace Podd;
@@ -44,8 +50,8 @@ protected:
   virtual Int_t  ReadDatabase( const TDatime& date );
   virtual Int_t  ReadRunDatabase( const TDatime& date ); //This is to load beam energy (redundant, I know, but whatever)
 
-  //no need for this yet
-  //  virtual Int_t   Begin( THaRunBase* r=0 );
+  //Bind the E arm, P arm and their detectors (once per run, after all apparatuses are initialized):
+  virtual Int_t   Begin( THaRunBase* r=0 );
   
   //constant (per-run) parameters: 
   //-----------------------------------------------------------------------------------------------------------------------
@@ -69,6 +75,14 @@ protected:
   std::string fParmDetName;
   std::string fParmDetNamePol;
   std::string fParmDetNameCalo;
+
+  //Apparatuses and detectors named above, bound in Begin(); any nullptr disables the module:
+  SBSGEPEArm *fEarm;
+  SBSEArm *fParm;
+  SBSECal *fEdet;
+  SBSGEMSpectrometerTracker *fPdet;
+  SBSGEMPolarimeterTracker *fPdetPol;
+  SBSHCal *fPdetCalo;
   
   //We might as well store spectrometer 3-vectors here, or would that be redundant with the ones in the spectrometer classes? 
 
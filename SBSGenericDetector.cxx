@@ -23,12 +23,20 @@
 #include "THaApparatus.h"
 #include "TString.h"
 
+#include <algorithm>
 #include <cstring>
 #include <iostream>
 #include <iomanip>
 
 ClassImp(SBSGenericDetector);
 
+// Append the hits of one element (a contiguous range of a hit column) to an output vector
+template<typename T, typename S>
+static inline void AppendColumn( std::vector<T> &out, const SBSData::Span<S> &hits )
+{
+  out.insert( out.end(), hits.begin(), hits.end() );
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 /// SBSGenericDetector constructor
 ///
@@ -58,6 +66,8 @@ SBSGenericDetector::SBSGenericDetector( const char* name, const char* descriptio
   fTimeOffsetTrigPhase = 0.0;
 
   fTrigTimeCentral = 0.0;
+
+  fClearAllElements = true;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -958,7 +968,29 @@ Int_t SBSGenericDetector::ReadDatabase( const TDatime& date )
       }
     }
   }
-  
+
+  // All channels keep their hits in the detector-wide stores
+  UInt_t nref = fRefElements.size();
+  fADCHits.Init(fNelem+nref);
+  fTDCHits.Init(fNelem+nref);
+  for( Int_t k = 0; k < fNelem; k++ ) {
+    SBSElement *e = fElements[k];
+    if( !e ) continue;
+    if( e->ADC() ) e->ADC()->Attach(&fADCHits,k);
+    if( e->TDC() ) e->TDC()->Attach(&fTDCHits,k);
+  }
+  for( UInt_t k = 0; k < nref; k++ ) {
+    SBSElement *e = fRefElements[k];
+    if( !e ) continue;
+    if( e->ADC() ) e->ADC()->Attach(&fADCHits,fNelem+k);
+    if( e->TDC() ) e->TDC()->Attach(&fTDCHits,fNelem+k);
+  }
+
+  // Per-event list of elements that received hits; the next Clear() resets every element
+  fElementIsDirty.assign(fNelem,false);
+  fDirtyElements.clear();
+  fDirtyElements.reserve(fNelem);
+  fClearAllElements = true;
    
   // All is well that ends well
   fIsInit = true;
@@ -1067,6 +1099,8 @@ Int_t SBSGenericDetector::DefineVariables( EMode mode )
       ve.push_back({ "hits.a",   "All ADC inntegrals",  "fRaw.a" });
       ve.push_back({ "hits.a_amp",   "All ADC amplitudes",  "fRaw.a_amp" });
       ve.push_back({ "hits.a_time",   "All ADC pulse times",  "fRaw.a_time" });
+      if(fModeADC == SBSModeADC::kWaveform)
+	ve.push_back({ "hits.a_tot",   "All ADC pulse time-over-threshold",  "fRaw.a_tot" });
     }
   }
 
@@ -1140,6 +1174,10 @@ Int_t SBSGenericDetector::Decode( const THaEvData& evdata )
   //  std::cout << "(evtime,trigphase)=(" << evtime << ", " << fTrigPhase << ")" << std::endl;
   
   //static const char* const here = "Decode()";
+
+  // Lay out the hit rows of all elements before decoding, so that the hits of
+  // each element end up contiguous and in element order
+  ReserveHits( evdata );
   
   // Loop over modules for the reference time
   SBSElement *blk = nullptr;
@@ -1174,7 +1212,9 @@ Int_t SBSGenericDetector::Decode( const THaEvData& evdata )
         continue;
       fNhits++;
       // Get the block index for this crate,slot,channel combo
-      blk = fElements[ fChanMap[imod][chan-d->lo] ];
+      Int_t ielem = fChanMap[imod][chan-d->lo];
+      blk = fElements[ ielem ];
+      MarkElementDirty( ielem );
       if(d->IsADC()) {
         DecodeADC(evdata,blk,d,chan,kFALSE);
       } else if ( d->IsTDC()) {
@@ -1182,8 +1222,10 @@ Int_t SBSGenericDetector::Decode( const THaEvData& evdata )
       }
     }
   }
-  //
-  for(Int_t k = 0; k < fNelem; k++) {
+  // Only elements that received hits can have a good hit. Keep them in element order,
+  // which is the order in which CoarseProcess (and the sub-classes) write their output:
+  std::sort( fDirtyElements.begin(), fDirtyElements.end() );
+  for( auto k : fDirtyElements ) {
     SBSElement *tblk = fElements[k];  
     FindGoodHit(tblk);
   }
@@ -1196,6 +1238,40 @@ Int_t SBSGenericDetector::Decode( const THaEvData& evdata )
   //
   return fNhits;
 }
+////
+void SBSGenericDetector::ReserveHits( const THaEvData& evdata )
+{
+  // Same channel loops as Decode. Reserve the largest number of hits that
+  // DecodeADC/DecodeTDC can store for each channel.
+  for( UInt_t imod = 0; imod < fDetMap->GetSize(); imod++ ) {
+    THaDetMap::Module *d = fDetMap->GetModule( imod );
+    Bool_t isref = (!fDisableRefADC || !fDisableRefTDC) && fModuleRefTimeFlag[imod];
+    for(UInt_t ihit = 0; ihit < evdata.GetNumChan( d->crate, d->slot ); ihit++) {
+      Int_t chan = evdata.GetNextChan( d->crate, d->slot, ihit );
+      UInt_t nhit = evdata.GetNumHits( d->crate, d->slot, chan );
+      if( nhit == 0 ) continue;
+      UInt_t nadc = 0;
+      if( fModeADC == SBSModeADC::kADCSimple )
+	nadc = 1;
+      else if( fModeADC == SBSModeADC::kADC ) // mode 7: 4 words per pulse
+	nadc = nhit/4;
+      if( isref && chan <= fRefChanHi[imod] && chan >= fRefChanLo[imod] &&
+	  fRefChanMap[imod][chan-d->lo] != -1 ) {
+	UInt_t k = fNelem + fRefChanMap[imod][chan-d->lo];
+	if( d->IsADC() ) fADCHits.Reserve(k,nadc);
+	else if( d->IsTDC() ) fTDCHits.Reserve(k,nhit);
+      }
+      if( UInt_t(chan) > d->hi || UInt_t(chan) < d->lo || fChanMap[imod][chan-d->lo] < 0 )
+	continue;
+      UInt_t k = fChanMap[imod][chan-d->lo];
+      if( d->IsADC() ) fADCHits.Reserve(k,nadc);
+      else if( d->IsTDC() ) fTDCHits.Reserve(k,nhit);
+    }
+  }
+  fADCHits.Layout();
+  fTDCHits.Layout();
+}
+
 ////
 Int_t SBSGenericDetector::DecodeADC( const THaEvData& evdata,
 				     SBSElement *blk, THaDetMap::Module *d, Int_t chan,Bool_t IsRef)
@@ -1243,15 +1319,20 @@ Int_t SBSGenericDetector::DecodeADC( const THaEvData& evdata,
       }
     }
   } else {
-    std::vector<Double_t> samples;
-    samples.resize(nhit);
+    // Reuse the same sample buffer for every channel (it only grows
+    // when a longer readout window is seen)
+    if( fWaveformSamples.size() < nhit )
+      fWaveformSamples.resize(nhit);
+    Double_t *samples = fWaveformSamples.data();
     for(UInt_t i = 0; i < nhit; i++) {
       samples[i] = evdata.GetData(d->crate, d->slot, chan, i);
     }
-    blk->Waveform()->Process(samples);
-    samples.clear();
     SBSData::Waveform *wave = blk->Waveform();
+    wave->Process(samples,nhit);
     wave->SetValTime(wave->GetTime().val- reftime);
+    for(UInt_t ih = 0; ih < wave->GetNHits(); ih++) {
+      wave->SetValTime(ih, wave->GetHit(ih).time.val - reftime);
+    }
   }
   return nhit;
 }
@@ -1446,12 +1527,25 @@ void SBSGenericDetector::Clear( Option_t* opt )
   fNGoodADChits = 0;
   fCoarseProcessed = false;
   fFineProcessed = false;
-  for( auto& element: fElements ) {
-    element->Clear();
+  // Elements without hits in the last event are still clean; only reset the others
+  if( fClearAllElements || fElementIsDirty.size() != fElements.size() ) {
+    for( auto& element: fElements ) {
+      element->Clear();
+    }
+    fElementIsDirty.assign(fElements.size(),false);
+    fClearAllElements = false;
+  } else {
+    for( auto k : fDirtyElements ) {
+      fElements[k]->Clear();
+      fElementIsDirty[k] = false;
+    }
   }
+  fDirtyElements.clear();
   for( auto& refElement: fRefElements ) {
     refElement->Clear();
   }
+  fADCHits.Clear();
+  fTDCHits.Clear();
 }
 
 Int_t SBSGenericDetector::CoarseProcess(TClonesArray& )// tracks)
@@ -1548,20 +1642,23 @@ Int_t SBSGenericDetector::CoarseProcess(TClonesArray& )// tracks)
         }
       }
       if(fStoreRawHits) {
-	const std::vector<SBSData::TDCHit> &hits = blk->TDC()->GetAllHits();
-	for( const auto &hit : hits) {
-	  fRefRaw.TDCelemID.push_back(hit.elemID);
-	  Double_t tempval=hit.le.val;
-	  if(fModeTDC == SBSModeTDC::kTDCSimple) { // need to recalculate for F1 data
-	    Double_t cal=blk->TDC()->GetCal();
-	    Double_t offset=blk->TDC()->GetOffset();
-	    tempval= (hit.le.raw-hit.TrigTime-offset)*cal;
-	  }
-	  fRefRaw.t.push_back(tempval);
-	  if(fModeTDC == SBSModeTDC::kTDC) { // has trailing info
-	    fRefRaw.t_te.push_back(hit.te.val);
-	    fRefRaw.t_ToT.push_back(hit.ToT.val);
+	// Copy the hit columns of this element
+	const SBSData::TDC *tdc = blk->TDC();
+	AppendColumn(fRefRaw.TDCelemID, tdc->GetAllElemIDs());
+	if(fModeTDC == SBSModeTDC::kTDCSimple) { // need to recalculate for F1 data
+	  Double_t cal=tdc->GetCal();
+	  Double_t offset=tdc->GetOffset();
+	  SBSData::Span<Double_t> le_raw = tdc->GetAllLeadsRaw();
+	  SBSData::Span<UInt_t> trigtime = tdc->GetAllTrigTimes();
+	  for( size_t ih = 0; ih < le_raw.size(); ih++) {
+	    fRefRaw.t.push_back((le_raw[ih]-trigtime[ih]-offset)*cal);
 	  }
+	} else {
+	  AppendColumn(fRefRaw.t, tdc->GetAllLeads());
+	}
+	if(fModeTDC == SBSModeTDC::kTDC) { // has trailing info
+	  AppendColumn(fRefRaw.t_te, tdc->GetAllTrails());
+	  AppendColumn(fRefRaw.t_ToT, tdc->GetAllToT());
 	}
       }
 
@@ -1626,13 +1723,11 @@ Int_t SBSGenericDetector::CoarseProcess(TClonesArray& )// tracks)
 	}
 	// Now store all the hits if specified the by user
 	if(fStoreRawHits) {
-	  const std::vector<SBSData::PulseADCData> &hits = blk->ADC()->GetAllHits();
-	  for( const auto &hit : hits) {
-	    fRefRaw.ADCelemID.push_back(blk->GetID());
-	    fRefRaw.a.push_back(hit.integral.val);
-	    fRefRaw.a_amp.push_back(hit.amplitude.val);
-	    fRefRaw.a_time.push_back(hit.time.val);
-	  }
+	  const SBSData::ADC *adc = blk->ADC();
+	  fRefRaw.ADCelemID.insert(fRefRaw.ADCelemID.end(), adc->GetNHits(), blk->GetID());
+	  AppendColumn(fRefRaw.a, adc->GetAllIntegrals());
+	  AppendColumn(fRefRaw.a_amp, adc->GetAllAmplitudes());
+	  AppendColumn(fRefRaw.a_time, adc->GetAllTimes());
 	}
 	//    } else if  (fModeADC == SBSModeADC::kWaveform ){ // Waveform mode
       } else if( fModeADC == SBSModeADC::kWaveform && blk->Waveform()->HasData()){
@@ -1662,8 +1757,7 @@ Int_t SBSGenericDetector::CoarseProcess(TClonesArray& )// tracks)
 	    //std::cout << "SBSCalorimeter, " << GetName() << " " << blk->GetID() << " " << blk->GetRow() << " " << blk->GetCol() << " " << blk->GetX() << " " << blk->GetY() << std::endl;
 	 
 	    fRefGood.ped.push_back(wave->GetPed());
-	    fRefGood.a_mult.push_back(0);
-	    if (wave->GetTime().val>0) fRefGood.a_mult.push_back(1);
+	    fRefGood.a_mult.push_back(wave->GetNHits());
 	    fRefGood.a.push_back(wave->GetIntegral().raw);
 	    Double_t gain= wave->GetGain();
 	    fRefGood.a_p.push_back(wave->GetIntegral().val/gain);
@@ -1704,7 +1798,11 @@ Int_t SBSGenericDetector::CoarseProcess(TClonesArray& )// tracks)
 
   
   
-  for(Int_t k = 0; k < fNelem; k++) {
+  // Unless empty elements are stored, only elements that received hits in Decode()
+  // can produce output:
+  Int_t nloop = fStoreEmptyElements ? fNelem : Int_t(fDirtyElements.size());
+  for(Int_t i = 0; i < nloop; i++) {
+    Int_t k = fStoreEmptyElements ? i : fDirtyElements[i];
     blk = fElements[k];
     if(!blk)
       continue;
@@ -1782,15 +1880,13 @@ Int_t SBSGenericDetector::CoarseProcess(TClonesArray& )// tracks)
         }
       }
       if(fStoreRawHits) {
-	const std::vector<SBSData::TDCHit> &hits = blk->TDC()->GetAllHits();
-	for( const auto &hit : hits) {
-	  fRaw.TDCelemID.push_back(hit.elemID);
-	  
-	  fRaw.t.push_back(hit.le.val);
-	  if(fModeTDC == SBSModeTDC::kTDC) { // has trailing info
-	    fRaw.t_te.push_back(hit.te.val);
-	    fRaw.t_ToT.push_back(hit.ToT.val);
-	  }
+	// Copy the hit columns of this element
+	const SBSData::TDC *tdc = blk->TDC();
+	AppendColumn(fRaw.TDCelemID, tdc->GetAllElemIDs());
+	AppendColumn(fRaw.t, tdc->GetAllLeads());
+	if(fModeTDC == SBSModeTDC::kTDC) { // has trailing info
+	  AppendColumn(fRaw.t_te, tdc->GetAllTrails());
+	  AppendColumn(fRaw.t_ToT, tdc->GetAllToT());
 	}
       }
     }
@@ -1850,12 +1946,10 @@ Int_t SBSGenericDetector::CoarseProcess(TClonesArray& )// tracks)
 	}
 	// Now store all the hits if specified the by user
 	if(fStoreRawHits) {
-	  const std::vector<SBSData::PulseADCData> &hits = blk->ADC()->GetAllHits();
-	  for( const auto &hit : hits) {
-	    fRaw.a.push_back(hit.integral.val);
-	    fRaw.a_amp.push_back(hit.amplitude.val);
-	    fRaw.a_time.push_back(hit.time.val);
-	  }
+	  const SBSData::ADC *adc = blk->ADC();
+	  AppendColumn(fRaw.a, adc->GetAllIntegrals());
+	  AppendColumn(fRaw.a_amp, adc->GetAllAmplitudes());
+	  AppendColumn(fRaw.a_time, adc->GetAllTimes());
 	}
       } else { // Waveform mode
         SBSData::Waveform *wave = blk->Waveform();
@@ -1873,6 +1967,16 @@ Int_t SBSGenericDetector::CoarseProcess(TClonesArray& )// tracks)
 	      fGood.samps[idx+s]   = s_c[s];
             }
 	  }
+	  // Store all the pulses found in the window if specified by the user
+	  if(fStoreRawHits) {
+	    const std::vector<SBSData::PulseADCData> &hits = wave->GetAllHits();
+	    for( size_t ih = 0; ih < hits.size(); ih++) {
+	      fRaw.a.push_back(hits[ih].integral.val);
+	      fRaw.a_amp.push_back(hits[ih].amplitude.val);
+	      fRaw.a_time.push_back(hits[ih].time.val);
+	      fRaw.a_tot.push_back(wave->GetToT(ih).val);
+	    }
+	  }
 	  if (wave->GetGoodHitIndex() >=0) {
 	    fNGoodADChits++;
 	    fGood.ADCrow.push_back(blk->GetRow());
@@ -1885,8 +1989,7 @@ Int_t SBSGenericDetector::CoarseProcess(TClonesArray& )// tracks)
 	    //std::cout << "SBSCalorimeter, " << GetName() << " " << blk->GetID() << " " << blk->GetRow() << " " << blk->GetCol() << " " << blk->GetX() << " " << blk->GetY() << std::endl;
 	 
 	    fGood.ped.push_back(wave->GetPed());
-	    fGood.a_mult.push_back(0);
-	    if (wave->GetTime().val>0) fGood.a_mult.push_back(1);
+	    fGood.a_mult.push_back(wave->GetNHits());
 	    fGood.a.push_back(wave->GetIntegral().raw);
 	    Double_t gain= wave->GetGain();
 	    fGood.a_p.push_back(wave->GetIntegral().val/gain);
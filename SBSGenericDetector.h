@@ -79,6 +79,7 @@ struct SBSGenericOutputData {
   std::vector<Double_t> a_amptrig_p;     //< [] ADC pulse amplitude -pedestal
   std::vector<Double_t> a_amptrig_c;     //< [] ADC pulse amplitude -pedestal
   std::vector<Double_t> a_time;    //< [] ADC pulse time
+  std::vector<Double_t> a_tot;     //< [] ADC pulse time-over-threshold (waveform mode)
   // TDC variables
   std::vector<Int_t> t_mult;         //< [] TDC # of hits per channel
   std::vector<Double_t> t;         //< [] TDC (leading edge) time
@@ -113,6 +114,7 @@ struct SBSGenericOutputData {
     a_amptrig_p.clear();
     a_amptrig_c.clear();
     a_time.clear();
+    a_tot.clear();
     t.clear();
     t_mult.clear();
     t_te.clear();
@@ -183,6 +185,16 @@ protected:
   virtual Int_t  DefineVariables( EMode mode = kDefine );
   virtual Int_t  FindGoodHit(SBSElement *); // 
 
+  // Counting pass of Decode: reserve the hit rows of the channels of this event
+  void ReserveHits( const THaEvData& );
+
+  void MarkElementDirty( Int_t k ) {
+    if( !fElementIsDirty[k] ) {
+      fElementIsDirty[k] = true;
+      fDirtyElements.push_back(k);
+    }
+  }
+
   // Configuration
   Int_t  fNRefElem;        ///< Number of Ref Time elements
   Int_t  fNrows;        ///< Number of rows
@@ -214,9 +226,19 @@ protected:
   SBSGenericOutputData fRefGood;     //< Good Ref time data output
   SBSGenericOutputData fRefRaw;      //< All Ref time hits
 
+  std::vector<Double_t> fWaveformSamples; //< Scratch buffer for waveform samples of one channel
+
   // Blocks, where the grid is just for easy access to the elements by row,col,layer
   std::vector<SBSElement*> fElements;
+  // Elements that received hits in this event (sorted by index after Decode), so that
+  // good-hit finding, output and Clear scale with occupancy rather than detector size:
+  std::vector<Int_t> fDirtyElements;
+  std::vector<Bool_t> fElementIsDirty;
+  Bool_t fClearAllElements; //< Reset all elements in the next Clear() (set after (re)building them)
   std::vector<SBSElement*> fRefElements; //< Reference elements (for TDCs and multi-function ADCs)
+  // Hits of all elements (index k) and reference elements (index fNelem+k), in element order:
+  SBSData::ADCHitStore fADCHits;
+  SBSData::TDCHitStore fTDCHits;
   std::vector<std::vector<std::vector<SBSElement*> > > fElementGrid;
   // Clusters for this event
 
@@ -0,0 +1,148 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// SBSOpticsExpansion
+//
+// Power-table evaluation of the spectrometer optics expansions
+// (see header for details).
+//
+//////////////////////////////////////////////////////////////////////////
+
+#include "SBSOpticsExpansion.h"
+#include <iostream>
+
+//_____________________________________________________________________________
+SBSOpticsExpansion::SBSOpticsExpansion() : fNterms(0), fNout(0)
+{
+  for( int ivar=0; ivar<kNvars; ivar++ ){
+    fMinPower[ivar] = 0;
+    fMaxPower[ivar] = 0;
+    fPowOffset[ivar] = ivar;
+  }
+}
+
+//_____________________________________________________________________________
+void SBSOpticsExpansion::Clear()
+{
+  fNterms = 0;
+  fNout = 0;
+  for( int ivar=0; ivar<kNvars; ivar++ ){
+    fMinPower[ivar] = 0;
+    fMaxPower[ivar] = 0;
+    fPowOffset[ivar] = ivar;
+  }
+  fPowIndex.clear();
+  fCoeff.clear();
+  fPowers.clear();
+}
+
+//_____________________________________________________________________________
+Bool_t SBSOpticsExpansion::Init( const std::vector<int> &e0, const std::vector<int> &e1,
+				 const std::vector<int> &e2, const std::vector<int> &e3,
+				 const std::vector<int> &e4,
+				 const std::vector<const std::vector<double>*> &coeffs )
+{
+  Clear();
+
+  const std::vector<int> *expon[kNvars] = { &e0, &e1, &e2, &e3, &e4 };
+
+  size_t nterms = e0.size();
+  for( int ivar=0; ivar<kNvars; ivar++ ){
+    if( expon[ivar]->size() != nterms ){
+      std::cerr << "SBSOpticsExpansion::Init: inconsistent number of exponents for variable "
+		<< ivar << std::endl;
+      return false;
+    }
+  }
+  for( size_t iout=0; iout<coeffs.size(); iout++ ){
+    if( !coeffs[iout] || coeffs[iout]->size() != nterms ){
+      std::cerr << "SBSOpticsExpansion::Init: inconsistent number of coefficients for output "
+		<< iout << std::endl;
+      return false;
+    }
+  }
+
+  int minpow[kNvars], maxpow[kNvars];
+  for( int ivar=0; ivar<kNvars; ivar++ ){
+    minpow[ivar] = 0;
+    maxpow[ivar] = 0;
+    for( size_t iterm=0; iterm<nterms; iterm++ ){
+      int e = (*expon[ivar])[iterm];
+      if( e < minpow[ivar] ) minpow[ivar] = e;
+      if( e > maxpow[ivar] ) maxpow[ivar] = e;
+    }
+  }
+
+  //Lay out the power tables of all variables one after the other:
+  int offset = 0;
+  for( int ivar=0; ivar<kNvars; ivar++ ){
+    fMinPower[ivar] = minpow[ivar];
+    fMaxPower[ivar] = maxpow[ivar];
+    fPowOffset[ivar] = offset - minpow[ivar];
+    offset += maxpow[ivar] - minpow[ivar] + 1;
+  }
+  fPowers.assign( offset, 1.0 );
+
+  fNterms = nterms;
+  fNout = coeffs.size();
+
+  fPowIndex.resize( kNvars*nterms );
+  fCoeff.resize( fNout*nterms );
+  for( size_t iterm=0; iterm<nterms; iterm++ ){
+    for( int ivar=0; ivar<kNvars; ivar++ ){
+      fPowIndex[kNvars*iterm+ivar] = fPowOffset[ivar] + (*expon[ivar])[iterm];
+    }
+    for( int iout=0; iout<fNout; iout++ ){
+      fCoeff[fNout*iterm+iout] = (*coeffs[iout])[iterm];
+    }
+  }
+
+  return true;
+}
+
+//_____________________________________________________________________________
+void SBSOpticsExpansion::FillPowerTables( const Double_t *vars )
+{
+  Double_t *powers = fPowers.data();
+  for( int ivar=0; ivar<kNvars; ivar++ ){
+    Double_t *p = powers + fPowOffset[ivar];
+    p[0] = 1.0;
+    for( int ipow=1; ipow<=fMaxPower[ivar]; ipow++ ){
+      p[ipow] = p[ipow-1]*vars[ivar];
+    }
+    //negative exponents (as with pow(), a zero variable gives inf):
+    for( int ipow=-1; ipow>=fMinPower[ivar]; ipow-- ){
+      p[ipow] = p[ipow+1]/vars[ivar];
+    }
+  }
+}
+
+//_____________________________________________________________________________
+void SBSOpticsExpansion::Eval( const Double_t *vars, Double_t *out )
+{
+  for( int iout=0; iout<fNout; iout++ ) out[iout] = 0.0;
+
+  if( fNterms == 0 ) return;
+
+  FillPowerTables( vars );
+
+  const Double_t *powers = fPowers.data();
+  const Int_t *idx = fPowIndex.data();
+  const Double_t *c = fCoeff.data();
+
+  //Same product order as the pow()-based loops this replaces:
+  for( int iterm=0; iterm<fNterms; iterm++, idx += kNvars, c += fNout ){
+    Double_t term = powers[idx[0]] * powers[idx[1]] * powers[idx[2]] *
+      powers[idx[3]] * powers[idx[4]];
+    for( int iout=0; iout<fNout; iout++ ){
+      out[iout] += c[iout]*term;
+    }
+  }
+}
+
+//_____________________________________________________________________________
+void SBSOpticsExpansion::EvalBatch( Int_t npoints, const Double_t *vars, Double_t *out )
+{
+  for( int ipoint=0; ipoint<npoints; ipoint++ ){
+    Eval( vars + kNvars*ipoint, out + fNout*ipoint );
+  }
+}
@@ -0,0 +1,67 @@
+#ifndef SBSOpticsExpansion_h
+#define SBSOpticsExpansion_h
+
+//////////////////////////////////////////////////////////////////////////
+//
+// SBSOpticsExpansion
+//
+// Evaluator for the polynomial optics expansions used by the SBS
+// spectrometers (target reconstruction, forward optics, eTOF). Each
+// expansion is a sum over monomials in five input variables,
+//
+//   out_n = sum_t C_n[t] * v0^e0[t] * v1^e1[t] * v2^e2[t] * v3^e3[t] * v4^e4[t]
+//
+// with an arbitrary number of output coefficient sets C_n sharing the same
+// exponents. Instead of calling pow() five times per term, Eval() fills a
+// table of the powers min exponent...max exponent of each input variable
+// once (by repeated multiplication, and by repeated division for negative
+// exponents) and then evaluates all the outputs in a single pass over the
+// terms. EvalBatch() does the same for many input points.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#include "Rtypes.h"
+#include <vector>
+
+class SBSOpticsExpansion {
+ public:
+  enum { kNvars = 5 };
+
+  SBSOpticsExpansion();
+
+  void Clear();
+
+  // Define the expansion: one exponent array per input variable (all of
+  // size nterms, any integer exponents), and one coefficient array per output.
+  // Returns false (and leaves the expansion empty) for inconsistent input:
+  Bool_t Init( const std::vector<int> &e0, const std::vector<int> &e1,
+	       const std::vector<int> &e2, const std::vector<int> &e3,
+	       const std::vector<int> &e4,
+	       const std::vector<const std::vector<double>*> &coeffs );
+
+  Bool_t IsEmpty() const { return fNterms == 0; }
+  Int_t GetNterms() const { return fNterms; }
+  Int_t GetNoutputs() const { return fNout; }
+
+  // Evaluate all outputs at the point vars[kNvars]; out[GetNoutputs()] is overwritten:
+  void Eval( const Double_t *vars, Double_t *out );
+
+  // Evaluate npoints points stored consecutively in vars (kNvars values per point),
+  // writing GetNoutputs() values per point to out (same results as Eval):
+  void EvalBatch( Int_t npoints, const Double_t *vars, Double_t *out );
+
+ private:
+  void FillPowerTables( const Double_t *vars );
+
+  Int_t fNterms;
+  Int_t fNout;
+  Int_t fMinPower[kNvars];  // lowest exponent of each variable (<= 0)
+  Int_t fMaxPower[kNvars];  // highest exponent of each variable (>= 0)
+  Int_t fPowOffset[kNvars]; // position of the power 0 of each variable in fPowers
+
+  std::vector<Int_t> fPowIndex;    // kNvars entries per term: index into fPowers
+  std::vector<Double_t> fCoeff;    // fNout coefficients per term, term-major
+  std::vector<Double_t> fPowers;   // scratch: powers fMinPower[ivar]...fMaxPower[ivar] of each variable
+};
+
+#endif
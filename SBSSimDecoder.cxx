@@ -80,6 +80,7 @@ SBSSimDecoder::SBSSimDecoder()// : fCheckedForEnabledDetectors(false), fTreeIsSe
     (SBSSimDataDecoder::GetEncoderByName("mpd"));
   
   fIsInit = false;
+  fDirectInjection = false;
   
 }
 
@@ -100,6 +101,7 @@ Int_t SBSSimDecoder::Init(){
 
   //status += DefineVariables();
   SetDetectors();
+  SetupLoaders();
 
   fIsInit = true;
 
@@ -167,158 +169,168 @@ Int_t SBSSimDecoder::DefineVariables( THaAnalysisObject::EMode mode )
     {"mc_nucl",    "MC Initial (struck) nucleon type: 1 = proton, 0 = neutron",   "fNucl"},
     {"mc_fnucl",   "MC Final-state (detected) nucleon type: 1 = proton, 0 = neutron",   "fFnucl"},
     {"nbbtracks",   "number of BB MC tracks",   "fNBBtracks"},
-    {"bbtrack_nhits",   "BB MC track hit mult",   "fBBtrack_Nhits"},
-    {"bbtrack_tid",   "BB MC track TID",   "fBBtrack_TID"},
-    {"bbtrack_pid",   "BB MC track PID",   "fBBtrack_PID"},
-    {"bbtrack_mid",   "BB MC track MID",   "fBBtrack_MID"},
-    {"bbtrack_p",   "BB MC track momentum",   "fBBtrack_P"},
-    {"bbtrack_x",   "BB MC track transport X position",   "fBBtrack_X"},
-    {"bbtrack_y",   "BB MC track transport Y position",   "fBBtrack_Y"},
-    {"bbtrack_dx",   "BB MC track transport dX slope",   "fBBtrack_dX"},
-    {"bbtrack_dy",   "BB MC track transport dY slope",   "fBBtrack_dY"},
     {"nbbgemhits",   "number of BBGEM MC hits",   "fNBBGEMhits"},
-    {"bbgemhit_plane",   "BBGEM MC hit plane",   "fBBGEMhit_plane"},
-    {"bbgemhit_tid",   "BBGEM MC hit TID",   "fBBGEMhit_TID"},
-    {"bbgemhit_pid",   "BBGEM MC hit PID",   "fBBGEMhit_PID"},
-    {"bbgemhit_mid",   "BBGEM MC hit MID",   "fBBGEMhit_MID"},
-    {"bbgemhit_edep",   "BBGEM MC hit edep",   "fBBGEMhit_edep"},
-    {"bbgemhit_x",   "BBGEM MC hit transport X",   "fBBGEMhit_x"},
-    {"bbgemhit_y",   "BBGEM MC hit transport Y",   "fBBGEMhit_y"},
     {"bbps_esum",   "BBPS total energy sum",   "fBBPS_esum"},
     {"bbsh_esum",   "BBSH total energy sum",   "fBBSH_esum"},
     {"gep.nfttracks",   "number of FT MC tracks",   "fNFTtracks"},
-    {"gep.fttrack_nhits",   "FT MC track hit mult",   "fFTtrack_Nhits"},
-    {"gep.fttrack_tid",   "FT MC track TID",   "fFTtrack_TID"},
-    {"gep.fttrack_pid",   "FT MC track PID",   "fFTtrack_PID"},
-    {"gep.fttrack_mid",   "FT MC track MID",   "fFTtrack_MID"},
-    {"gep.fttrack_p",   "FT MC track momentum",   "fFTtrack_P"},
-    {"gep.fttrack_x",   "FT MC track transport X position",   "fFTtrack_X"},
-    {"gep.fttrack_y",   "FT MC track transport Y position",   "fFTtrack_Y"},
-    {"gep.fttrack_dx",   "FT MC track transport dX slope",   "fFTtrack_dX"},
-    {"gep.fttrack_dy",   "FT MC track transport dY slope",   "fFTtrack_dY"},
     {"gep.nftgemhits",   "number of FTGEM MC hits",   "fNFTGEMhits"},
-    {"gep.ftgemhit_plane",   "FTGEM MC hit plane",   "fFTGEMhit_plane"},
-    {"gep.ftgemhit_tid",   "FTGEM MC hit TID",   "fFTGEMhit_TID"},
-    {"gep.ftgemhit_pid",   "FTGEM MC hit PID",   "fFTGEMhit_PID"},
-    {"gep.ftgemhit_mid",   "FTGEM MC hit MID",   "fFTGEMhit_MID"},
-    {"gep.ftgemhit_edep",   "FTGEM MC hit edep",   "fFTGEMhit_edep"},
-    {"gep.ftgemhit_x",   "FTGEM MC hit transport X",   "fFTGEMhit_x"},
-    {"gep.ftgemhit_y",   "FTGEM MC hit transport Y",   "fFTGEMhit_y"},
     {"gep.nfpptracks",   "number of FPP MC tracks",   "fNFPPtracks"},
-    {"gep.fpptrack_nhits",   "FPP MC track hit mult",   "fFPPtrack_Nhits"},
-    {"gep.fpptrack_tid",   "FPP MC track TID",   "fFPPtrack_TID"},
-    {"gep.fpptrack_pid",   "FPP MC track PID",   "fFPPtrack_PID"},
-    {"gep.fpptrack_mid",   "FPP MC track MID",   "fFPPtrack_MID"},
-    {"gep.fpptrack_p",   "FPP MC track momentum",   "fFPPtrack_P"},
-    {"gep.fpptrack_x",   "FPP MC track transport X position",   "fFPPtrack_X"},
-    {"gep.fpptrack_y",   "FPP MC track transport Y position",   "fFPPtrack_Y"},
-    {"gep.fpptrack_dx",   "FPP MC track transport dX slope",   "fFPPtrack_dX"},
-    {"gep.fpptrack_dy",   "FPP MC track transport dY slope",   "fFPPtrack_dY"},
     {"gep.nfppgemhits",   "number of FPPGEM MC hits",   "fNFPPGEMhits"},
-    {"gep.fppgemhit_plane",   "FPPGEM MC hit plane",   "fFPPGEMhit_plane"},
-    {"gep.fppgemhit_tid",   "FPPGEM MC hit TID",   "fFPPGEMhit_TID"},
-    {"gep.fppgemhit_pid",   "FPPGEM MC hit PID",   "fFPPGEMhit_PID"},
-    {"gep.fppgemhit_mid",   "FPPGEM MC hit MID",   "fFPPGEMhit_MID"},
-    {"gep.fppgemhit_edep",   "FPPGEM MC hit edep",   "fFPPGEMhit_edep"},
-    {"gep.fppgemhit_x",   "FPPGEM MC hit transport X",   "fFPPGEMhit_x"},
-    {"gep.fppgemhit_y",   "FPPGEM MC hit transport Y",   "fFPPGEMhit_y"},
     {"hcal_esum",   "HCAL total energy sum",   "fHCAL_esum"},
     {"gep.ecal_esum",   "ECAL total energy sum",   "fECAL_esum"},
 
-    {"bbgemhit_ptridx",    "Primary track index for BBGEM SD",        "fBBGEMhit_ptridx"},
-    {"bbgemhit_otridx",    "Origin track index for BBGEM SD",         "fBBGEMhit_otridx"},
-    {"bbgemhit_sdtridx",   "SD track index for BBGEM SD",             "fBBGEMhit_sdtridx"},
-    {"bbgemtrack_ptridx",  "Primary track index for BBGEM Track SD",  "fBBGEMtrack_ptridx"},
-    {"bbgemtrack_otridx",  "Origin track index for BBGEM Track SD",   "fBBGEMtrack_otridx"},
-    {"bbgemtrack_sdtridx", "SD track index for BBGEM Track SD",       "fBBGEMtrack_sdtridx"},
-    {"bbhodohit_ptridx",   "Primary track index for BBHodo SD",       "fBBHODOhit_ptridx"},
-    {"bbhodohit_otridx",   "Origin track index for BBHodo SD",        "fBBHODOhit_otridx"},
-    {"bbhodohit_sdtridx",  "SD track index for BBHodo SD",            "fBBHODOhit_sdtridx"},
-    {"bbpshit_ptridx",   "Primary track index for BBPSTF1 SD",        "fBBPSTF1hit_ptridx"},
-    {"bbpshit_otridx",   "Origin track index for BBPSTF1 SD",         "fBBPSTF1hit_otridx"},
-    {"bbpshit_sdtridx",  "SD track index for BBPSTF1 SD",             "fBBPSTF1hit_sdtridx"},
-    {"bbshhit_ptridx",   "Primary track index for BBSHTF1 SD",        "fBBSHTF1hit_ptridx"},
-    {"bbshhit_otridx",   "Origin track index for BBSHTF1 SD",         "fBBSHTF1hit_otridx"},
-    {"bbshhit_sdtridx",  "SD track index for BBSHTF1 SD",             "fBBSHTF1hit_sdtridx"},
-    {"hcalhit_ptridx",   "Primary track index for HCalScint SD",      "fHCALhit_ptridx"},
-    {"hcalhit_otridx",   "Origin track index for HCalScint SD",       "fHCALhit_otridx"},
-    {"hcalhit_sdtridx",  "SD track index for HCalScint SD",           "fHCALhit_sdtridx"},
-    {"gep.ecalhit_ptridx",   "Primary track index for ECal TF1 SD",   "fECALhit_ptridx"},
-    {"gep.ecalhit_otridx",   "Origin track index for ECal TF1 SD",    "fECALhit_otridx"},
-    {"gep.ecalhit_sdtridx",  "SD track index for ECal TF1 SD",        "fECALhit_sdtridx"},
-    {"gep.cdethit_ptridx",   "Primary track index for CDETScint SD",  "fCDEThit_ptridx"},
-    {"gep.cdethit_otridx",   "Origin track index for CDETScint SD",   "fCDEThit_otridx"},
-    {"gep.cdethit_sdtridx",  "SD track index for CDETScint SD",       "fCDEThit_sdtridx"},
-    {"gep.fthit_ptridx",   "Primary track index for FT SD",           "fFThit_ptridx"},
-    {"gep.fthit_otridx",   "Origin track index for FT SD",            "fFThit_otridx"},
-    {"gep.fthit_sdtridx",  "SD track index for FT SD",                "fFThit_sdtridx"},
-    {"gep.fttrack_ptridx",   "Primary track index for FT Track SD",   "fFTtrack_ptridx"},
-    {"gep.fttrack_otridx",   "Origin track index for FT Track SD",    "fFTtrack_otridx"},
-    {"gep.fttrack_sdtridx",  "SD track index for FT Track SD",        "fFTtrack_sdtridx"},
-    {"gep.fpphit_ptridx",   "Primary track index for FPP SD",         "fFPPhit_ptridx"},
-    {"gep.fpphit_otridx",   "Origin track index for FPP SD",          "fFPPhit_otridx"},
-    {"gep.fpphit_sdtridx",  "SD track index for FPP SD",              "fFPPhit_sdtridx"},
-    {"gep.fpptrack_ptridx",   "Primary track index for FPP Track SD", "fFPPtrack_ptridx"},
-    {"gep.fpptrack_otridx",   "Origin track index for FPP Track SD",  "fFPPtrack_otridx"},
-    {"gep.fpptrack_sdtridx",  "SD track index for FPP Track SD",      "fFPPtrack_sdtridx"},
     
     
     {"ptrack_ntracks",   "Primary track ntracks", "fPTrack_ntracks"},
-    {"ptrack_tid",       "Primary track TID",     "fPTrack_TID"},
-    {"ptrack_pid",       "Primary track PID",     "fPTrack_PID"},
-    {"ptrack_posx",      "Primary track posx",    "fPTrack_posx"},
-    {"ptrack_posy",      "Primary track posy",    "fPTrack_posy"},
-    {"ptrack_posz",      "Primary track posz",    "fPTrack_posz"},
-    {"ptrack_momx",      "Primary track momx",    "fPTrack_momx"},
-    {"ptrack_momy",      "Primary track momy",    "fPTrack_momy"},
-    {"ptrack_momz",      "Primary track momz",    "fPTrack_momz"},
-    {"ptrack_polx",      "Primary track polx",    "fPTrack_polx"},
-    {"ptrack_poly",      "Primary track poly",    "fPTrack_poly"},
-    {"ptrack_polz",      "Primary track polz",    "fPTrack_polz"},
-    {"ptrack_etot",      "Primary track Etot",    "fPTrack_Etot"},
-    {"ptrack_t",         "Primary track T",       "fPTrack_T"},
     {"otrack_ntracks",   "Origin track ntracks", "fOTrack_ntracks"},
-    {"otrack_tid",       "Origin track TID",     "fOTrack_TID"},
-    {"otrack_pid",       "Origin track PID",     "fOTrack_PID"},
-    {"otrack_posx",      "Origin track posx",    "fOTrack_posx"},
-    {"otrack_posy",      "Origin track posy",    "fOTrack_posy"},
-    {"otrack_posz",      "Origin track posz",    "fOTrack_posz"},
-    {"otrack_momx",      "Origin track momx",    "fOTrack_momx"},
-    {"otrack_momy",      "Origin track momy",    "fOTrack_momy"},
-    {"otrack_momz",      "Origin track momz",    "fOTrack_momz"},
-    {"otrack_polx",      "Origin track polx",    "fOTrack_polx"},
-    {"otrack_poly",      "Origin track poly",    "fOTrack_poly"},
-    {"otrack_polz",      "Origin track polz",    "fOTrack_polz"},
-    {"otrack_etot",      "Origin track Etot",    "fOTrack_Etot"},
-    {"otrack_t",         "Origin track T",       "fOTrack_T"},
     {"sdtrack_ntracks",  "SD track ntracks",      "fSDTrack_ntracks"},
-    {"sdtrack_tid",      "SD track TID",          "fSDTrack_TID"},
-    {"sdtrack_mid",      "SD track MID",          "fSDTrack_MID"},
-    {"sdtrack_pid",      "SD track PID",          "fSDTrack_PID"},
-    {"sdtrack_posx",     "SD track posx",    "fSDTrack_posx"},
-    {"sdtrack_posy",     "SD track posy",    "fSDTrack_posy"},
-    {"sdtrack_posz",     "SD track posz",    "fSDTrack_posz"},
-    {"sdtrack_momx",     "SD track momx",    "fSDTrack_momx"},
-    {"sdtrack_momy",     "SD track momy",    "fSDTrack_momy"},
-    {"sdtrack_momz",     "SD track momz",    "fSDTrack_momz"},
-    {"sdtrack_polx",     "SD track polx",    "fSDTrack_polx"},
-    {"sdtrack_poly",     "SD track poly",    "fSDTrack_poly"},
-    {"sdtrack_polz",     "SD track polz",    "fSDTrack_polz"},
-    {"sdtrack_etot",     "SD track Etot",    "fSDTrack_Etot"},
-    {"sdtrack_t",        "SD track T",       "fSDTrack_T"},
-    {"sdtrack_vx",       "SD track vx",    "fSDTrack_vx"},
-    {"sdtrack_vy",       "SD track vy",    "fSDTrack_vy"},
-    {"sdtrack_vz",       "SD track vz",    "fSDTrack_vz"},
-    {"sdtrack_vnx",      "SD track vnx",    "fSDTrack_vnx"},
-    {"sdtrack_vny",      "SD track vny",    "fSDTrack_vny"},
-    {"sdtrack_vnz",      "SD track vnz",    "fSDTrack_vnz"},
-    {"sdtrack_vEkin",    "SD track vEkin",  "fSDTrack_vEkin"},
     { 0 }
   };
 
-  return THaAnalysisObject::
+  // MC truth arrays: variable-size arrays pointing into the tree's buffers
+  VarDef arrays[] = {
+    {"bbtrack_nhits", "BB MC track hit mult", kIntP, 0, &fBBtrack_Nhits.data, &fBBtrack_Nhits.n},
+    {"bbtrack_tid", "BB MC track TID", kIntP, 0, &fBBtrack_TID.data, &fBBtrack_TID.n},
+    {"bbtrack_pid", "BB MC track PID", kIntP, 0, &fBBtrack_PID.data, &fBBtrack_PID.n},
+    {"bbtrack_mid", "BB MC track MID", kIntP, 0, &fBBtrack_MID.data, &fBBtrack_MID.n},
+    {"bbtrack_p", "BB MC track momentum", kDoubleP, 0, &fBBtrack_P.data, &fBBtrack_P.n},
+    {"bbtrack_x", "BB MC track transport X position", kDoubleP, 0, &fBBtrack_X.data, &fBBtrack_X.n},
+    {"bbtrack_y", "BB MC track transport Y position", kDoubleP, 0, &fBBtrack_Y.data, &fBBtrack_Y.n},
+    {"bbtrack_dx", "BB MC track transport dX slope", kDoubleP, 0, &fBBtrack_dX.data, &fBBtrack_dX.n},
+    {"bbtrack_dy", "BB MC track transport dY slope", kDoubleP, 0, &fBBtrack_dY.data, &fBBtrack_dY.n},
+    {"bbgemhit_plane", "BBGEM MC hit plane", kIntP, 0, &fBBGEMhit_plane.data, &fBBGEMhit_plane.n},
+    {"bbgemhit_tid", "BBGEM MC hit TID", kIntP, 0, &fBBGEMhit_TID.data, &fBBGEMhit_TID.n},
+    {"bbgemhit_pid", "BBGEM MC hit PID", kIntP, 0, &fBBGEMhit_PID.data, &fBBGEMhit_PID.n},
+    {"bbgemhit_mid", "BBGEM MC hit MID", kIntP, 0, &fBBGEMhit_MID.data, &fBBGEMhit_MID.n},
+    {"bbgemhit_edep", "BBGEM MC hit edep", kDoubleP, 0, &fBBGEMhit_edep.data, &fBBGEMhit_edep.n},
+    {"bbgemhit_x", "BBGEM MC hit transport X", kDoubleP, 0, &fBBGEMhit_x.data, &fBBGEMhit_x.n},
+    {"bbgemhit_y", "BBGEM MC hit transport Y", kDoubleP, 0, &fBBGEMhit_y.data, &fBBGEMhit_y.n},
+    {"gep.fttrack_nhits", "FT MC track hit mult", kIntP, 0, &fFTtrack_Nhits.data, &fFTtrack_Nhits.n},
+    {"gep.fttrack_tid", "FT MC track TID", kIntP, 0, &fFTtrack_TID.data, &fFTtrack_TID.n},
+    {"gep.fttrack_pid", "FT MC track PID", kIntP, 0, &fFTtrack_PID.data, &fFTtrack_PID.n},
+    {"gep.fttrack_mid", "FT MC track MID", kIntP, 0, &fFTtrack_MID.data, &fFTtrack_MID.n},
+    {"gep.fttrack_p", "FT MC track momentum", kDoubleP, 0, &fFTtrack_P.data, &fFTtrack_P.n},
+    {"gep.fttrack_x", "FT MC track transport X position", kDoubleP, 0, &fFTtrack_X.data, &fFTtrack_X.n},
+    {"gep.fttrack_y", "FT MC track transport Y position", kDoubleP, 0, &fFTtrack_Y.data, &fFTtrack_Y.n},
+    {"gep.fttrack_dx", "FT MC track transport dX slope", kDoubleP, 0, &fFTtrack_dX.data, &fFTtrack_dX.n},
+    {"gep.fttrack_dy", "FT MC track transport dY slope", kDoubleP, 0, &fFTtrack_dY.data, &fFTtrack_dY.n},
+    {"gep.ftgemhit_plane", "FTGEM MC hit plane", kIntP, 0, &fFTGEMhit_plane.data, &fFTGEMhit_plane.n},
+    {"gep.ftgemhit_tid", "FTGEM MC hit TID", kIntP, 0, &fFTGEMhit_TID.data, &fFTGEMhit_TID.n},
+    {"gep.ftgemhit_pid", "FTGEM MC hit PID", kIntP, 0, &fFTGEMhit_PID.data, &fFTGEMhit_PID.n},
+    {"gep.ftgemhit_mid", "FTGEM MC hit MID", kIntP, 0, &fFTGEMhit_MID.data, &fFTGEMhit_MID.n},
+    {"gep.ftgemhit_edep", "FTGEM MC hit edep", kDoubleP, 0, &fFTGEMhit_edep.data, &fFTGEMhit_edep.n},
+    {"gep.ftgemhit_x", "FTGEM MC hit transport X", kDoubleP, 0, &fFTGEMhit_x.data, &fFTGEMhit_x.n},
+    {"gep.ftgemhit_y", "FTGEM MC hit transport Y", kDoubleP, 0, &fFTGEMhit_y.data, &fFTGEMhit_y.n},
+    {"gep.fpptrack_nhits", "FPP MC track hit mult", kIntP, 0, &fFPPtrack_Nhits.data, &fFPPtrack_Nhits.n},
+    {"gep.fpptrack_tid", "FPP MC track TID", kIntP, 0, &fFPPtrack_TID.data, &fFPPtrack_TID.n},
+    {"gep.fpptrack_pid", "FPP MC track PID", kIntP, 0, &fFPPtrack_PID.data, &fFPPtrack_PID.n},
+    {"gep.fpptrack_mid", "FPP MC track MID", kIntP, 0, &fFPPtrack_MID.data, &fFPPtrack_MID.n},
+    {"gep.fpptrack_p", "FPP MC track momentum", kDoubleP, 0, &fFPPtrack_P.data, &fFPPtrack_P.n},
+    {"gep.fpptrack_x", "FPP MC track transport X position", kDoubleP, 0, &fFPPtrack_X.data, &fFPPtrack_X.n},
+    {"gep.fpptrack_y", "FPP MC track transport Y position", kDoubleP, 0, &fFPPtrack_Y.data, &fFPPtrack_Y.n},
+    {"gep.fpptrack_dx", "FPP MC track transport dX slope", kDoubleP, 0, &fFPPtrack_dX.data, &fFPPtrack_dX.n},
+    {"gep.fpptrack_dy", "FPP MC track transport dY slope", kDoubleP, 0, &fFPPtrack_dY.data, &fFPPtrack_dY.n},
+    {"gep.fppgemhit_plane", "FPPGEM MC hit plane", kIntP, 0, &fFPPGEMhit_plane.data, &fFPPGEMhit_plane.n},
+    {"gep.fppgemhit_tid", "FPPGEM MC hit TID", kIntP, 0, &fFPPGEMhit_TID.data, &fFPPGEMhit_TID.n},
+    {"gep.fppgemhit_pid", "FPPGEM MC hit PID", kIntP, 0, &fFPPGEMhit_PID.data, &fFPPGEMhit_PID.n},
+    {"gep.fppgemhit_mid", "FPPGEM MC hit MID", kIntP, 0, &fFPPGEMhit_MID.data, &fFPPGEMhit_MID.n},
+    {"gep.fppgemhit_edep", "FPPGEM MC hit edep", kDoubleP, 0, &fFPPGEMhit_edep.data, &fFPPGEMhit_edep.n},
+    {"gep.fppgemhit_x", "FPPGEM MC hit transport X", kDoubleP, 0, &fFPPGEMhit_x.data, &fFPPGEMhit_x.n},
+    {"gep.fppgemhit_y", "FPPGEM MC hit transport Y", kDoubleP, 0, &fFPPGEMhit_y.data, &fFPPGEMhit_y.n},
+    {"bbgemhit_ptridx", "Primary track index for BBGEM SD", kIntP, 0, &fBBGEMhit_ptridx.data, &fBBGEMhit_ptridx.n},
+    {"bbgemhit_otridx", "Origin track index for BBGEM SD", kIntP, 0, &fBBGEMhit_otridx.data, &fBBGEMhit_otridx.n},
+    {"bbgemhit_sdtridx", "SD track index for BBGEM SD", kIntP, 0, &fBBGEMhit_sdtridx.data, &fBBGEMhit_sdtridx.n},
+    {"bbgemtrack_ptridx", "Primary track index for BBGEM Track SD", kIntP, 0, &fBBGEMtrack_ptridx.data, &fBBGEMtrack_ptridx.n},
+    {"bbgemtrack_otridx", "Origin track index for BBGEM Track SD", kIntP, 0, &fBBGEMtrack_otridx.data, &fBBGEMtrack_otridx.n},
+    {"bbgemtrack_sdtridx", "SD track index for BBGEM Track SD", kIntP, 0, &fBBGEMtrack_sdtridx.data, &fBBGEMtrack_sdtridx.n},
+    {"bbhodohit_ptridx", "Primary track index for BBHodo SD", kIntP, 0, &fBBHODOhit_ptridx.data, &fBBHODOhit_ptridx.n},
+    {"bbhodohit_otridx", "Origin track index for BBHodo SD", kIntP, 0, &fBBHODOhit_otridx.data, &fBBHODOhit_otridx.n},
+    {"bbhodohit_sdtridx", "SD track index for BBHodo SD", kIntP, 0, &fBBHODOhit_sdtridx.data, &fBBHODOhit_sdtridx.n},
+    {"bbpshit_ptridx", "Primary track index for BBPSTF1 SD", kIntP, 0, &fBBPSTF1hit_ptridx.data, &fBBPSTF1hit_ptridx.n},
+    {"bbpshit_otridx", "Origin track index for BBPSTF1 SD", kIntP, 0, &fBBPSTF1hit_otridx.data, &fBBPSTF1hit_otridx.n},
+    {"bbpshit_sdtridx", "SD track index for BBPSTF1 SD", kIntP, 0, &fBBPSTF1hit_sdtridx.data, &fBBPSTF1hit_sdtridx.n},
+    {"bbshhit_ptridx", "Primary track index for BBSHTF1 SD", kIntP, 0, &fBBSHTF1hit_ptridx.data, &fBBSHTF1hit_ptridx.n},
+    {"bbshhit_otridx", "Origin track index for BBSHTF1 SD", kIntP, 0, &fBBSHTF1hit_otridx.data, &fBBSHTF1hit_otridx.n},
+    {"bbshhit_sdtridx", "SD track index for BBSHTF1 SD", kIntP, 0, &fBBSHTF1hit_sdtridx.data, &fBBSHTF1hit_sdtridx.n},
+    {"hcalhit_ptridx", "Primary track index for HCalScint SD", kIntP, 0, &fHCALhit_ptridx.data, &fHCALhit_ptridx.n},
+    {"hcalhit_otridx", "Origin track index for HCalScint SD", kIntP, 0, &fHCALhit_otridx.data, &fHCALhit_otridx.n},
+    {"hcalhit_sdtridx", "SD track index for HCalScint SD", kIntP, 0, &fHCALhit_sdtridx.data, &fHCALhit_sdtridx.n},
+    {"gep.ecalhit_ptridx", "Primary track index for ECal TF1 SD", kIntP, 0, &fECALhit_ptridx.data, &fECALhit_ptridx.n},
+    {"gep.ecalhit_otridx", "Origin track index for ECal TF1 SD", kIntP, 0, &fECALhit_otridx.data, &fECALhit_otridx.n},
+    {"gep.ecalhit_sdtridx", "SD track index for ECal TF1 SD", kIntP, 0, &fECALhit_sdtridx.data, &fECALhit_sdtridx.n},
+    {"gep.cdethit_ptridx", "Primary track index for CDETScint SD", kIntP, 0, &fCDEThit_ptridx.data, &fCDEThit_ptridx.n},
+    {"gep.cdethit_otridx", "Origin track index for CDETScint SD", kIntP, 0, &fCDEThit_otridx.data, &fCDEThit_otridx.n},
+    {"gep.cdethit_sdtridx", "SD track index for CDETScint SD", kIntP, 0, &fCDEThit_sdtridx.data, &fCDEThit_sdtridx.n},
+    {"gep.fthit_ptridx", "Primary track index for FT SD", kIntP, 0, &fFThit_ptridx.data, &fFThit_ptridx.n},
+    {"gep.fthit_otridx", "Origin track index for FT SD", kIntP, 0, &fFThit_otridx.data, &fFThit_otridx.n},
+    {"gep.fthit_sdtridx", "SD track index for FT SD", kIntP, 0, &fFThit_sdtridx.data, &fFThit_sdtridx.n},
+    {"gep.fttrack_ptridx", "Primary track index for FT Track SD", kIntP, 0, &fFTtrack_ptridx.data, &fFTtrack_ptridx.n},
+    {"gep.fttrack_otridx", "Origin track index for FT Track SD", kIntP, 0, &fFTtrack_otridx.data, &fFTtrack_otridx.n},
+    {"gep.fttrack_sdtridx", "SD track index for FT Track SD", kIntP, 0, &fFTtrack_sdtridx.data, &fFTtrack_sdtridx.n},
+    {"gep.fpphit_ptridx", "Primary track index for FPP SD", kIntP, 0, &fFPPhit_ptridx.data, &fFPPhit_ptridx.n},
+    {"gep.fpphit_otridx", "Origin track index for FPP SD", kIntP, 0, &fFPPhit_otridx.data, &fFPPhit_otridx.n},
+    {"gep.fpphit_sdtridx", "SD track index for FPP SD", kIntP, 0, &fFPPhit_sdtridx.data, &fFPPhit_sdtridx.n},
+    {"gep.fpptrack_ptridx", "Primary track index for FPP Track SD", kIntP, 0, &fFPPtrack_ptridx.data, &fFPPtrack_ptridx.n},
+    {"gep.fpptrack_otridx", "Origin track index for FPP Track SD", kIntP, 0, &fFPPtrack_otridx.data, &fFPPtrack_otridx.n},
+    {"gep.fpptrack_sdtridx", "SD track index for FPP Track SD", kIntP, 0, &fFPPtrack_sdtridx.data, &fFPPtrack_sdtridx.n},
+    {"ptrack_tid", "Primary track TID", kIntP, 0, &fPTrack_TID.data, &fPTrack_TID.n},
+    {"ptrack_pid", "Primary track PID", kIntP, 0, &fPTrack_PID.data, &fPTrack_PID.n},
+    {"ptrack_posx", "Primary track posx", kDoubleP, 0, &fPTrack_posx.data, &fPTrack_posx.n},
+    {"ptrack_posy", "Primary track posy", kDoubleP, 0, &fPTrack_posy.data, &fPTrack_posy.n},
+    {"ptrack_posz", "Primary track posz", kDoubleP, 0, &fPTrack_posz.data, &fPTrack_posz.n},
+    {"ptrack_momx", "Primary track momx", kDoubleP, 0, &fPTrack_momx.data, &fPTrack_momx.n},
+    {"ptrack_momy", "Primary track momy", kDoubleP, 0, &fPTrack_momy.data, &fPTrack_momy.n},
+    {"ptrack_momz", "Primary track momz", kDoubleP, 0, &fPTrack_momz.data, &fPTrack_momz.n},
+    {"ptrack_polx", "Primary track polx", kDoubleP, 0, &fPTrack_polx.data, &fPTrack_polx.n},
+    {"ptrack_poly", "Primary track poly", kDoubleP, 0, &fPTrack_poly.data, &fPTrack_poly.n},
+    {"ptrack_polz", "Primary track polz", kDoubleP, 0, &fPTrack_polz.data, &fPTrack_polz.n},
+    {"ptrack_etot", "Primary track Etot", kDoubleP, 0, &fPTrack_Etot.data, &fPTrack_Etot.n},
+    {"ptrack_t", "Primary track T", kDoubleP, 0, &fPTrack_T.data, &fPTrack_T.n},
+    {"otrack_tid", "Origin track TID", kIntP, 0, &fOTrack_TID.data, &fOTrack_TID.n},
+    {"otrack_pid", "Origin track PID", kIntP, 0, &fOTrack_PID.data, &fOTrack_PID.n},
+    {"otrack_posx", "Origin track posx", kDoubleP, 0, &fOTrack_posx.data, &fOTrack_posx.n},
+    {"otrack_posy", "Origin track posy", kDoubleP, 0, &fOTrack_posy.data, &fOTrack_posy.n},
+    {"otrack_posz", "Origin track posz", kDoubleP, 0, &fOTrack_posz.data, &fOTrack_posz.n},
+    {"otrack_momx", "Origin track momx", kDoubleP, 0, &fOTrack_momx.data, &fOTrack_momx.n},
+    {"otrack_momy", "Origin track momy", kDoubleP, 0, &fOTrack_momy.data, &fOTrack_momy.n},
+    {"otrack_momz", "Origin track momz", kDoubleP, 0, &fOTrack_momz.data, &fOTrack_momz.n},
+    {"otrack_polx", "Origin track polx", kDoubleP, 0, &fOTrack_polx.data, &fOTrack_polx.n},
+    {"otrack_poly", "Origin track poly", kDoubleP, 0, &fOTrack_poly.data, &fOTrack_poly.n},
+    {"otrack_polz", "Origin track polz", kDoubleP, 0, &fOTrack_polz.data, &fOTrack_polz.n},
+    {"otrack_etot", "Origin track Etot", kDoubleP, 0, &fOTrack_Etot.data, &fOTrack_Etot.n},
+    {"otrack_t", "Origin track T", kDoubleP, 0, &fOTrack_T.data, &fOTrack_T.n},
+    {"sdtrack_tid", "SD track TID", kIntP, 0, &fSDTrack_TID.data, &fSDTrack_TID.n},
+    {"sdtrack_mid", "SD track MID", kIntP, 0, &fSDTrack_MID.data, &fSDTrack_MID.n},
+    {"sdtrack_pid", "SD track PID", kIntP, 0, &fSDTrack_PID.data, &fSDTrack_PID.n},
+    {"sdtrack_posx", "SD track posx", kDoubleP, 0, &fSDTrack_posx.data, &fSDTrack_posx.n},
+    {"sdtrack_posy", "SD track posy", kDoubleP, 0, &fSDTrack_posy.data, &fSDTrack_posy.n},
+    {"sdtrack_posz", "SD track posz", kDoubleP, 0, &fSDTrack_posz.data, &fSDTrack_posz.n},
+    {"sdtrack_momx", "SD track momx", kDoubleP, 0, &fSDTrack_momx.data, &fSDTrack_momx.n},
+    {"sdtrack_momy", "SD track momy", kDoubleP, 0, &fSDTrack_momy.data, &fSDTrack_momy.n},
+    {"sdtrack_momz", "SD track momz", kDoubleP, 0, &fSDTrack_momz.data, &fSDTrack_momz.n},
+    {"sdtrack_polx", "SD track polx", kDoubleP, 0, &fSDTrack_polx.data, &fSDTrack_polx.n},
+    {"sdtrack_poly", "SD track poly", kDoubleP, 0, &fSDTrack_poly.data, &fSDTrack_poly.n},
+    {"sdtrack_polz", "SD track polz", kDoubleP, 0, &fSDTrack_polz.data, &fSDTrack_polz.n},
+    {"sdtrack_etot", "SD track Etot", kDoubleP, 0, &fSDTrack_Etot.data, &fSDTrack_Etot.n},
+    {"sdtrack_t", "SD track T", kDoubleP, 0, &fSDTrack_T.data, &fSDTrack_T.n},
+    {"sdtrack_vx", "SD track vx", kDoubleP, 0, &fSDTrack_vx.data, &fSDTrack_vx.n},
+    {"sdtrack_vy", "SD track vy", kDoubleP, 0, &fSDTrack_vy.data, &fSDTrack_vy.n},
+    {"sdtrack_vz", "SD track vz", kDoubleP, 0, &fSDTrack_vz.data, &fSDTrack_vz.n},
+    {"sdtrack_vnx", "SD track vnx", kDoubleP, 0, &fSDTrack_vnx.data, &fSDTrack_vnx.n},
+    {"sdtrack_vny", "SD track vny", kDoubleP, 0, &fSDTrack_vny.data, &fSDTrack_vny.n},
+    {"sdtrack_vnz", "SD track vnz", kDoubleP, 0, &fSDTrack_vnz.data, &fSDTrack_vnz.n},
+    {"sdtrack_vEkin", "SD track vEkin", kDoubleP, 0, &fSDTrack_vEkin.data, &fSDTrack_vEkin.n},
+    { 0 }
+  };
+
+  Int_t err = THaAnalysisObject::
     DefineVarsFromList( vars, THaAnalysisObject::kRVarDef,
 			mode, "", this, Podd::MC_PREFIX, here );
+  if( err )
+    return err;
+  return THaAnalysisObject::
+    DefineVarsFromList( arrays, THaAnalysisObject::kVarDef,
+			mode, "", this, Podd::MC_PREFIX, here );
 }
 
 //-----------------------------------------------------------------------------
@@ -393,34 +405,38 @@ Int_t SBSSimDecoder::DoLoadEvent(const Int_t* evbuffer )
   const SBSSimEvent* simEvent = reinterpret_cast<const SBSSimEvent*>(buffer);
   // add a check here!!!
   
+  // MC truth groups not used by the output are not read from the tree
+  // (see SBSSimFile::SelectBranches), so they are skipped here as well.
   //simc variables
   if(simEvent->GetExperiment()==kGEp){
-    fSigma_simc = simEvent->Tgep->simc_sigma;
-    fWeight_simc = simEvent->Tgep->simc_Weight;
-    fQ2_simc = simEvent->Tgep->simc_Q2;
-    fXbj_simc = simEvent->Tgep->simc_xbj;
-    fNu_simc = simEvent->Tgep->simc_nu;
-    fW_simc = simEvent->Tgep->simc_W;
-    fEpsilon_simc = simEvent->Tgep->simc_epsilon;
-    fEbeam_simc = simEvent->Tgep->simc_Ebeam;
-    fEp_simc = simEvent->Tgep->simc_p_e;
-    fEtheta_simc = simEvent->Tgep->simc_theta_e;
-    fEphi_simc = simEvent->Tgep->simc_phi_e;
-    fEPx_simc = simEvent->Tgep->simc_px_e;
-    fEPy_simc = simEvent->Tgep->simc_py_e;
-    fEPz_simc = simEvent->Tgep->simc_pz_e;
-    fFnucl_simc = simEvent->Tgep->simc_fnucl;
-    fNp_simc = simEvent->Tgep->simc_p_n;
-    fNtheta_simc = simEvent->Tgep->simc_theta_n;
-    fNphi_simc = simEvent->Tgep->simc_phi_n;
-    fNPx_simc = simEvent->Tgep->simc_px_n;
-    fNPy_simc = simEvent->Tgep->simc_py_n;
-    fNPz_simc = simEvent->Tgep->simc_pz_n;
-    fVx_simc = simEvent->Tgep->simc_vx;
-    fVy_simc = simEvent->Tgep->simc_vy;
-    fVz_simc = simEvent->Tgep->simc_vz;
-    fVeE_simc = simEvent->Tgep->simc_veE;
-    fVetheta_simc = simEvent->Tgep->simc_vetheta;
+    if( simEvent->fReadMCTruth[kSimcTruth] ){
+      fSigma_simc = simEvent->Tgep->simc_sigma;
+      fWeight_simc = simEvent->Tgep->simc_Weight;
+      fQ2_simc = simEvent->Tgep->simc_Q2;
+      fXbj_simc = simEvent->Tgep->simc_xbj;
+      fNu_simc = simEvent->Tgep->simc_nu;
+      fW_simc = simEvent->Tgep->simc_W;
+      fEpsilon_simc = simEvent->Tgep->simc_epsilon;
+      fEbeam_simc = simEvent->Tgep->simc_Ebeam;
+      fEp_simc = simEvent->Tgep->simc_p_e;
+      fEtheta_simc = simEvent->Tgep->simc_theta_e;
+      fEphi_simc = simEvent->Tgep->simc_phi_e;
+      fEPx_simc = simEvent->Tgep->simc_px_e;
+      fEPy_simc = simEvent->Tgep->simc_py_e;
+      fEPz_simc = simEvent->Tgep->simc_pz_e;
+      fFnucl_simc = simEvent->Tgep->simc_fnucl;
+      fNp_simc = simEvent->Tgep->simc_p_n;
+      fNtheta_simc = simEvent->Tgep->simc_theta_n;
+      fNphi_simc = simEvent->Tgep->simc_phi_n;
+      fNPx_simc = simEvent->Tgep->simc_px_n;
+      fNPy_simc = simEvent->Tgep->simc_py_n;
+      fNPz_simc = simEvent->Tgep->simc_pz_n;
+      fVx_simc = simEvent->Tgep->simc_vx;
+      fVy_simc = simEvent->Tgep->simc_vy;
+      fVz_simc = simEvent->Tgep->simc_vz;
+      fVeE_simc = simEvent->Tgep->simc_veE;
+      fVetheta_simc = simEvent->Tgep->simc_vetheta;
+    }
     //g4sbs variables
     fSigma = simEvent->Tgep->ev_sigma;
     fOmega = simEvent->Tgep->ev_solang;
@@ -437,126 +453,136 @@ Int_t SBSSimDecoder::DoLoadEvent(const Int_t* evbuffer )
     fNp = simEvent->Tgep->ev_np;
     fNucl = simEvent->Tgep->ev_nucl;
     fFnucl = simEvent->Tgep->ev_fnucl;
-    fNFTtracks = simEvent->Tgep->Harm_FT_Track_ntracks;
-    fFTtrack_Nhits = *(simEvent->Tgep->Harm_FT_Track_NumHits);
-    fFTtrack_TID = *(simEvent->Tgep->Harm_FT_Track_TID);
-    fFTtrack_PID = *(simEvent->Tgep->Harm_FT_Track_PID);
-    fFTtrack_MID = *(simEvent->Tgep->Harm_FT_Track_MID);
-    fFTtrack_P = *(simEvent->Tgep->Harm_FT_Track_P);
-    fFTtrack_X = *(simEvent->Tgep->Harm_FT_Track_X);
-    fFTtrack_Y = *(simEvent->Tgep->Harm_FT_Track_Y);
-    fFTtrack_dX = *(simEvent->Tgep->Harm_FT_Track_Xp);
-    fFTtrack_dY = *(simEvent->Tgep->Harm_FT_Track_Yp);
-    fNFTGEMhits = simEvent->Tgep->Harm_FT_hit_nhits;
-    fFTGEMhit_plane = *(simEvent->Tgep->Harm_FT_hit_plane);
-    fFTGEMhit_TID = *(simEvent->Tgep->Harm_FT_hit_trid);
-    fFTGEMhit_PID = *(simEvent->Tgep->Harm_FT_hit_pid);
-    fFTGEMhit_MID = *(simEvent->Tgep->Harm_FT_hit_mid);
-    fFTGEMhit_edep = *(simEvent->Tgep->Harm_FT_hit_edep);
-    fFTGEMhit_x = *(simEvent->Tgep->Harm_FT_hit_tx);
-    fFTGEMhit_y = *(simEvent->Tgep->Harm_FT_hit_ty);
-    fNFPPtracks = simEvent->Tgep->Harm_FPP1_Track_ntracks;
-    fFPPtrack_Nhits = *(simEvent->Tgep->Harm_FPP1_Track_NumHits);
-    fFPPtrack_TID = *(simEvent->Tgep->Harm_FPP1_Track_TID);
-    fFPPtrack_PID = *(simEvent->Tgep->Harm_FPP1_Track_PID);
-    fFPPtrack_MID = *(simEvent->Tgep->Harm_FPP1_Track_MID);
-    fFPPtrack_P = *(simEvent->Tgep->Harm_FPP1_Track_P);
-    fFPPtrack_X = *(simEvent->Tgep->Harm_FPP1_Track_X);
-    fFPPtrack_Y = *(simEvent->Tgep->Harm_FPP1_Track_Y);
-    fFPPtrack_dX = *(simEvent->Tgep->Harm_FPP1_Track_Xp);
-    fFPPtrack_dY = *(simEvent->Tgep->Harm_FPP1_Track_Yp);
-    fNFPPGEMhits = simEvent->Tgep->Harm_FPP1_hit_nhits;
-    fFPPGEMhit_plane = *(simEvent->Tgep->Harm_FPP1_hit_plane);
-    fFPPGEMhit_TID = *(simEvent->Tgep->Harm_FPP1_hit_trid);
-    fFPPGEMhit_PID = *(simEvent->Tgep->Harm_FPP1_hit_pid);
-    fFPPGEMhit_MID = *(simEvent->Tgep->Harm_FPP1_hit_mid);
-    fFPPGEMhit_edep = *(simEvent->Tgep->Harm_FPP1_hit_edep);
-    fFPPGEMhit_x = *(simEvent->Tgep->Harm_FPP1_hit_tx);
-    fFPPGEMhit_y = *(simEvent->Tgep->Harm_FPP1_hit_ty);
+    if( simEvent->fReadMCTruth[kGEMTruth] ){
+      fNFTtracks = simEvent->Tgep->Harm_FT_Track_ntracks;
+      fFTtrack_Nhits.Set(simEvent->Tgep->Harm_FT_Track_NumHits);
+      fFTtrack_TID.Set(simEvent->Tgep->Harm_FT_Track_TID);
+      fFTtrack_PID.Set(simEvent->Tgep->Harm_FT_Track_PID);
+      fFTtrack_MID.Set(simEvent->Tgep->Harm_FT_Track_MID);
+      fFTtrack_P.Set(simEvent->Tgep->Harm_FT_Track_P);
+      fFTtrack_X.Set(simEvent->Tgep->Harm_FT_Track_X);
+      fFTtrack_Y.Set(simEvent->Tgep->Harm_FT_Track_Y);
+      fFTtrack_dX.Set(simEvent->Tgep->Harm_FT_Track_Xp);
+      fFTtrack_dY.Set(simEvent->Tgep->Harm_FT_Track_Yp);
+      fNFTGEMhits = simEvent->Tgep->Harm_FT_hit_nhits;
+      fFTGEMhit_plane.Set(simEvent->Tgep->Harm_FT_hit_plane);
+      fFTGEMhit_TID.Set(simEvent->Tgep->Harm_FT_hit_trid);
+      fFTGEMhit_PID.Set(simEvent->Tgep->Harm_FT_hit_pid);
+      fFTGEMhit_MID.Set(simEvent->Tgep->Harm_FT_hit_mid);
+      fFTGEMhit_edep.Set(simEvent->Tgep->Harm_FT_hit_edep);
+      fFTGEMhit_x.Set(simEvent->Tgep->Harm_FT_hit_tx);
+      fFTGEMhit_y.Set(simEvent->Tgep->Harm_FT_hit_ty);
+      fNFPPtracks = simEvent->Tgep->Harm_FPP1_Track_ntracks;
+      fFPPtrack_Nhits.Set(simEvent->Tgep->Harm_FPP1_Track_NumHits);
+      fFPPtrack_TID.Set(simEvent->Tgep->Harm_FPP1_Track_TID);
+      fFPPtrack_PID.Set(simEvent->Tgep->Harm_FPP1_Track_PID);
+      fFPPtrack_MID.Set(simEvent->Tgep->Harm_FPP1_Track_MID);
+      fFPPtrack_P.Set(simEvent->Tgep->Harm_FPP1_Track_P);
+      fFPPtrack_X.Set(simEvent->Tgep->Harm_FPP1_Track_X);
+      fFPPtrack_Y.Set(simEvent->Tgep->Harm_FPP1_Track_Y);
+      fFPPtrack_dX.Set(simEvent->Tgep->Harm_FPP1_Track_Xp);
+      fFPPtrack_dY.Set(simEvent->Tgep->Harm_FPP1_Track_Yp);
+      fNFPPGEMhits = simEvent->Tgep->Harm_FPP1_hit_nhits;
+      fFPPGEMhit_plane.Set(simEvent->Tgep->Harm_FPP1_hit_plane);
+      fFPPGEMhit_TID.Set(simEvent->Tgep->Harm_FPP1_hit_trid);
+      fFPPGEMhit_PID.Set(simEvent->Tgep->Harm_FPP1_hit_pid);
+      fFPPGEMhit_MID.Set(simEvent->Tgep->Harm_FPP1_hit_mid);
+      fFPPGEMhit_edep.Set(simEvent->Tgep->Harm_FPP1_hit_edep);
+      fFPPGEMhit_x.Set(simEvent->Tgep->Harm_FPP1_hit_tx);
+      fFPPGEMhit_y.Set(simEvent->Tgep->Harm_FPP1_hit_ty);
+    }
     
-    fHCAL_esum = simEvent->Tgep->Harm_HCalScint_det_esum;
-    fECAL_esum = simEvent->Tgep->Earm_ECalTF1_det_esum;
+    if( simEvent->fReadMCTruth[kEsumTruth] ){
+      fHCAL_esum = simEvent->Tgep->Harm_HCalScint_det_esum;
+      fECAL_esum = simEvent->Tgep->Earm_ECalTF1_det_esum;
+    }
     
-    fHCALhit_ptridx = *(simEvent->Tgep->Harm_HCalScint_hit_ptridx);
-    fHCALhit_otridx = *(simEvent->Tgep->Harm_HCalScint_hit_otridx);
-    fHCALhit_sdtridx = *(simEvent->Tgep->Harm_HCalScint_hit_sdtridx);
-    fPTrack_ntracks = simEvent->Tgep->PTrack_ntracks;
-    fPTrack_TID = *(simEvent->Tgep->PTrack_TID);
-    fPTrack_PID = *(simEvent->Tgep->PTrack_PID);
-    fPTrack_posx = *(simEvent->Tgep->PTrack_posx);
-    fPTrack_posy = *(simEvent->Tgep->PTrack_posy);
-    fPTrack_posz = *(simEvent->Tgep->PTrack_posz);
-    fPTrack_momx = *(simEvent->Tgep->PTrack_momx);
-    fPTrack_momy = *(simEvent->Tgep->PTrack_momy);
-    fPTrack_momz = *(simEvent->Tgep->PTrack_momz);
-    fPTrack_polx = *(simEvent->Tgep->PTrack_polx);
-    fPTrack_poly = *(simEvent->Tgep->PTrack_poly);
-    fPTrack_polz = *(simEvent->Tgep->PTrack_polz);
-    fPTrack_Etot = *(simEvent->Tgep->PTrack_Etot);
-    fPTrack_T = *(simEvent->Tgep->PTrack_T);
-    fOTrack_ntracks = simEvent->Tgep->OTrack_ntracks;
-    fOTrack_TID = *(simEvent->Tgep->OTrack_TID);
-    fOTrack_PID = *(simEvent->Tgep->OTrack_PID);
-    fOTrack_posx = *(simEvent->Tgep->OTrack_posx);
-    fOTrack_posy = *(simEvent->Tgep->OTrack_posy);
-    fOTrack_posz = *(simEvent->Tgep->OTrack_posz);
-    fOTrack_momx = *(simEvent->Tgep->OTrack_momx);
-    fOTrack_momy = *(simEvent->Tgep->OTrack_momy);
-    fOTrack_momz = *(simEvent->Tgep->OTrack_momz);
-    fOTrack_polx = *(simEvent->Tgep->OTrack_polx);
-    fOTrack_poly = *(simEvent->Tgep->OTrack_poly);
-    fOTrack_polz = *(simEvent->Tgep->OTrack_polz);
-    fOTrack_Etot = *(simEvent->Tgep->OTrack_Etot);
-    fOTrack_T = *(simEvent->Tgep->OTrack_T);
-    fSDTrack_ntracks = simEvent->Tgep->SDTrack_ntracks;
-    fSDTrack_TID = *(simEvent->Tgep->SDTrack_TID);
-    fSDTrack_MID = *(simEvent->Tgep->SDTrack_MID);
-    fSDTrack_PID = *(simEvent->Tgep->SDTrack_PID);
-    fSDTrack_posx = *(simEvent->Tgep->SDTrack_posx);
-    fSDTrack_posy = *(simEvent->Tgep->SDTrack_posy);
-    fSDTrack_posz = *(simEvent->Tgep->SDTrack_posz);
-    fSDTrack_momx = *(simEvent->Tgep->SDTrack_momx);
-    fSDTrack_momy = *(simEvent->Tgep->SDTrack_momy);
-    fSDTrack_momz = *(simEvent->Tgep->SDTrack_momz);
-    fSDTrack_polx = *(simEvent->Tgep->SDTrack_polx);
-    fSDTrack_poly = *(simEvent->Tgep->SDTrack_poly);
-    fSDTrack_polz = *(simEvent->Tgep->SDTrack_polz);
-    fSDTrack_Etot = *(simEvent->Tgep->SDTrack_Etot);
-    fSDTrack_T = *(simEvent->Tgep->SDTrack_T);
-    fSDTrack_vx = *(simEvent->Tgep->SDTrack_vx);
-    fSDTrack_vy = *(simEvent->Tgep->SDTrack_vy);
-    fSDTrack_vz = *(simEvent->Tgep->SDTrack_vz);
-    fSDTrack_vnx = *(simEvent->Tgep->SDTrack_vnx);
-    fSDTrack_vny = *(simEvent->Tgep->SDTrack_vny);
-    fSDTrack_vnz = *(simEvent->Tgep->SDTrack_vnz);
-    fSDTrack_vEkin = *(simEvent->Tgep->SDTrack_vEkin);
+    if( simEvent->fReadMCTruth[kTrackIdxTruth] ){
+      fHCALhit_ptridx.Set(simEvent->Tgep->Harm_HCalScint_hit_ptridx);
+      fHCALhit_otridx.Set(simEvent->Tgep->Harm_HCalScint_hit_otridx);
+      fHCALhit_sdtridx.Set(simEvent->Tgep->Harm_HCalScint_hit_sdtridx);
+    }
+    if( simEvent->fReadMCTruth[kTrackTruth] ){
+      fPTrack_ntracks = simEvent->Tgep->PTrack_ntracks;
+      fPTrack_TID.Set(simEvent->Tgep->PTrack_TID);
+      fPTrack_PID.Set(simEvent->Tgep->PTrack_PID);
+      fPTrack_posx.Set(simEvent->Tgep->PTrack_posx);
+      fPTrack_posy.Set(simEvent->Tgep->PTrack_posy);
+      fPTrack_posz.Set(simEvent->Tgep->PTrack_posz);
+      fPTrack_momx.Set(simEvent->Tgep->PTrack_momx);
+      fPTrack_momy.Set(simEvent->Tgep->PTrack_momy);
+      fPTrack_momz.Set(simEvent->Tgep->PTrack_momz);
+      fPTrack_polx.Set(simEvent->Tgep->PTrack_polx);
+      fPTrack_poly.Set(simEvent->Tgep->PTrack_poly);
+      fPTrack_polz.Set(simEvent->Tgep->PTrack_polz);
+      fPTrack_Etot.Set(simEvent->Tgep->PTrack_Etot);
+      fPTrack_T.Set(simEvent->Tgep->PTrack_T);
+      fOTrack_ntracks = simEvent->Tgep->OTrack_ntracks;
+      fOTrack_TID.Set(simEvent->Tgep->OTrack_TID);
+      fOTrack_PID.Set(simEvent->Tgep->OTrack_PID);
+      fOTrack_posx.Set(simEvent->Tgep->OTrack_posx);
+      fOTrack_posy.Set(simEvent->Tgep->OTrack_posy);
+      fOTrack_posz.Set(simEvent->Tgep->OTrack_posz);
+      fOTrack_momx.Set(simEvent->Tgep->OTrack_momx);
+      fOTrack_momy.Set(simEvent->Tgep->OTrack_momy);
+      fOTrack_momz.Set(simEvent->Tgep->OTrack_momz);
+      fOTrack_polx.Set(simEvent->Tgep->OTrack_polx);
+      fOTrack_poly.Set(simEvent->Tgep->OTrack_poly);
+      fOTrack_polz.Set(simEvent->Tgep->OTrack_polz);
+      fOTrack_Etot.Set(simEvent->Tgep->OTrack_Etot);
+      fOTrack_T.Set(simEvent->Tgep->OTrack_T);
+      fSDTrack_ntracks = simEvent->Tgep->SDTrack_ntracks;
+      fSDTrack_TID.Set(simEvent->Tgep->SDTrack_TID);
+      fSDTrack_MID.Set(simEvent->Tgep->SDTrack_MID);
+      fSDTrack_PID.Set(simEvent->Tgep->SDTrack_PID);
+      fSDTrack_posx.Set(simEvent->Tgep->SDTrack_posx);
+      fSDTrack_posy.Set(simEvent->Tgep->SDTrack_posy);
+      fSDTrack_posz.Set(simEvent->Tgep->SDTrack_posz);
+      fSDTrack_momx.Set(simEvent->Tgep->SDTrack_momx);
+      fSDTrack_momy.Set(simEvent->Tgep->SDTrack_momy);
+      fSDTrack_momz.Set(simEvent->Tgep->SDTrack_momz);
+      fSDTrack_polx.Set(simEvent->Tgep->SDTrack_polx);
+      fSDTrack_poly.Set(simEvent->Tgep->SDTrack_poly);
+      fSDTrack_polz.Set(simEvent->Tgep->SDTrack_polz);
+      fSDTrack_Etot.Set(simEvent->Tgep->SDTrack_Etot);
+      fSDTrack_T.Set(simEvent->Tgep->SDTrack_T);
+      fSDTrack_vx.Set(simEvent->Tgep->SDTrack_vx);
+      fSDTrack_vy.Set(simEvent->Tgep->SDTrack_vy);
+      fSDTrack_vz.Set(simEvent->Tgep->SDTrack_vz);
+      fSDTrack_vnx.Set(simEvent->Tgep->SDTrack_vnx);
+      fSDTrack_vny.Set(simEvent->Tgep->SDTrack_vny);
+      fSDTrack_vnz.Set(simEvent->Tgep->SDTrack_vnz);
+      fSDTrack_vEkin.Set(simEvent->Tgep->SDTrack_vEkin);
+    }
   }else{
-    fSigma_simc = simEvent->Tgmn->simc_sigma;
-    fWeight_simc = simEvent->Tgmn->simc_Weight;
-    fQ2_simc = simEvent->Tgmn->simc_Q2;
-    fXbj_simc = simEvent->Tgmn->simc_xbj;
-    fNu_simc = simEvent->Tgmn->simc_nu;
-    fW_simc = simEvent->Tgmn->simc_W;
-    fEpsilon_simc = simEvent->Tgmn->simc_epsilon;
-    fEbeam_simc = simEvent->Tgmn->simc_Ebeam;
-    fEp_simc = simEvent->Tgmn->simc_p_e;
-    fEtheta_simc = simEvent->Tgmn->simc_theta_e;
-    fEphi_simc = simEvent->Tgmn->simc_phi_e;
-    fEPx_simc = simEvent->Tgmn->simc_px_e;
-    fEPy_simc = simEvent->Tgmn->simc_py_e;
-    fEPz_simc = simEvent->Tgmn->simc_pz_e;
-    fFnucl_simc = simEvent->Tgmn->simc_fnucl;
-    fNp_simc = simEvent->Tgmn->simc_p_n;
-    fNtheta_simc = simEvent->Tgmn->simc_theta_n;
-    fNphi_simc = simEvent->Tgmn->simc_phi_n;
-    fNPx_simc = simEvent->Tgmn->simc_px_n;
-    fNPy_simc = simEvent->Tgmn->simc_py_n;
-    fNPz_simc = simEvent->Tgmn->simc_pz_n;
-    fVx_simc = simEvent->Tgmn->simc_vx;
-    fVy_simc = simEvent->Tgmn->simc_vy;
-    fVz_simc = simEvent->Tgmn->simc_vz;
-    fVeE_simc = simEvent->Tgmn->simc_veE;
-    fVetheta_simc = simEvent->Tgmn->simc_vetheta;
+    if( simEvent->fReadMCTruth[kSimcTruth] ){
+      fSigma_simc = simEvent->Tgmn->simc_sigma;
+      fWeight_simc = simEvent->Tgmn->simc_Weight;
+      fQ2_simc = simEvent->Tgmn->simc_Q2;
+      fXbj_simc = simEvent->Tgmn->simc_xbj;
+      fNu_simc = simEvent->Tgmn->simc_nu;
+      fW_simc = simEvent->Tgmn->simc_W;
+      fEpsilon_simc = simEvent->Tgmn->simc_epsilon;
+      fEbeam_simc = simEvent->Tgmn->simc_Ebeam;
+      fEp_simc = simEvent->Tgmn->simc_p_e;
+      fEtheta_simc = simEvent->Tgmn->simc_theta_e;
+      fEphi_simc = simEvent->Tgmn->simc_phi_e;
+      fEPx_simc = simEvent->Tgmn->simc_px_e;
+      fEPy_simc = simEvent->Tgmn->simc_py_e;
+      fEPz_simc = simEvent->Tgmn->simc_pz_e;
+      fFnucl_simc = simEvent->Tgmn->simc_fnucl;
+      fNp_simc = simEvent->Tgmn->simc_p_n;
+      fNtheta_simc = simEvent->Tgmn->simc_theta_n;
+      fNphi_simc = simEvent->Tgmn->simc_phi_n;
+      fNPx_simc = simEvent->Tgmn->simc_px_n;
+      fNPy_simc = simEvent->Tgmn->simc_py_n;
+      fNPz_simc = simEvent->Tgmn->simc_pz_n;
+      fVx_simc = simEvent->Tgmn->simc_vx;
+      fVy_simc = simEvent->Tgmn->simc_vy;
+      fVz_simc = simEvent->Tgmn->simc_vz;
+      fVeE_simc = simEvent->Tgmn->simc_veE;
+      fVetheta_simc = simEvent->Tgmn->simc_vetheta;
+    }
     //g4sbs variables
     fSigma = simEvent->Tgmn->ev_sigma;
     fOmega = simEvent->Tgmn->ev_solang;
@@ -573,94 +599,102 @@ Int_t SBSSimDecoder::DoLoadEvent(const Int_t* evbuffer )
     fNp = simEvent->Tgmn->ev_np;
     fNucl = simEvent->Tgmn->ev_nucl;
     fFnucl = simEvent->Tgmn->ev_fnucl;
-    fNBBtracks = simEvent->Tgmn->Earm_BBGEM_Track_ntracks;
-    fBBtrack_Nhits = *(simEvent->Tgmn->Earm_BBGEM_Track_NumHits);
-    fBBtrack_TID = *(simEvent->Tgmn->Earm_BBGEM_Track_TID);
-    fBBtrack_PID = *(simEvent->Tgmn->Earm_BBGEM_Track_PID);
-    fBBtrack_MID = *(simEvent->Tgmn->Earm_BBGEM_Track_MID);
-    fBBtrack_P = *(simEvent->Tgmn->Earm_BBGEM_Track_P);
-    fBBtrack_X = *(simEvent->Tgmn->Earm_BBGEM_Track_X);
-    fBBtrack_Y = *(simEvent->Tgmn->Earm_BBGEM_Track_Y);
-    fBBtrack_dX = *(simEvent->Tgmn->Earm_BBGEM_Track_Xp);
-    fBBtrack_dY = *(simEvent->Tgmn->Earm_BBGEM_Track_Yp);
-    fNBBGEMhits = simEvent->Tgmn->Earm_BBGEM_hit_nhits;
-    fBBGEMhit_plane = *(simEvent->Tgmn->Earm_BBGEM_hit_plane);
-    fBBGEMhit_TID = *(simEvent->Tgmn->Earm_BBGEM_hit_trid);
-    fBBGEMhit_PID = *(simEvent->Tgmn->Earm_BBGEM_hit_pid);
-    fBBGEMhit_MID = *(simEvent->Tgmn->Earm_BBGEM_hit_mid);
-    fBBGEMhit_edep = *(simEvent->Tgmn->Earm_BBGEM_hit_edep);
-    fBBGEMhit_x = *(simEvent->Tgmn->Earm_BBGEM_hit_tx);
-    fBBGEMhit_y = *(simEvent->Tgmn->Earm_BBGEM_hit_ty);
-    fBBPS_esum = simEvent->Tgmn->Earm_BBPSTF1_det_esum;
-    fBBSH_esum = simEvent->Tgmn->Earm_BBSHTF1_det_esum;
-    fBBGEMhit_ptridx = *(simEvent->Tgmn->Earm_BBGEM_hit_ptridx);
-    fBBGEMhit_otridx = *(simEvent->Tgmn->Earm_BBGEM_hit_otridx);
-    fBBGEMhit_sdtridx = *(simEvent->Tgmn->Earm_BBGEM_hit_sdtridx);
-    fBBGEMtrack_ptridx = *(simEvent->Tgmn->Earm_BBGEM_Track_ptridx);
-    fBBGEMtrack_otridx = *(simEvent->Tgmn->Earm_BBGEM_Track_otridx);
-    fBBGEMtrack_sdtridx = *(simEvent->Tgmn->Earm_BBGEM_Track_sdtridx);
-    fBBHODOhit_ptridx = *(simEvent->Tgmn->Earm_BBHodoScint_hit_ptridx);
-    fBBHODOhit_otridx = *(simEvent->Tgmn->Earm_BBHodoScint_hit_otridx);
-    fBBHODOhit_sdtridx = *(simEvent->Tgmn->Earm_BBHodoScint_hit_sdtridx);
-    fBBPSTF1hit_ptridx = *(simEvent->Tgmn->Earm_BBPSTF1_hit_ptridx);
-    fBBPSTF1hit_otridx = *(simEvent->Tgmn->Earm_BBPSTF1_hit_otridx);
-    fBBPSTF1hit_sdtridx = *(simEvent->Tgmn->Earm_BBPSTF1_hit_sdtridx);
-    fBBSHTF1hit_ptridx = *(simEvent->Tgmn->Earm_BBSHTF1_hit_ptridx);
-    fBBSHTF1hit_otridx = *(simEvent->Tgmn->Earm_BBSHTF1_hit_otridx);
-    fBBSHTF1hit_sdtridx = *(simEvent->Tgmn->Earm_BBSHTF1_hit_sdtridx);
-    fHCALhit_ptridx = *(simEvent->Tgmn->Harm_HCalScint_hit_ptridx);
-    fHCALhit_otridx = *(simEvent->Tgmn->Harm_HCalScint_hit_otridx);
-    fHCALhit_sdtridx = *(simEvent->Tgmn->Harm_HCalScint_hit_sdtridx);
-    fPTrack_ntracks = simEvent->Tgmn->PTrack_ntracks;
-    fPTrack_TID = *(simEvent->Tgmn->PTrack_TID);
-    fPTrack_PID = *(simEvent->Tgmn->PTrack_PID);
-    fPTrack_posx = *(simEvent->Tgmn->PTrack_posx);
-    fPTrack_posy = *(simEvent->Tgmn->PTrack_posy);
-    fPTrack_posz = *(simEvent->Tgmn->PTrack_posz);
-    fPTrack_momx = *(simEvent->Tgmn->PTrack_momx);
-    fPTrack_momy = *(simEvent->Tgmn->PTrack_momy);
-    fPTrack_momz = *(simEvent->Tgmn->PTrack_momz);
-    fPTrack_polx = *(simEvent->Tgmn->PTrack_polx);
-    fPTrack_poly = *(simEvent->Tgmn->PTrack_poly);
-    fPTrack_polz = *(simEvent->Tgmn->PTrack_polz);
-    fPTrack_Etot = *(simEvent->Tgmn->PTrack_Etot);
-    fPTrack_T = *(simEvent->Tgmn->PTrack_T);
-    fOTrack_ntracks = simEvent->Tgmn->OTrack_ntracks;
-    fOTrack_TID = *(simEvent->Tgmn->OTrack_TID);
-    fOTrack_PID = *(simEvent->Tgmn->OTrack_PID);
-    fOTrack_posx = *(simEvent->Tgmn->OTrack_posx);
-    fOTrack_posy = *(simEvent->Tgmn->OTrack_posy);
-    fOTrack_posz = *(simEvent->Tgmn->OTrack_posz);
-    fOTrack_momx = *(simEvent->Tgmn->OTrack_momx);
-    fOTrack_momy = *(simEvent->Tgmn->OTrack_momy);
-    fOTrack_momz = *(simEvent->Tgmn->OTrack_momz);
-    fOTrack_polx = *(simEvent->Tgmn->OTrack_polx);
-    fOTrack_poly = *(simEvent->Tgmn->OTrack_poly);
-    fOTrack_polz = *(simEvent->Tgmn->OTrack_polz);
-    fOTrack_Etot = *(simEvent->Tgmn->OTrack_Etot);
-    fOTrack_T = *(simEvent->Tgmn->OTrack_T);
-    fSDTrack_ntracks = simEvent->Tgmn->SDTrack_ntracks;
-    fSDTrack_TID = *(simEvent->Tgmn->SDTrack_TID);
-    fSDTrack_MID = *(simEvent->Tgmn->SDTrack_MID);
-    fSDTrack_PID = *(simEvent->Tgmn->SDTrack_PID);
-    fSDTrack_posx = *(simEvent->Tgmn->SDTrack_posx);
-    fSDTrack_posy = *(simEvent->Tgmn->SDTrack_posy);
-    fSDTrack_posz = *(simEvent->Tgmn->SDTrack_posz);
-    fSDTrack_momx = *(simEvent->Tgmn->SDTrack_momx);
-    fSDTrack_momy = *(simEvent->Tgmn->SDTrack_momy);
-    fSDTrack_momz = *(simEvent->Tgmn->SDTrack_momz);
-    fSDTrack_polx = *(simEvent->Tgmn->SDTrack_polx);
-    fSDTrack_poly = *(simEvent->Tgmn->SDTrack_poly);
-    fSDTrack_polz = *(simEvent->Tgmn->SDTrack_polz);
-    fSDTrack_Etot = *(simEvent->Tgmn->SDTrack_Etot);
-    fSDTrack_T = *(simEvent->Tgmn->SDTrack_T);
-    fSDTrack_vx = *(simEvent->Tgmn->SDTrack_vx);
-    fSDTrack_vy = *(simEvent->Tgmn->SDTrack_vy);
-    fSDTrack_vz = *(simEvent->Tgmn->SDTrack_vz);
-    fSDTrack_vnx = *(simEvent->Tgmn->SDTrack_vnx);
-    fSDTrack_vny = *(simEvent->Tgmn->SDTrack_vny);
-    fSDTrack_vnz = *(simEvent->Tgmn->SDTrack_vnz);
-    fSDTrack_vEkin = *(simEvent->Tgmn->SDTrack_vEkin);
+    if( simEvent->fReadMCTruth[kGEMTruth] ){
+      fNBBtracks = simEvent->Tgmn->Earm_BBGEM_Track_ntracks;
+      fBBtrack_Nhits.Set(simEvent->Tgmn->Earm_BBGEM_Track_NumHits);
+      fBBtrack_TID.Set(simEvent->Tgmn->Earm_BBGEM_Track_TID);
+      fBBtrack_PID.Set(simEvent->Tgmn->Earm_BBGEM_Track_PID);
+      fBBtrack_MID.Set(simEvent->Tgmn->Earm_BBGEM_Track_MID);
+      fBBtrack_P.Set(simEvent->Tgmn->Earm_BBGEM_Track_P);
+      fBBtrack_X.Set(simEvent->Tgmn->Earm_BBGEM_Track_X);
+      fBBtrack_Y.Set(simEvent->Tgmn->Earm_BBGEM_Track_Y);
+      fBBtrack_dX.Set(simEvent->Tgmn->Earm_BBGEM_Track_Xp);
+      fBBtrack_dY.Set(simEvent->Tgmn->Earm_BBGEM_Track_Yp);
+      fNBBGEMhits = simEvent->Tgmn->Earm_BBGEM_hit_nhits;
+      fBBGEMhit_plane.Set(simEvent->Tgmn->Earm_BBGEM_hit_plane);
+      fBBGEMhit_TID.Set(simEvent->Tgmn->Earm_BBGEM_hit_trid);
+      fBBGEMhit_PID.Set(simEvent->Tgmn->Earm_BBGEM_hit_pid);
+      fBBGEMhit_MID.Set(simEvent->Tgmn->Earm_BBGEM_hit_mid);
+      fBBGEMhit_edep.Set(simEvent->Tgmn->Earm_BBGEM_hit_edep);
+      fBBGEMhit_x.Set(simEvent->Tgmn->Earm_BBGEM_hit_tx);
+      fBBGEMhit_y.Set(simEvent->Tgmn->Earm_BBGEM_hit_ty);
+    }
+    if( simEvent->fReadMCTruth[kEsumTruth] ){
+      fBBPS_esum = simEvent->Tgmn->Earm_BBPSTF1_det_esum;
+      fBBSH_esum = simEvent->Tgmn->Earm_BBSHTF1_det_esum;
+    }
+    if( simEvent->fReadMCTruth[kTrackIdxTruth] ){
+      fBBGEMhit_ptridx.Set(simEvent->Tgmn->Earm_BBGEM_hit_ptridx);
+      fBBGEMhit_otridx.Set(simEvent->Tgmn->Earm_BBGEM_hit_otridx);
+      fBBGEMhit_sdtridx.Set(simEvent->Tgmn->Earm_BBGEM_hit_sdtridx);
+      fBBGEMtrack_ptridx.Set(simEvent->Tgmn->Earm_BBGEM_Track_ptridx);
+      fBBGEMtrack_otridx.Set(simEvent->Tgmn->Earm_BBGEM_Track_otridx);
+      fBBGEMtrack_sdtridx.Set(simEvent->Tgmn->Earm_BBGEM_Track_sdtridx);
+      fBBHODOhit_ptridx.Set(simEvent->Tgmn->Earm_BBHodoScint_hit_ptridx);
+      fBBHODOhit_otridx.Set(simEvent->Tgmn->Earm_BBHodoScint_hit_otridx);
+      fBBHODOhit_sdtridx.Set(simEvent->Tgmn->Earm_BBHodoScint_hit_sdtridx);
+      fBBPSTF1hit_ptridx.Set(simEvent->Tgmn->Earm_BBPSTF1_hit_ptridx);
+      fBBPSTF1hit_otridx.Set(simEvent->Tgmn->Earm_BBPSTF1_hit_otridx);
+      fBBPSTF1hit_sdtridx.Set(simEvent->Tgmn->Earm_BBPSTF1_hit_sdtridx);
+      fBBSHTF1hit_ptridx.Set(simEvent->Tgmn->Earm_BBSHTF1_hit_ptridx);
+      fBBSHTF1hit_otridx.Set(simEvent->Tgmn->Earm_BBSHTF1_hit_otridx);
+      fBBSHTF1hit_sdtridx.Set(simEvent->Tgmn->Earm_BBSHTF1_hit_sdtridx);
+      fHCALhit_ptridx.Set(simEvent->Tgmn->Harm_HCalScint_hit_ptridx);
+      fHCALhit_otridx.Set(simEvent->Tgmn->Harm_HCalScint_hit_otridx);
+      fHCALhit_sdtridx.Set(simEvent->Tgmn->Harm_HCalScint_hit_sdtridx);
+    }
+    if( simEvent->fReadMCTruth[kTrackTruth] ){
+      fPTrack_ntracks = simEvent->Tgmn->PTrack_ntracks;
+      fPTrack_TID.Set(simEvent->Tgmn->PTrack_TID);
+      fPTrack_PID.Set(simEvent->Tgmn->PTrack_PID);
+      fPTrack_posx.Set(simEvent->Tgmn->PTrack_posx);
+      fPTrack_posy.Set(simEvent->Tgmn->PTrack_posy);
+      fPTrack_posz.Set(simEvent->Tgmn->PTrack_posz);
+      fPTrack_momx.Set(simEvent->Tgmn->PTrack_momx);
+      fPTrack_momy.Set(simEvent->Tgmn->PTrack_momy);
+      fPTrack_momz.Set(simEvent->Tgmn->PTrack_momz);
+      fPTrack_polx.Set(simEvent->Tgmn->PTrack_polx);
+      fPTrack_poly.Set(simEvent->Tgmn->PTrack_poly);
+      fPTrack_polz.Set(simEvent->Tgmn->PTrack_polz);
+      fPTrack_Etot.Set(simEvent->Tgmn->PTrack_Etot);
+      fPTrack_T.Set(simEvent->Tgmn->PTrack_T);
+      fOTrack_ntracks = simEvent->Tgmn->OTrack_ntracks;
+      fOTrack_TID.Set(simEvent->Tgmn->OTrack_TID);
+      fOTrack_PID.Set(simEvent->Tgmn->OTrack_PID);
+      fOTrack_posx.Set(simEvent->Tgmn->OTrack_posx);
+      fOTrack_posy.Set(simEvent->Tgmn->OTrack_posy);
+      fOTrack_posz.Set(simEvent->Tgmn->OTrack_posz);
+      fOTrack_momx.Set(simEvent->Tgmn->OTrack_momx);
+      fOTrack_momy.Set(simEvent->Tgmn->OTrack_momy);
+      fOTrack_momz.Set(simEvent->Tgmn->OTrack_momz);
+      fOTrack_polx.Set(simEvent->Tgmn->OTrack_polx);
+      fOTrack_poly.Set(simEvent->Tgmn->OTrack_poly);
+      fOTrack_polz.Set(simEvent->Tgmn->OTrack_polz);
+      fOTrack_Etot.Set(simEvent->Tgmn->OTrack_Etot);
+      fOTrack_T.Set(simEvent->Tgmn->OTrack_T);
+      fSDTrack_ntracks = simEvent->Tgmn->SDTrack_ntracks;
+      fSDTrack_TID.Set(simEvent->Tgmn->SDTrack_TID);
+      fSDTrack_MID.Set(simEvent->Tgmn->SDTrack_MID);
+      fSDTrack_PID.Set(simEvent->Tgmn->SDTrack_PID);
+      fSDTrack_posx.Set(simEvent->Tgmn->SDTrack_posx);
+      fSDTrack_posy.Set(simEvent->Tgmn->SDTrack_posy);
+      fSDTrack_posz.Set(simEvent->Tgmn->SDTrack_posz);
+      fSDTrack_momx.Set(simEvent->Tgmn->SDTrack_momx);
+      fSDTrack_momy.Set(simEvent->Tgmn->SDTrack_momy);
+      fSDTrack_momz.Set(simEvent->Tgmn->SDTrack_momz);
+      fSDTrack_polx.Set(simEvent->Tgmn->SDTrack_polx);
+      fSDTrack_poly.Set(simEvent->Tgmn->SDTrack_poly);
+      fSDTrack_polz.Set(simEvent->Tgmn->SDTrack_polz);
+      fSDTrack_Etot.Set(simEvent->Tgmn->SDTrack_Etot);
+      fSDTrack_T.Set(simEvent->Tgmn->SDTrack_T);
+      fSDTrack_vx.Set(simEvent->Tgmn->SDTrack_vx);
+      fSDTrack_vy.Set(simEvent->Tgmn->SDTrack_vy);
+      fSDTrack_vz.Set(simEvent->Tgmn->SDTrack_vz);
+      fSDTrack_vnx.Set(simEvent->Tgmn->SDTrack_vnx);
+      fSDTrack_vny.Set(simEvent->Tgmn->SDTrack_vny);
+      fSDTrack_vnz.Set(simEvent->Tgmn->SDTrack_vnz);
+      fSDTrack_vEkin.Set(simEvent->Tgmn->SDTrack_vEkin);
+    }
   }
   
   Int_t ret = HED_OK;
@@ -702,40 +736,39 @@ Int_t SBSSimDecoder::DoLoadEvent(const Int_t* evbuffer )
   //Bool_t newclus;
   //Int_t crate, slot, chan,lchan;
   
-  std::vector<std::map<Decoder::THaSlotData*, std::vector<UInt_t> > > detmaps;
-  detmaps.resize(fDetectors.size());
-  
-  for(size_t d = 0; d<fDetectors.size(); d++){
-    if(fDebug>2)cout << fDetectors[d] << endl;
-    //SBSDigSim::UHitData_t* HitData_Det = simEvent->HitDataDet.at(fDetectors[d]);
-    LoadDetector(detmaps[d], fDetectors[d], simEvent);
+  for( auto& ldr : fLoaders ) {
+    if(fDebug>2)cout << ldr.name << endl;
+    ldr.Clear();
+    if( ldr.type != kNoLoader )
+      LoadDetector(ldr, simEvent);
   }
   
-  // Now call LoadSlot for the different detectors
-  for(size_t d = 0; d < fDetectors.size(); d++) {
+  // Now call LoadSlot for the different detectors (no slot buffers are
+  // filled with direct injection: LoadDetector already loaded the data)
+  for( auto& ldr : fLoaders ) {
     //int size_det = 0;
     if(fDebug>2)
-      cout << " " << fDetectors[d] << endl;
-    for( std::map<Decoder::THaSlotData*, std::vector<UInt_t> >::iterator it =
-	   detmaps[d].begin(); it != detmaps[d].end(); ++it) {
-      if(it->first->GetModule()==0) {
+      cout << " " << ldr.name << endl;
+    for( size_t s = 0; s < ldr.nslots; s++ ) {
+      SlotWords& sw = ldr.slots[s];
+      if(sw.sldat->GetModule()==0) {
         if(fDebug>2) {
 	  std::cout << "No data available for detector "
-		    << fDetectors[d] << std::endl;
+		    << ldr.name << std::endl;
         }
       } else {
 	event_type = 1;
 	//if there is data in at least one detector, event_type set to 1 
 	if(fDebug>2){
-	  std::cout << "load crate/slot: " << it->first->getCrate() << "/" << it->first->getSlot() << " it->second = {";
-	  for(size_t k = 0; k<it->second.size(); k++)std::cout << it->second[k] << " ; ";
+	  std::cout << "load crate/slot: " << sw.sldat->getCrate() << "/" << sw.sldat->getSlot() << " words = {";
+	  for(size_t k = 0; k<sw.words.size(); k++)std::cout << sw.words[k] << " ; ";
 	  std::cout << " } " << std::endl;
 	}
-	it->first->GetModule()->LoadSlot(it->first,
-					 it->second.data(),0,it->second.size() );
+	sw.sldat->GetModule()->LoadSlot(sw.sldat,
+					 sw.words.data(),0,sw.words.size() );
       }
-      //cout << fDetectors[d].c_str() << " " << it->first->getCrate() << " " << it->first->getSlot() << " " << it->second.size() << endl;
-      //size_det+=it->second.size();
+      //cout << ldr.name << " " << sw.sldat->getCrate() << " " << sw.sldat->getSlot() << " " << sw.words.size() << endl;
+      //size_det+=sw.words.size();
     }
     //if(strcmp(fDetectors[d].c_str(), "sbs.hcal")==0)h1_sizeHCal->Fill(size_det);
     //if(strcmp(fDetectors[d].c_str(), "bb.gem")==0)h1_sizeGEMs->Fill(size_det);
@@ -764,11 +797,9 @@ Int_t SBSSimDecoder::RetrieveDetMapParam(const char* detname,
 */
 
 
-Int_t SBSSimDecoder::LoadDetector( std::map<Decoder::THaSlotData*,
-				   std::vector<UInt_t> > &map,
-				   const std::string& detname,
-				   const SBSSimEvent* simev)
+Int_t SBSSimDecoder::LoadDetector( DetLoader& ldr, const SBSSimEvent* simev )
 {
+  const std::string& detname = ldr.name;
   if(fDebug>1)std::cout << "SBSSimDecoder::LoadDectector(" << detname << ")" << std::endl;
   //int detid = detinfo.DetUniqueId();
   Int_t crate, slot;
@@ -794,7 +825,7 @@ Int_t SBSSimDecoder::LoadDetector( std::map<Decoder::THaSlotData*,
   //cout << detname.c_str() << endl;
   int row, col;
   
-  if(strcmp(detname.c_str(), "bb.ps")==0){
+  if(ldr.type == kBBPS){
     //cout << " ouh " << detname.c_str() << " " << simev->Tgmn->Earm_BBPSTF1_hit_nhits << " " << simev->Tgmn->Earm_BBPS_dighit_nchan << endl;
     samps.clear();
     assert(simev->Tgmn->b_Earm_BBPS_dighit_nchan);
@@ -839,27 +870,13 @@ Int_t SBSSimDecoder::LoadDetector( std::map<Decoder::THaSlotData*,
 	//lchan = col*26+row;
 	//cout << " => " << row << ", " << col << " new lchan = " << lchan << endl;
 	//ADC
-	ChanToROC(detname, lchan, crate, slot, chan);
+	ChanToROC(ldr, lchan, crate, slot, chan);
 	
 	if( crate >= 0 || slot >=  0 ) {
 	  sldat = crateslot[idx(crate,slot)].get();
 	}
 
-	// This line is very confusing since it (somewhat irresponsibly/carelessly IMO) uses the STL keyword map as a function argument. We can do better. But ANYWAY,
-	// map is an argument passed to SBSSimDecoder::LoadDetector by reference, of type std::map<Decoder::THaSlotData*, std::vector<UInt_t> >
-	// The line below is grabbing a pointer to the std::vector<UInt_t> that is the mapped value corresponding to the "key" sldat, which itself
-	// is a pointer to Decoder::THaSlotData 
-	std::vector<UInt_t> *myev = &(map[sldat]);
-	
-	// cout << detname.c_str() << " det channel " << lchan << ", crate " << crate 
-	//      << ", slot " << slot << " chan " << chan << " size " << samps.size() << endl;
-	if(!samps.empty()){
-	  myev->push_back(SBSSimDataDecoder::EncodeHeader(5, chan, samps.size()));
-	  for(unsigned int samp : samps){
-	    myev->push_back(samp);
-	    //cout << " " << samps[k];
-	  }
-	}
+	LoadSamples( ldr, sldat, chan, samps );
 	//cout << endl;
 	
 	samps.clear();
@@ -868,12 +885,12 @@ Int_t SBSSimDecoder::LoadDetector( std::map<Decoder::THaSlotData*,
       /*
       //cout << j << " " << simev->Tgmn->Earm_BBPS_dighit_chan->at(j) << " " << simev->Tgmn->Earm_BBPS_dighit_adc->at(j) << endl;
       lchan = simev->Tgmn->Earm_BBPS_dighit_chan->at(j);
-      ChanToROC(detname, lchan, crate, slot, chan);
+      ChanToROC(ldr, lchan, crate, slot, chan);
       
       if( crate >= 0 || slot >=  0 ) {
 	sldat = crateslot[idx(crate,slot)].get();
       }
-      std::vector<UInt_t> *myev = &(map[sldat]);
+      std::vector<UInt_t> *myev = &(ldr.Words(sldat));
       
       myev->push_back(SBSSimDataDecoder::EncodeHeader(6, chan, 1));
    
@@ -887,7 +904,7 @@ Int_t SBSSimDecoder::LoadDetector( std::map<Decoder::THaSlotData*,
       */
     }
   }
-  if(strcmp(detname.c_str(), "bb.sh")==0){
+  if(ldr.type == kBBSH){
     //cout << " ouh " << detname.c_str() << " " << simev->Tgmn->Earm_BBSHTF1_hit_nhits << " " << simev->Tgmn->Earm_BBSH_dighit_nchan << endl;
     samps.clear();
     assert(simev->Tgmn->b_Earm_BBSH_dighit_nchan);
@@ -929,22 +946,12 @@ Int_t SBSSimDecoder::LoadDetector( std::map<Decoder::THaSlotData*,
 	lchan = row*7+col;
       //cout << " => " << row << ", " << col << " new lchan = " << lchan << endl;
 	//ADC
-	ChanToROC(detname, lchan, crate, slot, chan);
+	ChanToROC(ldr, lchan, crate, slot, chan);
 	
 	if( crate >= 0 || slot >=  0 ) {
 	  sldat = crateslot[idx(crate,slot)].get();
 	}
-	std::vector<UInt_t> *myev = &(map[sldat]);
-	
-	// cout << detname.c_str() << " det channel " << lchan << ", crate " << crate 
-	//      << ", slot " << slot << " chan " << chan << " size " << samps.size() << endl;
-	if(!samps.empty()){
-	  myev->push_back(SBSSimDataDecoder::EncodeHeader(5, chan, samps.size()));
-	  for(unsigned int samp : samps){
-	    myev->push_back(samp);
-	    //cout << " " << samps[k];
-	  }
-	}
+	LoadSamples( ldr, sldat, chan, samps );
 	//cout << endl;
 	
 	samps.clear();
@@ -953,12 +960,12 @@ Int_t SBSSimDecoder::LoadDetector( std::map<Decoder::THaSlotData*,
       /*
       //cout << j << " " << simev->Tgmn->Earm_BBSH_dighit_chan->at(j) << " " << simev->Tgmn->Earm_BBSH_dighit_adc->at(j) << endl;
       lchan = simev->Tgmn->Earm_BBSH_dighit_chan->at(j);
-      ChanToROC(detname, lchan, crate, slot, chan);
+      ChanToROC(ldr, lchan, crate, slot, chan);
       
       if( crate >= 0 || slot >=  0 ) {
 	sldat = crateslot[idx(crate,slot)].get();
       }
-      std::vector<UInt_t> *myev = &(map[sldat]);
+      std::vector<UInt_t> *myev = &(ldr.Words(sldat));
       
       myev->push_back(SBSSimDataDecoder::EncodeHeader(6, chan, 1));
    
@@ -972,117 +979,84 @@ Int_t SBSSimDecoder::LoadDetector( std::map<Decoder::THaSlotData*,
       */
     }
   }
-  if(strcmp(detname.c_str(), "bb.hodo")==0){
+  if(ldr.type == kBBHodo){
     //cout << " ouh " << detname.c_str() << " " << simev->Tgmn->Earm_BBHodoScint_hit_nhits << " " << simev->Tgmn->Earm_BBHodo_dighit_nchan << endl;
     // cout << simev->Tgmn->Earm_BBHodo_dighit_chan->size() << " " 
     // 	 << simev->Tgmn->Earm_BBHodo_dighit_adc->size() << " " 
     // 	 << simev->Tgmn->Earm_BBHodo_dighit_tdc_l->size() << " " 
     // 	 << simev->Tgmn->Earm_BBHodo_dighit_tdc_t->size() << endl; 
     /*
-    ChanToROC(detname, 180, crate, slot, chan);
+    ChanToROC(ldr, 180, crate, slot, chan);
     cout << crate << " " << slot << " " << chan << endl;
     if( crate >= 0 || slot >=  0 ) {
       sldat = crateslot[idx(crate,slot)].get();
     }
-    std::vector<UInt_t> *myev = &(map[sldat]);
+    std::vector<UInt_t> *myev = &(ldr.Words(sldat));
     myev->push_back(SBSSimDataDecoder::EncodeHeader(1, chan, 2));
     myev->push_back(0);
     */
-    int ntdc = 0;
     assert(simev->Tgmn->b_Earm_BBHodo_dighit_nchan);
     for(int j = 0; j<simev->Tgmn->Earm_BBHodo_dighit_nchan; j++){
-      ntdc = 0;
       lchan = simev->Tgmn->Earm_BBHodo_dighit_chan->at(j);
       col = lchan%2;
       row = (lchan-col)/2;
       lchan = col*90+row;
-      ChanToROC(detname, lchan, crate, slot, chan);
+      ChanToROC(ldr, lchan, crate, slot, chan);
       //cout << detname << " " << simev->Tgmn->Earm_BBHodo_dighit_chan->at(j) << " " << lchan << " " << crate << " " << slot << " " << chan << endl;
       //cout << j << " " << simev->Tgmn->Earm_BBHodo_dighit_chan->at(j) << " " << simev->Tgmn->Earm_BBHodo_dighit_adc->at(j) << " " << simev->Tgmn->Earm_BBHodo_dighit_tdc_l->at(j) << " " << simev->Tgmn->Earm_BBHodo_dighit_tdc_t->at(j) << endl;
       if( crate >= 0 || slot >=  0 ) {
 	sldat = crateslot[idx(crate,slot)].get();
       }
-      if(simev->Tgmn->Earm_BBHodo_dighit_tdc_l->at(j)>-1000000)ntdc++;
-      if(simev->Tgmn->Earm_BBHodo_dighit_tdc_t->at(j)>-1000000)ntdc++;
-      
-      if(ntdc){
-	std::vector<UInt_t> *myev = &(map[sldat]);
-	myev->push_back(SBSSimDataDecoder::EncodeHeader(1, chan, ntdc));
-	
-	if(simev->Tgmn->Earm_BBHodo_dighit_tdc_l->at(j)>-1000000)myev->push_back(simev->Tgmn->Earm_BBHodo_dighit_tdc_l->at(j));
-	if(simev->Tgmn->Earm_BBHodo_dighit_tdc_t->at(j)>-1000000){
-	  uint tdc =  simev->Tgmn->Earm_BBHodo_dighit_tdc_t->at(j)|(1<<31);
-	  //cout << tdc << endl;
-	  myev->push_back( tdc );
-	}
+      times.clear();
+      if(simev->Tgmn->Earm_BBHodo_dighit_tdc_l->at(j)>-1000000)times.push_back(simev->Tgmn->Earm_BBHodo_dighit_tdc_l->at(j));
+      if(simev->Tgmn->Earm_BBHodo_dighit_tdc_t->at(j)>-1000000)times.push_back(simev->Tgmn->Earm_BBHodo_dighit_tdc_t->at(j)|(1<<31));
+      if(!times.empty())
+	LoadTimes( ldr, sldat, 1, chan, times );
       /*
-      ChanToROC(detname, lchan, crate, slot, chan);//+91 ??? that might be the trick
+      ChanToROC(ldr, lchan, crate, slot, chan);//+91 ??? that might be the trick
       if( crate >= 0 || slot >=  0 ) {
 	sldat = crateslot[idx(crate,slot)].get();
       }
-      myev = &(map[sldat]);
+      myev = &(ldr.Words(sldat));
       
       myev->push_back(SBSSimDataDecoder::EncodeHeader(8, chan, 1));
       myev->push_back(simev->Tgmn->Earm_BBHodo_dighit_adc->at(j));
       */
-	if(fDebug>2){
-	  std::cout << " j = " << j << " my ev = {";
-	  for(size_t k = 0; k<myev->size(); k++)std::cout << myev->at(k) << " ; ";
-	  std::cout << " } " << std::endl;
-	}
-      }
     }
   }
-  if(strcmp(detname.c_str(), "bb.grinch_tdc")==0){
-    int ntdc = 0;
+  if(ldr.type == kBBGRINCH){
     //if(simev->Tgmn->b_Earm_GRINCH_dighit_nchan==0)
     //cout << "*** Warning: your GRINCH variables are probably missing in the tree you are analyzing. " << endl << " consider using another file or removing the grinch for your analysis " << endl;
     //cout << " ouh " << detname.c_str() << " " << simev->Tgmn->Earm_GRINCH_hit_nhits << " " << simev->Tgmn->b_Earm_GRINCH_dighit_nchan << " " << simev->Tgmn->Earm_GRINCH_dighit_nchan << endl;
     assert(simev->Tgmn->b_Earm_GRINCH_dighit_nchan);
     for(int j = 0; j<simev->Tgmn->Earm_GRINCH_dighit_nchan; j++){
-      ntdc = 0;
       //cout << j << " " << simev->Tgmn->Earm_GRINCH_dighit_chan->at(j) << " " << simev->Tgmn->Earm_GRINCH_dighit_adc->at(j) << " " << simev->Tgmn->Earm_GRINCH_dighit_tdc_l->at(j) << " " << simev->Tgmn->Earm_GRINCH_dighit_tdc_t->at(j) << endl;
       lchan = simev->Tgmn->Earm_GRINCH_dighit_chan->at(j);
-      ChanToROC(detname, lchan, crate, slot, chan);
+      ChanToROC(ldr, lchan, crate, slot, chan);
       
       if( crate >= 0 || slot >=  0 ) {
 	sldat = crateslot[idx(crate,slot)].get();
       }
 
-      if(simev->Tgmn->Earm_GRINCH_dighit_tdc_l->at(j)>-1000000)ntdc++;
-      if(simev->Tgmn->Earm_GRINCH_dighit_tdc_t->at(j)>-1000000)ntdc++;
-
-      if(ntdc){
-	std::vector<UInt_t> *myev = &(map[sldat]);
-	
-	myev->push_back(SBSSimDataDecoder::EncodeHeader(1, chan, ntdc));
-	
-	if(simev->Tgmn->Earm_GRINCH_dighit_tdc_l->at(j)>-1000000)myev->push_back(simev->Tgmn->Earm_GRINCH_dighit_tdc_l->at(j));
-	if(simev->Tgmn->Earm_GRINCH_dighit_tdc_t->at(j)>-1000000){
-	  uint tdc =  simev->Tgmn->Earm_GRINCH_dighit_tdc_t->at(j)|(1<<31);
-	  //cout << tdc << endl;
-	  myev->push_back( tdc );
-	}
+      times.clear();
+      if(simev->Tgmn->Earm_GRINCH_dighit_tdc_l->at(j)>-1000000)times.push_back(simev->Tgmn->Earm_GRINCH_dighit_tdc_l->at(j));
+      if(simev->Tgmn->Earm_GRINCH_dighit_tdc_t->at(j)>-1000000)times.push_back(simev->Tgmn->Earm_GRINCH_dighit_tdc_t->at(j)|(1<<31));
+      if(!times.empty())
+	LoadTimes( ldr, sldat, 1, chan, times );
       /*
-      ChanToROC(detname, lchan, crate, slot, chan);//+288 ??? that might be the trick
+      ChanToROC(ldr, lchan, crate, slot, chan);//+288 ??? that might be the trick
       if( crate >= 0 || slot >=  0 ) {
 	sldat = crateslot[idx(crate,slot)].get();
       }
-      myev = &(map[sldat]);
+      myev = &(ldr.Words(sldat));
       
       myev->push_back(SBSSimDataDecoder::EncodeHeader(8, chan, 1));
       myev->push_back(simev->Tgmn->Earm_GRINCH_dighit_adc->at(j));
       */
-	if(fDebug>2){
-	  std::cout << " j = " << j << " my ev = {";
-	  for(size_t k = 0; k<myev->size(); k++)std::cout << myev->at(k) << " ; ";
-	  std::cout << " } " << std::endl;
-	}
-      }
     }
   }
   
-  if(strcmp(detname.c_str(), "bb.gem")==0){
+  if(ldr.type == kBBGEM){
     //cout << fPx << " " << fPy << " " << fPz << "   " << fVz << endl;
     samps.clear();  
     strips.clear();  
@@ -1092,7 +1066,7 @@ Int_t SBSSimDecoder::LoadDetector( std::map<Decoder::THaSlotData*,
       loadevt = false;
       mod = simev->Tgmn->Earm_BBGEM_dighit_module->at(j);
       lchan = simev->Tgmn->Earm_BBGEM_dighit_strip->at(j);
-      apvnum = APVnum(detname, mod, lchan, crate, slot, chan);
+      apvnum = APVnum(ldr, mod, lchan, crate, slot, chan);
       
       if(simev->Tgmn->Earm_BBGEM_dighit_samp->at(j)>=0){
 	strips.push_back(chan);
@@ -1116,19 +1090,7 @@ Int_t SBSSimDecoder::LoadDetector( std::map<Decoder::THaSlotData*,
 	if( crate >= 0 || slot >=  0 ) {
 	  sldat = crateslot[idx(crate,slot)].get();
 	}
-	std::vector<UInt_t> *myev = &(map[sldat]);
-	
-	if(!samps.empty()){
-	  //myev->push_back(SBSSimDataDecoder::EncodeHeader(5, apvnum, samps.size()));
-	  //I think I'm onto something here, but I also need to transmit strip num 
-	  myev->push_back(SBSSimDataDecoder::EncodeHeader(9, apvnum, samps.size()));
-	  for(int k = 0; k<(int)samps.size(); k++){
-	    // cout << " " << samps[k];
-	    myev->push_back(strips[k]*8192+samps[k]);//strips[k]<< 13 | samps[k]);
-	  }
-	  //for(int l = 0; l<myev->size();l++)cout << myev->at(l) << " ";
-	  //cout << endl;
-	}
+	LoadStrips( ldr, sldat, apvnum, strips, samps );
 	//cout << endl;
 	
 	samps.clear();
@@ -1138,7 +1100,7 @@ Int_t SBSSimDecoder::LoadDetector( std::map<Decoder::THaSlotData*,
   }
   
   
-  if(strcmp(detname.c_str(), "sbs.hcal")==0){
+  if(ldr.type == kHCal){
     //cout << " ouh " << detname.c_str() << " " << simev->Tgmn->Harm_HCalScint_hit_nhits << " " << simev->Tgmn->Harm_HCal_dighit_nchan << endl;
     samps.clear();
     times.clear();
@@ -1170,36 +1132,20 @@ Int_t SBSSimDecoder::LoadDetector( std::map<Decoder::THaSlotData*,
       
 	if(loadevt){
 	  //ADC
-	  ChanToROC(detname, lchan, crate, slot, chan);
+	  ChanToROC(ldr, lchan, crate, slot, chan);
 	
 	  if( crate >= 0 || slot >=  0 ) {
 	    sldat = crateslot[idx(crate,slot)].get();
 	  }
-	  std::vector<UInt_t> *myev = &(map[sldat]);
-	
-	  // cout << detname.c_str() << " det channel " << lchan << ", crate " << crate 
-	  //      << ", slot " << slot << " chan " << chan << " size " << samps.size() << endl;
-	  if(!samps.empty()){
-	    myev->push_back(SBSSimDataDecoder::EncodeHeader(5, chan, samps.size()));
-	    for(unsigned int samp : samps){
-	      myev->push_back(samp);
-	      //cout << " " << samps[k];
-	    }
-	  }
+	  LoadSamples( ldr, sldat, chan, samps );
 	  //cout << endl;
 
 	  //TDC
-	  ChanToROC(detname, lchan+288, crate, slot, chan);
+	  ChanToROC(ldr, lchan+288, crate, slot, chan);
 	  if( crate >= 0 || slot >=  0 ) {
 	    sldat = crateslot[idx(crate,slot)].get();
 	  }
-	  myev = &(map[sldat]);
-	  if(!times.empty()){
-	    myev->push_back(SBSSimDataDecoder::EncodeHeader(4, chan, times.size()));
-	    for(unsigned int time : times){
-	      myev->push_back(time);
-	    }
-	  }
+	  LoadTimes( ldr, sldat, 4, chan, times );
 	
 	  samps.clear();
 	  times.clear();
@@ -1233,36 +1179,20 @@ Int_t SBSSimDecoder::LoadDetector( std::map<Decoder::THaSlotData*,
       
 	if(loadevt){
 	  //ADC
-	  ChanToROC(detname, lchan, crate, slot, chan);
+	  ChanToROC(ldr, lchan, crate, slot, chan);
 	
 	  if( crate >= 0 || slot >=  0 ) {
 	    sldat = crateslot[idx(crate,slot)].get();
 	  }
-	  std::vector<UInt_t> *myev = &(map[sldat]);
-	
-	  // cout << detname.c_str() << " det channel " << lchan << ", crate " << crate 
-	  //      << ", slot " << slot << " chan " << chan << " size " << samps.size() << endl;
-	  if(!samps.empty()){
-	    myev->push_back(SBSSimDataDecoder::EncodeHeader(5, chan, samps.size()));
-	    for(unsigned int samp : samps){
-	      myev->push_back(samp);
-	      //cout << " " << samps[k];
-	    }
-	  }
+	  LoadSamples( ldr, sldat, chan, samps );
 	  //cout << endl;
 
 	  //TDC
-	  ChanToROC(detname, lchan+288, crate, slot, chan);
+	  ChanToROC(ldr, lchan+288, crate, slot, chan);
 	  if( crate >= 0 || slot >=  0 ) {
 	    sldat = crateslot[idx(crate,slot)].get();
 	  }
-	  myev = &(map[sldat]);
-	  if(!times.empty()){
-	    myev->push_back(SBSSimDataDecoder::EncodeHeader(4, chan, times.size()));
-	    for(unsigned int time : times){
-	      myev->push_back(time);
-	    }
-	  }
+	  LoadTimes( ldr, sldat, 4, chan, times );
 	
 	  samps.clear();
 	  times.clear();
@@ -1272,7 +1202,7 @@ Int_t SBSSimDecoder::LoadDetector( std::map<Decoder::THaSlotData*,
   }
 
   //GEP electron arm systems:
-  if(strcmp(detname.c_str(), "earm.ecal")==0){
+  if(ldr.type == kECal){
     //cout << " ouh " << detname.c_str() << " " << simev->Tgep->Earm_EcalScint_hit_nhits << " " << simev->Tgep->Earm_Ecal_dighit_nchan << endl;
     samps.clear();
     times.clear();
@@ -1303,30 +1233,20 @@ Int_t SBSSimDecoder::LoadDetector( std::map<Decoder::THaSlotData*,
       
       if(loadevt){
 	//ADC
-	ChanToROC(detname, lchan, crate, slot, chan);
+	ChanToROC(ldr, lchan, crate, slot, chan);
 	
 	if( crate >= 0 || slot >=  0 ) {
 	  sldat = crateslot[idx(crate,slot)].get();
 	}
-	std::vector<UInt_t> *myev = &(map[sldat]);
-	
-	// cout << detname.c_str() << " det channel " << lchan << ", crate " << crate 
-	//      << ", slot " << slot << " chan " << chan << " size " << samps.size() << endl;
-	if(!samps.empty()){
-	  myev->push_back(SBSSimDataDecoder::EncodeHeader(5, chan, samps.size()));
-	  for(unsigned int samp : samps){
-	    myev->push_back(samp);
-	    //cout << " " << samps[k];
-	  }
-	}
+	LoadSamples( ldr, sldat, chan, samps );
 	//cout << endl;
 
 	// //TDC
-	// ChanToROC(detname, lchan+288, crate, slot, chan);
+	// ChanToROC(ldr, lchan+288, crate, slot, chan);
 	// if( crate >= 0 || slot >=  0 ) {
 	//   sldat = crateslot[idx(crate,slot)].get();
 	// }
-	// myev = &(map[sldat]);
+	// myev = &(ldr.Words(sldat));
 	// if(!times.empty()){
 	//   myev->push_back(SBSSimDataDecoder::EncodeHeader(4, chan, times.size()));
 	//   for(unsigned int time : times){
@@ -1342,70 +1262,54 @@ Int_t SBSSimDecoder::LoadDetector( std::map<Decoder::THaSlotData*,
     
   }
 
-  if(strcmp(detname.c_str(), "earm.cdet")==0){
+  if(ldr.type == kCDet){
     //cout << " ouh " << detname.c_str() << " " << simev->Tgep->Earm_BBHodoScint_hit_nhits << " " << simev->Tgep->Earm_CDET_dighit_nchan << endl;
     // cout << simev->Tgep->Earm_CDET_dighit_chan->size() << " " 
     // 	 << simev->Tgep->Earm_CDET_dighit_adc->size() << " " 
     // 	 << simev->Tgep->Earm_CDET_dighit_tdc_l->size() << " " 
     // 	 << simev->Tgep->Earm_CDET_dighit_tdc_t->size() << endl; 
     /*
-    ChanToROC(detname, 180, crate, slot, chan);
+    ChanToROC(ldr, 180, crate, slot, chan);
     cout << crate << " " << slot << " " << chan << endl;
     if( crate >= 0 || slot >=  0 ) {
       sldat = crateslot[idx(crate,slot)].get();
     }
-    std::vector<UInt_t> *myev = &(map[sldat]);
+    std::vector<UInt_t> *myev = &(ldr.Words(sldat));
     myev->push_back(SBSSimDataDecoder::EncodeHeader(1, chan, 2));
     myev->push_back(0);
     */
-    int ntdc = 0;
     assert(simev->Tgep->b_Earm_CDET_dighit_nchan);
     for(int j = 0; j<simev->Tgep->Earm_CDET_dighit_nchan; j++){
-      ntdc = 0;
       lchan = simev->Tgep->Earm_CDET_dighit_chan->at(j);
       //do we want that???
       //col = lchan%2;
       //row = (lchan-col)/2;
       //lchan = col*24+row;
-      ChanToROC(detname, lchan, crate, slot, chan);
+      ChanToROC(ldr, lchan, crate, slot, chan);
       //if(crate!=9)cout << detname << " " << simev->Tgep->Earm_CDET_dighit_chan->at(j) << " " << lchan << " " << crate << " " << slot << endl;
       if( crate >= 0 || slot >=  0 ) {
 	sldat = crateslot[idx(crate,slot)].get();
       }
-      if(simev->Tgep->Earm_CDET_dighit_tdc_l->at(j)>-1000000)ntdc++;
-      if(simev->Tgep->Earm_CDET_dighit_tdc_t->at(j)>-1000000)ntdc++;
-      
-      if(ntdc){
-	std::vector<UInt_t> *myev = &(map[sldat]);
-	myev->push_back(SBSSimDataDecoder::EncodeHeader(1, chan, ntdc));
-	
-	if(simev->Tgep->Earm_CDET_dighit_tdc_l->at(j)>-1000000)myev->push_back(simev->Tgep->Earm_CDET_dighit_tdc_l->at(j));
-	if(simev->Tgep->Earm_CDET_dighit_tdc_t->at(j)>-1000000){
-	  uint tdc =  simev->Tgep->Earm_CDET_dighit_tdc_t->at(j)|(1<<31);
-	  //cout << tdc << endl;
-	  myev->push_back( tdc );
-	}
+      times.clear();
+      if(simev->Tgep->Earm_CDET_dighit_tdc_l->at(j)>-1000000)times.push_back(simev->Tgep->Earm_CDET_dighit_tdc_l->at(j));
+      if(simev->Tgep->Earm_CDET_dighit_tdc_t->at(j)>-1000000)times.push_back(simev->Tgep->Earm_CDET_dighit_tdc_t->at(j)|(1<<31));
+      if(!times.empty())
+	LoadTimes( ldr, sldat, 1, chan, times );
       /*
-      ChanToROC(detname, lchan, crate, slot, chan);//+91 ??? that might be the trick
+      ChanToROC(ldr, lchan, crate, slot, chan);//+91 ??? that might be the trick
       if( crate >= 0 || slot >=  0 ) {
 	sldat = crateslot[idx(crate,slot)].get();
       }
-      myev = &(map[sldat]);
+      myev = &(ldr.Words(sldat));
       
       myev->push_back(SBSSimDataDecoder::EncodeHeader(8, chan, 1));
       myev->push_back(simev->Tgep->Earm_CDET_dighit_adc->at(j));
       */
-	if(fDebug>2){
-	  std::cout << " j = " << j << " my ev = {";
-	  for(size_t k = 0; k<myev->size(); k++)std::cout << myev->at(k) << " ; ";
-	  std::cout << " } " << std::endl;
-	}
-      }
     }
   }
 
   //GEP GEMs
-  if(strcmp(detname.c_str(), "sbs.gemFT")==0){
+  if(ldr.type == kGEMFT){
     //cout << fPx << " " << fPy << " " << fPz << "   " << fVz << endl;
     samps.clear();  
     strips.clear();  
@@ -1415,7 +1319,7 @@ Int_t SBSSimDecoder::LoadDetector( std::map<Decoder::THaSlotData*,
       loadevt = false;
       mod = simev->Tgep->Harm_FT_dighit_module->at(j);
       lchan = simev->Tgep->Harm_FT_dighit_strip->at(j);
-      apvnum = APVnum(detname, mod, lchan, crate, slot, chan);
+      apvnum = APVnum(ldr, mod, lchan, crate, slot, chan);
       
       if(simev->Tgep->Harm_FT_dighit_samp->at(j)>=0){
 	strips.push_back(chan);
@@ -1439,19 +1343,7 @@ Int_t SBSSimDecoder::LoadDetector( std::map<Decoder::THaSlotData*,
 	if( crate >= 0 || slot >=  0 ) {
 	  sldat = crateslot[idx(crate,slot)].get();
 	}
-	std::vector<UInt_t> *myev = &(map[sldat]);
-	
-	if(!samps.empty()){
-	  //myev->push_back(SBSSimDataDecoder::EncodeHeader(5, apvnum, samps.size()));
-	  //I think I'm onto something here, but I also need to transmit strip num 
-	  myev->push_back(SBSSimDataDecoder::EncodeHeader(9, apvnum, samps.size()));
-	  for(int k = 0; k<(int)samps.size(); k++){
-	    // cout << " " << samps[k];
-	    myev->push_back(strips[k]*8192+samps[k]);//strips[k]<< 13 | samps[k]);
-	  }
-	  //for(int l = 0; l<myev->size();l++)cout << myev->at(l) << " ";
-	  //cout << endl;
-	}
+	LoadStrips( ldr, sldat, apvnum, strips, samps );
 	//cout << endl;
 	
 	samps.clear();
@@ -1460,7 +1352,7 @@ Int_t SBSSimDecoder::LoadDetector( std::map<Decoder::THaSlotData*,
     }
   }
   
-  if(strcmp(detname.c_str(), "sbs.gemFPP")==0){
+  if(ldr.type == kGEMFPP){
     //cout << fPx << " " << fPy << " " << fPz << "   " << fVz << endl;
     samps.clear();  
     strips.clear();  
@@ -1470,7 +1362,7 @@ Int_t SBSSimDecoder::LoadDetector( std::map<Decoder::THaSlotData*,
       loadevt = false;
       mod = simev->Tgep->Harm_FPP1_dighit_module->at(j);
       lchan = simev->Tgep->Harm_FPP1_dighit_strip->at(j);
-      apvnum = APVnum(detname, mod, lchan, crate, slot, chan);
+      apvnum = APVnum(ldr, mod, lchan, crate, slot, chan);
       
       if(simev->Tgep->Harm_FPP1_dighit_samp->at(j)>=0){
 	strips.push_back(chan);
@@ -1494,19 +1386,7 @@ Int_t SBSSimDecoder::LoadDetector( std::map<Decoder::THaSlotData*,
 	if( crate >= 0 || slot >=  0 ) {
 	  sldat = crateslot[idx(crate,slot)].get();
 	}
-	std::vector<UInt_t> *myev = &(map[sldat]);
-	
-	if(!samps.empty()){
-	  //myev->push_back(SBSSimDataDecoder::EncodeHeader(5, apvnum, samps.size()));
-	  //I think I'm onto something here, but I also need to transmit strip num 
-	  myev->push_back(SBSSimDataDecoder::EncodeHeader(9, apvnum, samps.size()));
-	  for(int k = 0; k<(int)samps.size(); k++){
-	    // cout << " " << samps[k];
-	    myev->push_back(strips[k]*8192+samps[k]);//strips[k]<< 13 | samps[k]);
-	  }
-	  //for(int l = 0; l<myev->size();l++)cout << myev->at(l) << " ";
-	  //cout << endl;
-	}
+	LoadStrips( ldr, sldat, apvnum, strips, samps );
 	//cout << endl;
 	
 	samps.clear();
@@ -1516,7 +1396,7 @@ Int_t SBSSimDecoder::LoadDetector( std::map<Decoder::THaSlotData*,
   }
     
   //add here the GEN-RP scintillators
-  if(strcmp(detname.c_str(), "sbs.active_ana")==0){
+  if(ldr.type == kActiveAna){
     //cout << " ouh " << detname.c_str() << " " << simev->Tgenrp->Earm_BBSHTF1_hit_nhits << " " << simev->Tgenrp->Earm_BBSH_dighit_nchan << endl;
     samps.clear();
     assert(simev->Tgenrp->b_Harm_ActAn_dighit_nchan);
@@ -1547,23 +1427,13 @@ Int_t SBSSimDecoder::LoadDetector( std::map<Decoder::THaSlotData*,
 	//col = (lchan-row)/4;
 	//lchan = row*4+col;
 	//ADC
-	ChanToROC(detname, lchan, crate, slot, chan);
+	ChanToROC(ldr, lchan, crate, slot, chan);
 	//if(crate!=9)cout << detname << " " << simev->Tgenrp->Harm_ActAn_dighit_chan->at(j) << " " << lchan << " " << crate << " " << slot << endl;
 	
 	if( crate >= 0 || slot >=  0 ) {
 	  sldat = crateslot[idx(crate,slot)].get();
 	}
-	std::vector<UInt_t> *myev = &(map[sldat]);
-	
-	// cout << detname.c_str() << " det channel " << lchan << ", crate " << crate 
-	//      << ", slot " << slot << " chan " << chan << " size " << samps.size() << endl;
-	if(!samps.empty()){
-	  myev->push_back(SBSSimDataDecoder::EncodeHeader(5, chan, samps.size()));
-	  for(unsigned int samp : samps){
-	    myev->push_back(samp);
-	    //cout << " " << samps[k];
-	  }
-	}
+	LoadSamples( ldr, sldat, chan, samps );
 	//cout << endl;
 	
 	samps.clear();
@@ -1572,12 +1442,12 @@ Int_t SBSSimDecoder::LoadDetector( std::map<Decoder::THaSlotData*,
       /*
       //cout << j << " " << simev->Tgenrp->Harm_ActAn_dighit_chan->at(j) << " " << simev->Tgenrp->Harm_ActAn_dighit_adc->at(j) << endl;
       lchan = simev->Tgenrp->Harm_ActAn_dighit_chan->at(j);
-      ChanToROC(detname, lchan, crate, slot, chan);
+      ChanToROC(ldr, lchan, crate, slot, chan);
       
       if( crate >= 0 || slot >=  0 ) {
 	sldat = crateslot[idx(crate,slot)].get();
       }
-      std::vector<UInt_t> *myev = &(map[sldat]);
+      std::vector<UInt_t> *myev = &(ldr.Words(sldat));
       
       myev->push_back(SBSSimDataDecoder::EncodeHeader(6, chan, 1));
    
@@ -1591,70 +1461,54 @@ Int_t SBSSimDecoder::LoadDetector( std::map<Decoder::THaSlotData*,
       */
     }
   }
-  if(strcmp(detname.c_str(), "sbs.hodoPR")==0){
+  if(ldr.type == kHodoPR){
     //cout << " ouh " << detname.c_str() << " " << simev->Tgenrp->Earm_BBHodoScint_hit_nhits << " " << simev->Tgenrp->Harm_PRPolScintFarSide_dighit_nchan << endl;
     // cout << simev->Tgenrp->Harm_PRPolScintFarSide_dighit_chan->size() << " " 
     // 	 << simev->Tgenrp->Harm_PRPolScintFarSide_dighit_adc->size() << " " 
     // 	 << simev->Tgenrp->Harm_PRPolScintFarSide_dighit_tdc_l->size() << " " 
     // 	 << simev->Tgenrp->Harm_PRPolScintFarSide_dighit_tdc_t->size() << endl; 
     /*
-    ChanToROC(detname, 180, crate, slot, chan);
+    ChanToROC(ldr, 180, crate, slot, chan);
     cout << crate << " " << slot << " " << chan << endl;
     if( crate >= 0 || slot >=  0 ) {
       sldat = crateslot[idx(crate,slot)].get();
     }
-    std::vector<UInt_t> *myev = &(map[sldat]);
+    std::vector<UInt_t> *myev = &(ldr.Words(sldat));
     myev->push_back(SBSSimDataDecoder::EncodeHeader(1, chan, 2));
     myev->push_back(0);
     */
-    int ntdc = 0;
     assert(simev->Tgenrp->b_Harm_PRPolScintFarSide_dighit_nchan);
     for(int j = 0; j<simev->Tgenrp->Harm_PRPolScintFarSide_dighit_nchan; j++){
-      ntdc = 0;
       lchan = simev->Tgenrp->Harm_PRPolScintFarSide_dighit_chan->at(j);
       //do we want that???
       //col = lchan%2;
       //row = (lchan-col)/2;
       //lchan = col*24+row;
-      ChanToROC(detname, lchan, crate, slot, chan);
+      ChanToROC(ldr, lchan, crate, slot, chan);
       //if(crate!=9)cout << detname << " " << simev->Tgenrp->Harm_PRPolScintFarSide_dighit_chan->at(j) << " " << lchan << " " << crate << " " << slot << endl;
       if( crate >= 0 || slot >=  0 ) {
 	sldat = crateslot[idx(crate,slot)].get();
       }
-      if(simev->Tgenrp->Harm_PRPolScintFarSide_dighit_tdc_l->at(j)>-1000000)ntdc++;
-      if(simev->Tgenrp->Harm_PRPolScintFarSide_dighit_tdc_t->at(j)>-1000000)ntdc++;
-      
-      if(ntdc){
-	std::vector<UInt_t> *myev = &(map[sldat]);
-	myev->push_back(SBSSimDataDecoder::EncodeHeader(1, chan, ntdc));
-	
-	if(simev->Tgenrp->Harm_PRPolScintFarSide_dighit_tdc_l->at(j)>-1000000)myev->push_back(simev->Tgenrp->Harm_PRPolScintFarSide_dighit_tdc_l->at(j));
-	if(simev->Tgenrp->Harm_PRPolScintFarSide_dighit_tdc_t->at(j)>-1000000){
-	  uint tdc =  simev->Tgenrp->Harm_PRPolScintFarSide_dighit_tdc_t->at(j)|(1<<31);
-	  //cout << tdc << endl;
-	  myev->push_back( tdc );
-	}
+      times.clear();
+      if(simev->Tgenrp->Harm_PRPolScintFarSide_dighit_tdc_l->at(j)>-1000000)times.push_back(simev->Tgenrp->Harm_PRPolScintFarSide_dighit_tdc_l->at(j));
+      if(simev->Tgenrp->Harm_PRPolScintFarSide_dighit_tdc_t->at(j)>-1000000)times.push_back(simev->Tgenrp->Harm_PRPolScintFarSide_dighit_tdc_t->at(j)|(1<<31));
+      if(!times.empty())
+	LoadTimes( ldr, sldat, 1, chan, times );
       /*
-      ChanToROC(detname, lchan, crate, slot, chan);//+91 ??? that might be the trick
+      ChanToROC(ldr, lchan, crate, slot, chan);//+91 ??? that might be the trick
       if( crate >= 0 || slot >=  0 ) {
 	sldat = crateslot[idx(crate,slot)].get();
       }
-      myev = &(map[sldat]);
+      myev = &(ldr.Words(sldat));
       
       myev->push_back(SBSSimDataDecoder::EncodeHeader(8, chan, 1));
       myev->push_back(simev->Tgenrp->Harm_PRPolScintFarSide_dighit_adc->at(j));
       */
-	if(fDebug>2){
-	  std::cout << " j = " << j << " my ev = {";
-	  for(size_t k = 0; k<myev->size(); k++)std::cout << myev->at(k) << " ; ";
-	  std::cout << " } " << std::endl;
-	}
-      }
     }
   }
 
   //GENRP GEMs
-  if(strcmp(detname.c_str(), "sbs.gemCeF")==0){
+  if(ldr.type == kGEMCeF){
     //cout << fPx << " " << fPy << " " << fPz << "   " << fVz << endl;
     samps.clear();  
     strips.clear();  
@@ -1664,7 +1518,7 @@ Int_t SBSSimDecoder::LoadDetector( std::map<Decoder::THaSlotData*,
       loadevt = false;
       mod = simev->Tgenrp->Harm_CEPolFront_dighit_module->at(j);
       lchan = simev->Tgenrp->Harm_CEPolFront_dighit_strip->at(j);
-      apvnum = APVnum(detname, mod, lchan, crate, slot, chan);
+      apvnum = APVnum(ldr, mod, lchan, crate, slot, chan);
       
       if(simev->Tgenrp->Harm_CEPolFront_dighit_samp->at(j)>=0){
 	strips.push_back(chan);
@@ -1688,19 +1542,7 @@ Int_t SBSSimDecoder::LoadDetector( std::map<Decoder::THaSlotData*,
 	if( crate >= 0 || slot >=  0 ) {
 	  sldat = crateslot[idx(crate,slot)].get();
 	}
-	std::vector<UInt_t> *myev = &(map[sldat]);
-	
-	if(!samps.empty()){
-	  //myev->push_back(SBSSimDataDecoder::EncodeHeader(5, apvnum, samps.size()));
-	  //I think I'm onto something here, but I also need to transmit strip num 
-	  myev->push_back(SBSSimDataDecoder::EncodeHeader(9, apvnum, samps.size()));
-	  for(int k = 0; k<(int)samps.size(); k++){
-	    // cout << " " << samps[k];
-	    myev->push_back(strips[k]*8192+samps[k]);//strips[k]<< 13 | samps[k]);
-	  }
-	  //for(int l = 0; l<myev->size();l++)cout << myev->at(l) << " ";
-	  //cout << endl;
-	}
+	LoadStrips( ldr, sldat, apvnum, strips, samps );
 	//cout << endl;
 	
 	samps.clear();
@@ -1709,7 +1551,7 @@ Int_t SBSSimDecoder::LoadDetector( std::map<Decoder::THaSlotData*,
     }
   }
 
-  if(strcmp(detname.c_str(), "sbs.gemCeR")==0){
+  if(ldr.type == kGEMCeR){
     //cout << fPx << " " << fPy << " " << fPz << "   " << fVz << endl;
     samps.clear();  
     strips.clear();  
@@ -1719,7 +1561,7 @@ Int_t SBSSimDecoder::LoadDetector( std::map<Decoder::THaSlotData*,
       loadevt = false;
       mod = simev->Tgenrp->Harm_CEPolRear_dighit_module->at(j);
       lchan = simev->Tgenrp->Harm_CEPolRear_dighit_strip->at(j);
-      apvnum = APVnum(detname, mod, lchan, crate, slot, chan);
+      apvnum = APVnum(ldr, mod, lchan, crate, slot, chan);
       
       if(simev->Tgenrp->Harm_CEPolRear_dighit_samp->at(j)>=0){
 	strips.push_back(chan);
@@ -1743,19 +1585,7 @@ Int_t SBSSimDecoder::LoadDetector( std::map<Decoder::THaSlotData*,
 	if( crate >= 0 || slot >=  0 ) {
 	  sldat = crateslot[idx(crate,slot)].get();
 	}
-	std::vector<UInt_t> *myev = &(map[sldat]);
-	
-	if(!samps.empty()){
-	  //myev->push_back(SBSSimDataDecoder::EncodeHeader(5, apvnum, samps.size()));
-	  //I think I'm onto something here, but I also need to transmit strip num 
-	  myev->push_back(SBSSimDataDecoder::EncodeHeader(9, apvnum, samps.size()));
-	  for(int k = 0; k<(int)samps.size(); k++){
-	    // cout << " " << samps[k];
-	    myev->push_back(strips[k]*8192+samps[k]);//strips[k]<< 13 | samps[k]);
-	  }
-	  //for(int l = 0; l<myev->size();l++)cout << myev->at(l) << " ";
-	  //cout << endl;
-	}
+	LoadStrips( ldr, sldat, apvnum, strips, samps );
 	//cout << endl;
 	
 	samps.clear();
@@ -1764,7 +1594,7 @@ Int_t SBSSimDecoder::LoadDetector( std::map<Decoder::THaSlotData*,
     }
   }
   
-  if(strcmp(detname.c_str(), "sbs.gemPR")==0){
+  if(ldr.type == kGEMPR){
     //cout << fPx << " " << fPy << " " << fPz << "   " << fVz << endl;
     samps.clear();  
     strips.clear();  
@@ -1774,7 +1604,7 @@ Int_t SBSSimDecoder::LoadDetector( std::map<Decoder::THaSlotData*,
       loadevt = false;
       mod = simev->Tgenrp->Harm_PRPolGEMFarSide_dighit_module->at(j);
       lchan = simev->Tgenrp->Harm_PRPolGEMFarSide_dighit_strip->at(j);
-      apvnum = APVnum(detname, mod, lchan, crate, slot, chan);
+      apvnum = APVnum(ldr, mod, lchan, crate, slot, chan);
       
       if(simev->Tgenrp->Harm_PRPolGEMFarSide_dighit_samp->at(j)>=0){
 	strips.push_back(chan);
@@ -1798,19 +1628,7 @@ Int_t SBSSimDecoder::LoadDetector( std::map<Decoder::THaSlotData*,
 	if( crate >= 0 || slot >=  0 ) {
 	  sldat = crateslot[idx(crate,slot)].get();
 	}
-	std::vector<UInt_t> *myev = &(map[sldat]);
-	
-	if(!samps.empty()){
-	  //myev->push_back(SBSSimDataDecoder::EncodeHeader(5, apvnum, samps.size()));
-	  //I think I'm onto something here, but I also need to transmit strip num 
-	  myev->push_back(SBSSimDataDecoder::EncodeHeader(9, apvnum, samps.size()));
-	  for(int k = 0; k<(int)samps.size(); k++){
-	    // cout << " " << samps[k];
-	    myev->push_back(strips[k]*8192+samps[k]);//strips[k]<< 13 | samps[k]);
-	  }
-	  //for(int l = 0; l<myev->size();l++)cout << myev->at(l) << " ";
-	  //cout << endl;
-	}
+	LoadStrips( ldr, sldat, apvnum, strips, samps );
 	//cout << endl;
 	
 	samps.clear();
@@ -1848,7 +1666,7 @@ Int_t SBSSimDecoder::LoadDetector( std::map<Decoder::THaSlotData*,
     assert(HitData_Det->chan->at(j)>=0);
     //determine crate/slot
     lchan = (int)HitData_Det->chan->at(j);//+chan_mult*fNChan[detname];
-    ChanToROC(detname, lchan, crate, slot, chan);
+    ChanToROC(ldr, lchan, crate, slot, chan);
 
     if(fDebug>2)
       std::cout << "crate " << crate  << " slot " << slot << " chan " << chan << std::endl;
@@ -1862,7 +1680,7 @@ Int_t SBSSimDecoder::LoadDetector( std::map<Decoder::THaSlotData*,
     }
     
     //save the header
-    std::vector<UInt_t> *myev = &(map[sldat]);
+    std::vector<UInt_t> *myev = &(ldr.Words(sldat));
     myev->push_back(SBSSimDataDecoder::EncodeHeader(data_type,chan,nwords));
     if(detname.find("gem")!=std::string::npos){
       for(int k = 0; k<2;k++){ myev->push_back(mpd_hdr[k]);
@@ -1950,6 +1768,20 @@ void SBSSimDecoder::SetDetectors()
 
   rundate.Print();
 
+  std::vector<std::string> detnames;
+  GetDetectorNames( detnames );
+  for( size_t i = 0; i < detnames.size(); i++ ){
+    cout << "Setting det " << detnames[i] << " into SBSSimDecoder" << endl;
+    AddDetector( detnames[i], rundate );
+  }
+}
+
+void SBSSimDecoder::GetDetectorNames( std::vector<std::string>& detnames )
+{
+  // Walk the apparatuses in gHaApps. SBSBBTotalShower is decoded as
+  // its two subdetectors (shower and preshower).
+  detnames.clear();
+  
   TIter aiter(gHaApps);
   THaApparatus* app = 0;
   while( (app=(THaApparatus*)aiter()) ){
@@ -1957,36 +1789,257 @@ void SBSSimDecoder::SetDetectors()
     TIter diter(listdet);
     TObject* det = 0;
     while( (det=(TObject*)diter()) ){
-      cout << "Setting det " << app->GetName() << "." << det->GetName() 
-	   << " into SBSSimDecoder" << endl;
       if(strcmp(app->GetDetector(det->GetName())->GetClassName(),"SBSBBTotalShower")==0){
 	SBSBBTotalShower* TS = (SBSBBTotalShower*)app->GetDetector(det->GetName());
-	// AddDetector(Form("%s.%s",app->GetName(), TS->GetShower()->GetName()), 
-	// 	    (app->GetDetector(det->GetName()))->GetInitDate());
-	// AddDetector(Form("%s.%s",app->GetName(), TS->GetPreShower()->GetName()), 
-	// 	    (app->GetDetector(det->GetName()))->GetInitDate());
-
-	AddDetector(Form("%s.%s",app->GetName(), TS->GetShower()->GetName()), 
-		    rundate);
-	AddDetector(Form("%s.%s",app->GetName(), TS->GetPreShower()->GetName()), 
-		    rundate);
-       }else{
-	// AddDetector(Form("%s.%s",app->GetName(), det->GetName()), 
-	// 	    (app->GetDetector(det->GetName()))->GetInitDate());
-
-	AddDetector(Form("%s.%s",app->GetName(), det->GetName()), 
-		    rundate);
+	detnames.push_back(Form("%s.%s",app->GetName(), TS->GetShower()->GetName()));
+	detnames.push_back(Form("%s.%s",app->GetName(), TS->GetPreShower()->GetName()));
+      }else{
+	detnames.push_back(Form("%s.%s",app->GetName(), det->GetName()));
       }
     }
   }
 }
 
+//-----------------------------------------------------------------------------
+// Detectors known to LoadDetector: the loader that encodes their hits and the
+// tree branches it reads. Only the digitized hits are used by LoadDetector;
+// this table must be kept in sync with it.
+namespace {
+  struct DetTableEntry {
+    const char* det;
+    const char* branch;
+    Int_t       type;
+  };
+
+  const DetTableEntry dettable[] = {
+    { "bb.ps",          "Earm.BBPS.dighit.*",              SBSSimDecoder::kBBPS },
+    { "bb.sh",          "Earm.BBSH.dighit.*",              SBSSimDecoder::kBBSH },
+    { "bb.hodo",        "Earm.BBHodo.dighit.*",            SBSSimDecoder::kBBHodo },
+    { "bb.grinch_tdc",  "Earm.GRINCH.dighit.*",            SBSSimDecoder::kBBGRINCH },
+    { "bb.gem",         "Earm.BBGEM.dighit.*",             SBSSimDecoder::kBBGEM },
+    { "sbs.hcal",       "Harm.HCal.dighit.*",              SBSSimDecoder::kHCal },
+    { "earm.ecal",      "Earm.ECal.dighit.*",              SBSSimDecoder::kECal },
+    { "earm.cdet",      "Earm.CDET.dighit.*",              SBSSimDecoder::kCDet },
+    { "sbs.gemFT",      "Harm.FT.dighit.*",                SBSSimDecoder::kGEMFT },
+    { "sbs.gemFPP",     "Harm.FPP1.dighit.*",              SBSSimDecoder::kGEMFPP },
+    { "sbs.active_ana", "Harm.ActAn.dighit.*",             SBSSimDecoder::kActiveAna },
+    { "sbs.hodoPR",     "Harm.PRPolScintFarSide.dighit.*", SBSSimDecoder::kHodoPR },
+    { "sbs.gemCeF",     "Harm.CEPolFront.dighit.*",        SBSSimDecoder::kGEMCeF },
+    { "sbs.gemCeR",     "Harm.CEPolRear.dighit.*",         SBSSimDecoder::kGEMCeR },
+    { "sbs.gemPR",      "Harm.PRPolGEMFarSide.dighit.*",   SBSSimDecoder::kGEMPR },
+    { nullptr, nullptr, SBSSimDecoder::kNoLoader }
+  };
+
+  const DetTableEntry* FindDetTableEntry( const std::string& detname )
+  {
+    for( int i = 0; dettable[i].det; i++ ){
+      if( detname == dettable[i].det )
+	return &dettable[i];
+    }
+    return nullptr;
+  }
+}
+
+Int_t SBSSimDecoder::GetDetectorLoader( const std::string& detname )
+{
+  const DetTableEntry* entry = FindDetTableEntry( detname );
+  return entry ? entry->type : kNoLoader;
+}
+
+bool SBSSimDecoder::GetDetectorBranches( const std::string& detname,
+					 std::vector<TString>& branches )
+{
+  const DetTableEntry* entry = FindDetTableEntry( detname );
+  if( entry ){
+    branches.push_back( entry->branch );
+    return true;
+  }
+  return false;
+}
+
+Int_t SBSSimDecoder::GetMCTruthGroup( const std::string& varname )
+{
+  // Classify by the variable names defined in DefineVariables.
+  // The order of the checks matters (e.g. "bbgemhit_ptridx").
+  if( varname.find("tridx") != std::string::npos ) return kTrackIdxTruth;
+  if( varname.find("esum") != std::string::npos ) return kEsumTruth;
+  if( varname.compare(0, 5, "simc_") == 0 ) return kSimcTruth;
+  if( varname.compare(0, 7, "ptrack_") == 0 ||
+      varname.compare(0, 7, "otrack_") == 0 ||
+      varname.compare(0, 8, "sdtrack_") == 0 ) return kTrackTruth;
+  if( varname.compare(0, 2, "bb") == 0 ||
+      varname.compare(0, 3, "nbb") == 0 ||
+      varname.compare(0, 4, "gep.") == 0 ) return kGEMTruth;
+  // "mc_*" come from the "ev" branch, which is always read
+  return -1;
+}
+
+void SBSSimDecoder::GetMCTruthBranches( Int_t group, std::vector<TString>& branches )
+{
+  // Patterns not present in the tree of a given experiment are simply ignored.
+  switch( group ){
+  case kSimcTruth:
+    branches.push_back( "simc.*" );
+    break;
+  case kGEMTruth:
+    branches.push_back( "Earm.BBGEM.Track.*" );
+    branches.push_back( "Earm.BBGEM.hit.*" );
+    branches.push_back( "Harm.FT.Track.*" );
+    branches.push_back( "Harm.FT.hit.*" );
+    branches.push_back( "Harm.FPP1.Track.*" );
+    branches.push_back( "Harm.FPP1.hit.*" );
+    break;
+  case kEsumTruth:
+    branches.push_back( "*.det.esum" );
+    break;
+  case kTrackIdxTruth:
+    branches.push_back( "*tridx" );
+    break;
+  case kTrackTruth:
+    branches.push_back( "PTrack.*" );
+    branches.push_back( "OTrack.*" );
+    branches.push_back( "SDTrack.*" );
+    break;
+  default:
+    break;
+  }
+}
+
 Int_t SBSSimDecoder::AddDetector(std::string detname, TDatime date)
 {
   fDetectors.push_back(detname);
   return ReadDetectorDB(detname, date);
 }
 
+void SBSSimDecoder::SetupLoaders()
+{
+  // Resolve the detector names and channel tables once, so that
+  // LoadDetector needs no string compares or map lookups per hit.
+  // Must be called after the detector databases have been read.
+  fLoaders.clear();
+  fLoaders.resize(fDetectors.size());
+  for( size_t d = 0; d < fDetectors.size(); d++ ){
+    DetLoader& ldr = fLoaders[d];
+    ldr.name = fDetectors[d];
+    ldr.type = GetDetectorLoader(ldr.name);
+    auto it = fInvDetMap.find(ldr.name);
+    if( it != fInvDetMap.end() )
+      ldr.chanmap = &it->second;
+    auto jt = fInvGEMDetMap.find(ldr.name);
+    if( jt != fInvGEMDetMap.end() )
+      ldr.gemmap = &jt->second;
+
+    if( ldr.type == kNoLoader ){
+      cout << "SBSSimDecoder: no loader for detector " << ldr.name
+	   << ", its hits will not be decoded" << endl;
+    } else if( !ldr.chanmap && !ldr.gemmap ){
+      cout << "SBSSimDecoder: no channel map for detector " << ldr.name
+	   << ", its hits will not be decoded" << endl;
+      ldr.type = kNoLoader;
+    }
+  }
+}
+
+//-----------------------------------------------------------------------------
+std::vector<UInt_t>& SBSSimDecoder::DetLoader::Words( Decoder::THaSlotData* sldat )
+{
+  // Return the word buffer of slot sldat for this event, adding the slot if
+  // it has no buffer yet. Hits are sorted by channel, so usually the slot is
+  // the same as for the previous call. The returned reference is valid only
+  // until the next call.
+  if( last < nslots && slots[last].sldat == sldat )
+    return slots[last].words;
+  for( last = 0; last < nslots; last++ ){
+    if( slots[last].sldat == sldat )
+      return slots[last].words;
+  }
+  if( nslots == slots.size() )
+    slots.emplace_back();
+  last = nslots++;
+  slots[last].sldat = sldat;
+  slots[last].words.clear(); // keeps the capacity of earlier events
+  return slots[last].words;
+}
+
+//-----------------------------------------------------------------------------
+bool SBSSimDecoder::InjectSlot( Decoder::THaSlotData* sldat )
+{
+  // Direct injection: true if data for slot sldat should be loaded. As with
+  // LoadSlot, slots without a module are skipped, and any slot with a module
+  // marks this event as a physics event.
+  if( !sldat || !sldat->GetModule() )
+    return false;
+  event_type = 1;
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+void SBSSimDecoder::LoadSamples( DetLoader& ldr, Decoder::THaSlotData* sldat,
+				 UShort_t chan, const std::vector<UInt_t>& samps )
+{
+  // Load the ADC samples of channel 'chan' of slot sldat
+  // (SBSSimSADCEncoder, type 5)
+  if( fDirectInjection ) {
+    if( InjectSlot(sldat) ) {
+      for( UInt_t samp : samps )
+	sldat->loadData("adc", chan, samp, samp);
+    }
+    return;
+  }
+  std::vector<UInt_t>& words = ldr.Words(sldat);
+  if( !samps.empty() ) {
+    words.push_back(SBSSimDataDecoder::EncodeHeader(5, chan, samps.size()));
+    words.insert(words.end(), samps.begin(), samps.end());
+  }
+}
+
+//-----------------------------------------------------------------------------
+void SBSSimDecoder::LoadStrips( DetLoader& ldr, Decoder::THaSlotData* sldat,
+				UShort_t apvnum, const std::vector<UInt_t>& strips,
+				const std::vector<UInt_t>& samps )
+{
+  // Load the samples of APV 'apvnum' of slot sldat. strips[k] is the APV
+  // channel of sample samps[k] (SBSSimMPDEncoder, type 9)
+  assert( strips.size() == samps.size() );
+  if( fDirectInjection ) {
+    if( InjectSlot(sldat) ) {
+      for( size_t k = 0; k < samps.size(); k++ ) {
+	UInt_t word = strips[k]*8192+samps[k];
+	sldat->loadData("adc", apvnum, word%8192, word/8192);
+      }
+    }
+    return;
+  }
+  std::vector<UInt_t>& words = ldr.Words(sldat);
+  if( !samps.empty() ) {
+    words.push_back(SBSSimDataDecoder::EncodeHeader(9, apvnum, samps.size()));
+    for( size_t k = 0; k < samps.size(); k++ )
+      words.push_back(strips[k]*8192+samps[k]);//strips[k]<< 13 | samps[k]);
+  }
+}
+
+//-----------------------------------------------------------------------------
+void SBSSimDecoder::LoadTimes( DetLoader& ldr, Decoder::THaSlotData* sldat,
+			       UShort_t type, UShort_t chan,
+			       const std::vector<UInt_t>& times )
+{
+  // Load the TDC hits of channel 'chan' of slot sldat (SBSSimTDCEncoder
+  // 'type'). Bit 31 of a time is the edge (1 for trailing edge).
+  if( fDirectInjection ) {
+    if( InjectSlot(sldat) ) {
+      for( UInt_t time : times )
+	sldat->loadData("tdc", chan, time&0x7FFFFFFF, (time>>31)&0x1);
+    }
+    return;
+  }
+  std::vector<UInt_t>& words = ldr.Words(sldat);
+  if( !times.empty() ) {
+    words.push_back(SBSSimDataDecoder::EncodeHeader(type, chan, times.size()));
+    words.insert(words.end(), times.begin(), times.end());
+  }
+}
+
+//-----------------------------------------------------------------------------
 Int_t SBSSimDecoder::ReadDetectorDB(std::string detname, TDatime date)
 {
   //EPAF: in here the det name is the "full" det name i.e. including the spectro name
@@ -2271,7 +2324,7 @@ Int_t SBSSimDecoder::ReadDetectorDB(std::string detname, TDatime date)
 
 //-----------------------------------------------------------------------------
 //static inline
-void SBSSimDecoder::ChanToROC(const std::string& detname, Int_t h_chan,
+void SBSSimDecoder::ChanToROC(const DetLoader& ldr, Int_t h_chan,
 			       Int_t& crate, Int_t& slot, UShort_t& chan )const 
 {
   // Convert location parameters (row, col, chan) of the given Channel
@@ -2296,20 +2349,23 @@ void SBSSimDecoder::ChanToROC(const std::string& detname, Int_t h_chan,
   crate = d.quot+FC;
   slot  = d.rem+FS;
   */
-  if( (size_t)h_chan>=fInvDetMap.at(detname).size() )std::cout << " " << detname << " "  << h_chan << " " << &fInvDetMap.at(detname) << std::endl;
-  assert( (size_t)h_chan<fInvDetMap.at(detname).size() );
+  assert( ldr.chanmap );
+  const std::vector<detchaninfo>& invmap = *ldr.chanmap;
+  if( (size_t)h_chan>=invmap.size() )std::cout << " " << ldr.name << " "  << h_chan << " " << &invmap << std::endl;
+  assert( (size_t)h_chan<invmap.size() );
   
   if(fDebug>3){
   
-    std::cout << &(fInvDetMap.at(detname)).at(h_chan) << std::endl;
+    std::cout << &invmap[h_chan] << std::endl;
   }
-  crate = ((fInvDetMap.at(detname)).at(h_chan)).crate;
-  slot = ((fInvDetMap.at(detname)).at(h_chan)).slot;
-  chan = ((fInvDetMap.at(detname)).at(h_chan)).chan;
+  const detchaninfo& info = invmap[h_chan];
+  crate = info.crate;
+  slot = info.slot;
+  chan = info.chan;
   
 }
 
-int SBSSimDecoder::APVnum(const std::string& detname, Int_t mod, Int_t h_chan,
+int SBSSimDecoder::APVnum(const DetLoader& ldr, Int_t mod, Int_t h_chan,
 			  Int_t &crate, Int_t &slot, UShort_t &chan) const
 {
   chan = h_chan%128;
@@ -2318,8 +2374,10 @@ int SBSSimDecoder::APVnum(const std::string& detname, Int_t mod, Int_t h_chan,
   // std::cout << "(detname, mod, h_chan, chan, n )= (" << detname << ", " << mod << ", "
   // 	    << h_chan << ", " << chan << ", " << n << ")" << std::endl;
   
-  assert( (size_t)mod<fInvGEMDetMap.at(detname).size() );
-  assert( (size_t)n<(fInvGEMDetMap.at(detname)[mod]).size() );
+  assert( ldr.gemmap );
+  const std::vector<std::vector<gemstripinfo>>& invmap = *ldr.gemmap;
+  assert( (size_t)mod<invmap.size() );
+  assert( (size_t)n<invmap[mod].size() );
 
   // if( mod>fInvGEMDetMap.at(detname).size() ){
   //   std::err << "ERROR: map size =  " << " for detector " << detname 
@@ -2330,9 +2388,10 @@ int SBSSimDecoder::APVnum(const std::string& detname, Int_t mod, Int_t h_chan,
   // }
   //if((fInvGEMDetMap.at(detname))[mod][n].chan_lo<=h_chan &&
   // hchan <= (fInvGEMDetMap.at(detname))[mod][n].chan_hi){
-  crate = ((fInvGEMDetMap.at(detname))[mod][n]).crate;
-  slot = ((fInvGEMDetMap.at(detname))[mod][n]).slot;
-  return ((fInvGEMDetMap.at(detname))[mod][n]).apvnum;
+  const gemstripinfo& info = invmap[mod][n];
+  crate = info.crate;
+  slot = info.slot;
+  return info.apvnum;
   //}else{
   //return -1;
   //}
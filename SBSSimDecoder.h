@@ -78,6 +78,32 @@ class SBSSimDecoder : public Podd::SimDecoder {
     virtual ~gemstripinfo(){};
   };
   
+  // Names ("app.det") of all detectors the decoder will load from the
+  // simulation tree, i.e. those of the apparatuses in gHaApps
+  static void GetDetectorNames( std::vector<std::string>& detnames );
+  // Loaders for the detectors known to LoadDetector
+  enum EDetLoader { kNoLoader = -1,
+		    kBBPS, kBBSH, kBBHodo, kBBGRINCH, kBBGEM, kHCal,
+		    kECal, kCDet, kGEMFT, kGEMFPP, kActiveAna, kHodoPR,
+		    kGEMCeF, kGEMCeR, kGEMPR };
+  // Loader (EDetLoader) for detector "detname", or kNoLoader if unknown
+  static Int_t GetDetectorLoader( const std::string& detname );
+  // Tree branches (wildcard patterns) needed to decode detector "detname".
+  // Returns false if the detector is unknown (then all branches should be read)
+  static bool GetDetectorBranches( const std::string& detname,
+				   std::vector<TString>& branches );
+  // Load the digitized hits directly into the slot data (as the SBSSimADC/
+  // SBSSimTDC modules would) instead of encoding them into SBSSimDataDecoder
+  // words that the modules decode again. Off by default; the encoded path
+  // remains available for validation.
+  void SetDirectInjection( bool enable = true ) { fDirectInjection = enable; }
+  bool IsDirectInjection() const { return fDirectInjection; }
+  // MC truth group (MCTruth_t) filled by MC variable "varname" (without the
+  // MC prefix), or -1 if the variable doesn't depend on any optional group
+  static Int_t GetMCTruthGroup( const std::string& varname );
+  // Tree branches (wildcard patterns) read for MC truth group "group"
+  static void GetMCTruthBranches( Int_t group, std::vector<TString>& branches );
+  
   //Utilities
   // a bit dumb, I know, but I don't know another way
   //void SetTree(TTree *t);
@@ -108,12 +134,42 @@ protected:
 
   bool fIsInit;
 
+  // Encoded words for one slot in the current event
+  struct SlotWords {
+    Decoder::THaSlotData* sldat = nullptr;
+    std::vector<UInt_t>   words;
+  };
+  // Per-detector state used by LoadDetector, set up once in Init. The slot
+  // buffers are reused from event to event (only the first nslots are in
+  // use in the current event).
+  struct DetLoader {
+    std::string name;            // "app.det"
+    Int_t type = kNoLoader;      // EDetLoader
+    const std::vector<detchaninfo>* chanmap = nullptr;               // fInvDetMap entry
+    const std::vector<std::vector<gemstripinfo>>* gemmap = nullptr;  // fInvGEMDetMap entry
+    std::vector<SlotWords> slots;
+    size_t nslots = 0;
+    size_t last = 0;             // slot of the most recent Words() call
+
+    std::vector<UInt_t>& Words( Decoder::THaSlotData* sldat );
+    void Clear() { nslots = last = 0; }
+  };
+
   void SetDetectors();
+  void SetupLoaders();
   Int_t AddDetector(std::string detname, TDatime date);
   Int_t ReadDetectorDB(std::string detname, TDatime date);
-  Int_t LoadDetector( std::map<Decoder::THaSlotData*, std::vector<UInt_t> > &map,
-		      const std::string& detname,
-		      const SBSSimEvent* simev); 
+  Int_t LoadDetector( DetLoader& ldr, const SBSSimEvent* simev );
+  // Hand one channel's hits to slot sldat, either encoded (ldr.Words) or
+  // injected directly (fDirectInjection)
+  bool InjectSlot( Decoder::THaSlotData* sldat );
+  void LoadSamples( DetLoader& ldr, Decoder::THaSlotData* sldat,
+		    UShort_t chan, const std::vector<UInt_t>& samps );
+  void LoadStrips( DetLoader& ldr, Decoder::THaSlotData* sldat,
+		   UShort_t apvnum, const std::vector<UInt_t>& strips,
+		   const std::vector<UInt_t>& samps );
+  void LoadTimes( DetLoader& ldr, Decoder::THaSlotData* sldat, UShort_t type,
+		  UShort_t chan, const std::vector<UInt_t>& times );
   
   void CheckForEnabledDetectors();
   //void CheckForDetector(const char *detname, short id);
@@ -122,6 +178,8 @@ protected:
   
   bool fCheckedForEnabledDetectors;
   std::vector<std::string> fDetectors;
+  std::vector<DetLoader> fLoaders; //! One per entry of fDetectors
+  bool fDirectInjection;           // Bypass the encode/decode round trip
   
   //bool fTreeIsSet;
   //digsim_tree* fTree;
@@ -143,12 +201,24 @@ protected:
   std::map<std::string, uint> fFirstCrateDetMap;
   */
   
-  void ChanToROC( const std::string& detname, Int_t h_chan,
+  void ChanToROC( const DetLoader& ldr, Int_t h_chan,
 		  Int_t &crate, Int_t &slot, UShort_t &chan ) const;
   
-  int APVnum( const std::string& detname, Int_t mod, Int_t h_chan,
+  int APVnum( const DetLoader& ldr, Int_t mod, Int_t h_chan,
 	      Int_t &crate, Int_t &slot, UShort_t &chan ) const;
   
+  // Non-owning view of a vector branch of the simulation tree. The MC truth
+  // arrays are exported as global variables through these views instead of
+  // being copied; a view is valid until the next tree entry is read.
+  template<typename T> struct MCTruthArray {
+    const T* data = nullptr;
+    Int_t    n    = 0;
+    void Set( const std::vector<T>* v ) {
+      data = v ? v->data() : nullptr;
+      n    = v ? Int_t(v->size()) : 0;
+    }
+  };
+
   // TODO: function(s) that load(s) the MC track hit
   // simc variables
   Double_t fSigma_simc;
@@ -194,154 +264,154 @@ protected:
   Int_t fNucl;
   Int_t fFnucl;
   Int_t fNBBtracks;
-  std::vector<Int_t> fBBtrack_Nhits;
-  std::vector<Int_t> fBBtrack_TID;
-  std::vector<Int_t> fBBtrack_PID;
-  std::vector<Int_t> fBBtrack_MID;
-  std::vector<Double_t> fBBtrack_P;
-  std::vector<Double_t> fBBtrack_X;
-  std::vector<Double_t> fBBtrack_Y;
-  std::vector<Double_t> fBBtrack_dX;
-  std::vector<Double_t> fBBtrack_dY;
+  MCTruthArray<Int_t> fBBtrack_Nhits; //!
+  MCTruthArray<Int_t> fBBtrack_TID; //!
+  MCTruthArray<Int_t> fBBtrack_PID; //!
+  MCTruthArray<Int_t> fBBtrack_MID; //!
+  MCTruthArray<Double_t> fBBtrack_P; //!
+  MCTruthArray<Double_t> fBBtrack_X; //!
+  MCTruthArray<Double_t> fBBtrack_Y; //!
+  MCTruthArray<Double_t> fBBtrack_dX; //!
+  MCTruthArray<Double_t> fBBtrack_dY; //!
   Int_t fNBBGEMhits; 
-  std::vector<Int_t> fBBGEMhit_plane;
-  std::vector<Int_t> fBBGEMhit_TID;
-  std::vector<Int_t> fBBGEMhit_PID;
-  std::vector<Int_t> fBBGEMhit_MID;
-  std::vector<Double_t> fBBGEMhit_edep;
-  std::vector<Double_t> fBBGEMhit_x;
-  std::vector<Double_t> fBBGEMhit_y;
+  MCTruthArray<Int_t> fBBGEMhit_plane; //!
+  MCTruthArray<Int_t> fBBGEMhit_TID; //!
+  MCTruthArray<Int_t> fBBGEMhit_PID; //!
+  MCTruthArray<Int_t> fBBGEMhit_MID; //!
+  MCTruthArray<Double_t> fBBGEMhit_edep; //!
+  MCTruthArray<Double_t> fBBGEMhit_x; //!
+  MCTruthArray<Double_t> fBBGEMhit_y; //!
   Double_t fBBPS_esum;
   Double_t fBBSH_esum;
   Int_t fNFTtracks;
-  std::vector<Int_t> fFTtrack_Nhits;
-  std::vector<Int_t> fFTtrack_TID;
-  std::vector<Int_t> fFTtrack_PID;
-  std::vector<Int_t> fFTtrack_MID;
-  std::vector<Double_t> fFTtrack_P;
-  std::vector<Double_t> fFTtrack_X;
-  std::vector<Double_t> fFTtrack_Y;
-  std::vector<Double_t> fFTtrack_dX;
-  std::vector<Double_t> fFTtrack_dY;
+  MCTruthArray<Int_t> fFTtrack_Nhits; //!
+  MCTruthArray<Int_t> fFTtrack_TID; //!
+  MCTruthArray<Int_t> fFTtrack_PID; //!
+  MCTruthArray<Int_t> fFTtrack_MID; //!
+  MCTruthArray<Double_t> fFTtrack_P; //!
+  MCTruthArray<Double_t> fFTtrack_X; //!
+  MCTruthArray<Double_t> fFTtrack_Y; //!
+  MCTruthArray<Double_t> fFTtrack_dX; //!
+  MCTruthArray<Double_t> fFTtrack_dY; //!
   Int_t fNFTGEMhits; 
-  std::vector<Int_t> fFTGEMhit_plane;
-  std::vector<Int_t> fFTGEMhit_TID;
-  std::vector<Int_t> fFTGEMhit_PID;
-  std::vector<Int_t> fFTGEMhit_MID;
-  std::vector<Double_t> fFTGEMhit_edep;
-  std::vector<Double_t> fFTGEMhit_x;
-  std::vector<Double_t> fFTGEMhit_y;
+  MCTruthArray<Int_t> fFTGEMhit_plane; //!
+  MCTruthArray<Int_t> fFTGEMhit_TID; //!
+  MCTruthArray<Int_t> fFTGEMhit_PID; //!
+  MCTruthArray<Int_t> fFTGEMhit_MID; //!
+  MCTruthArray<Double_t> fFTGEMhit_edep; //!
+  MCTruthArray<Double_t> fFTGEMhit_x; //!
+  MCTruthArray<Double_t> fFTGEMhit_y; //!
   Int_t fNFPPtracks;
-  std::vector<Int_t> fFPPtrack_Nhits;
-  std::vector<Int_t> fFPPtrack_TID;
-  std::vector<Int_t> fFPPtrack_PID;
-  std::vector<Int_t> fFPPtrack_MID;
-  std::vector<Double_t> fFPPtrack_P;
-  std::vector<Double_t> fFPPtrack_X;
-  std::vector<Double_t> fFPPtrack_Y;
-  std::vector<Double_t> fFPPtrack_dX;
-  std::vector<Double_t> fFPPtrack_dY;
+  MCTruthArray<Int_t> fFPPtrack_Nhits; //!
+  MCTruthArray<Int_t> fFPPtrack_TID; //!
+  MCTruthArray<Int_t> fFPPtrack_PID; //!
+  MCTruthArray<Int_t> fFPPtrack_MID; //!
+  MCTruthArray<Double_t> fFPPtrack_P; //!
+  MCTruthArray<Double_t> fFPPtrack_X; //!
+  MCTruthArray<Double_t> fFPPtrack_Y; //!
+  MCTruthArray<Double_t> fFPPtrack_dX; //!
+  MCTruthArray<Double_t> fFPPtrack_dY; //!
   Int_t fNFPPGEMhits; 
-  std::vector<Int_t> fFPPGEMhit_plane;
-  std::vector<Int_t> fFPPGEMhit_TID;
-  std::vector<Int_t> fFPPGEMhit_PID;
-  std::vector<Int_t> fFPPGEMhit_MID;
-  std::vector<Double_t> fFPPGEMhit_edep;
-  std::vector<Double_t> fFPPGEMhit_x;
-  std::vector<Double_t> fFPPGEMhit_y;
+  MCTruthArray<Int_t> fFPPGEMhit_plane; //!
+  MCTruthArray<Int_t> fFPPGEMhit_TID; //!
+  MCTruthArray<Int_t> fFPPGEMhit_PID; //!
+  MCTruthArray<Int_t> fFPPGEMhit_MID; //!
+  MCTruthArray<Double_t> fFPPGEMhit_edep; //!
+  MCTruthArray<Double_t> fFPPGEMhit_x; //!
+  MCTruthArray<Double_t> fFPPGEMhit_y; //!
   Double_t fHCAL_esum;
   Double_t fECAL_esum;
   
   //PTrack & SDTrack indices
   //SD: GEM, Hodo, PS, SH, HCAL 
-  std::vector<Int_t> fBBGEMhit_ptridx;
-  std::vector<Int_t> fBBGEMhit_otridx;
-  std::vector<Int_t> fBBGEMhit_sdtridx;
-  std::vector<Int_t> fBBGEMtrack_ptridx;
-  std::vector<Int_t> fBBGEMtrack_otridx;
-  std::vector<Int_t> fBBGEMtrack_sdtridx;
-  std::vector<Int_t> fBBHODOhit_ptridx;
-  std::vector<Int_t> fBBHODOhit_otridx;
-  std::vector<Int_t> fBBHODOhit_sdtridx;
-  std::vector<Int_t> fBBPSTF1hit_ptridx;
-  std::vector<Int_t> fBBPSTF1hit_otridx;
-  std::vector<Int_t> fBBPSTF1hit_sdtridx;
-  std::vector<Int_t> fBBSHTF1hit_ptridx;
-  std::vector<Int_t> fBBSHTF1hit_otridx;
-  std::vector<Int_t> fBBSHTF1hit_sdtridx;
-  std::vector<Int_t> fHCALhit_ptridx;
-  std::vector<Int_t> fHCALhit_otridx;
-  std::vector<Int_t> fHCALhit_sdtridx;
-  std::vector<Int_t> fFThit_ptridx;
-  std::vector<Int_t> fFThit_otridx;
-  std::vector<Int_t> fFThit_sdtridx;
-  std::vector<Int_t> fFTtrack_ptridx;
-  std::vector<Int_t> fFTtrack_otridx;
-  std::vector<Int_t> fFTtrack_sdtridx;
-  std::vector<Int_t> fFPPhit_ptridx;
-  std::vector<Int_t> fFPPhit_otridx;
-  std::vector<Int_t> fFPPhit_sdtridx;
-  std::vector<Int_t> fFPPtrack_ptridx;
-  std::vector<Int_t> fFPPtrack_otridx;
-  std::vector<Int_t> fFPPtrack_sdtridx;
-  std::vector<Int_t> fECALhit_ptridx;
-  std::vector<Int_t> fECALhit_otridx;
-  std::vector<Int_t> fECALhit_sdtridx;
-  std::vector<Int_t> fCDEThit_ptridx;
-  std::vector<Int_t> fCDEThit_otridx;
-  std::vector<Int_t> fCDEThit_sdtridx;
+  MCTruthArray<Int_t> fBBGEMhit_ptridx; //!
+  MCTruthArray<Int_t> fBBGEMhit_otridx; //!
+  MCTruthArray<Int_t> fBBGEMhit_sdtridx; //!
+  MCTruthArray<Int_t> fBBGEMtrack_ptridx; //!
+  MCTruthArray<Int_t> fBBGEMtrack_otridx; //!
+  MCTruthArray<Int_t> fBBGEMtrack_sdtridx; //!
+  MCTruthArray<Int_t> fBBHODOhit_ptridx; //!
+  MCTruthArray<Int_t> fBBHODOhit_otridx; //!
+  MCTruthArray<Int_t> fBBHODOhit_sdtridx; //!
+  MCTruthArray<Int_t> fBBPSTF1hit_ptridx; //!
+  MCTruthArray<Int_t> fBBPSTF1hit_otridx; //!
+  MCTruthArray<Int_t> fBBPSTF1hit_sdtridx; //!
+  MCTruthArray<Int_t> fBBSHTF1hit_ptridx; //!
+  MCTruthArray<Int_t> fBBSHTF1hit_otridx; //!
+  MCTruthArray<Int_t> fBBSHTF1hit_sdtridx; //!
+  MCTruthArray<Int_t> fHCALhit_ptridx; //!
+  MCTruthArray<Int_t> fHCALhit_otridx; //!
+  MCTruthArray<Int_t> fHCALhit_sdtridx; //!
+  MCTruthArray<Int_t> fFThit_ptridx; //!
+  MCTruthArray<Int_t> fFThit_otridx; //!
+  MCTruthArray<Int_t> fFThit_sdtridx; //!
+  MCTruthArray<Int_t> fFTtrack_ptridx; //!
+  MCTruthArray<Int_t> fFTtrack_otridx; //!
+  MCTruthArray<Int_t> fFTtrack_sdtridx; //!
+  MCTruthArray<Int_t> fFPPhit_ptridx; //!
+  MCTruthArray<Int_t> fFPPhit_otridx; //!
+  MCTruthArray<Int_t> fFPPhit_sdtridx; //!
+  MCTruthArray<Int_t> fFPPtrack_ptridx; //!
+  MCTruthArray<Int_t> fFPPtrack_otridx; //!
+  MCTruthArray<Int_t> fFPPtrack_sdtridx; //!
+  MCTruthArray<Int_t> fECALhit_ptridx; //!
+  MCTruthArray<Int_t> fECALhit_otridx; //!
+  MCTruthArray<Int_t> fECALhit_sdtridx; //!
+  MCTruthArray<Int_t> fCDEThit_ptridx; //!
+  MCTruthArray<Int_t> fCDEThit_otridx; //!
+  MCTruthArray<Int_t> fCDEThit_sdtridx; //!
     
   //PTrack & SDTrack branches
   Int_t fPTrack_ntracks;
-  std::vector<Int_t> fPTrack_TID; 
-  std::vector<Int_t> fPTrack_PID; 
-  std::vector<Double_t> fPTrack_posx; 
-  std::vector<Double_t> fPTrack_posy;
-  std::vector<Double_t> fPTrack_posz;
-  std::vector<Double_t> fPTrack_momx;   
-  std::vector<Double_t> fPTrack_momy;
-  std::vector<Double_t> fPTrack_momz;
-  std::vector<Double_t> fPTrack_polx;
-  std::vector<Double_t> fPTrack_poly;
-  std::vector<Double_t> fPTrack_polz;
-  std::vector<Double_t> fPTrack_Etot;
-  std::vector<Double_t> fPTrack_T;                     
+  MCTruthArray<Int_t> fPTrack_TID; //! 
+  MCTruthArray<Int_t> fPTrack_PID; //! 
+  MCTruthArray<Double_t> fPTrack_posx; //! 
+  MCTruthArray<Double_t> fPTrack_posy; //!
+  MCTruthArray<Double_t> fPTrack_posz; //!
+  MCTruthArray<Double_t> fPTrack_momx; //!   
+  MCTruthArray<Double_t> fPTrack_momy; //!
+  MCTruthArray<Double_t> fPTrack_momz; //!
+  MCTruthArray<Double_t> fPTrack_polx; //!
+  MCTruthArray<Double_t> fPTrack_poly; //!
+  MCTruthArray<Double_t> fPTrack_polz; //!
+  MCTruthArray<Double_t> fPTrack_Etot; //!
+  MCTruthArray<Double_t> fPTrack_T; //!                     
   Int_t fOTrack_ntracks;
-  std::vector<Int_t> fOTrack_TID; 
-  std::vector<Int_t> fOTrack_PID; 
-  std::vector<Double_t> fOTrack_posx; 
-  std::vector<Double_t> fOTrack_posy;
-  std::vector<Double_t> fOTrack_posz;
-  std::vector<Double_t> fOTrack_momx;   
-  std::vector<Double_t> fOTrack_momy;
-  std::vector<Double_t> fOTrack_momz;
-  std::vector<Double_t> fOTrack_polx;
-  std::vector<Double_t> fOTrack_poly;
-  std::vector<Double_t> fOTrack_polz;
-  std::vector<Double_t> fOTrack_Etot;
-  std::vector<Double_t> fOTrack_T;                     
+  MCTruthArray<Int_t> fOTrack_TID; //! 
+  MCTruthArray<Int_t> fOTrack_PID; //! 
+  MCTruthArray<Double_t> fOTrack_posx; //! 
+  MCTruthArray<Double_t> fOTrack_posy; //!
+  MCTruthArray<Double_t> fOTrack_posz; //!
+  MCTruthArray<Double_t> fOTrack_momx; //!   
+  MCTruthArray<Double_t> fOTrack_momy; //!
+  MCTruthArray<Double_t> fOTrack_momz; //!
+  MCTruthArray<Double_t> fOTrack_polx; //!
+  MCTruthArray<Double_t> fOTrack_poly; //!
+  MCTruthArray<Double_t> fOTrack_polz; //!
+  MCTruthArray<Double_t> fOTrack_Etot; //!
+  MCTruthArray<Double_t> fOTrack_T; //!                     
   Double_t fSDTrack_ntracks;
-  std::vector<Int_t> fSDTrack_TID; 
-  std::vector<Int_t> fSDTrack_MID; 
-  std::vector<Int_t> fSDTrack_PID;
-  std::vector<Double_t> fSDTrack_posx; 
-  std::vector<Double_t> fSDTrack_posy;
-  std::vector<Double_t> fSDTrack_posz;
-  std::vector<Double_t> fSDTrack_momx;   
-  std::vector<Double_t> fSDTrack_momy;
-  std::vector<Double_t> fSDTrack_momz;
-  std::vector<Double_t> fSDTrack_polx;
-  std::vector<Double_t> fSDTrack_poly;
-  std::vector<Double_t> fSDTrack_polz;  
-  std::vector<Double_t> fSDTrack_Etot;
-  std::vector<Double_t> fSDTrack_T; 
-  std::vector<Double_t> fSDTrack_vx; 
-  std::vector<Double_t> fSDTrack_vy;
-  std::vector<Double_t> fSDTrack_vz; 
-  std::vector<Double_t> fSDTrack_vnx; 
-  std::vector<Double_t> fSDTrack_vny;
-  std::vector<Double_t> fSDTrack_vnz;  
-  std::vector<Double_t> fSDTrack_vEkin;  
+  MCTruthArray<Int_t> fSDTrack_TID; //! 
+  MCTruthArray<Int_t> fSDTrack_MID; //! 
+  MCTruthArray<Int_t> fSDTrack_PID; //!
+  MCTruthArray<Double_t> fSDTrack_posx; //! 
+  MCTruthArray<Double_t> fSDTrack_posy; //!
+  MCTruthArray<Double_t> fSDTrack_posz; //!
+  MCTruthArray<Double_t> fSDTrack_momx; //!   
+  MCTruthArray<Double_t> fSDTrack_momy; //!
+  MCTruthArray<Double_t> fSDTrack_momz; //!
+  MCTruthArray<Double_t> fSDTrack_polx; //!
+  MCTruthArray<Double_t> fSDTrack_poly; //!
+  MCTruthArray<Double_t> fSDTrack_polz; //!  
+  MCTruthArray<Double_t> fSDTrack_Etot; //!
+  MCTruthArray<Double_t> fSDTrack_T; //! 
+  MCTruthArray<Double_t> fSDTrack_vx; //! 
+  MCTruthArray<Double_t> fSDTrack_vy; //!
+  MCTruthArray<Double_t> fSDTrack_vz; //! 
+  MCTruthArray<Double_t> fSDTrack_vnx; //! 
+  MCTruthArray<Double_t> fSDTrack_vny; //!
+  MCTruthArray<Double_t> fSDTrack_vnz; //!  
+  MCTruthArray<Double_t> fSDTrack_vEkin; //!  
   
   //TH1D* h1_sizeHCal;
   //TH1D* h1_sizeGEMs;
@@ -22,6 +22,7 @@ SBSSimEvent::SBSSimEvent(TTree* tree, Exp_t experiment) {
   RunID = EvtID = 0;
 
   fExperiment = experiment;
+  for( int i = 0; i < kNMCTruth; i++ ) fReadMCTruth[i] = true;
 
   //Now we need to initialize the appropriate Tree structure based on experiment:
   //We should probably use an enum or something simple to make this less clunky than doing a string comparison each time we open the file
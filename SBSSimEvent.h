@@ -10,6 +10,11 @@
 
 enum Exp_t    { kGEp, kGEnRP, kGMN, kSIDIS};
 
+// Groups of MC truth branches that can be switched off independently
+// (see SBSSimFile::SelectBranches). The "ev" branch is always read since it
+// is needed for the event weight.
+enum MCTruth_t { kSimcTruth, kGEMTruth, kEsumTruth, kTrackIdxTruth, kTrackTruth, kNMCTruth };
+
 class TTree;
 
 class SBSSimEvent {
@@ -41,6 +46,10 @@ class SBSSimEvent {
   
   Exp_t fExperiment;
   
+  // Which MC truth groups are actually read from the tree. All true by default;
+  // SBSSimFile turns off the groups that the output doesn't use.
+  Bool_t fReadMCTruth[kNMCTruth];
+  
   //Auto-generated ROOT Tree classes for each experiment ROOT tree; generated using TTree::MakeClass()
   
   //Later on, any time we want to analyze a g4sbs root file whose format has changed, we can just run TTree::MakeClass on that root file with the appropriate
@@ -6,7 +6,7 @@
 //
 //   Interface to an input file with simulated SoLID spectrometer data
 //
-//   Takes raw digitized simulation data from ROOT input file and
+//   Takes raw digitized simulation data from ROOT input file(s) and
 //   uses them to fill a SBSSimEvent object. A pointer to the event
 //   object is available via GetEvBuffer() for use by the decoder.
 //
@@ -18,6 +18,8 @@
 #include "SBSSimEvent.h"
 #include "SBSBBShower.h"
 #include "SBSBBTotalShower.h"
+#include "SBSSimDecoder.h"
+#include "THaAnalyzer.h"
 //#include "evio.h"     // for S_SUCCESS
 // We really only need S_SUCCESS from evio.h, so why not just define
 // it ourselves so we don't have to pull the whole header file.
@@ -28,23 +30,32 @@
 
 #include "TFile.h"
 #include "TTree.h"
+#include "TChain.h"
+#include "TROOT.h"
 #include "TError.h"
 #include "TClonesArray.h"
 #include "TString.h"
 #include "TMath.h"
+#include "TRegexp.h"
+#include "TObjArray.h"
+#include "TObjString.h"
+#include "TBranch.h"
 
 #include <cstring>
 #include <libgen.h>    // for POSIX basename()
 #include <cstdlib>
 #include <iostream>
+#include <fstream>
+#include <algorithm>
 
 using namespace std;
 
 //-----------------------------------------------------------------------------
 SBSSimFile::SBSSimFile(const char* filename, const char *experiment, const char* description) :
   THaRunBase(description), fROOTFileName(filename), //fExperiment(experiment), 
-  fROOTFile(0), fTree(0), 
-  fEvent(0), fNEntries(0), fEntry(0), fVerbose(0)
+  fTree(0), 
+  fEvent(0), fNEntries(0), fEntry(0), fVerbose(0),
+  fSelectBranches(kTRUE), fCacheSizeMB(-1), fUnzipThreads(0)
 {
   // Constructor
 
@@ -114,7 +125,9 @@ SBSSimFile::SBSSimFile(const char* filename, const char* description, std::vecto
 //-----------------------------------------------------------------------------
 SBSSimFile::SBSSimFile(const SBSSimFile &run)
   : THaRunBase(run), fROOTFileName(run.fROOTFileName), 
-    fROOTFile(0), fTree(0), fEvent(0), fNEntries(0), fEntry(0), fVerbose(0)
+    fTree(0), fEvent(0), fNEntries(0), fEntry(0), fVerbose(0),
+    fSelectBranches(run.fSelectBranches), fCacheSizeMB(run.fCacheSizeMB),
+    fUnzipThreads(run.fUnzipThreads)
 {
 }
 
@@ -123,9 +136,13 @@ SBSSimFile& SBSSimFile::operator=(const THaRunBase& rhs)
 {
   if (this != &rhs) {
     THaRunBase::operator=(rhs);
-    if( rhs.InheritsFrom("SBSSimFile") )
-      fROOTFileName = static_cast<const SBSSimFile&>(rhs).fROOTFileName;
-    fROOTFile = 0;
+    if( rhs.InheritsFrom("SBSSimFile") ) {
+      const SBSSimFile& rhsr = static_cast<const SBSSimFile&>(rhs);
+      fROOTFileName = rhsr.fROOTFileName;
+      fSelectBranches = rhsr.fSelectBranches;
+      fCacheSizeMB = rhsr.fCacheSizeMB;
+      fUnzipThreads = rhsr.fUnzipThreads;
+    }
     fTree = 0;
     fEvent = 0;
     fNEntries = fEntry = 0;
@@ -164,7 +181,11 @@ Int_t SBSSimFile::Init()
 
   Int_t ret = THaRunBase::Init();
   if( !ret ) {
-    char* s = strdup(fROOTFileName);
+    // Run name: the (first) input file
+    TString first = fROOTFileName.Strip(TString::kBoth);
+    Ssiz_t pos = first.First(" \t,");
+    if( pos != kNPOS ) first.Remove(pos);
+    char* s = strdup(first);
     fName = basename(s);
     free(s);
     fNumber = 1;
@@ -182,8 +203,13 @@ Int_t SBSSimFile::ReadDatabase()
   FILE* f = Podd::OpenDBFile("run", fDate, "SBSSimFile::ReadDatabase", "r", 1);
   if( !f )  return -1;
   TString expt;
+  Int_t selectbranches = fSelectBranches, cachesizeMB = fCacheSizeMB;
+  Int_t unzipthreads = fUnzipThreads;
   DBRequest request[] = {
     { "experiment",  &expt, kTString },
+    { "select_branches", &selectbranches, kInt, 0, 1 },
+    { "tree_cache_mb", &cachesizeMB, kInt, 0, 1 },
+    { "unzip_threads", &unzipthreads, kInt, 0, 1 },
     { nullptr }
   };
   Int_t err = THaAnalysisObject::LoadDB( f, fDate, request, "");
@@ -199,6 +225,9 @@ Int_t SBSSimFile::ReadDatabase()
   }else{
     GetExperiment(expt.Data());
   }
+  fSelectBranches = (selectbranches != 0);
+  fCacheSizeMB = cachesizeMB;
+  fUnzipThreads = unzipthreads;
   //return err;
   
   fDBRead = true;
@@ -229,6 +258,17 @@ void SBSSimFile::GetExperiment(const char *experiment)
   
 }
 
+//-----------------------------------------------------------------------------
+void SBSSimFile::AddFile( const char* name )
+{
+  // Add input file(s) 'name' (may contain wildcards) to the run. Takes
+  // effect at the next Open().
+
+  if( !name || !*name ) return;
+  if( !fROOTFileName.IsNull() ) fROOTFileName += " ";
+  fROOTFileName += name;
+}
+
 //-----------------------------------------------------------------------------
 Int_t SBSSimFile::Open()
 {
@@ -236,20 +276,32 @@ Int_t SBSSimFile::Open()
   // Open ROOT input file
   if(fVerbose>0)std::cout << "SBSSimFile::Open(): initialize file with experiment: " << fExperiment << std::endl;
   
-  fROOTFile = new TFile(fROOTFileName, "READ", "SBS MC data");
-  if( !fROOTFile || fROOTFile->IsZombie() ) {
-    Error( __FUNCTION__, "Cannot open input file %s", fROOTFileName.Data() );
-    Close();
-    return -1;
+  // Chain all input files. Each file is opened here to check that it
+  // contains the tree.
+  fTree = new TChain(treeName);
+  TObjArray* names = fROOTFileName.Tokenize(" \t,");
+  Int_t nfiles = 0;
+  for( Int_t i = 0; i < names->GetEntriesFast(); i++ ) {
+    const char* name = static_cast<TObjString*>(names->At(i))->GetString().Data();
+    Int_t n = fTree->Add(name, 0);
+    if( n <= 0 ) {
+      Error( __FUNCTION__, "Cannot open input file %s, or tree %s does not "
+	     "exist in the file", name, treeName );
+      delete names;
+      Close();
+      return -1;
+    }
+    nfiles += n;
   }
-
-  fTree = static_cast<TTree*>( fROOTFile->Get(treeName) );
-  if( !fTree ) {
-    Error( __FUNCTION__, "Tree %s does not exist in the input file.",
-	   treeName );
+  delete names;
+  if( nfiles == 0 ) {
+    Error( __FUNCTION__, "No input file given" );
     Close();
     return -2;
   }
+  if( fVerbose > 0 || nfiles > 1 )
+    std::cout << "SBSSimFile::Open(): chained " << nfiles << " input file(s)"
+	      << std::endl;
 
   //  fTree->SetBranchStatus("*", kFALSE);
 
@@ -286,20 +338,171 @@ Int_t SBSSimFile::Open()
   //fTree->Print();
   //fEvent = new SBSSimEvent(fTree, fDetList);
   
+  SelectBranches();
+  
   fOpened = kTRUE;
   return 0;
 }
 
+//-----------------------------------------------------------------------------
+void SBSSimFile::GetOutputMCTruth( Bool_t* readtruth ) const
+{
+  // Find which MC truth groups are needed by scanning the output definition
+  // and cut files for the MC variables of the SBSSimDecoder. If the files
+  // can't be read, or a wildcard is used with the MC prefix, all groups are
+  // read.
+
+  for( int i = 0; i < kNMCTruth; i++ ) readtruth[i] = false;
+
+  THaAnalyzer* analyzer = THaAnalyzer::GetInstance();
+  if( !analyzer || !analyzer->GetOdefFile() || !*analyzer->GetOdefFile() ){
+    for( int i = 0; i < kNMCTruth; i++ ) readtruth[i] = true;
+    return;
+  }
+  
+  const string prefix = Podd::MC_PREFIX;
+  const char* files[] = { analyzer->GetOdefFile(), analyzer->GetCutFile() };
+  for( int ifile = 0; ifile < 2; ifile++ ){
+    if( !files[ifile] || !*files[ifile] ) continue; //cut file is optional
+    ifstream infile( files[ifile] );
+    if( !infile ){
+      for( int i = 0; i < kNMCTruth; i++ ) readtruth[i] = true;
+      return;
+    }
+    string line;
+    while( getline(infile, line) ){
+      size_t pos = line.find('#'); //skip comments
+      if( pos != string::npos ) line.erase(pos);
+      pos = 0;
+      while( (pos = line.find(prefix, pos)) != string::npos ){
+	pos += prefix.length();
+	size_t end = line.find_first_not_of( "abcdefghijklmnopqrstuvwxyz"
+					     "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+					     "0123456789_.*", pos );
+	string varname = line.substr( pos, end == string::npos ? string::npos : end-pos );
+	if( varname.find('*') != string::npos ){
+	  for( int i = 0; i < kNMCTruth; i++ ) readtruth[i] = true;
+	  return;
+	}
+	Int_t group = SBSSimDecoder::GetMCTruthGroup( varname );
+	if( group >= 0 ) readtruth[group] = true;
+      }
+    }
+  }
+}
+
+//-----------------------------------------------------------------------------
+void SBSSimFile::SelectBranches()
+{
+  // Deactivate all branches of the input tree except those needed for this
+  // replay: the digitized data of the detectors loaded by SBSSimDecoder,
+  // the MC truth groups used by the output, and "ev" (for the event weight).
+  // Then set up a TTreeCache for the remaining branches, so that they are
+  // read in a few large reads instead of one read per basket.
+
+  if( !fTree || !fEvent ) return;
+  
+  std::vector<TString> patterns;
+  bool selectall = !fSelectBranches;
+  
+  if( !selectall ){
+    std::vector<std::string> detnames;
+    SBSSimDecoder::GetDetectorNames( detnames );
+    for( size_t i = 0; i < detnames.size(); i++ ){
+      if( !SBSSimDecoder::GetDetectorBranches( detnames[i], patterns ) ){
+	Warning( __FUNCTION__, "No branch list for detector %s, "
+		 "reading all branches", detnames[i].c_str() );
+	selectall = true;
+	break;
+      }
+    }
+  }
+  
+  if( !selectall ){
+    GetOutputMCTruth( fEvent->fReadMCTruth );
+    patterns.push_back( "ev" );
+    for( int i = 0; i < kNMCTruth; i++ ){
+      if( fEvent->fReadMCTruth[i] )
+	SBSSimDecoder::GetMCTruthBranches( i, patterns );
+    }
+  }
+  
+  std::vector<TRegexp> regexps;
+  for( size_t i = 0; i < patterns.size(); i++ )
+    regexps.push_back( TRegexp(patterns[i], kTRUE) );
+  
+  if( !selectall ) fTree->SetBranchStatus( "*", kFALSE );
+  
+  // Only the top-level branches are considered: g4sbs writes one branch per
+  // variable, with the full dotted name. The branches are those of the first
+  // tree of the chain; all files are assumed to have the same layout.
+  std::vector<TString> active;
+  Double_t zipbytes = 0; // per event
+  TObjArray* branches = fTree->GetListOfBranches();
+  for( Int_t ib = 0; ib < branches->GetEntriesFast(); ib++ ){
+    TBranch* br = static_cast<TBranch*>( branches->At(ib) );
+    TString name = br->GetName();
+    bool keep = selectall;
+    for( size_t i = 0; i < regexps.size() && !keep; i++ ){
+      Ssiz_t len = 0;
+      keep = ( name.Index(regexps[i], &len) == 0 && len == name.Length() );
+    }
+    if( !keep ) continue;
+    if( !selectall ) fTree->SetBranchStatus( br->GetName(), kTRUE );
+    active.push_back( name );
+    if( br->GetEntries() > 0 )
+      zipbytes += Double_t(br->GetZipBytes("*"))/br->GetEntries();
+  }
+  
+  if( fVerbose > 0 || !selectall )
+    cout << "SBSSimFile::SelectBranches(): reading " << active.size() << " of "
+	 << branches->GetEntriesFast() << " branches" << endl;
+  
+  // Cache size: the compressed size of the selected branches for a few
+  // thousand events, within reasonable bounds
+  const Long64_t kMB = 1024*1024;
+  Long64_t cachesize = fCacheSizeMB*kMB;
+  if( fCacheSizeMB < 0 ){
+    cachesize = Long64_t(zipbytes*2000);
+    cachesize = std::min( std::max(cachesize, kMB), 100*kMB );
+  }
+  if( cachesize <= 0 || active.empty() ) return;
+  
+  // Background decompression: the cache unzips its baskets in parallel
+  // (ROOT implicit MT tasks) ahead of the entry being read. This must be
+  // set up before the cache is created.
+  if( fUnzipThreads > 0 ) {
+#ifdef R__USE_IMT
+    if( !ROOT::IsImplicitMTEnabled() )
+      ROOT::EnableImplicitMT( fUnzipThreads );
+    fTree->SetParallelUnzip( kTRUE );
+    if( fVerbose > 0 )
+      cout << "SBSSimFile::SelectBranches(): parallel unzipping enabled"
+	   << endl;
+#else
+    Warning( __FUNCTION__, "ROOT built without implicit MT support, "
+	     "ignoring unzip_threads = %d", fUnzipThreads );
+#endif
+  }
+  
+  // Branches are added by name, so that the cache follows the chain from
+  // file to file
+  fTree->SetCacheSize( cachesize );
+  for( size_t i = 0; i < active.size(); i++ )
+    fTree->AddBranchToCache( active[i], kTRUE );
+  fTree->StopCacheLearningPhase();
+  
+  if( fVerbose > 0 )
+    cout << "SBSSimFile::SelectBranches(): TTreeCache size " 
+	 << cachesize/kMB << " MB" << endl;
+}
+
 //-----------------------------------------------------------------------------
 Int_t SBSSimFile::Close()
 {
   if(fVerbose>0)std::cout << " SBSSimFile::Close(): closing file and destroy previously configured SBSSimEvent " << std::endl;
   
-  delete fTree; fTree = 0;
-  if (fROOTFile) {
-    fROOTFile->Close();
-    delete fROOTFile; fROOTFile = 0;
-  }
+  delete fTree; fTree = 0;  // closes the input files
   delete fEvent; fEvent = 0;
   fOpened = kFALSE;
   return 0;
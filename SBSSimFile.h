@@ -18,8 +18,7 @@
 
 #include <set>
 
-class TFile;
-class TTree;
+class TChain;
 class TBranch;
 class SBSSimEvent;
  
@@ -33,7 +32,8 @@ class SBSSimFile : public THaRunBase {
   virtual ~SBSSimFile();
   virtual SBSSimFile &operator=(const THaRunBase &rhs);
   // for ROOT RTTI
-  SBSSimFile() : fROOTFile(0), fTree(0), fEvent(0), fEntry(0) {}
+  SBSSimFile() : fTree(0), fEvent(0), fEntry(0),
+    fSelectBranches(kTRUE), fCacheSizeMB(-1), fUnzipThreads(0) {}
 
   virtual void  Print( Option_t* opt="" ) const;
 
@@ -48,17 +48,30 @@ class SBSSimFile : public THaRunBase {
   const char*   GetFileName() const { return fROOTFileName.Data(); }
   Int_t         Open();
   Int_t         ReadEvent();
+  // Input file(s): one or more file names separated by blanks or commas.
+  // Names may contain wildcards. All files are chained into one run.
   void          SetFileName( const char* name ) { fROOTFileName = name; }
+  void          AddFile( const char* name );
 
   void          SetVerbose(int v){fVerbose = v;};
+  // Read only the branches needed by the decoder and the output (default),
+  // or all branches of the tree
+  void          SetSelectBranches( Bool_t b ) { fSelectBranches = b; }
+  // TTreeCache size in MB; -1 (default) = estimate from the selected branches,
+  // 0 = no cache
+  void          SetCacheSizeMB( Int_t mb ) { fCacheSizeMB = mb; }
+  // Number of threads for decompressing the input in the background
+  // (ROOT implicit MT with parallel unzipping of the TTreeCache), 0 = off
+  void          SetUnzipThreads( Int_t n ) { fUnzipThreads = n; }
   void          GetExperiment(const char* experiment);
   
  protected:
   virtual Int_t ReadDatabase();
+  void          SelectBranches();
+  void          GetOutputMCTruth( Bool_t* readtruth ) const;
 
-  TString fROOTFileName;  //  Name of input file
-  TFile* fROOTFile;       //! Input ROOT file
-  TTree* fTree;           //! Input Tree with simulation data
+  TString fROOTFileName;  //  Name(s) of input file(s)
+  TChain* fTree;          //! Input Tree(s) with simulation data
   SBSSimEvent* fEvent;   //! Current event
 
   //std::vector<TString> fDetList;
@@ -68,13 +81,17 @@ class SBSSimFile : public THaRunBase {
 
   Int_t fVerbose;       //! Current entry number
 
+  Bool_t fSelectBranches; // Deactivate branches not needed for the replay
+  Int_t  fCacheSizeMB;    // TTreeCache size (MB), -1 = auto, 0 = off
+  Int_t  fUnzipThreads;   // Background unzipping threads, 0 = off
+
   //TString fExperiment;
   //std::set<TString> fValidExperiments;
 
   std::set<Exp_t> fValidExperiments;
   Exp_t fExperiment;
   
-  ClassDef(SBSSimFile,1) // Interface to input file with simulated SoLID data
+  ClassDef(SBSSimFile,3) // Interface to input file with simulated SoLID data
 };
 
 #endif
@@ -75,6 +75,7 @@
 //#pragma link C++ class UHitData_t+;
 //#pragma link C++ defined_in "SBSSimFadc250Module.h";
 #pragma link C++ class SBSCHAnalyzer+;
+#pragma link C++ class SBSAnalyzer+;
 #pragma link C++ class SBSRPBeamSideHodo+;
 #pragma link C++ class SBSRPFarSideHodo+;
 #pragma link C++ class SBSTimingHodoscopePMT+;
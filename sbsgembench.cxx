@@ -0,0 +1,1089 @@
+//////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// sbsgembench: standalone benchmark of the GEM decode --> cluster --> track chain
+//
+// Generates synthetic MPD/VTP frames for all the APV cards of a GEM tracker, using the module geometry,
+// decode map, pedestals and strip timing parameters read from the database, and runs them through the
+// same code as the replay: MPDModule::LoadSlot, SBSGEMModule::Decode (via SBSGEMSpectrometerTracker::Decode),
+// SBSGEMTrackerBase::hit_reconstruction and SBSGEMTrackerBase::find_tracks.
+//
+// Each event contains:
+//    - a configurable number of straight signal tracks, with hits on every module they cross
+//    - background hits at a given strip occupancy, either "uniform" (U and V clusters generated independently of
+//      each other), or "correlated" (2D hits producing one U and one V cluster with shared amplitude and time,
+//      which is the case that makes the number of hit combinations explode)
+//    - a fraction of background clusters with negative polarity
+//    - pedestals, strip noise and, for full readout frames, an event-by-event common-mode shift of each APV card
+//
+// For each occupancy point, the benchmark reports the event rate and the time spent per event in the
+// decoding, clustering and tracking stages, the mean number of hit combinations tested by find_tracks,
+// and the fraction of events for which tracking was skipped (too many hit combinations for the combinatorial search,
+// too many cells or candidates for the cellular automaton). It also reports the mean number of heap allocations
+// (calls of operator new, counted by the replacement operators below) made per event by the timed stages, and the
+// number of blocks allocated by the cluster arenas of the modules, which should both be ~0 once the work arrays
+// have reached their steady-state size.
+//
+// The DB_DIR environment variable must point to the database (as for the replay). The crate map must contain
+// MPDModule entries for the GEM crates/slots. Constraints on the track search region from other detectors are
+// not available in the benchmark, so the full acceptance is searched regardless of the "useconstraint" flag.
+//
+// With -C, only the common-mode calculation is timed: the full readout frames of every APV card are captured while
+// the events are generated, unpacked into the per-APV arrays of the module exactly as SBSGEMModule::Decode does, and
+// SBSGEMModule::GetCommonMode is called for each time sample with each of the requested methods. Besides the time per
+// call, the sum of all the common-mode values is printed with full precision, so that the results of two builds
+// (e.g. before and after a change of the common-mode code) can be checked for bit-identity on the same seed.
+//
+// With -K, every event is decoded, clustered and tracked twice, once with the strip kernels specialized for 6 or 3
+// time samples and once with the generic kernels (-G), and the time per event of both is printed side by side, with
+// the number of events for which the two passes did not give the same strips, clusters, 2D hits and tracks. Both
+// passes update the rolling common-mode averages of the modules, so with the online common-mode correction enabled
+// (-z and "correct_common_mode" in the database), a mismatch can also come from that rather than from the kernels.
+//
+// Usage: sbsgembench [options], sbsgembench -h for the list of options.
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "SBSBigBite.h"
+#include "SBSGEMSpectrometerTracker.h"
+#include "SBSGEMModule.h"
+#include "MPDModule.h"
+
+#include "SimDecoder.h"
+#include "THaSlotData.h"
+#include "THaGlobals.h"
+#include "THaVarList.h"
+#include "THaCutList.h"
+
+#include "TDatime.h"
+#include "TList.h"
+#include "TMath.h"
+#include "TRandom3.h"
+#include "TVector2.h"
+#include "TVector3.h"
+
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+//---------------------------------------------------------------------------
+// Heap allocation counter: replaces the global operator new/delete of the program, so that every allocation
+// made by the analyzer and library code (std containers, TObjects, ...) is counted:
+static atomic<unsigned long long> gNallocs( 0 );
+
+static void *CountedAlloc( size_t size ){
+  gNallocs.fetch_add( 1, memory_order_relaxed );
+  void *p = malloc( size > 0 ? size : 1 );
+  if( !p ) throw bad_alloc();
+  return p;
+}
+
+void *operator new( size_t size ){ return CountedAlloc( size ); }
+void *operator new[]( size_t size ){ return CountedAlloc( size ); }
+void *operator new( size_t size, const nothrow_t& ) noexcept {
+  gNallocs.fetch_add( 1, memory_order_relaxed );
+  return malloc( size > 0 ? size : 1 );
+}
+void *operator new[]( size_t size, const nothrow_t& ) noexcept {
+  gNallocs.fetch_add( 1, memory_order_relaxed );
+  return malloc( size > 0 ? size : 1 );
+}
+void operator delete( void *p ) noexcept { free( p ); }
+void operator delete[]( void *p ) noexcept { free( p ); }
+void operator delete( void *p, size_t ) noexcept { free( p ); }
+void operator delete[]( void *p, size_t ) noexcept { free( p ); }
+void operator delete( void *p, const nothrow_t& ) noexcept { free( p ); }
+void operator delete[]( void *p, const nothrow_t& ) noexcept { free( p ); }
+
+//---------------------------------------------------------------------------
+// Benchmark configuration (command-line options):
+struct GEMBenchConfig {
+  int nevents = 1000;               // events per occupancy point
+  vector<double> occupancies = { 0.0, 0.01, 0.02, 0.05, 0.1, 0.2 }; // nominal strip occupancies
+  int ntracks = 1;                  // signal tracks per event
+  bool correlated = true;           // background: correlated U/V (2D) hits or independent U and V clusters
+  double negfraction = 0.05;        // fraction of background clusters with negative polarity
+  double cmrms = 30.0;              // RMS of the common-mode shift of each APV card (ADC), full readout only
+  bool zerosuppress = false;        // emulate online CM subtraction and zero suppression instead of full readout
+  double ampMPV = 1500.0;           // most probable cluster amplitude (sum over strips of the peak sample, ADC)
+  double bkgdwindow = 100.0;        // background hit times are uniform within +/- this window around the signal (ns)
+  double clustersigma = -1.0;       // transverse charge spread (m); < 0 = use the module "sigmahitshape"
+  unsigned int seed = 12345;        // random seed (0 = unique seed)
+  int trackfinder = -1;             // override the database track finder method ( < 0 = use the database value)
+  bool generickernels = false;      // use the generic strip kernels instead of the ones specialized for 6 or 3 time samples
+  bool comparekernels = false;      // time both the specialized and the generic strip kernels on the same events
+  vector<int> cmflags;              // common-mode-only mode: GetCommonMode methods to time (empty = full decode/cluster/track chain)
+  string appname = "bb";            // apparatus name (database prefix)
+  string trackername = "gem";       // tracker name (database prefix)
+  string date;                      // date used for the database lookup (default = now)
+  string csvfile;                   // optional output file with the results
+};
+
+//---------------------------------------------------------------------------
+// One synthetic event: the VTP data of each crate/slot with GEM APV cards.
+// Like SBSSimDecoder, the benchmark decoder interprets its "event buffer" as a pointer to this structure.
+struct GEMBenchSlot {
+  UInt_t crate;
+  UInt_t slot;
+  vector<UInt_t> words;
+};
+
+struct GEMBenchEvent {
+  UInt_t evnum;
+  vector<GEMBenchSlot> slots;
+};
+
+// The strips of one APV card as encoded in the last event, for the common-mode-only mode:
+struct GEMBenchAPVFrame {
+  int module;
+  const mpdmap_t *apv;
+  vector<UInt_t> chan;     //APV channel of each strip
+  vector<Int_t> samples;   //ADC samples, chan.size() * number of time samples
+};
+
+//---------------------------------------------------------------------------
+// Decoder: fills the crate/slot structures from a GEMBenchEvent by calling LoadSlot of the modules defined
+// in the crate map (MPDModule for the GEM slots), exactly as the CODA decoder does with real data.
+class GEMBenchDecoder : public Podd::SimDecoder {
+public:
+  GEMBenchDecoder() = default;
+  virtual ~GEMBenchDecoder() = default;
+
+  virtual Int_t LoadEvent( const UInt_t* evbuffer );
+};
+
+Int_t GEMBenchDecoder::LoadEvent( const UInt_t* evbuffer ){
+  const GEMBenchEvent *event = reinterpret_cast<const GEMBenchEvent*>( evbuffer );
+
+  Int_t ret = HED_OK;
+  if( first_decode || fNeedInit ){
+    if( (ret = init_cmap()) != HED_OK )
+      return ret;
+    if( (ret = init_slotdata()) != HED_OK )
+      return ret;
+    first_decode = false;
+  }
+
+  Clear();
+  for( unsigned short i : fSlotClear )
+    crateslot[i]->clearEvent();
+
+  evscaler = 0;
+  event_length = 0;
+  event_type = 1;
+  event_num = event->evnum;
+
+  for( const auto &sw : event->slots ){
+    THaSlotData *sldat = crateslot[idx(sw.crate,sw.slot)].get();
+    if( !sldat || !sldat->GetModule() ){
+      cerr << "Error in [GEMBenchDecoder::LoadEvent]: no module defined in the crate map for crate, slot = "
+	   << sw.crate << ", " << sw.slot << endl;
+      return HED_ERR;
+    }
+    sldat->GetModule()->LoadSlot( sldat, sw.words.data(), 0, sw.words.size() );
+  }
+
+  return HED_OK;
+}
+
+//---------------------------------------------------------------------------
+// Tracker: gives the benchmark access to the modules and to the individual stages of the reconstruction
+class GEMBenchTracker : public SBSGEMSpectrometerTracker {
+public:
+  GEMBenchTracker( const char *name, const char *description )
+    : SBSGEMSpectrometerTracker( name, description ) {}
+  virtual ~GEMBenchTracker() = default;
+
+  const vector<SBSGEMModule*> &GetModules() const { return fModules; }
+  int GetNlayers() const { return fNlayers; }
+
+  void Configure( const GEMBenchConfig &config ){
+    //There are no other detectors to provide the constraint points:
+    fUseConstraint = false;
+    if( config.trackfinder >= 0 ) fTrackFinderMethod = config.trackfinder;
+    if( config.generickernels ){
+      for( auto mod : fModules ) mod->SetForceGenericKernels( true );
+    }
+  }
+  bool CanTrack() const { return !fPedestalMode && !fNonTrackingMode; }
+
+  void RunTracking(){ find_tracks(); }
+
+  TVector2 GetUV( int module, const TVector3 &origin, const TVector3 &direction ){
+    return GetUVTrack( module, origin, direction );
+  }
+};
+
+//---------------------------------------------------------------------------
+// Generator of the synthetic APV frames:
+class GEMBenchGenerator {
+public:
+  GEMBenchGenerator( GEMBenchTracker *tracker, const GEMBenchConfig &config );
+
+  bool IsOK() const { return fOK; }
+  UInt_t GetNAPVs() const { return fNAPVs; }
+
+  void Generate( UInt_t evnum, double occupancy, GEMBenchEvent &event );
+
+  //APV frames of the last event (only kept in the common-mode-only mode). The vector is reused from event to event,
+  //only the first GetNframes() entries are valid:
+  const vector<GEMBenchAPVFrame> &GetFrames() const { return fFrames; }
+  size_t GetNframes() const { return fNframes; }
+
+private:
+  struct APVref {
+    int module;
+    const mpdmap_t *apv;
+  };
+
+  //APV cards read out by one MPD (fiber) of a VTP:
+  struct FiberReadout {
+    UInt_t fiber;
+    vector<APVref> apvs;
+  };
+
+  struct SlotReadout {
+    UInt_t crate;
+    UInt_t slot;
+    vector<FiberReadout> fibers;
+  };
+
+  void AddCluster( int module, int axis, double pos, double amplitude, double t0 );
+  void AddHit2D( int module, double u, double v, double amplitude, double t0, bool allowneg );
+  void AddTracks();
+  void AddBackground( double occupancy );
+  void EncodeAPV( const APVref &ref, vector<UInt_t> &words );
+
+  double PulseShape( double t ) const { return t > 0.0 ? (t/fTau)*exp( 1.0 - t/fTau ) : 0.0; }
+  double RandomStripPos( int module, int axis );
+
+  GEMBenchTracker *fTracker;
+  GEMBenchConfig fConfig;
+  TRandom3 fRandom;
+  bool fOK;
+
+  vector<SBSGEMModule*> fModules;
+  vector<vector<int> > fModulesByLayer;
+  vector<vector<double> > fSignal[2]; //by axis and module: signal amplitude of each strip and sample (nstrips*nsamples)
+  vector<SlotReadout> fReadout;
+  UInt_t fNAPVs;
+
+  bool fCapture;
+  vector<GEMBenchAPVFrame> fFrames;
+  size_t fNframes;
+
+  UInt_t fNsamples;
+  double fTau;       //strip pulse shaping time (ns)
+  double fTsignal;   //start time of the signal pulses (ns)
+  vector<double> fSampleTime;
+};
+
+GEMBenchGenerator::GEMBenchGenerator( GEMBenchTracker *tracker, const GEMBenchConfig &config )
+  : fTracker(tracker), fConfig(config), fRandom(config.seed), fOK(false), fNAPVs(0),
+    fCapture(!config.cmflags.empty()), fNframes(0), fNsamples(Decoder::MPDModule::fgNsamplesPerStrip), fTau(56.0), fTsignal(0.0)
+{
+  fModules = tracker->GetModules();
+  if( fModules.empty() ){
+    cerr << "Error in [GEMBenchGenerator]: tracker has no modules" << endl;
+    return;
+  }
+
+  fModulesByLayer.resize( tracker->GetNlayers() );
+
+  //Group the APV cards by crate, slot and fiber, since each fiber is one MPD frame in the VTP data:
+  map<pair<UInt_t,UInt_t>, map<UInt_t, vector<APVref> > > apvs_by_slot;
+
+  for( int imod=0; imod<(int)fModules.size(); imod++ ){
+    SBSGEMModule *mod = fModules[imod];
+    if( mod->fN_MPD_TIME_SAMP != fNsamples ){
+      cerr << "Error in [GEMBenchGenerator]: module " << mod->GetName() << " has " << int(mod->fN_MPD_TIME_SAMP)
+	   << " time samples, the VTP frame format has " << fNsamples << endl;
+      return;
+    }
+    if( mod->fLayer < fModulesByLayer.size() ) fModulesByLayer[mod->fLayer].push_back( imod );
+
+    fSignal[SBSGEM::kUaxis].push_back( vector<double>( mod->fNstripsU*fNsamples, 0.0 ) );
+    fSignal[SBSGEM::kVaxis].push_back( vector<double>( mod->fNstripsV*fNsamples, 0.0 ) );
+
+    for( const auto &apv : mod->fMPDmap ){
+      apvs_by_slot[make_pair(apv.crate,apv.slot)][apv.mpd_id].push_back( { imod, &apv } );
+      fNAPVs++;
+    }
+  }
+
+  for( const auto &slotapvs : apvs_by_slot ){
+    SlotReadout sr{ slotapvs.first.first, slotapvs.first.second, {} };
+    for( const auto &fiberapvs : slotapvs.second ){
+      sr.fibers.push_back( { fiberapvs.first, fiberapvs.second } );
+    }
+    fReadout.push_back( sr );
+  }
+
+  //Signal timing from the first module: the pulses start one shaping time before the center of the strip timing cut
+  fTau = fModules[0]->fStripTau;
+  fTsignal = fModules[0]->fStripMaxTcut_central[SBSGEM::kUaxis] - fTau;
+  fSampleTime.resize( fNsamples );
+  for( UInt_t isamp=0; isamp<fNsamples; isamp++ ){
+    fSampleTime[isamp] = (isamp + 0.5)*fModules[0]->fSamplePeriod;
+  }
+
+  fOK = true;
+}
+
+double GEMBenchGenerator::RandomStripPos( int module, int axis ){
+  SBSGEMModule *mod = fModules[module];
+  UInt_t nstrips = (axis == SBSGEM::kUaxis) ? mod->fNstripsU : mod->fNstripsV;
+  double pitch = (axis == SBSGEM::kUaxis) ? mod->fUStripPitch : mod->fVStripPitch;
+  double offset = (axis == SBSGEM::kUaxis) ? mod->fUStripOffset : mod->fVStripOffset;
+
+  return offset + (fRandom.Rndm() - 0.5)*nstrips*pitch;
+}
+
+void GEMBenchGenerator::AddCluster( int module, int axis, double pos, double amplitude, double t0 ){
+  //Spread the charge of one cluster over the strips, with the strip position convention of SBSGEMModule:
+  //position of strip i = ( i + 0.5 - 0.5*nstrips ) * pitch + offset
+  SBSGEMModule *mod = fModules[module];
+  int nstrips = (axis == SBSGEM::kUaxis) ? mod->fNstripsU : mod->fNstripsV;
+  double pitch = (axis == SBSGEM::kUaxis) ? mod->fUStripPitch : mod->fVStripPitch;
+  double offset = (axis == SBSGEM::kUaxis) ? mod->fUStripOffset : mod->fVStripOffset;
+  double sigma = fConfig.clustersigma > 0.0 ? fConfig.clustersigma : mod->fSigma_hitshape;
+
+  double center = (pos - offset)/pitch + 0.5*nstrips - 0.5; //in units of strips
+  double sigmastrips = std::max( 0.1, sigma/pitch );
+
+  int nspread = int( ceil( 3.0*sigmastrips ) );
+  int first = std::max( 0, int( floor( center ) ) - nspread );
+  int last = std::min( nstrips-1, int( ceil( center ) ) + nspread );
+
+  double pulse[Decoder::MPDModule::fgNsamplesPerStrip];
+  for( UInt_t isamp=0; isamp<fNsamples; isamp++ ){
+    pulse[isamp] = PulseShape( fSampleTime[isamp] - t0 );
+  }
+
+  vector<double> &signal = fSignal[axis][module];
+  double norm = 1.0/(sqrt(2.0)*sigmastrips);
+  for( int istrip=first; istrip<=last; istrip++ ){
+    double frac = 0.5*( TMath::Erf( (istrip + 0.5 - center)*norm ) - TMath::Erf( (istrip - 0.5 - center)*norm ) );
+    for( UInt_t isamp=0; isamp<fNsamples; isamp++ ){
+      signal[istrip*fNsamples+isamp] += amplitude*frac*pulse[isamp];
+    }
+  }
+}
+
+void GEMBenchGenerator::AddHit2D( int module, double u, double v, double amplitude, double t0, bool allowneg ){
+  //U and V share the charge, up to a small asymmetry:
+  double asym = fRandom.Gaus( 0.0, 0.05 );
+  double signU = ( allowneg && fRandom.Rndm() < fConfig.negfraction ) ? -1.0 : 1.0;
+  double signV = ( allowneg && fRandom.Rndm() < fConfig.negfraction ) ? -1.0 : 1.0;
+  AddCluster( module, SBSGEM::kUaxis, u, signU*amplitude*(1.0+asym), t0 );
+  AddCluster( module, SBSGEM::kVaxis, v, signV*amplitude*(1.0-asym), t0 );
+}
+
+void GEMBenchGenerator::AddTracks(){
+  //Straight tracks joining a random point on a module of the first layer to a random point on a module of the last layer:
+  int firstlayer = -1, lastlayer = -1;
+  for( int layer=0; layer<(int)fModulesByLayer.size(); layer++ ){
+    if( fModulesByLayer[layer].empty() ) continue;
+    if( firstlayer < 0 ) firstlayer = layer;
+    lastlayer = layer;
+  }
+  if( firstlayer < 0 || firstlayer == lastlayer ) return;
+
+  for( int itrack=0; itrack<fConfig.ntracks; itrack++ ){
+    TVector3 endpoints[2];
+    int layers[2] = { firstlayer, lastlayer };
+    for( int iend=0; iend<2; iend++ ){
+      const vector<int> &mods = fModulesByLayer[layers[iend]];
+      int imod = mods[ fRandom.Integer( mods.size() ) ];
+      SBSGEMModule *mod = fModules[imod];
+      TVector2 XY = mod->UVtoXY( TVector2( RandomStripPos( imod, SBSGEM::kUaxis ), RandomStripPos( imod, SBSGEM::kVaxis ) ) );
+      endpoints[iend] = mod->DetToTrackCoord( XY.X(), XY.Y() );
+    }
+
+    TVector3 direction = endpoints[1] - endpoints[0];
+    double amplitude = std::min( 8.0*fConfig.ampMPV, fRandom.Landau( fConfig.ampMPV, 0.15*fConfig.ampMPV ) );
+
+    for( int imod=0; imod<(int)fModules.size(); imod++ ){
+      SBSGEMModule *mod = fModules[imod];
+      TVector2 UV = fTracker->GetUV( imod, endpoints[0], direction );
+
+      //only modules where the track crosses the strips of both axes get a hit:
+      if( fabs( UV.X() - mod->fUStripOffset ) > 0.5*mod->fNstripsU*mod->fUStripPitch ||
+	  fabs( UV.Y() - mod->fVStripOffset ) > 0.5*mod->fNstripsV*mod->fVStripPitch ) continue;
+
+      AddHit2D( imod, UV.X(), UV.Y(), amplitude*fRandom.Gaus( 1.0, 0.1 ), fTsignal + fRandom.Gaus( 0.0, 5.0 ), false );
+    }
+  }
+}
+
+void GEMBenchGenerator::AddBackground( double occupancy ){
+  if( occupancy <= 0.0 ) return;
+
+  for( int imod=0; imod<(int)fModules.size(); imod++ ){
+    SBSGEMModule *mod = fModules[imod];
+    double sigma = fConfig.clustersigma > 0.0 ? fConfig.clustersigma : mod->fSigma_hitshape;
+
+    //nominal number of strips fired by one cluster (strips within +/- 2 sigma):
+    double stripsperclust[2] = { 1.0 + 2.0*ceil( 2.0*sigma/mod->fUStripPitch ),
+				 1.0 + 2.0*ceil( 2.0*sigma/mod->fVStripPitch ) };
+    double nclust[2] = { occupancy*mod->fNstripsU/stripsperclust[0],
+			 occupancy*mod->fNstripsV/stripsperclust[1] };
+
+    if( fConfig.correlated ){
+      int nhits = fRandom.Poisson( 0.5*( nclust[0] + nclust[1] ) );
+      for( int ihit=0; ihit<nhits; ihit++ ){
+	double amplitude = std::min( 8.0*fConfig.ampMPV, fRandom.Landau( fConfig.ampMPV, 0.15*fConfig.ampMPV ) );
+	double t0 = fTsignal + fRandom.Uniform( -fConfig.bkgdwindow, fConfig.bkgdwindow );
+	AddHit2D( imod, RandomStripPos( imod, SBSGEM::kUaxis ), RandomStripPos( imod, SBSGEM::kVaxis ), amplitude, t0, true );
+      }
+    } else {
+      for( int axis=0; axis<2; axis++ ){
+	int nhits = fRandom.Poisson( nclust[axis] );
+	for( int ihit=0; ihit<nhits; ihit++ ){
+	  double amplitude = std::min( 8.0*fConfig.ampMPV, fRandom.Landau( fConfig.ampMPV, 0.15*fConfig.ampMPV ) );
+	  if( fRandom.Rndm() < fConfig.negfraction ) amplitude = -amplitude;
+	  double t0 = fTsignal + fRandom.Uniform( -fConfig.bkgdwindow, fConfig.bkgdwindow );
+	  AddCluster( imod, axis, RandomStripPos( imod, axis ), amplitude, t0 );
+	}
+      }
+    }
+  }
+}
+
+void GEMBenchGenerator::EncodeAPV( const APVref &ref, vector<UInt_t> &words ){
+  // Encode the strips of one APV card in the VTP format decoded by MPDModule::LoadSlot: three words per strip, each
+  // containing two 13-bit signed ADC samples (bits 0-12 and 13-25). APV channel bits 4:0 go in bits 30-26 of the
+  // first word, APV channel bits 6:5 in bits 27-26 of the second word, and the APV ID (adc_id) in bits 30-26 of the third:
+  SBSGEMModule *mod = fModules[ref.module];
+  const mpdmap_t &apv = *ref.apv;
+
+  bool isU = apv.axis == SBSGEM::kUaxis;
+  UInt_t nstrips = isU ? mod->fNstripsU : mod->fNstripsV;
+  const vector<double> &signal = fSignal[isU ? SBSGEM::kUaxis : SBSGEM::kVaxis][ref.module];
+  const vector<double> &pedestal = isU ? mod->fPedestalU : mod->fPedestalV;
+  const vector<double> &pedrms = isU ? mod->fPedRMSU : mod->fPedRMSV;
+
+  //common-mode shift of this APV card in this event, by time sample (full readout only):
+  double cm[Decoder::MPDModule::fgNsamplesPerStrip];
+  double cmshift = fConfig.zerosuppress ? 0.0 : fRandom.Gaus( 0.0, fConfig.cmrms );
+  for( UInt_t isamp=0; isamp<fNsamples; isamp++ ){
+    cm[isamp] = fConfig.zerosuppress ? 0.0 : cmshift + fRandom.Gaus( 0.0, 0.1*fConfig.cmrms );
+  }
+
+  Int_t samples[Decoder::MPDModule::fgNsamplesPerStrip];
+
+  GEMBenchAPVFrame *frame = nullptr;
+  if( fCapture ){
+    if( fNframes == fFrames.size() ) fFrames.emplace_back();
+    frame = &fFrames[fNframes++];
+    frame->module = ref.module;
+    frame->apv = &apv;
+    frame->chan.clear();
+    frame->samples.clear();
+  }
+
+  for( UInt_t ich=0; ich<mod->fN_APV25_CHAN; ich++ ){
+    Int_t strip = mod->GetStripNumber( ich, apv.pos, apv.invert );
+    if( strip < 0 || strip >= (Int_t) nstrips ) continue;
+
+    //full readout frames are not pedestal-subtracted unless the pedestals are subtracted online:
+    double ped = ( fConfig.zerosuppress || mod->fPedSubFlag != 0 ) ? 0.0 : pedestal[strip];
+    double rms = pedrms[strip];
+
+    double sum = 0.0;
+    for( UInt_t isamp=0; isamp<fNsamples; isamp++ ){
+      double adc = ped + cm[isamp] + fRandom.Gaus( 0.0, rms ) + signal[strip*fNsamples+isamp];
+      samples[isamp] = std::max( -4096, std::min( 4095, int( TMath::Nint( adc ) ) ) );
+      sum += samples[isamp];
+    }
+
+    //online zero suppression on the average of the time samples:
+    if( fConfig.zerosuppress && sum/fNsamples <= mod->fZeroSuppressRMS*rms ) continue;
+
+    if( frame ){
+      frame->chan.push_back( ich );
+      frame->samples.insert( frame->samples.end(), samples, samples + fNsamples );
+    }
+
+    for( int iw=0; iw<3; iw++ ){
+      UInt_t word = ( UInt_t( samples[2*iw] ) & 0x1FFF ) | ( ( UInt_t( samples[2*iw+1] ) & 0x1FFF ) << 13 );
+      if( iw == 0 ) word |= ( ich & 0x1F ) << 26;
+      if( iw == 1 ) word |= ( (ich >> 5) & 0x3 ) << 26;
+      if( iw == 2 ) word |= ( apv.adc_id & 0x1F ) << 26;
+      words.push_back( word );
+    }
+  }
+}
+
+void GEMBenchGenerator::Generate( UInt_t evnum, double occupancy, GEMBenchEvent &event ){
+  for( int axis=0; axis<2; axis++ ){
+    for( auto &signal : fSignal[axis] ) signal.assign( signal.size(), 0.0 );
+  }
+
+  AddTracks();
+  AddBackground( occupancy );
+
+  event.evnum = evnum;
+  event.slots.resize( fReadout.size() );
+  fNframes = 0;
+
+  for( size_t islot=0; islot<fReadout.size(); islot++ ){
+    const SlotReadout &sr = fReadout[islot];
+    GEMBenchSlot &sw = event.slots[islot];
+    sw.crate = sr.crate;
+    sw.slot = sr.slot;
+    sw.words.clear();
+
+    for( const auto &fr : sr.fibers ){
+      //MPD frame header (type 5): ENABLE_CM in bit 26, BUILD_ALL_SAMPLES in bit 25, fiber in bits 21-16, MPD ID in bits 4-0:
+      UInt_t enable_cm = fConfig.zerosuppress ? 1 : 0;
+      UInt_t build_all = fConfig.zerosuppress ? 0 : 1;
+      sw.words.push_back( 0x80000000 | (5 << 27) | (enable_cm << 26) | (build_all << 25) |
+			  ( (fr.fiber & 0x3F) << 16 ) | ( fr.fiber & 0x1F ) );
+      for( const auto &ref : fr.apvs ) EncodeAPV( ref, sw.words );
+    }
+  }
+}
+
+//---------------------------------------------------------------------------
+// Results of one occupancy point:
+struct GEMBenchResult {
+  double occupancy;
+  double occU;       //measured fraction of U strips fired (after CM subtraction and zero suppression)
+  double occV;       //measured fraction of V strips fired
+  double rate;       //events/s (decoding + clustering + tracking)
+  double tdecode;    //ms/event
+  double tcluster;   //ms/event
+  double ttrack;     //ms/event
+  double ncombos;    //mean number of hit combinations tested
+  double skipped;    //fraction of events for which tracking was skipped
+  double ntracks;    //mean number of tracks found
+  double nallocs;    //mean number of heap allocations per event (decoding + clustering + tracking)
+  ULong64_t narena;  //blocks allocated by the cluster arenas of all modules during this occupancy point
+};
+
+//---------------------------------------------------------------------------
+// Common-mode-only mode:
+
+// Fill the per-APV arrays of the module from a captured frame, as SBSGEMModule::Decode does for a full readout frame
+// (no online common-mode subtraction). Returns false if not all the channels of the APV card are in the frame, in which
+// case Decode doesn't calculate the common-mode either:
+static bool LoadAPVFrame( SBSGEMModule *mod, const GEMBenchAPVFrame &frame ){
+  if( frame.chan.size() != mod->fN_APV25_CHAN ) return false;
+
+  const mpdmap_t &apv = *frame.apv;
+  UInt_t nsamp = mod->fN_MPD_TIME_SAMP;
+  const vector<double> &pedestal = ( apv.axis == SBSGEM::kUaxis ) ? mod->fPedestalU : mod->fPedestalV;
+
+  for( size_t ihit=0; ihit<frame.chan.size(); ihit++ ){
+    UInt_t strip = mod->GetStripNumber( frame.chan[ihit], apv.pos, apv.invert );
+    double ped = pedestal[strip];
+
+    for( UInt_t isamp=0; isamp<nsamp; isamp++ ){
+      UInt_t iraw = isamp + nsamp*ihit;
+      Int_t ADC = frame.samples[iraw];
+
+      mod->fStripAPV[iraw] = strip;
+      mod->fRawStripAPV[iraw] = frame.chan[ihit];
+      mod->fRawADC_APV[iraw] = ADC;
+      //with online pedestal subtraction, the pedestal is added back to the "nopedsub" value and not subtracted again:
+      mod->fRawADC_nopedsub_APV[iraw] = mod->fPedSubFlag != 0 ? Int_t( ADC + ped ) : ADC;
+      mod->fPedSubADC_APV[iraw] = double(ADC) - ( mod->fPedSubFlag != 0 ? 0.0 : ped );
+    }
+  }
+  return true;
+}
+
+// Results of one occupancy point and common-mode method:
+struct GEMBenchCMResult {
+  double occupancy;
+  int flag;          //GetCommonMode method
+  double tcall;      //ns per call (one APV card, one time sample)
+  double ncalls;     //mean number of calls per event
+  double cmsum;      //sum of all the common-mode values (to compare builds)
+};
+
+static int RunCommonModeBenchmark( const GEMBenchConfig &config, GEMBenchGenerator &generator,
+				   const vector<SBSGEMModule*> &modules ){
+  typedef chrono::steady_clock clock_type;
+
+  GEMBenchEvent event;
+  UInt_t evnum = 0;
+  size_t nflags = config.cmflags.size();
+
+  //Warm-up, not timed:
+  for( int iev=0; iev<10; iev++ ){
+    generator.Generate( ++evnum, config.occupancies[0], event );
+    for( size_t iframe=0; iframe<generator.GetNframes(); iframe++ ){
+      const GEMBenchAPVFrame &frame = generator.GetFrames()[iframe];
+      SBSGEMModule *mod = modules[frame.module];
+      if( !LoadAPVFrame( mod, frame ) ) continue;
+      for( int flag : config.cmflags ){
+	for( UInt_t isamp=0; isamp<mod->fN_MPD_TIME_SAMP; isamp++ ) mod->GetCommonMode( isamp, flag, *frame.apv );
+      }
+    }
+  }
+
+  vector<GEMBenchCMResult> results;
+
+  for( double occupancy : config.occupancies ){
+    vector<double> tcm( nflags, 0.0 ), cmsum( nflags, 0.0 );
+    unsigned long long ncalls = 0;
+
+    for( int iev=0; iev<config.nevents; iev++ ){
+      generator.Generate( ++evnum, occupancy, event );
+
+      for( size_t iframe=0; iframe<generator.GetNframes(); iframe++ ){
+	const GEMBenchAPVFrame &frame = generator.GetFrames()[iframe];
+	SBSGEMModule *mod = modules[frame.module];
+	if( !LoadAPVFrame( mod, frame ) ) continue;
+
+	UInt_t nsamp = mod->fN_MPD_TIME_SAMP;
+	ncalls += nsamp;
+
+	//Each method sees the same block, as when Decode calculates several of them for the diagnostic histograms:
+	for( size_t iflag=0; iflag<nflags; iflag++ ){
+	  double sum = 0.0;
+	  clock_type::time_point t0 = clock_type::now();
+	  for( UInt_t isamp=0; isamp<nsamp; isamp++ ){
+	    sum += mod->GetCommonMode( isamp, config.cmflags[iflag], *frame.apv );
+	  }
+	  clock_type::time_point t1 = clock_type::now();
+	  tcm[iflag] += chrono::duration<double>( t1 - t0 ).count();
+	  cmsum[iflag] += sum;
+	}
+      }
+    }
+
+    for( size_t iflag=0; iflag<nflags; iflag++ ){
+      GEMBenchCMResult res;
+      res.occupancy = occupancy;
+      res.flag = config.cmflags[iflag];
+      res.tcall = ncalls > 0 ? 1.e9*tcm[iflag]/ncalls : 0.0;
+      res.ncalls = double(ncalls)/config.nevents;
+      res.cmsum = cmsum[iflag];
+      results.push_back( res );
+    }
+
+    cerr << "occupancy " << occupancy << " done" << endl;
+  }
+
+  printf( "\n%10s %6s %12s %12s %24s\n", "occupancy", "method", "ns/call", "calls/evt", "sum of CM values" );
+  for( const auto &res : results ){
+    printf( "%10.4f %6d %12.1f %12.1f %24.17g\n", res.occupancy, res.flag, res.tcall, res.ncalls, res.cmsum );
+  }
+
+  if( !config.csvfile.empty() ){
+    ofstream csv( config.csvfile.c_str() );
+    csv << "occupancy,method,ns_per_call,calls_per_event,cm_sum" << endl;
+    csv.precision( 17 );
+    for( const auto &res : results ){
+      csv << res.occupancy << "," << res.flag << "," << res.tcall << "," << res.ncalls << "," << res.cmsum << endl;
+    }
+  }
+
+  return 0;
+}
+
+//---------------------------------------------------------------------------
+// Kernel comparison mode: every event is processed twice, once with the strip kernels specialized for 6 or 3 time
+// samples and once with the generic ones (alternating which goes first), so that both timings come from the same
+// events, and the results of the two passes are checked for identity.
+
+// Results of one pass, for the comparison of the two passes of an event:
+struct GEMBenchPassResult {
+  UInt_t nstrips;
+  UInt_t nclust;
+  UInt_t nhits2D;
+  vector<double> tracks; //x, y, x', y' of each track
+};
+
+static void RunBenchPass( GEMBenchTracker *tracker, GEMBenchDecoder &evdata, const GEMBenchEvent &event,
+			  bool generic, double *t, GEMBenchPassResult &pass ){
+  typedef chrono::steady_clock clock_type;
+
+  const vector<SBSGEMModule*> &modules = tracker->GetModules();
+  for( auto mod : modules ) mod->SetForceGenericKernels( generic );
+
+  clock_type::time_point t0 = clock_type::now();
+
+  evdata.LoadEvent( reinterpret_cast<const UInt_t*>( &event ) );
+  tracker->Clear();
+  tracker->Decode( evdata );
+
+  clock_type::time_point t1 = clock_type::now();
+
+  tracker->hit_reconstruction();
+
+  clock_type::time_point t2 = clock_type::now();
+
+  if( tracker->CanTrack() ) tracker->RunTracking();
+
+  clock_type::time_point t3 = clock_type::now();
+
+  t[0] += chrono::duration<double>( t1 - t0 ).count();
+  t[1] += chrono::duration<double>( t2 - t1 ).count();
+  t[2] += chrono::duration<double>( t3 - t2 ).count();
+
+  pass.nstrips = pass.nclust = pass.nhits2D = 0;
+  for( auto mod : modules ){
+    pass.nstrips += mod->fNstrips_hit;
+    pass.nclust += mod->fNclustU + mod->fNclustV;
+    pass.nhits2D += mod->fN2Dhits;
+  }
+  pass.tracks.clear();
+  if( tracker->CanTrack() ){
+    for( int itrack=0; itrack<tracker->GetNtracks(); itrack++ ){
+      double x, y, xp, yp;
+      tracker->GetTrack( itrack, x, y, xp, yp );
+      pass.tracks.insert( pass.tracks.end(), { x, y, xp, yp } );
+    }
+  }
+}
+
+static int RunKernelComparison( const GEMBenchConfig &config, GEMBenchGenerator &generator,
+				GEMBenchTracker *tracker, GEMBenchDecoder &evdata ){
+  GEMBenchEvent event;
+  UInt_t evnum = 0;
+  GEMBenchPassResult pass[2];
+  double tdummy[3] = { 0.0, 0.0, 0.0 };
+
+  //Warm-up, not timed:
+  for( int iev=0; iev<10; iev++ ){
+    generator.Generate( ++evnum, config.occupancies[0], event );
+    RunBenchPass( tracker, evdata, event, false, tdummy, pass[0] );
+    RunBenchPass( tracker, evdata, event, true, tdummy, pass[1] );
+  }
+
+  struct KernelResult {
+    double occupancy;
+    double rate[2];    //events/s, [specialized/generic]
+    double t[2][3];    //ms/event, [specialized/generic][decode/cluster/track]
+    int nmismatch;     //events for which the two passes gave different results
+  };
+  vector<KernelResult> results;
+  int nmismatch_total = 0;
+
+  for( double occupancy : config.occupancies ){
+    double t[2][3] = { { 0.0, 0.0, 0.0 }, { 0.0, 0.0, 0.0 } };
+    int nmismatch = 0;
+
+    for( int iev=0; iev<config.nevents; iev++ ){
+      generator.Generate( ++evnum, occupancy, event );
+
+      for( int ipass=0; ipass<2; ipass++ ){
+	int generic = ( ipass + iev )%2;
+	RunBenchPass( tracker, evdata, event, generic != 0, t[generic], pass[generic] );
+      }
+
+      if( pass[0].nstrips != pass[1].nstrips || pass[0].nclust != pass[1].nclust ||
+	  pass[0].nhits2D != pass[1].nhits2D || pass[0].tracks != pass[1].tracks ) nmismatch++;
+    }
+
+    double nev = config.nevents;
+
+    KernelResult res;
+    res.occupancy = occupancy;
+    for( int ik=0; ik<2; ik++ ){
+      double ttotal = t[ik][0] + t[ik][1] + t[ik][2];
+      res.rate[ik] = ttotal > 0.0 ? nev/ttotal : 0.0;
+      for( int istage=0; istage<3; istage++ ) res.t[ik][istage] = 1000.0*t[ik][istage]/nev;
+    }
+    res.nmismatch = nmismatch;
+    results.push_back( res );
+    nmismatch_total += nmismatch;
+
+    cerr << "occupancy " << occupancy << " done: " << res.rate[0] << " (specialized), "
+	 << res.rate[1] << " (generic) events/s" << endl;
+  }
+
+  printf( "\n%10s %10s %10s %8s %10s %10s %10s %10s %10s %10s %9s\n", "occupancy", "spec_ev/s", "gen_ev/s", "speedup",
+	  "spec_dec", "gen_dec", "spec_cl", "gen_cl", "spec_trk", "gen_trk", "mismatch" );
+  for( const auto &res : results ){
+    printf( "%10.4f %10.1f %10.1f %8.3f %10.3f %10.3f %10.3f %10.3f %10.3f %10.3f %9d\n", res.occupancy,
+	    res.rate[0], res.rate[1], res.rate[1] > 0.0 ? res.rate[0]/res.rate[1] : 0.0,
+	    res.t[0][0], res.t[1][0], res.t[0][1], res.t[1][1], res.t[0][2], res.t[1][2], res.nmismatch );
+  }
+
+  if( !config.csvfile.empty() ){
+    ofstream csv( config.csvfile.c_str() );
+    csv << "occupancy,specialized_events_per_s,generic_events_per_s,specialized_decode_ms,generic_decode_ms,"
+	<< "specialized_cluster_ms,generic_cluster_ms,specialized_track_ms,generic_track_ms,mismatched_events" << endl;
+    for( const auto &res : results ){
+      csv << res.occupancy << "," << res.rate[0] << "," << res.rate[1] << ","
+	  << res.t[0][0] << "," << res.t[1][0] << "," << res.t[0][1] << "," << res.t[1][1] << ","
+	  << res.t[0][2] << "," << res.t[1][2] << "," << res.nmismatch << endl;
+    }
+  }
+
+  if( nmismatch_total > 0 ){
+    cerr << "Error: the specialized and generic strip kernels gave different results for "
+	 << nmismatch_total << " events" << endl;
+  }
+
+  //Leave the modules as configured:
+  for( auto mod : tracker->GetModules() ) mod->SetForceGenericKernels( config.generickernels );
+
+  return nmismatch_total > 0 ? 3 : 0;
+}
+
+static void Usage( const char *prog, const GEMBenchConfig &def ){
+  cout << "Usage: " << prog << " [options]" << endl
+       << "  -n nevents       events per occupancy point (default " << def.nevents << ")" << endl
+       << "  -o occ1,occ2,... nominal background strip occupancies (default 0,0.01,0.02,0.05,0.1,0.2)" << endl
+       << "  -t ntracks       signal tracks per event (default " << def.ntracks << ")" << endl
+       << "  -b mode          background: \"correlated\" (U/V hit pairs, default) or \"uniform\" (independent U and V clusters)" << endl
+       << "  -N fraction      fraction of background clusters with negative polarity (default " << def.negfraction << ")" << endl
+       << "  -c rms           common-mode shift RMS per APV card, ADC (default " << def.cmrms << ")" << endl
+       << "  -z               emulate online common-mode subtraction and zero suppression (default: full readout)" << endl
+       << "  -A mpv           most probable cluster amplitude, ADC (default " << def.ampMPV << ")" << endl
+       << "  -w window        background time window, +/- ns around the signal (default " << def.bkgdwindow << ")" << endl
+       << "  -S sigma         transverse charge spread, m (default: module sigmahitshape)" << endl
+       << "  -s seed          random seed, 0 = unique (default " << def.seed << ")" << endl
+       << "  -m method        track finder: 0 = combinatorial, 1 = cellular automaton (default: database)" << endl
+       << "  -G               use the generic strip kernels instead of the ones specialized for 6 or 3 time samples" << endl
+       << "  -K               compare the specialized and generic strip kernels: time both on the same events, check the results agree" << endl
+       << "  -C flag1,flag2,.. only time SBSGEMModule::GetCommonMode with these methods on the full readout frames" << endl
+       << "  -a name          apparatus name (default \"" << def.appname << "\")" << endl
+       << "  -g name          tracker name (default \"" << def.trackername << "\")" << endl
+       << "  -d \"date\"        date for the database lookup, \"YYYY-MM-DD hh:mm:ss\" (default: now)" << endl
+       << "  -f file          also write the results to file (comma-separated values)" << endl
+       << "  -h               print this message" << endl;
+}
+
+int main( int argc, char **argv ){
+
+  GEMBenchConfig config;
+  const GEMBenchConfig defaults;
+
+  int opt;
+  while( (opt = getopt( argc, argv, "n:o:t:b:N:c:zA:w:S:s:m:GKC:a:g:d:f:h" )) != -1 ){
+    switch( opt ){
+    case 'n': config.nevents = atoi( optarg ); break;
+    case 'o': {
+      config.occupancies.clear();
+      stringstream ss( optarg );
+      string item;
+      while( getline( ss, item, ',' ) ){
+	if( !item.empty() ) config.occupancies.push_back( atof( item.c_str() ) );
+      }
+      break;
+    }
+    case 't': config.ntracks = atoi( optarg ); break;
+    case 'b':
+      if( string( optarg ) == "uniform" ) config.correlated = false;
+      else if( string( optarg ) == "correlated" ) config.correlated = true;
+      else { Usage( argv[0], defaults ); return 1; }
+      break;
+    case 'N': config.negfraction = atof( optarg ); break;
+    case 'c': config.cmrms = atof( optarg ); break;
+    case 'z': config.zerosuppress = true; break;
+    case 'A': config.ampMPV = atof( optarg ); break;
+    case 'w': config.bkgdwindow = atof( optarg ); break;
+    case 'S': config.clustersigma = atof( optarg ); break;
+    case 's': config.seed = strtoul( optarg, nullptr, 10 ); break;
+    case 'm': config.trackfinder = atoi( optarg ); break;
+    case 'G': config.generickernels = true; break;
+    case 'K': config.comparekernels = true; break;
+    case 'C': {
+      config.cmflags.clear();
+      stringstream ss( optarg );
+      string item;
+      while( getline( ss, item, ',' ) ){
+	if( !item.empty() ) config.cmflags.push_back( atoi( item.c_str() ) );
+      }
+      break;
+    }
+    case 'a': config.appname = optarg; break;
+    case 'g': config.trackername = optarg; break;
+    case 'd': config.date = optarg; break;
+    case 'f': config.csvfile = optarg; break;
+    case 'h': Usage( argv[0], defaults ); return 0;
+    default: Usage( argv[0], defaults ); return 1;
+    }
+  }
+
+  if( config.nevents <= 0 || config.occupancies.empty() ){
+    Usage( argv[0], defaults );
+    return 1;
+  }
+
+  if( !config.cmflags.empty() && config.zerosuppress ){
+    cerr << "Error: the common-mode-only mode (-C) needs full readout frames, it cannot be combined with -z" << endl;
+    return 1;
+  }
+
+  if( config.comparekernels && ( !config.cmflags.empty() || config.generickernels ) ){
+    cerr << "Error: the kernel comparison mode (-K) cannot be combined with -C or -G" << endl;
+    return 1;
+  }
+
+  //Global lists normally created by the analyzer's interactive interface:
+  gHaVars = new THaVarList;
+  gHaCuts = new THaCutList( gHaVars );
+  gHaApps = new TList;
+
+  TDatime date;
+  if( !config.date.empty() ) date.Set( config.date.c_str() );
+
+  SBSBigBite *app = new SBSBigBite( config.appname.c_str(), "GEM benchmark apparatus" );
+  GEMBenchTracker *tracker = new GEMBenchTracker( config.trackername.c_str(), "GEM tracker" );
+  app->AddDetector( tracker );
+  gHaApps->Add( app );
+
+  if( app->Init( date ) != THaAnalysisObject::kOK || !tracker->IsOK() ){
+    cerr << "Error: initialization of " << config.appname << "." << config.trackername << " failed. Is DB_DIR set?" << endl;
+    return 2;
+  }
+
+  tracker->Configure( config );
+
+  if( !tracker->CanTrack() ){
+    cerr << "Warning: " << config.appname << "." << config.trackername
+	 << " is in pedestal or non-tracking mode, only decoding and clustering are benchmarked" << endl;
+  }
+
+  GEMBenchGenerator generator( tracker, config );
+  if( !generator.IsOK() ) return 2;
+
+  GEMBenchDecoder evdata;
+  evdata.SetRunTime( date.Convert() );
+  evdata.Init();
+
+  const vector<SBSGEMModule*> &modules = tracker->GetModules();
+
+  UInt_t nstripsU = 0, nstripsV = 0;
+  for( auto mod : modules ){
+    nstripsU += mod->fNstripsU;
+    nstripsV += mod->fNstripsV;
+  }
+
+  cout << "GEM benchmark: " << modules.size() << " modules, " << tracker->GetNlayers() << " layers, "
+       << generator.GetNAPVs() << " APV cards, " << (config.zerosuppress ? "zero-suppressed" : "full readout") << " frames, "
+       << (config.correlated ? "correlated" : "uniform") << " background, " << config.ntracks << " signal track(s)/event, "
+       << config.nevents << " events/point" << (config.generickernels ? ", generic strip kernels" : "") << endl;
+
+  if( !config.cmflags.empty() ) return RunCommonModeBenchmark( config, generator, modules );
+
+  if( config.comparekernels ) return RunKernelComparison( config, generator, tracker, evdata );
+
+  typedef chrono::steady_clock clock_type;
+
+  GEMBenchEvent event;
+  UInt_t evnum = 0;
+
+  //Warm-up (crate map and slot initialization, first allocation of the work arrays) is not timed:
+  for( int iev=0; iev<10; iev++ ){
+    generator.Generate( ++evnum, config.occupancies[0], event );
+    evdata.LoadEvent( reinterpret_cast<const UInt_t*>( &event ) );
+    tracker->Clear();
+    tracker->Decode( evdata );
+    tracker->hit_reconstruction();
+    if( tracker->CanTrack() ) tracker->RunTracking();
+  }
+
+  vector<GEMBenchResult> results;
+
+  for( double occupancy : config.occupancies ){
+    double tdecode = 0.0, tcluster = 0.0, ttrack = 0.0;
+    double sumoccU = 0.0, sumoccV = 0.0, sumcombos = 0.0, sumtracks = 0.0;
+    int nskipped = 0;
+    unsigned long long nallocs = 0;
+
+    ULong64_t narena0 = 0;
+    for( auto mod : modules ) narena0 += mod->GetNclusterArenaAllocs();
+
+    for( int iev=0; iev<config.nevents; iev++ ){
+      generator.Generate( ++evnum, occupancy, event );
+
+      unsigned long long nalloc0 = gNallocs.load( memory_order_relaxed );
+      clock_type::time_point t0 = clock_type::now();
+
+      evdata.LoadEvent( reinterpret_cast<const UInt_t*>( &event ) );
+      tracker->Clear();
+      tracker->Decode( evdata );
+
+      clock_type::time_point t1 = clock_type::now();
+
+      tracker->hit_reconstruction();
+
+      clock_type::time_point t2 = clock_type::now();
+
+      if( tracker->CanTrack() ) tracker->RunTracking();
+
+      clock_type::time_point t3 = clock_type::now();
+      nallocs += gNallocs.load( memory_order_relaxed ) - nalloc0;
+
+      tdecode += chrono::duration<double>( t1 - t0 ).count();
+      tcluster += chrono::duration<double>( t2 - t1 ).count();
+      ttrack += chrono::duration<double>( t3 - t2 ).count();
+
+      UInt_t nhitU = 0, nhitV = 0;
+      for( auto mod : modules ){
+	nhitU += mod->fNstrips_hitU;
+	nhitV += mod->fNstrips_hitV;
+      }
+      sumoccU += nstripsU > 0 ? double(nhitU)/nstripsU : 0.0;
+      sumoccV += nstripsV > 0 ? double(nhitV)/nstripsV : 0.0;
+
+      sumcombos += tracker->GetNcombosTested();
+      sumtracks += tracker->GetNtracks();
+      if( tracker->TrackingSkipped() ) nskipped++;
+    }
+
+    ULong64_t narena = 0;
+    for( auto mod : modules ) narena += mod->GetNclusterArenaAllocs();
+
+    double nev = config.nevents;
+    double ttotal = tdecode + tcluster + ttrack;
+
+    GEMBenchResult res;
+    res.occupancy = occupancy;
+    res.occU = sumoccU/nev;
+    res.occV = sumoccV/nev;
+    res.rate = ttotal > 0.0 ? nev/ttotal : 0.0;
+    res.tdecode = 1000.0*tdecode/nev;
+    res.tcluster = 1000.0*tcluster/nev;
+    res.ttrack = 1000.0*ttrack/nev;
+    res.ncombos = sumcombos/nev;
+    res.skipped = nskipped/nev;
+    res.ntracks = sumtracks/nev;
+    res.nallocs = nallocs/nev;
+    res.narena = narena - narena0;
+    results.push_back( res );
+
+    cerr << "occupancy " << occupancy << " done: " << res.rate << " events/s" << endl;
+  }
+
+  printf( "\n%10s %8s %8s %10s %10s %10s %10s %12s %8s %8s %10s %8s\n", "occupancy", "occU", "occV", "events/s",
+	  "decode_ms", "clust_ms", "track_ms", "ncombos", "skipped", "ntracks", "allocs/evt", "arena" );
+  for( const auto &res : results ){
+    printf( "%10.4f %8.4f %8.4f %10.1f %10.3f %10.3f %10.3f %12.1f %8.4f %8.3f %10.1f %8llu\n", res.occupancy, res.occU, res.occV, res.rate,
+	    res.tdecode, res.tcluster, res.ttrack, res.ncombos, res.skipped, res.ntracks, res.nallocs,
+	    (unsigned long long) res.narena );
+  }
+
+  if( !config.csvfile.empty() ){
+    ofstream csv( config.csvfile.c_str() );
+    csv << "occupancy,occU,occV,events_per_s,decode_ms,cluster_ms,track_ms,ncombos,skipped_fraction,ntracks,allocs_per_event,arena_blocks" << endl;
+    for( const auto &res : results ){
+      csv << res.occupancy << "," << res.occU << "," << res.occV << "," << res.rate << ","
+	  << res.tdecode << "," << res.tcluster << "," << res.ttrack << ","
+	  << res.ncombos << "," << res.skipped << "," << res.ntracks << ","
+	  << res.nallocs << "," << res.narena << endl;
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,209 @@
+//////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// sbsmergejobs: merge the output files of an event-partitioned replay (see SBSAnalyzer.h)
+//
+// Each job of the replay writes the physics events of its own batches to the event tree, in increasing
+// event number order. The event trees of all jobs are merged into one tree in event number order (k-way
+// merge on the event number), so that the merged file looks like the output of a serial replay.
+//
+// The other objects are treated as follows:
+//    - histograms (anything inheriting from TH1) are summed over the jobs. Histograms filled for every event
+//      type, rather than for the analyzed physics events only, are counted once per job.
+//    - all other trees (scalers, EPICS, ...) and objects (run data, cut summaries, ...) are taken from the
+//      first job: every job processes all non-physics events, so they are identical in all files.
+//
+// Usage: sbsmergejobs [-t tree] [-e event number] -o merged.root job0.root job1.root ...
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "TFile.h"
+#include "TTree.h"
+#include "TTreeFormula.h"
+#include "TH1.h"
+#include "TKey.h"
+#include "TClass.h"
+#include "TDirectory.h"
+#include "TList.h"
+#include "TObject.h"
+#include "TString.h"
+
+#include <unistd.h>
+#include <iostream>
+#include <set>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+static void Usage( const char *prog ){
+  cout << "Usage: " << prog << " [options] -o <merged.root> <job0.root> <job1.root> ..." << endl
+       << "  -o <file>   merged output file (required)" << endl
+       << "  -t <name>   event tree, merged in event order (default T)" << endl
+       << "  -e <expr>   event number of the event tree entries (default fEvtHdr.fEvtNum)" << endl
+       << "  -f          overwrite the output file if it exists" << endl
+       << "  -h          print this message" << endl;
+}
+
+//Merge the event trees of all the jobs in event number order into the current directory:
+static bool MergeEventTrees( const vector<TTree*> &trees, const char *evexpr ){
+  size_t njobs = trees.size();
+
+  //Event numbers of all entries of all the trees. Each tree is already in event order:
+  vector<vector<Double_t> > evnum( njobs );
+  for( size_t ijob=0; ijob<njobs; ijob++ ){
+    TTreeFormula evform( "evnum", evexpr, trees[ijob] );
+    if( evform.GetNdim() == 0 ){
+      cerr << "Cannot evaluate event number \"" << evexpr << "\" for tree " << trees[ijob]->GetName()
+	   << " of job " << ijob << endl;
+      return false;
+    }
+    Long64_t nentries = trees[ijob]->GetEntries();
+    evnum[ijob].resize( nentries );
+    for( Long64_t ientry=0; ientry<nentries; ientry++ ){
+      trees[ijob]->LoadTree( ientry );
+      evform.GetNdata();
+      evnum[ijob][ientry] = evform.EvalInstance();
+    }
+  }
+
+  TTree *merged = trees[0]->CloneTree( 0 );
+
+  //The merged tree shares the branch buffers of the tree it is filled from; switch them when the next entry comes
+  //from another job (once per batch):
+  vector<Long64_t> next( njobs, 0 );
+  size_t current = 0;
+
+  while( true ){
+    size_t ibest = njobs;
+    for( size_t ijob=0; ijob<njobs; ijob++ ){
+      if( next[ijob] >= Long64_t(evnum[ijob].size()) ) continue;
+      if( ibest == njobs || evnum[ijob][next[ijob]] < evnum[ibest][next[ibest]] ) ibest = ijob;
+    }
+    if( ibest == njobs ) break;
+
+    if( ibest != current ){
+      trees[ibest]->CopyAddresses( merged );
+      current = ibest;
+    }
+    trees[ibest]->GetEntry( next[ibest]++ );
+    merged->Fill();
+  }
+
+  merged->Write( "", TObject::kOverwrite );
+
+  cout << "Merged " << merged->GetEntries() << " entries of tree " << merged->GetName()
+       << " from " << njobs << " jobs" << endl;
+
+  //Detach the merged tree from the input buffers before anything is deleted:
+  trees[current]->CopyAddresses( merged, true );
+  delete merged;
+
+  return true;
+}
+
+//Merge the contents of directory "path" of all the input files into the output directory "outdir":
+static bool MergeDirectory( const vector<TFile*> &files, const TString &path, TDirectory *outdir,
+			    const char *treename, const char *evexpr ){
+  TDirectory *indir = path.IsNull() ? files[0] : files[0]->GetDirectory( path );
+  if( !indir ) return false;
+
+  set<string> done; //keys are listed highest cycle first; only use that one
+  bool ok = true;
+
+  TIter nextkey( indir->GetListOfKeys() );
+  TKey *key;
+  while( (key = (TKey*) nextkey()) ){
+    if( !done.insert( key->GetName() ).second ) continue;
+
+    TString objpath = path.IsNull() ? TString(key->GetName()) : path + "/" + key->GetName();
+    TClass *cl = TClass::GetClass( key->GetClassName() );
+    if( !cl ) continue;
+
+    if( cl->InheritsFrom( TDirectory::Class() ) ){
+      TDirectory *subdir = outdir->mkdir( key->GetName(), key->GetTitle() );
+      ok = MergeDirectory( files, objpath, subdir, treename, evexpr ) && ok;
+    } else if( cl->InheritsFrom( TTree::Class() ) ){
+      outdir->cd();
+      if( path.IsNull() && objpath == treename ){
+	vector<TTree*> trees;
+	for( size_t ifile=0; ifile<files.size(); ifile++ ){
+	  TTree *tree = nullptr;
+	  files[ifile]->GetObject( objpath, tree );
+	  if( !tree ){
+	    cerr << "Tree " << objpath << " missing in " << files[ifile]->GetName() << endl;
+	    return false;
+	  }
+	  trees.push_back( tree );
+	}
+	ok = MergeEventTrees( trees, evexpr ) && ok;
+      } else {
+	TTree *tree = (TTree*) key->ReadObj();
+	TTree *copy = tree->CloneTree( -1, "fast" );
+	copy->Write( "", TObject::kOverwrite );
+	delete copy;
+      }
+    } else if( cl->InheritsFrom( TH1::Class() ) ){
+      TH1 *hist = (TH1*) key->ReadObj();
+      for( size_t ifile=1; ifile<files.size(); ifile++ ){
+	TH1 *histjob = nullptr;
+	files[ifile]->GetObject( objpath, histjob );
+	if( histjob ) hist->Add( histjob );
+	delete histjob;
+      }
+      hist->SetDirectory( outdir );
+      outdir->cd();
+      hist->Write( "", TObject::kOverwrite );
+    } else {
+      TObject *obj = key->ReadObj();
+      outdir->cd();
+      obj->Write( key->GetName(), TObject::kOverwrite );
+    }
+  }
+
+  return ok;
+}
+
+int main( int argc, char **argv ){
+  TString outname, treename = "T", evexpr = "fEvtHdr.fEvtNum";
+  const char *outopt = "CREATE";
+
+  int opt;
+  while( (opt = getopt( argc, argv, "o:t:e:fh" )) != -1 ){
+    switch( opt ){
+    case 'o': outname = optarg; break;
+    case 't': treename = optarg; break;
+    case 'e': evexpr = optarg; break;
+    case 'f': outopt = "RECREATE"; break;
+    case 'h': Usage( argv[0] ); return 0;
+    default: Usage( argv[0] ); return 1;
+    }
+  }
+
+  if( outname.IsNull() || optind >= argc ){
+    Usage( argv[0] );
+    return 1;
+  }
+
+  vector<TFile*> files;
+  for( int iarg=optind; iarg<argc; iarg++ ){
+    TFile *file = TFile::Open( argv[iarg], "READ" );
+    if( !file || file->IsZombie() ){
+      cerr << "Cannot open " << argv[iarg] << endl;
+      return 1;
+    }
+    files.push_back( file );
+  }
+
+  TFile *fout = TFile::Open( outname, outopt );
+  if( !fout || fout->IsZombie() ){
+    cerr << "Cannot create " << outname << " (use -f to overwrite)" << endl;
+    return 1;
+  }
+
+  bool ok = MergeDirectory( files, "", fout, treename, evexpr );
+
+  fout->Close();
+  for( auto *file : files ) file->Close();
+
+  return ok ? 0 : 1;
+}
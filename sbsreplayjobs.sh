@@ -0,0 +1,83 @@
+#!/bin/sh
+
+# Event-parallel replay: run N copies of a replay command, each of which
+# analyzes only its own share of the physics events (see SBSAnalyzer.h),
+# then merge the job outputs in event order with sbsmergejobs.
+#
+# The replay script must use SBSAnalyzer. The jobs get their partition from
+# the environment (SBS_REPLAY_WORKER, SBS_REPLAY_NWORKERS,
+# SBS_REPLAY_BATCHSIZE), and each one writes <output>_job<i>.root.
+#
+# Example:
+#   sbsreplayjobs.sh -j 8 -o rootfiles/gmn_replay_13444.root -- \
+#       analyzer -b -q 'replay_gmn.C+(13444,-1)'
+
+usage() {
+    echo "Usage: $0 -j <njobs> [-b <batchsize>] [-o <output.root>] [-l <logdir>] -- <replay command>"
+    echo "  -j  number of replay jobs to run in parallel"
+    echo "  -b  number of consecutive physics events per batch (default 100)"
+    echo "  -o  output file the replay writes in a serial replay; if given, the"
+    echo "      job outputs <output>_job<i>.root are merged into it afterwards"
+    echo "  -l  directory for the job log files (default: current directory)"
+    exit 1
+}
+
+njobs=0
+batchsize=100
+output=""
+logdir="."
+
+while getopts "j:b:o:l:h" opt; do
+    case $opt in
+	j) njobs=$OPTARG ;;
+	b) batchsize=$OPTARG ;;
+	o) output=$OPTARG ;;
+	l) logdir=$OPTARG ;;
+	*) usage ;;
+    esac
+done
+shift `expr $OPTIND - 1`
+
+if [ "$njobs" -lt 1 ] || [ $# -eq 0 ]; then
+    usage
+fi
+
+mkdir -p "$logdir"
+
+pids=""
+i=0
+while [ $i -lt $njobs ]; do
+    SBS_REPLAY_WORKER=$i SBS_REPLAY_NWORKERS=$njobs SBS_REPLAY_BATCHSIZE=$batchsize \
+	"$@" > "$logdir/replay_job$i.log" 2>&1 &
+    pids="$pids $!"
+    i=`expr $i + 1`
+done
+
+echo "Started $njobs replay jobs, logs in $logdir/replay_job<i>.log"
+
+status=0
+i=0
+for pid in $pids; do
+    if ! wait $pid; then
+	echo "Replay job $i failed, see $logdir/replay_job$i.log"
+	status=1
+    fi
+    i=`expr $i + 1`
+done
+
+if [ $status -ne 0 ]; then
+    exit $status
+fi
+
+if [ -n "$output" ]; then
+    base=${output%.root}
+    inputs=""
+    i=0
+    while [ $i -lt $njobs ]; do
+	inputs="$inputs ${base}_job$i.root"
+	i=`expr $i + 1`
+    done
+    sbsmergejobs -f -o "$output" $inputs || exit 1
+fi
+
+exit 0